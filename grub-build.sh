@@ -16,14 +16,32 @@ ISO_DIR="iso"
 # Kernel source files
 KERNEL_SRC=(
     "$SRC_DIR/kernel/kernel.c"
+    "$SRC_DIR/kernel/idt.c"
+    "$SRC_DIR/kernel/timer.c"
+    "$SRC_DIR/kernel/pci.c"
     "$SRC_DIR/kernel/kprint.c"
+    "$SRC_DIR/kernel/mbuf.c"
     "$SRC_DIR/kernel/network.c"
+    "$SRC_DIR/kernel/inet.c"
+    "$SRC_DIR/kernel/tcp.c"
     "$SRC_DIR/kernel/command.c"
     "$SRC_DIR/kernel/disk.c"
+    "$SRC_DIR/kernel/cache.c"
+    "$SRC_DIR/kernel/journal.c"
+    "$SRC_DIR/kernel/crc.c"
+    "$SRC_DIR/kernel/mm.c"
+    "$SRC_DIR/kernel/slab.c"
+    "$SRC_DIR/kernel/paging.c"
+    "$SRC_DIR/kernel/elf.c"
+    "$SRC_DIR/kernel/smp.c"
+    "$SRC_DIR/kernel/keyboard.c"
+    "$SRC_DIR/kernel/serial.c"
     "$SRC_DIR/kernel/file.c"
     "$SRC_DIR/kernel/process.c"
     "$SRC_DIR/kernel/type.c"
     "$SRC_DIR/kernel/table.c"
+    "$SRC_DIR/kernel/dir.c"
+    "$SRC_DIR/kernel/stream.c"
     "$SRC_DIR/kernel/usb.c"
     "$SRC_DIR/kernel/system.c"
 )
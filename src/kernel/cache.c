@@ -0,0 +1,908 @@
+#include "cache.h"
+#include "disk.h"
+#include "kprint.h"
+#include "type.h"
+#include "cpu.h"
+#include "journal.h"
+
+/*=========================*/
+/* 3-1. Write-back Block Cache */
+/*=========================*/
+/*
+ * FS 이미지와 파일 테이블은 메모리에 상주하고, 변경된 섹터만 dirty 로 표시한다.
+ * cache_sync() 는 dirty 섹터만 디스크에 기록하므로 작은 변경이 전체 이미지를
+ * 다시 쓰지 않는다.
+ * 기록은 비동기 디스크 요청으로 제출되며, dirty 비트는 제출 시점에 지운다.
+ * 전송 중에 다시 변경된 섹터는 다시 dirty 가 되어 다음 flush 에 기록된다.
+ * cache_mark_meta() 로 표시된 메타데이터 섹터는 데이터 섹터를 먼저 보낸 뒤
+ * 저널 트랜잭션(journal.c)으로 묶어 기록한다.
+ *
+ * 영역의 섹터는 valid 일 때만 메모리 내용이 유효하다. cache_invalidate() 로
+ * 비운 섹터는 처음 접근할 때 디스크에서 읽고 (요구 읽기), cache_prefetch() 는
+ * 곧 읽을 구간을 여러 섹터짜리 비동기 요청으로 미리 읽는다 (read-ahead).
+ *
+ * 데이터 블록 영역은 풀 영역이다: CACHE_POOL_BLOCKS 개의 슬롯만 두고
+ * (sector -> 슬롯 해시), 자리가 없으면 CLOCK 으로 clean 슬롯을 내보낸다.
+ * dirty, 읽기/쓰기 진행 중인 슬롯은 내보내지 않으며, 전부 그런 상태면
+ * cache_sync() 로 기록한 뒤 다시 찾는다. 연속 섹터가 연속 슬롯에 놓이면
+ * 읽기/쓰기/map 모두 한 구간으로 다룬다.
+ */
+
+cache_stats_t cache_stats;
+readahead_stats_t ra_stats;
+
+static cache_region_t regions[CACHE_MAX_REGIONS];
+static uint32 region_count = 0;
+static uint8 dirty_map[(CACHE_SPAN_SECTORS + 7) / 8];
+static uint32 dirty_count = 0;
+static uint8 meta_map[(CACHE_SPAN_SECTORS + 7) / 8];
+static uint32 meta_count = 0;
+static uint32 ticks_since_flush = 0;
+static uint8 valid_map[(CACHE_SPAN_SECTORS + 7) / 8];    /* 메모리 내용이 유효 */
+static uint8 pending_map[(CACHE_SPAN_SECTORS + 7) / 8];  /* prefetch 읽기 진행 중 */
+static uint8 ahead_map[(CACHE_SPAN_SECTORS + 7) / 8];    /* prefetch 로 읽었고 아직 안 쓰임 */
+static uint8 fresh_map[(CACHE_SPAN_SECTORS + 7) / 8];    /* 새로 할당: 디스크 내용이 필요 없음 */
+
+/* 풀 영역 (하나만 둔다) */
+static cache_region_t *pool_region = 0;
+static uint8 pool_mem[CACHE_POOL_BLOCKS * BLOCK_SIZE];
+static uint32 slot_sector[CACHE_POOL_BLOCKS];   /* CACHE_NO_SECTOR = 빈 슬롯 */
+static int slot_next[CACHE_POOL_BLOCKS];        /* 해시 체인 */
+static uint8 slot_ref[CACHE_POOL_BLOCKS];       /* CLOCK 참조 비트 */
+static int pool_hash[CACHE_POOL_BUCKETS];
+static uint32 pool_used = 0;
+static uint32 clock_hand = 0;
+
+static disk_request_t ra_reqs[CACHE_RA_INFLIGHT];
+
+/* 진행 중인 flush 요청 (부분 섹터는 별도 bounce 버퍼 사용) */
+static disk_request_t flush_reqs[CACHE_MAX_INFLIGHT];
+static uint32 next_flush_req = 0;
+static disk_request_t tail_req;
+static uint8 tail_buf[BLOCK_SIZE];
+static disk_request_t drive_flush_req;
+static uint32 flush_errors = 0;
+
+static cache_region_t *find_region_by_sector(uint32 sector) {
+    uint32 i;
+    for (i = 0; i < region_count; i++) {
+        uint32 count = (regions[i].size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        if (sector >= regions[i].start_sector && sector < regions[i].start_sector + count)
+            return &regions[i];
+    }
+    return 0;
+}
+
+static cache_region_t *find_region_by_ptr(const uint8 *ptr) {
+    uint32 i;
+    for (i = 0; i < region_count; i++) {
+        if (regions[i].base && ptr >= regions[i].base && ptr < regions[i].base + regions[i].size)
+            return &regions[i];
+    }
+    return 0;
+}
+
+/* IRQ 문맥의 완료 콜백도 dirty 맵을 수정하므로 인터럽트를 막고 갱신 */
+static int set_dirty_bit(uint32 sector) {
+    uint32 bit = sector - DISK_FS_START_SECTOR;
+    int changed = 0;
+    if (bit >= CACHE_SPAN_SECTORS) return 0;
+    uint32 flags = irq_save();
+    if (!(dirty_map[bit / 8] & (1 << (bit % 8)))) {
+        dirty_map[bit / 8] |= (uint8)(1 << (bit % 8));
+        dirty_count++;
+        changed = 1;
+    }
+    irq_restore(flags);
+    return changed;
+}
+
+static void set_dirty(uint32 sector) {
+    if (set_dirty_bit(sector)) cache_stats.sectors_dirtied++;
+}
+
+static int is_dirty(uint32 sector) {
+    uint32 bit = sector - DISK_FS_START_SECTOR;
+    if (bit >= CACHE_SPAN_SECTORS) return 0;
+    return (dirty_map[bit / 8] >> (bit % 8)) & 1;
+}
+
+static void clear_dirty(uint32 sector) {
+    uint32 bit = sector - DISK_FS_START_SECTOR;
+    if (bit >= CACHE_SPAN_SECTORS) return;
+    uint32 flags = irq_save();
+    dirty_map[bit / 8] &= (uint8)~(1 << (bit % 8));
+    dirty_count--;
+    if (meta_map[bit / 8] & (1 << (bit % 8))) {
+        meta_map[bit / 8] &= (uint8)~(1 << (bit % 8));
+        meta_count--;
+    }
+    irq_restore(flags);
+}
+
+/* 메타데이터 표시 (dirty 가 지워질 때 같이 지워진다) */
+static void set_meta_bit(uint32 sector) {
+    uint32 bit = sector - DISK_FS_START_SECTOR;
+    if (bit >= CACHE_SPAN_SECTORS) return;
+    uint32 flags = irq_save();
+    if (!(meta_map[bit / 8] & (1 << (bit % 8)))) {
+        meta_map[bit / 8] |= (uint8)(1 << (bit % 8));
+        meta_count++;
+    }
+    irq_restore(flags);
+}
+
+static int is_meta(uint32 sector) {
+    uint32 bit = sector - DISK_FS_START_SECTOR;
+    if (bit >= CACHE_SPAN_SECTORS) return 0;
+    return (meta_map[bit / 8] >> (bit % 8)) & 1;
+}
+
+/* valid / pending / ahead / fresh 비트 (IRQ 완료 콜백과 공유) */
+static int map_test(const uint8 *map, uint32 sector) {
+    uint32 bit = sector - DISK_FS_START_SECTOR;
+    if (bit >= CACHE_SPAN_SECTORS) return 0;
+    return (map[bit / 8] >> (bit % 8)) & 1;
+}
+
+static void map_set(uint8 *map, uint32 sector, int on) {
+    uint32 bit = sector - DISK_FS_START_SECTOR;
+    if (bit >= CACHE_SPAN_SECTORS) return;
+    uint32 flags = irq_save();
+    if (on) map[bit / 8] |= (uint8)(1 << (bit % 8));
+    else map[bit / 8] &= (uint8)~(1 << (bit % 8));
+    irq_restore(flags);
+}
+
+/*=========================*/
+/* 3-3. 데이터 블록 풀 */
+/*=========================*/
+static uint32 pool_bucket(uint32 sector) {
+    return ((sector * 2654435761u) >> 16) % CACHE_POOL_BUCKETS;
+}
+
+static int pool_lookup(uint32 sector) {
+    int s;
+    for (s = pool_hash[pool_bucket(sector)]; s != -1; s = slot_next[s]) {
+        if (slot_sector[s] == sector) return s;
+    }
+    return -1;
+}
+
+static void pool_unhash(int slot) {
+    int *link = &pool_hash[pool_bucket(slot_sector[slot])];
+    while (*link != -1 && *link != slot) link = &slot_next[*link];
+    if (*link == slot) *link = slot_next[slot];
+    slot_sector[slot] = CACHE_NO_SECTOR;
+    pool_used--;
+}
+
+/* 디스크 쓰기가 진행 중인 섹터 (DMA 가 슬롯을 읽고 있으므로 내보내면 안 됨) */
+static int write_in_flight(uint32 sector) {
+    uint32 i;
+    for (i = 0; i < CACHE_MAX_INFLIGHT; i++) {
+        disk_request_t *req = &flush_reqs[i];
+        if (req->status == DISK_REQ_PENDING &&
+            sector >= req->sector && sector < req->sector + req->count) return 1;
+    }
+    return 0;
+}
+
+static int is_dirty(uint32 sector);
+
+/* 슬롯을 비워 sector 를 다시 읽어야 하는 상태로 만든다 */
+static void pool_detach(int slot) {
+    uint32 sector = slot_sector[slot];
+    map_set(valid_map, sector, 0);
+    if (map_test(ahead_map, sector)) {
+        map_set(ahead_map, sector, 0);
+        ra_stats.wasted++;
+    }
+    pool_unhash(slot);
+}
+
+/*
+ * CLOCK: 참조 비트가 꺼진 clean 슬롯을 찾는다. rounds 바퀴 돌아도 없으면 -1.
+ * 방금 붙인 슬롯은 바늘 바로 뒤에 있으므로 한 바퀴 안에서는 맨 나중에 본다.
+ */
+static int pool_victim(uint32 rounds) {
+    uint32 n;
+    for (n = 0; n < rounds * CACHE_POOL_BLOCKS; n++) {
+        int s = (int)clock_hand;
+        clock_hand = (clock_hand + 1) % CACHE_POOL_BLOCKS;
+        uint32 sector = slot_sector[s];
+        if (sector == CACHE_NO_SECTOR) return s;
+        if (slot_ref[s]) { slot_ref[s] = 0; continue; }
+        if (is_dirty(sector) || map_test(pending_map, sector) || write_in_flight(sector)) continue;
+        pool_detach(s);
+        cache_stats.evictions++;
+        return s;
+    }
+    return -1;
+}
+
+static uint32 region_flush(cache_region_t *r);
+
+/*
+ * 풀의 dirty 데이터 슬롯만 제자리에 기록하고 끝나기를 기다린다.
+ * 메타데이터 슬롯은 진행 중인 연산의 트랜잭션에 속하므로 건드리지 않는다
+ * (cache_sync 는 저널을 커밋해 반쯤 끝난 연산을 디스크에 남긴다).
+ */
+static void pool_writeback() {
+    uint32 i;
+    if (!pool_region || region_flush(pool_region) == 0) return;
+    for (i = 0; i < CACHE_MAX_INFLIGHT; i++) {
+        if (flush_reqs[i].status == DISK_REQ_PENDING) disk_wait(&flush_reqs[i]);
+    }
+    if (tail_req.status == DISK_REQ_PENDING) disk_wait(&tail_req);
+}
+
+/*
+ * sector 에 슬롯을 붙이고 주소를 돌려준다 (내용은 아직 채우지 않음).
+ * 한 바퀴 안에 자리가 없으면 may_sync 일 때만 dirty 데이터 슬롯을 기록해 비운 뒤 다시 찾고,
+ * 그래도 없으면 (메타데이터로 가득) 0 을 돌려 호출자가 연산을 끝내게 한다.
+ * prefetch 는 자주 쓰이는 블록을 밀어내지 않도록 한 바퀴에서 포기한다.
+ */
+static uint8 *pool_attach(uint32 sector, int may_sync) {
+    int s = pool_victim(1);
+    if (s < 0 && may_sync) {
+        cache_stats.pool_full++;
+        pool_writeback();
+        s = pool_victim(2);
+    }
+    if (s < 0) return 0;
+    uint32 b = pool_bucket(sector);
+    slot_sector[s] = sector;
+    slot_next[s] = pool_hash[b];
+    pool_hash[b] = s;
+    slot_ref[s] = 1;
+    pool_used++;
+    return pool_mem + (uint32)s * BLOCK_SIZE;
+}
+
+/* 섹터의 메모리 주소. 풀 영역에서 슬롯이 없으면 0 */
+static uint8 *sector_addr(cache_region_t *r, uint32 sector) {
+    if (r->base) return r->base + (sector - r->start_sector) * BLOCK_SIZE;
+    int s = pool_lookup(sector);
+    return s < 0 ? 0 : pool_mem + (uint32)s * BLOCK_SIZE;
+}
+
+/* 호출자에게 돌려주는 주소: CLOCK 참조 비트도 세운다 (flush 등 내부 접근은 제외) */
+static uint8 *sector_use(cache_region_t *r, uint32 sector) {
+    uint8 *p = sector_addr(r, sector);
+    if (p && !r->base) slot_ref[(uint32)(p - pool_mem) / BLOCK_SIZE] = 1;
+    return p;
+}
+
+/* 메모리 주소 -> 섹터 번호 (캐시 밖이면 CACHE_NO_SECTOR) */
+uint32 cache_sector_of(const void *ptr) {
+    const uint8 *p = (const uint8*)ptr;
+    if (p >= pool_mem && p < pool_mem + sizeof(pool_mem))
+        return slot_sector[(uint32)(p - pool_mem) / BLOCK_SIZE];
+    cache_region_t *r = find_region_by_ptr(p);
+    if (!r) return CACHE_NO_SECTOR;
+    return r->start_sector + (uint32)(p - r->base) / BLOCK_SIZE;
+}
+
+void cache_init() {
+    memset(&cache_stats, 0, sizeof(cache_stats));
+    memset(dirty_map, 0, sizeof(dirty_map));
+    memset(meta_map, 0, sizeof(meta_map));
+    memset(valid_map, 0, sizeof(valid_map));
+    memset(pending_map, 0, sizeof(pending_map));
+    memset(ahead_map, 0, sizeof(ahead_map));
+    memset(fresh_map, 0, sizeof(fresh_map));
+    memset(ra_reqs, 0, sizeof(ra_reqs));
+    memset(pool_hash, 0xFF, sizeof(pool_hash));
+    for (uint32 s = 0; s < CACHE_POOL_BLOCKS; s++) slot_sector[s] = CACHE_NO_SECTOR;
+    pool_region = 0;
+    pool_used = 0;
+    clock_hand = 0;
+    memset(&ra_stats, 0, sizeof(ra_stats));
+    meta_count = 0;
+    memset(flush_reqs, 0, sizeof(flush_reqs));
+    memset(&tail_req, 0, sizeof(tail_req));
+    memset(&drive_flush_req, 0, sizeof(drive_flush_req));
+    region_count = 0;
+    dirty_count = 0;
+    ticks_since_flush = 0;
+    next_flush_req = 0;
+    flush_errors = 0;
+}
+
+/*
+ * 메모리 영역을 디스크 섹터 범위에 연결한다. 이미 등록된 경우 그대로 둔다.
+ * 새 영역은 메모리 내용이 기준이므로 전부 valid 로 시작한다.
+ */
+int cache_register(uint32 start_sector, void *base, uint32 size) {
+    uint32 count = (size + BLOCK_SIZE - 1) / BLOCK_SIZE, i;
+    if (find_region_by_sector(start_sector)) return 0;
+    if (region_count >= CACHE_MAX_REGIONS) return -1;
+    if (start_sector < DISK_FS_START_SECTOR ||
+        start_sector + count > DISK_FS_START_SECTOR + CACHE_SPAN_SECTORS) return -1;
+    regions[region_count].start_sector = start_sector;
+    regions[region_count].base = (uint8*)base;
+    regions[region_count].size = size;
+    region_count++;
+    for (i = 0; i < count; i++) map_set(valid_map, start_sector + i, 1);
+    return 0;
+}
+
+/* 데이터 블록처럼 디스크에만 있고 필요할 때 풀 슬롯으로 올라오는 영역 */
+int cache_register_pool(uint32 start_sector, uint32 count) {
+    if (find_region_by_sector(start_sector)) return 0;
+    if (pool_region || region_count >= CACHE_MAX_REGIONS) return -1;
+    if (start_sector < DISK_FS_START_SECTOR ||
+        start_sector + count > DISK_FS_START_SECTOR + CACHE_SPAN_SECTORS) return -1;
+    regions[region_count].start_sector = start_sector;
+    regions[region_count].base = 0;
+    regions[region_count].size = count * BLOCK_SIZE;
+    pool_region = &regions[region_count];
+    region_count++;
+    return 0;
+}
+
+/*
+ * 영역 전체를 디스크에서 다시 읽어야 하는 상태로 돌린다 (dirty 섹터는 제외).
+ * 풀 영역은 clean 슬롯을 모두 비운다.
+ */
+int cache_invalidate(uint32 start_sector) {
+    cache_region_t *r = find_region_by_sector(start_sector);
+    if (!r) return -1;
+    uint32 count = (r->size + BLOCK_SIZE - 1) / BLOCK_SIZE, i;
+    for (i = 0; i < count; i++) {
+        uint32 sector = r->start_sector + i;
+        if (is_dirty(sector)) continue;
+        map_set(fresh_map, sector, 0);
+        if (r->base) { map_set(valid_map, sector, 0); continue; }
+        int s = pool_lookup(sector);
+        if (s >= 0 && !map_test(pending_map, sector) && !write_in_flight(sector)) pool_detach(s);
+    }
+    return 0;
+}
+
+/* 마지막 섹터가 부분 섹터일 때는 임시 버퍼를 거쳐 영역 밖을 건드리지 않는다. */
+static int region_read_sector(cache_region_t *r, uint32 i) {
+    uint32 offset = i * BLOCK_SIZE;
+    if (offset + BLOCK_SIZE <= r->size)
+        return disk_read(r->start_sector + i, r->base + offset, 1);
+    uint8 tmp[BLOCK_SIZE];
+    if (disk_read(r->start_sector + i, tmp, 1) != 0) return -1;
+    memcpy(r->base + offset, tmp, r->size - offset);
+    return 0;
+}
+
+int cache_load(uint32 start_sector) {
+    cache_region_t *r = find_region_by_sector(start_sector);
+    if (!r || !r->base) return -1;
+    uint32 count = (r->size + BLOCK_SIZE - 1) / BLOCK_SIZE, i;
+    uint32 full = r->size / BLOCK_SIZE;
+    /* 완전한 섹터는 한 번의 요청으로 읽고, 부분 섹터만 따로 읽는다 */
+    if (full > 0 && disk_read(r->start_sector, r->base, full) != 0) return -1;
+    if (full < count && region_read_sector(r, full) != 0) return -1;
+    for (i = 0; i < count; i++) {
+        if (is_dirty(r->start_sector + i)) clear_dirty(r->start_sector + i);
+        map_set(valid_map, r->start_sector + i, 1);
+    }
+    cache_stats.misses += count;
+    return 0;
+}
+
+/* sector 를 덮는 진행 중 prefetch 요청 */
+static disk_request_t *ra_req_find(uint32 sector) {
+    uint32 i;
+    for (i = 0; i < CACHE_RA_INFLIGHT; i++) {
+        disk_request_t *req = &ra_reqs[i];
+        if (req->status == DISK_REQ_PENDING &&
+            sector >= req->sector && sector < req->sector + req->count) return req;
+    }
+    return 0;
+}
+
+/* 진행 중인 prefetch 가 있으면 끝날 때까지 기다린다 */
+static void ra_wait(uint32 sector) {
+    disk_request_t *req;
+    if (!map_test(pending_map, sector)) return;
+    req = ra_req_find(sector);
+    if (req) {
+        ra_stats.waits++;
+        disk_wait(req);
+    }
+}
+
+/* 섹터를 처음 쓸 때: prefetch 로 읽어 둔 것이면 적중으로 센다 */
+static void ra_touch(uint32 sector) {
+    if (!map_test(ahead_map, sector)) return;
+    map_set(ahead_map, sector, 0);
+    ra_stats.hits++;
+}
+
+/* 읽기가 끝난 구간: 성공이면 valid, 실패면 (풀 영역은 슬롯을 반납하고) 비운 채로 둔다 */
+static void read_done(uint32 sector, uint32 count, int ok, int ahead) {
+    uint32 k;
+    for (k = 0; k < count; k++) {
+        if (ok) {
+            map_set(valid_map, sector + k, 1);
+            if (ahead) map_set(ahead_map, sector + k, 1);
+        } else if (pool_region && sector + k >= pool_region->start_sector &&
+                   sector + k < pool_region->start_sector + pool_region->size / BLOCK_SIZE) {
+            int s = pool_lookup(sector + k);
+            if (s >= 0) pool_unhash(s);
+        }
+        map_set(pending_map, sector + k, 0);
+    }
+}
+
+/*
+ * [sector, sector + run) (valid 도 pending 도 아닌 구간) 에 메모리를 붙인다.
+ * 새로 할당된 섹터는 0 으로 채워 바로 valid 가 되고, 나머지는 pending 으로 표시한 뒤
+ * 메모리상 연속인 조각마다 emit(시작 섹터, 주소, 개수) 를 부른다.
+ * 풀 슬롯을 얻지 못하면 거기서 멈추고 처리한 섹터 수를 돌려준다.
+ */
+typedef int (*read_emit_t)(uint32 sector, uint8 *buffer, uint32 count);
+
+static uint32 attach_run(cache_region_t *r, uint32 sector, uint32 run, int may_sync, read_emit_t emit) {
+    uint32 k, io_start = 0, io_count = 0;
+    uint8 *io_buf = 0;
+    for (k = 0; k <= run; k++) {
+        uint8 *p = 0;
+        int stop = 0;
+        if (k < run) {
+            p = r->base ? r->base + (sector + k - r->start_sector) * BLOCK_SIZE
+                        : pool_attach(sector + k, may_sync);
+            if (!p) {
+                stop = 1;
+            } else if (map_test(fresh_map, sector + k)) {
+                if (!r->base) memset(p, 0, BLOCK_SIZE);
+                map_set(fresh_map, sector + k, 0);
+                map_set(valid_map, sector + k, 1);
+                p = 0;
+            } else {
+                map_set(pending_map, sector + k, 1);
+            }
+        }
+        /* 메모리상 이어지지 않으면 모아 둔 조각을 내보낸다 */
+        if (io_count > 0 && (!p || p != io_buf + io_count * BLOCK_SIZE)) {
+            if (emit(io_start, io_buf, io_count) != 0) {
+                read_done(io_start, io_count, 0, 0);
+                if (p) read_done(sector + k, 1, 0, 0);
+                return k - io_count;
+            }
+            io_count = 0;
+        }
+        if (stop) return k;
+        if (p) {
+            if (io_count == 0) { io_start = sector + k; io_buf = p; }
+            io_count++;
+        }
+    }
+    return run;
+}
+
+static int emit_sync(uint32 sector, uint8 *buffer, uint32 count) {
+    int ok = disk_read(sector, buffer, count) == 0;
+    read_done(sector, count, ok, 0);
+    cache_stats.misses += count;
+    ra_stats.demand += count;
+    return ok ? 0 : -1;
+}
+
+/*
+ * sector 부터 최대 max 섹터가 valid 가 되도록 한다.
+ * 진행 중인 prefetch 는 기다리고, 나머지 빈 구간은 연속 조각마다 한 번의 요청으로 동기 읽기.
+ */
+static int fault_range(cache_region_t *r, uint32 sector, uint32 max) {
+    uint32 full = r->start_sector + r->size / BLOCK_SIZE;
+    uint32 end = sector + max, run;
+    while (sector < end) {
+        ra_wait(sector);
+        if (map_test(valid_map, sector)) {
+            ra_touch(sector);
+            sector++;
+            continue;
+        }
+        if (sector >= full) {
+            /* 상주 영역의 부분 섹터는 bounce 버퍼로 */
+            if (region_read_sector(r, sector - r->start_sector) != 0) return -1;
+            map_set(valid_map, sector, 1);
+            cache_stats.misses++;
+            ra_stats.demand++;
+            sector++;
+            continue;
+        }
+        run = 1;
+        while (sector + run < end && sector + run < full &&
+               !map_test(valid_map, sector + run) && !map_test(pending_map, sector + run)) run++;
+        if (attach_run(r, sector, run, 1, emit_sync) != run) return -1;
+        sector += run;
+    }
+    return 0;
+}
+
+/* [sector, sector + count) 를 지금 읽어 둔다 (마운트 시 메타데이터 등) */
+int cache_fault(uint32 sector, uint32 count) {
+    cache_region_t *r = find_region_by_sector(sector);
+    if (!r || find_region_by_sector(sector + count - 1) != r) return -1;
+    return fault_range(r, sector, count);
+}
+
+/*
+ * 섹터에 해당하는 메모리 주소. 아직 읽지 않은 섹터면 먼저 읽는다.
+ * 상주 영역은 읽기에 실패해도 주소를 돌려주므로 (내용은 이전 값) 오류 수로 확인한다.
+ * 풀 영역은 슬롯을 얻지 못하거나 읽기에 실패하면 0.
+ */
+void *cache_get(uint32 sector) {
+    cache_region_t *r = find_region_by_sector(sector);
+    if (!r) return 0;
+    if (map_test(valid_map, sector)) {
+        cache_stats.hits++;
+        ra_touch(sector);
+    } else if (fault_range(r, sector, 1) != 0) {
+        cache_stats.read_errors++;
+    }
+    return sector_use(r, sector);
+}
+
+/*
+ * sector 부터 최대 max 섹터의 연속 구간. 첫 섹터가 비어 있으면 RA_MIN_BLOCKS 까지
+ * 묶어서 읽고, *count 에는 지금 바로 쓸 수 있는 (valid) 연속 섹터 수를 돌려준다.
+ */
+void *cache_get_run(uint32 sector, uint32 max, uint32 *count) {
+    cache_region_t *r = find_region_by_sector(sector);
+    uint32 n, limit;
+    uint8 *base;
+    *count = 0;
+    if (!r || max == 0) return 0;
+    limit = r->start_sector + (r->size + BLOCK_SIZE - 1) / BLOCK_SIZE - sector;
+    if (max > limit) max = limit;
+    if (max > CACHE_RUN_MAX) max = CACHE_RUN_MAX;
+    if (map_test(valid_map, sector)) {
+        cache_stats.hits++;
+    } else if (fault_range(r, sector, max < RA_MIN_BLOCKS ? max : RA_MIN_BLOCKS) != 0) {
+        cache_stats.read_errors++;
+        if (!map_test(valid_map, sector)) return r->base ? (*count = 1, sector_addr(r, sector)) : 0;
+    }
+    base = sector_use(r, sector);
+    if (!base) return 0;
+    /* 이미 올라와 있고 메모리에서도 이어지는 섹터까지 */
+    for (n = 0; n < max && map_test(valid_map, sector + n) &&
+                sector_use(r, sector + n) == base + n * BLOCK_SIZE; n++) ra_touch(sector + n);
+    *count = n;
+    return base;
+}
+
+/*
+ * 디스크 내용과 상관없이 곧 덮어쓸 섹터 (새로 할당한 블록).
+ * 풀 영역에서 아직 슬롯이 없으면 처음 접근할 때 읽지 않고 0 으로 채운 슬롯을 준다.
+ */
+void cache_set_valid(uint32 sector, uint32 count) {
+    cache_region_t *r = find_region_by_sector(sector);
+    uint32 i;
+    if (!r) return;
+    for (i = 0; i < count; i++) {
+        ra_wait(sector + i);
+        if (map_test(ahead_map, sector + i)) {
+            map_set(ahead_map, sector + i, 0);
+            ra_stats.wasted++;
+        }
+        if (r->base || map_test(valid_map, sector + i)) map_set(valid_map, sector + i, 1);
+        else map_set(fresh_map, sector + i, 1);
+    }
+}
+
+/* IRQ 문맥: 읽은 섹터를 valid 로 표시. 실패하면 나중에 요구 읽기로 다시 읽는다 */
+static void ra_complete(disk_request_t *req) {
+    read_done(req->sector, req->count, req->status == DISK_REQ_DONE, 1);
+    if (req->status != DISK_REQ_DONE) ra_stats.errors++;
+}
+
+static disk_request_t *ra_req_alloc() {
+    uint32 i;
+    for (i = 0; i < CACHE_RA_INFLIGHT; i++) {
+        if (ra_reqs[i].status != DISK_REQ_PENDING) return &ra_reqs[i];
+    }
+    return 0;
+}
+
+static int emit_async(uint32 sector, uint8 *buffer, uint32 count) {
+    disk_request_t *req = ra_req_alloc();
+    if (!req) return -1;
+    req->op = DISK_OP_READ;
+    req->sector = sector;
+    req->buffer = buffer;
+    req->count = count;
+    req->complete = ra_complete;
+    req->ctx = 0;
+    ra_stats.requests++;
+    ra_stats.sectors += count;
+    cache_stats.misses += count;
+    disk_submit(req);
+    return 0;
+}
+
+/*
+ * [sector, sector + count) 중 아직 없는 연속 구간을 비동기 읽기로 제출하고 바로 반환.
+ * 요청 슬롯이나 풀 슬롯이 모자라면 남은 구간은 건너뛴다 (prefetch 는 힌트일 뿐이라
+ * dirty 블록을 기록하면서까지 자리를 만들지 않는다). 처리한 섹터 수를 돌려준다.
+ */
+uint32 cache_prefetch(uint32 sector, uint32 count) {
+    cache_region_t *r = find_region_by_sector(sector);
+    uint32 end, full, run, done, submitted = 0;
+    if (!r) return 0;
+    full = r->start_sector + r->size / BLOCK_SIZE;
+    end = sector + count < full ? sector + count : full;
+    while (sector < end) {
+        if (map_test(valid_map, sector) || map_test(pending_map, sector)) { sector++; continue; }
+        run = 1;
+        while (sector + run < end && run < RA_MAX_BLOCKS &&
+               !map_test(valid_map, sector + run) && !map_test(pending_map, sector + run)) run++;
+        done = attach_run(r, sector, run, 0, emit_async);
+        submitted += done;
+        if (done < run) break;
+        sector += run;
+    }
+    return submitted;
+}
+
+/* 풀 슬롯은 섹터가 흩어져 있을 수 있으므로 섹터(슬롯) 단위로 따라간다 */
+static void mark_range(const uint8 *p, uint32 len, int meta) {
+    while (len > 0) {
+        uint32 sector = cache_sector_of(p);
+        if (sector == CACHE_NO_SECTOR) return;
+        uint32 chunk = BLOCK_SIZE - ((uint32)p - (uint32)pool_mem) % BLOCK_SIZE;
+        cache_region_t *r = find_region_by_ptr(p);
+        if (r) chunk = BLOCK_SIZE - (uint32)(p - r->base) % BLOCK_SIZE;
+        if (chunk > len) chunk = len;
+        set_dirty(sector);
+        if (meta) set_meta_bit(sector);
+        p += chunk;
+        len -= chunk;
+    }
+}
+
+void cache_mark_dirty(const void *ptr, uint32 len) {
+    mark_range((const uint8*)ptr, len, 0);
+}
+
+void cache_mark_meta(const void *ptr, uint32 len) {
+    mark_range((const uint8*)ptr, len, 1);
+}
+
+/*
+ * 저널 기록 실패 시 (IRQ 문맥) 다음 트랜잭션에서 다시 기록.
+ * 그 사이 풀에서 밀려난 섹터는 내용이 없으므로 다시 표시할 수 없다.
+ */
+void cache_redirty_meta(uint32 sector) {
+    if (!map_test(valid_map, sector)) { flush_errors++; return; }
+    set_dirty_bit(sector);
+    set_meta_bit(sector);
+}
+
+/* 읽지 않은 (valid 가 아닌) 섹터는 디스크 내용이 맞으므로 건너뛴다 */
+void cache_mark_region_dirty(uint32 start_sector) {
+    cache_region_t *r = find_region_by_sector(start_sector);
+    if (!r || !r->base) return;
+    uint32 count = (r->size + BLOCK_SIZE - 1) / BLOCK_SIZE, i;
+    for (i = 0; i < count; i++) {
+        if (map_test(valid_map, r->start_sector + i)) set_dirty(r->start_sector + i);
+    }
+}
+
+uint32 cache_dirty_count() {
+    return dirty_count;
+}
+
+/* IRQ 문맥: 실패한 범위는 다시 dirty 로 표시해 다음 flush 에서 재시도 */
+static void flush_complete(disk_request_t *req) {
+    uint32 i;
+    if (req->status == DISK_REQ_DONE) {
+        cache_stats.sectors_written += req->count;
+        return;
+    }
+    flush_errors++;
+    for (i = 0; i < req->count; i++) set_dirty_bit(req->sector + i);
+}
+
+/* 재사용할 요청 슬롯. 모두 사용 중이면 가장 오래된 요청을 기다린다 */
+static disk_request_t *flush_req_alloc() {
+    disk_request_t *req = &flush_reqs[next_flush_req];
+    next_flush_req = (next_flush_req + 1) % CACHE_MAX_INFLIGHT;
+    if (req->status == DISK_REQ_PENDING) disk_wait(req);
+    return req;
+}
+
+static void flush_submit(disk_request_t *req, uint32 sector, uint8 *buffer, uint32 count) {
+    uint32 k;
+    for (k = 0; k < count; k++) clear_dirty(sector + k);
+    req->op = DISK_OP_WRITE;
+    req->sector = sector;
+    req->buffer = buffer;
+    req->count = count;
+    req->complete = flush_complete;
+    req->ctx = 0;
+    disk_submit(req);
+}
+
+/* 제자리에 바로 기록할 섹터 (저널이 켜져 있으면 메타데이터는 제외) */
+static int is_data_dirty(uint32 sector) {
+    return is_dirty(sector) && !(journal_enabled() && is_meta(sector));
+}
+
+/* 연속된 dirty 데이터 섹터를 하나의 쓰기 요청으로 묶어 제출 */
+static uint32 region_flush(cache_region_t *r) {
+    uint32 count = (r->size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32 full = r->size / BLOCK_SIZE;
+    uint32 i = 0, submitted = 0;
+    while (i < full) {
+        if (!is_data_dirty(r->start_sector + i)) { i++; continue; }
+        uint8 *base = sector_addr(r, r->start_sector + i);
+        uint32 run = 1;
+        while (i + run < full && is_data_dirty(r->start_sector + i + run) &&
+               sector_addr(r, r->start_sector + i + run) == base + run * BLOCK_SIZE) run++;
+        flush_submit(flush_req_alloc(), r->start_sector + i, base, run);
+        submitted += run;
+        i += run;
+    }
+    if (full < count && is_data_dirty(r->start_sector + full)) {
+        /* 마지막 부분 섹터는 bounce 버퍼로 복사해 영역 밖을 읽지 않는다 */
+        if (tail_req.status == DISK_REQ_PENDING) disk_wait(&tail_req);
+        memset(tail_buf, 0, BLOCK_SIZE);
+        memcpy(tail_buf, r->base + full * BLOCK_SIZE, r->size - full * BLOCK_SIZE);
+        flush_submit(&tail_req, r->start_sector + full, tail_buf, 1);
+        submitted++;
+    }
+    return submitted;
+}
+
+/*
+ * 메타데이터 섹터를 섹터 번호 순으로 저널 트랜잭션에 담는다.
+ * 저널 한 번에 다 들어가지 않으면 여러 트랜잭션으로 나눈다.
+ */
+static uint32 journal_flush() {
+    uint32 i, k, submitted = 0;
+    journal_begin();
+    for (i = 0; i < region_count && meta_count > 0; i++) {
+        cache_region_t *r = &regions[i];
+        uint32 count = (r->size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        for (k = 0; k < count; k++) {
+            uint32 sector = r->start_sector + k;
+            if (!is_dirty(sector) || !is_meta(sector)) continue;
+            if (journal_staged() == JOURNAL_MAX_SECTORS) {
+                journal_commit();
+                journal_begin();
+            }
+            uint32 len = (k + 1) * BLOCK_SIZE <= r->size ? BLOCK_SIZE : r->size - k * BLOCK_SIZE;
+            journal_add(sector, sector_addr(r, sector), len);
+            clear_dirty(sector);
+            submitted++;
+        }
+    }
+    journal_commit();
+    return submitted;
+}
+
+/* dirty 섹터 기록 요청을 제출하고 바로 반환 (완료는 IRQ 에서 처리) */
+void cache_sync_async() {
+    uint32 i, submitted = 0;
+    for (i = 0; i < region_count && dirty_count > 0; i++)
+        submitted += region_flush(&regions[i]);
+    /* 저널 커밋은 맨 앞에 FLUSH 를 넣으므로 위 데이터 섹터가 먼저 매체에 내려간다 */
+    if (journal_enabled() && meta_count > 0) {
+        submitted += journal_flush();
+    } else if (submitted > 0) {
+        if (drive_flush_req.status == DISK_REQ_PENDING) disk_wait(&drive_flush_req);
+        drive_flush_req.op = DISK_OP_FLUSH;
+        drive_flush_req.sector = 0;
+        drive_flush_req.count = 0;
+        drive_flush_req.buffer = 0;
+        drive_flush_req.complete = 0;
+        disk_submit(&drive_flush_req);
+    }
+    if (submitted > 0) {
+        cache_stats.flushes++;
+        cache_stats.last_flush_sectors = submitted;
+    }
+    ticks_since_flush = 0;
+}
+
+/* 모든 dirty 섹터가 디스크에 기록될 때까지 대기 */
+int cache_sync() {
+    uint32 i, errors = flush_errors;
+    cache_sync_async();
+    for (i = 0; i < CACHE_MAX_INFLIGHT; i++) {
+        if (flush_reqs[i].status == DISK_REQ_PENDING) disk_wait(&flush_reqs[i]);
+    }
+    if (tail_req.status == DISK_REQ_PENDING) disk_wait(&tail_req);
+    if (drive_flush_req.status == DISK_REQ_PENDING) disk_wait(&drive_flush_req);
+    if (journal_enabled() && journal_wait() != 0) return -1;
+    if (drive_flush_req.status == DISK_REQ_ERROR) return -1;
+    return (flush_errors == errors && meta_count == 0) ? 0 : -1;
+}
+
+/*
+ * 파일 연산 하나가 끝날 때마다 호출: 다음 연산의 메타데이터까지 담을 자리가
+ * 저널에 없으면 지금 커밋해 한 연산이 두 트랜잭션으로 나뉘지 않게 한다.
+ */
+void cache_op_end() {
+    if (journal_enabled() && meta_count + JOURNAL_OP_RESERVE > JOURNAL_MAX_SECTORS)
+        cache_sync_async();
+}
+
+/* kmain 루프에서 호출: 일정 주기마다 dirty 섹터를 기록 */
+void cache_tick() {
+    ticks_since_flush++;
+    if (dirty_count > 0 && ticks_since_flush >= CACHE_FLUSH_INTERVAL)
+        cache_sync_async();
+}
+
+void cache_stat_cmd() {
+    kprint("Block cache statistics:\n");
+    kprint("  Hits: "); kprint_dec(cache_stats.hits);
+    kprint("\n  Misses: "); kprint_dec(cache_stats.misses);
+    kprint("\n  Read errors: "); kprint_dec(cache_stats.read_errors);
+    kprint("\n  Data pool: "); kprint_dec(pool_used);
+    kprint("/"); kprint_dec(CACHE_POOL_BLOCKS);
+    kprint(" blocks, evictions: "); kprint_dec(cache_stats.evictions);
+    kprint(", forced syncs: "); kprint_dec(cache_stats.pool_full);
+    kprint("\n  Dirty sectors: "); kprint_dec(dirty_count);
+    kprint("\n  Sectors dirtied: "); kprint_dec(cache_stats.sectors_dirtied);
+    kprint("\n  Sectors written: "); kprint_dec(cache_stats.sectors_written);
+    kprint("\n  Flushes: "); kprint_dec(cache_stats.flushes);
+    kprint("\n  Last flush: "); kprint_dec(cache_stats.last_flush_sectors);
+    kprint(" sectors\n");
+    kprint("  Journal commits: "); kprint_dec(journal_stats.commits);
+    kprint(", sectors: "); kprint_dec(journal_stats.sectors);
+    kprint(", last: "); kprint_dec(journal_stats.last_commit_sectors);
+    kprint(", replayed: "); kprint_dec(journal_stats.replayed_sectors);
+    kprint(", errors: "); kprint_dec(journal_stats.errors);
+    kprint("\n");
+    kprint("  Disk commands: "); kprint_dec(disk_stats.commands);
+    kprint(" (multiple mode: "); kprint_dec(disk_multiple_sectors());
+    kprint(" sectors/DRQ)\n");
+    kprint("  Disk requests: "); kprint_dec(disk_stats.requests);
+    kprint(", IRQs: "); kprint_dec(disk_stats.irqs);
+    kprint(", max queue depth: "); kprint_dec(disk_stats.max_queue_depth);
+    kprint(", errors: "); kprint_dec(disk_stats.errors);
+    kprint(", DMA sectors: "); kprint_dec(disk_stats.dma_sectors);
+    kprint("\n");
+    if (cache_stats.sectors_dirtied > 0) {
+        /* 기록된 섹터 / 변경된 섹터 (x100) */
+        uint32 amp = cache_stats.sectors_written * 100 / cache_stats.sectors_dirtied;
+        kprint("  Write amplification: "); kprint_dec(amp / 100); kprint(".");
+        if (amp % 100 < 10) kprint("0");
+        kprint_dec(amp % 100); kprint("x\n");
+    }
+}
+
+void readahead_stat_cmd(int reset) {
+    if (reset) {
+        memset(&ra_stats, 0, sizeof(ra_stats));
+        kprint("Read-ahead statistics reset.\n");
+        return;
+    }
+    kprint("Read-ahead statistics:\n");
+    kprint("  Requests: "); kprint_dec(ra_stats.requests);
+    kprint(", sectors: "); kprint_dec(ra_stats.sectors);
+    kprint(", in flight: ");
+    uint32 i, inflight = 0;
+    for (i = 0; i < CACHE_RA_INFLIGHT; i++) {
+        if (ra_reqs[i].status == DISK_REQ_PENDING) inflight++;
+    }
+    kprint_dec(inflight);
+    kprint("\n  Prefetched sectors used: "); kprint_dec(ra_stats.hits);
+    kprint(" (waited: "); kprint_dec(ra_stats.waits);
+    kprint("), overwritten unused: "); kprint_dec(ra_stats.wasted);
+    kprint("\n  Demand-read sectors: "); kprint_dec(ra_stats.demand);
+    kprint("\n  Sequential reads: "); kprint_dec(ra_stats.sequential);
+    kprint(", random: "); kprint_dec(ra_stats.random);
+    kprint(", max window: "); kprint_dec(ra_stats.window_max);
+    kprint(" blocks\n");
+    kprint("  Errors: "); kprint_dec(ra_stats.errors);
+    kprint("\n");
+    if (ra_stats.hits + ra_stats.demand > 0) {
+        /* 첫 접근 섹터 중 prefetch 로 이미 준비된 비율 */
+        kprint("  Hit rate: ");
+        kprint_dec(ra_stats.hits * 100 / (ra_stats.hits + ra_stats.demand));
+        kprint("%\n");
+    }
+}
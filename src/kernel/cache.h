@@ -0,0 +1,68 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "dc.h"
+
+/*
+ * 캐시가 관리하는 디스크 영역.
+ *  - 상주 영역: 메모리 base 에 섹터가 그대로 놓인다 (메타데이터, 파일 테이블 등)
+ *  - 풀 영역: 섹터가 필요할 때 고정 크기 블록 풀의 슬롯에 올라온다 (데이터 블록)
+ */
+typedef struct {
+    uint32 start_sector;
+    uint32 size;          /* 바이트 단위 크기 (마지막 섹터는 부분일 수 있음) */
+    uint8 *base;          /* 풀 영역이면 0 */
+} cache_region_t;
+
+typedef struct {
+    uint32 hits;             /* 메모리에서 바로 제공된 블록 접근 */
+    uint32 misses;           /* 디스크에서 읽어 온 섹터 */
+    uint32 sectors_dirtied;  /* clean -> dirty 로 바뀐 섹터 (논리적 변경량) */
+    uint32 sectors_written;  /* 실제로 디스크에 기록된 섹터 */
+    uint32 flushes;
+    uint32 last_flush_sectors;
+    uint32 read_errors;      /* 요구 읽기 실패 */
+    uint32 evictions;        /* 풀에서 밀려난 블록 */
+    uint32 pool_full;        /* 빈 슬롯이 없어 sync 후 다시 찾은 횟수 */
+} cache_stats_t;
+
+typedef struct {
+    uint32 requests;         /* 제출한 prefetch 요청 */
+    uint32 sectors;          /* prefetch 로 읽은 섹터 */
+    uint32 hits;             /* prefetch 된 섹터가 실제로 쓰인 수 */
+    uint32 waits;            /* 진행 중인 prefetch 를 기다린 횟수 */
+    uint32 demand;           /* 미리 읽지 못해 동기로 읽은 섹터 */
+    uint32 wasted;           /* 쓰이기 전에 새 할당으로 덮인 prefetch 섹터 */
+    uint32 errors;
+    uint32 sequential;       /* 순차로 판정된 읽기 (stream.c) */
+    uint32 random;
+    uint32 window_max;       /* 지금까지의 최대 창 (블록) */
+} readahead_stats_t;
+
+extern cache_stats_t cache_stats;
+extern readahead_stats_t ra_stats;
+
+void cache_init();
+int cache_register(uint32 start_sector, void *base, uint32 size);
+int cache_register_pool(uint32 start_sector, uint32 count);
+int cache_load(uint32 start_sector);
+int cache_invalidate(uint32 start_sector);
+int cache_fault(uint32 sector, uint32 count);
+void *cache_get(uint32 sector);
+void *cache_get_run(uint32 sector, uint32 max, uint32 *count);
+void cache_set_valid(uint32 sector, uint32 count);
+uint32 cache_sector_of(const void *ptr);
+uint32 cache_prefetch(uint32 sector, uint32 count);
+void cache_mark_dirty(const void *ptr, uint32 len);
+void cache_mark_meta(const void *ptr, uint32 len);
+void cache_redirty_meta(uint32 sector);
+void cache_mark_region_dirty(uint32 start_sector);
+uint32 cache_dirty_count();
+int cache_sync();
+void cache_sync_async();
+void cache_op_end();
+void cache_tick();
+void cache_stat_cmd();
+void readahead_stat_cmd(int reset);
+
+#endif //CACHE_H
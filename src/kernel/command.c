@@ -6,7 +6,21 @@
 #include "usb.h"
 #include "process.h"
 #include "network.h"
+#include "inet.h"
+#include "tcp.h"
 #include "system.h"
+#include "cache.h"
+#include "disk.h"
+#include "pci.h"
+#include "dir.h"
+#include "stream.h"
+#include "crc.h"
+#include "mm.h"
+#include "slab.h"
+#include "paging.h"
+#include "elf.h"
+#include "smp.h"
+#include "serial.h"
 
 /*=========================*/
 /* 12. CLI Command Processing */
@@ -19,7 +33,11 @@ void process_command(const char *cmd) {
     if (strcmp(tokens[0], "help") == 0) {
         kprint("Commands:\n");
         kprint("  help               - Show help\n");
-        kprint("  ls [-l]            - List files\n");
+        kprint("  ls [-l] [dir]      - List files\n");
+        kprint("  cd [dir]           - Change the current directory\n");
+        kprint("  pwd                - Print the current directory\n");
+        kprint("  mkdir <dir>        - Create a directory\n");
+        kprint("  rmdir <dir>        - Remove an empty directory\n");
         kprint("  cat <file>         - Display file contents\n");
         kprint("  write <file> <msg> - Create/update a file\n");
         kprint("  cp <src> <dst>     - Copy a file\n");
@@ -31,6 +49,22 @@ void process_command(const char *cmd) {
         kprint("  touch <file>       - Create an empty file\n");
         kprint("  append <file> <msg>- Append content to a file\n");
         kprint("  df                 - Show available disk blocks\n");
+        kprint("  sync               - Flush dirty blocks to disk\n");
+        kprint("  cachestat          - Show block cache statistics\n");
+        kprint("  rastat [reset]     - Show read-ahead statistics\n");
+        kprint("  diskmode [pio|dma] - Show/select disk transfer mode\n");
+        kprint("  diskbench          - Compare PIO and DMA read throughput\n");
+        kprint("  pci                - List PCI devices\n");
+        kprint("  fsstress [n]       - Create/lookup/delete n files, report ops/sec\n");
+        kprint("  pathstat [reset]   - Show path resolution / dentry cache statistics\n");
+        kprint("  scrub              - Verify checksums of every file\n");
+        kprint("  verify [on|off]    - Show/toggle checksum verification on read\n");
+        kprint("  hashbench          - Compare djb2 and CRC32C throughput\n");
+        kprint("  meminfo            - Show physical memory and buddy fragmentation\n");
+        kprint("  slabinfo           - Show slab caches and kmalloc usage\n");
+        kprint("  membench           - Benchmark page/slab/kmalloc alloc and free\n");
+        kprint("  vminfo             - Show paging and address space statistics\n");
+        kprint("  vmbench            - Benchmark address space setup and CR3 switches\n");
         kprint("  usb                - Display USB device status\n");
         kprint("  exec <file>        - Execute a script\n");
         kprint("  execbin <file>     - Execute a binary (supports ELF format)\n");
@@ -38,42 +72,87 @@ void process_command(const char *cmd) {
         kprint("  find <pattern>     - Search for files\n");
         kprint("  sysinfo            - Display system information\n");
         kprint("  fork <bin>         - Create a process from a binary file\n");
-        kprint("  schedule           - Run process scheduler\n");
+        kprint("  schedule           - Wait until all processes finish\n");
+        kprint("  ps                 - List processes and scheduler statistics\n");
+        kprint("  quantum [ms]       - Show/set the scheduler time slice\n");
+        kprint("  schedbench [n]     - Benchmark context switches and n CPU-bound tasks\n");
+        kprint("  spawnbench [n]     - Spawn n short tasks and report spawn/exit rates\n");
+        kprint("  consolebench [n]   - Compare console output paths over n lines\n");
+        kprint("  cpus               - Show CPUs, local APIC and per-CPU run queues\n");
+        kprint("  smpbench [n]       - Run a fixed workload on 1..n CPUs and show speedup\n");
         kprint("  netinfo            - Display network information\n");
         kprint("  nettest            - Send test packets\n");
-        kprint("  netapp             - Run a networking application\n");
+        kprint("  netapp             - Run a UDP echo server (port 7) until a key is pressed\n");
+        kprint("  udpblast [n] [size] [ip] [port] - Send n UDP datagrams and report packets/s\n");
+        kprint("  ping <ip> [count]  - Send ICMP echo requests and report round-trip times\n");
+        kprint("  arp                - Show the ARP cache and IP/UDP counters\n");
+        kprint("  csumbench          - Compare Internet checksum implementations\n");
+        kprint("  fileserve [port] [nodelay] - Serve files over TCP (port 8080) until a key is pressed\n");
+        kprint("  tcpstat            - Show TCP connections and counters\n");
         kprint("  reboot             - Reboot the system\n");
         kprint("  shutdown           - Shut down the system\n");
         kprint("  exit               - Exit CLI\n");
     }
     else if (strcmp(tokens[0], "ls") == 0) {
-        uint32 i;
-        if (token_count > 1 && strcmp(tokens[1], "-l") == 0) {
-            for (i = 0; i < MAX_FILES; i++) {
-                if (file_table[i].in_use) {
-                    kprint(file_table[i].name); kprint("\t");
-                    char numbuf[16];
-                    simple_itoa(file_table[i].inode.size, numbuf); kprint(numbuf); kprint(" bytes\tMode: ");
-                    simple_itoa(file_table[i].mode, numbuf); kprint(numbuf); kprint("\tOwner: ");
-                    simple_itoa(file_table[i].owner, numbuf); kprint(numbuf); kprint("\n");
-                }
-            }
-        } else {
-            for (i = 0; i < MAX_FILES; i++) {
-                if (file_table[i].in_use) { kprint(file_table[i].name); kprint("\n"); }
+        int long_format = (token_count > 1 && strcmp(tokens[1], "-l") == 0);
+        int arg = long_format ? 2 : 1;
+        int dir = (token_count > arg) ? find_file_index(tokens[arg]) : dir_cwd();
+        if (!file_is_dir(dir)) { kprint("Directory not found.\n"); return; }
+        uint32 pos = 0;
+        DirEntry ent;
+        while (dir_next_entry(dir, &pos, &ent) == 0) {
+            int i = (int)ent.slot;
+            if (strcmp(ent.name, "..") == 0) continue;
+            kprint(ent.name);
+            if (file_is_dir(i)) kprint("/");
+            if (long_format) {
+                kprint("\t");
+                char numbuf[16];
+                simple_itoa(file_table[i].inode.size, numbuf); kprint(numbuf); kprint(" bytes\tMode: ");
+                simple_itoa(file_table[i].mode, numbuf); kprint(numbuf); kprint("\tOwner: ");
+                simple_itoa(file_table[i].owner, numbuf); kprint(numbuf);
             }
+            kprint("\n");
         }
     }
+    else if (strcmp(tokens[0], "cd") == 0) {
+        if (dir_chdir(token_count > 1 ? tokens[1] : "/") != 0) kprint("Directory not found.\n");
+    }
+    else if (strcmp(tokens[0], "pwd") == 0) {
+        char path[MAX_CMD_LEN];
+        dir_path(dir_cwd(), path, sizeof(path));
+        kprint(path); kprint("\n");
+    }
+    else if (strcmp(tokens[0], "mkdir") == 0) {
+        if (token_count < 2) { kprint("Usage: mkdir <dir>\n"); return; }
+        if (make_directory(tokens[1]) == 0)
+            kprint("Directory creation successful.\n");
+        else
+            kprint("Directory creation error.\n");
+    }
+    else if (strcmp(tokens[0], "rmdir") == 0) {
+        if (token_count < 2) { kprint("Usage: rmdir <dir>\n"); return; }
+        if (remove_directory(tokens[1]) == 0)
+            kprint("Directory removal successful.\n");
+        else
+            kprint("Directory removal error (not found or not empty).\n");
+    }
     else if (strcmp(tokens[0], "cat") == 0) {
         if (token_count < 2) { kprint("Usage: cat <filename>\n"); return; }
         int idx = find_file_index(tokens[1]);
         if (idx == -1) { kprint("File not found.\n"); return; }
-        uint8 buffer[BLOCK_SIZE * MAX_DIRECT_BLOCKS];
-        if (knixfs_read_file(&file_table[idx].inode, buffer, sizeof(buffer)) == 0) {
-            uint32 size = file_table[idx].inode.size;
-            if (size < sizeof(buffer)) buffer[size] = '\0'; else buffer[sizeof(buffer)-1] = '\0';
-            kprint((const char*)buffer); kprint("\n");
-        } else { kprint("File read error.\n"); }
+        if (file_is_dir(idx)) { kprint("Is a directory.\n"); return; }
+        int fh = file_open(tokens[1], FILE_OPEN_READ);
+        if (fh == -1) { kprint("File read error.\n"); return; }
+        const char *chunk;
+        uint32 len;
+        while ((chunk = (const char*)file_map(fh, &len)) != 0) {
+            if (kprint_len(chunk, len) < len) break;
+            file_seek(fh, file_tell(fh) + len);
+        }
+        if (!chunk && file_tell(fh) < file_size(fh)) kprint("\nFile read error.");
+        file_close(fh);
+        kprint("\n");
     }
     else if (strcmp(tokens[0], "write") == 0) {
         if (token_count < 3) { kprint("Usage: write <filename> <message>\n"); return; }
@@ -122,7 +201,8 @@ void process_command(const char *cmd) {
         int idx = find_file_index(tokens[1]);
         if (idx == -1) { kprint("File not found.\n"); return; }
         file_table[idx].mode = simple_atoi(tokens[2]);
-        save_file_table();
+        file_entry_dirty(idx);
+        cache_op_end();
         kprint("Permission change completed.\n");
     }
     else if (strcmp(tokens[0], "chown") == 0) {
@@ -130,7 +210,8 @@ void process_command(const char *cmd) {
         int idx = find_file_index(tokens[1]);
         if (idx == -1) { kprint("File not found.\n"); return; }
         file_table[idx].owner = simple_atoi(tokens[2]);
-        save_file_table();
+        file_entry_dirty(idx);
+        cache_op_end();
         kprint("Owner change completed.\n");
     }
     else if (strcmp(tokens[0], "stat") == 0) {
@@ -170,14 +251,74 @@ void process_command(const char *cmd) {
             kprint("Error adding content.\n");
     }
     else if (strcmp(tokens[0], "df") == 0) {
-        uint32 free_count = 0, i;
-        for (i = 0; i < MAX_BLOCKS; i++) {
-            if (fs.free_block_bitmap[i]) free_count++;
-        }
+        uint32 free_count = fs_free_blocks();
         kprint("Number of blocks remaining: ");
         char numbuf[16];
         simple_itoa(free_count, numbuf); kprint(numbuf); kprint("\n");
     }
+    else if (strcmp(tokens[0], "sync") == 0) {
+        uint32 dirty = cache_dirty_count();
+        if (cache_sync() == 0) {
+            kprint("Sync completed, sectors written: ");
+            kprint_dec(dirty); kprint("\n");
+        } else {
+            kprint("Sync error.\n");
+        }
+    }
+    else if (strcmp(tokens[0], "cachestat") == 0) {
+        cache_stat_cmd();
+    }
+    else if (strcmp(tokens[0], "rastat") == 0) {
+        readahead_stat_cmd(token_count > 1 && strcmp(tokens[1], "reset") == 0);
+    }
+    else if (strcmp(tokens[0], "diskmode") == 0) {
+        if (token_count > 1) {
+            uint32 mode = (strcmp(tokens[1], "dma") == 0) ? DISK_MODE_DMA : DISK_MODE_PIO;
+            if (disk_set_mode(mode) != 0) { kprint("DMA is not available.\n"); return; }
+        }
+        kprint(disk_get_mode() == DISK_MODE_DMA ? "Disk mode: DMA\n" : "Disk mode: PIO\n");
+    }
+    else if (strcmp(tokens[0], "diskbench") == 0) {
+        disk_bench_cmd();
+    }
+    else if (strcmp(tokens[0], "fsstress") == 0) {
+        uint32 count = (token_count > 1) ? simple_atoi(tokens[1]) : 10000;
+        file_table_stress_cmd(count);
+    }
+    else if (strcmp(tokens[0], "pathstat") == 0) {
+        path_stat_cmd(token_count > 1 && strcmp(tokens[1], "reset") == 0);
+    }
+    else if (strcmp(tokens[0], "scrub") == 0) {
+        scrub_cmd();
+    }
+    else if (strcmp(tokens[0], "verify") == 0) {
+        if (token_count > 1) knixfs_set_verify(strcmp(tokens[1], "on") == 0);
+        kprint(knixfs_verify_enabled() ? "Verify on read: on" : "Verify on read: off");
+        kprint(crc32c_hw_available() ? " (CRC32C: SSE4.2)" : " (CRC32C: table)");
+        kprint(", checksum errors: ");
+        kprint_dec(knixfs_crc_errors()); kprint("\n");
+    }
+    else if (strcmp(tokens[0], "hashbench") == 0) {
+        hash_bench_cmd();
+    }
+    else if (strcmp(tokens[0], "meminfo") == 0) {
+        mem_stat_cmd();
+    }
+    else if (strcmp(tokens[0], "slabinfo") == 0) {
+        slab_stat_cmd();
+    }
+    else if (strcmp(tokens[0], "membench") == 0) {
+        mem_bench_cmd();
+    }
+    else if (strcmp(tokens[0], "vminfo") == 0) {
+        vm_stat_cmd();
+    }
+    else if (strcmp(tokens[0], "vmbench") == 0) {
+        vm_bench_cmd();
+    }
+    else if (strcmp(tokens[0], "pci") == 0) {
+        pci_list_cmd();
+    }
     else if (strcmp(tokens[0], "usb") == 0) {
         kprint("Number of USB devices: ");
         char numbuf[16];
@@ -204,14 +345,23 @@ void process_command(const char *cmd) {
     }
     else if (strcmp(tokens[0], "fork") == 0) {
         if (token_count < 2) { kprint("Usage: fork <binary_file>\n"); return; }
-        int idx = find_file_index(tokens[1]);
-        if (idx == -1) { kprint("Binary file not found.\n"); return; }
-        uint8 buffer[BLOCK_SIZE * MAX_DIRECT_BLOCKS];
-        if (knixfs_read_file(&file_table[idx].inode, buffer, sizeof(buffer)) != 0) {
+        int fh = file_open(tokens[1], FILE_OPEN_READ);
+        if (fh == -1) { kprint("Binary file not found.\n"); return; }
+        uint32 size;
+        const uint8 *image = file_image(fh, &size);
+        file_close(fh);
+        if (!image) {
             kprint("File Read Error.\n");
             return;
         }
-        int pid = sys_create_process((void (*)())buffer);
+        /* 이미지 버퍼는 다음 파일을 읽으면 덮이므로 프로세스 자신의 주소 공간에 복사해 둔다 */
+        uint32 cr3, entry;
+        if (binary_load(image, size, &cr3, &entry) != 0) {
+            kprint("Binary load error.\n");
+            return;
+        }
+        int pid = sys_create_process((knix_entry_t)entry, cr3);
+        if (pid == -1) as_destroy(cr3);
         if (pid != -1) {
             kprint("Create a new process, PID: ");
             char numbuf[16];
@@ -223,9 +373,33 @@ void process_command(const char *cmd) {
     }
     else if (strcmp(tokens[0], "schedule") == 0) {
         kprint("Run Process Scheduler...\n");
-        schedule();
+        process_wait_all();
         kprint("Shutting down the scheduler.\n");
     }
+    else if (strcmp(tokens[0], "ps") == 0) {
+        ps_cmd();
+    }
+    else if (strcmp(tokens[0], "quantum") == 0) {
+        if (token_count > 1) sched_set_quantum(simple_atoi(tokens[1]));
+        kprint("Quantum: ");
+        kprint_dec(sched_quantum_ticks * 1000 / SCHED_HZ);
+        kprint(" ms\n");
+    }
+    else if (strcmp(tokens[0], "schedbench") == 0) {
+        sched_bench_cmd(token_count > 1 ? simple_atoi(tokens[1]) : 0);
+    }
+    else if (strcmp(tokens[0], "spawnbench") == 0) {
+        spawn_bench_cmd(token_count > 1 ? simple_atoi(tokens[1]) : 0);
+    }
+    else if (strcmp(tokens[0], "consolebench") == 0) {
+        console_bench_cmd(token_count > 1 ? simple_atoi(tokens[1]) : 0);
+    }
+    else if (strcmp(tokens[0], "cpus") == 0) {
+        smp_info_cmd();
+    }
+    else if (strcmp(tokens[0], "smpbench") == 0) {
+        smp_bench_cmd(token_count > 1 ? simple_atoi(tokens[1]) : 0);
+    }
     else if (strcmp(tokens[0], "netinfo") == 0) {
         netinfo_cmd();
     }
@@ -235,6 +409,32 @@ void process_command(const char *cmd) {
     else if (strcmp(tokens[0], "netapp") == 0) {
         netapp_cmd();
     }
+    else if (strcmp(tokens[0], "udpblast") == 0) {
+        uint32 dst = 0;
+        if (token_count > 3 && ip_parse(tokens[3], &dst) != 0) {
+            kprint("Usage: udpblast [n] [size] [a.b.c.d] [port]\n");
+        } else {
+            udp_blast_cmd(token_count > 1 ? simple_atoi(tokens[1]) : 0,
+                          token_count > 2 ? simple_atoi(tokens[2]) : 0,
+                          dst, (uint16)(token_count > 4 ? simple_atoi(tokens[4]) : 0));
+        }
+    }
+    else if (strcmp(tokens[0], "ping") == 0) {
+        ping_cmd(token_count > 1 ? tokens[1] : 0, token_count > 2 ? simple_atoi(tokens[2]) : 0);
+    }
+    else if (strcmp(tokens[0], "arp") == 0) {
+        arp_cmd();
+    }
+    else if (strcmp(tokens[0], "csumbench") == 0) {
+        csum_bench_cmd();
+    }
+    else if (strcmp(tokens[0], "fileserve") == 0) {
+        file_serve_cmd((uint16)(token_count > 1 ? simple_atoi(tokens[1]) : 0),
+                       token_count > 2 && strcmp(tokens[2], "nodelay") == 0);
+    }
+    else if (strcmp(tokens[0], "tcpstat") == 0) {
+        tcp_stat_cmd();
+    }
     else if (strcmp(tokens[0], "reboot") == 0) {
         reboot_system();
     }
@@ -243,6 +443,7 @@ void process_command(const char *cmd) {
     }
     else if (strcmp(tokens[0], "exit") == 0) {
         kprint("Shutting down the CLI...\n");
+        cache_sync();
         while (1);
     }
     else {
@@ -0,0 +1,92 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include "dc.h"
+
+/* Time Stamp Counter (벤치마크/측정용) */
+static inline uint64 rdtsc() {
+    uint32 lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64)hi << 32) | lo;
+}
+
+/* 64비트 나눗셈(libgcc) 없이 출력하기 위한 1024 사이클 단위 변환 */
+static inline uint32 cycles_to_kcycles(uint64 cycles) {
+    return (uint32)(cycles >> 10);
+}
+
+/* CPUID (leaf, subleaf 0) */
+static inline void cpu_cpuid(uint32 leaf, uint32 *a, uint32 *b, uint32 *c, uint32 *d) {
+    __asm__ volatile ("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf), "c"(0));
+}
+
+/* MSR 읽기 */
+static inline uint64 cpu_rdmsr(uint32 msr) {
+    uint32 lo, hi;
+    __asm__ volatile ("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64)hi << 32) | lo;
+}
+
+/* 제어 레지스터 (페이징) */
+static inline uint32 cpu_read_cr2() {
+    uint32 v;
+    __asm__ volatile ("mov %%cr2, %0" : "=r"(v));
+    return v;
+}
+
+static inline uint32 cpu_read_cr3() {
+    uint32 v;
+    __asm__ volatile ("mov %%cr3, %0" : "=r"(v));
+    return v;
+}
+
+/* CR3 를 다시 쓰면 global 이 아닌 TLB 항목이 모두 버려진다 */
+static inline void cpu_write_cr3(uint32 v) {
+    __asm__ volatile ("mov %0, %%cr3" :: "r"(v) : "memory");
+}
+
+static inline uint32 cpu_read_cr4() {
+    uint32 v;
+    __asm__ volatile ("mov %%cr4, %0" : "=r"(v));
+    return v;
+}
+
+static inline void cpu_write_cr4(uint32 v) {
+    __asm__ volatile ("mov %0, %%cr4" :: "r"(v) : "memory");
+}
+
+static inline void cpu_invlpg(uint32 vaddr) {
+    __asm__ volatile ("invlpg (%0)" :: "r"(vaddr) : "memory");
+}
+
+/* 인터럽트 플래그 제어 */
+static inline uint32 irq_save() {
+    uint32 flags;
+    __asm__ volatile ("pushfl; popl %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32 flags) {
+    if (flags & 0x200) __asm__ volatile ("sti" ::: "memory");
+}
+
+static inline void cpu_enable_interrupts() {
+    __asm__ volatile ("sti" ::: "memory");
+}
+
+static inline void cpu_disable_interrupts() {
+    __asm__ volatile ("cli" ::: "memory");
+}
+
+/* 스핀 대기 루프용 (하이퍼스레드/가상 CPU 에 양보) */
+static inline void cpu_relax() {
+    __asm__ volatile ("pause" ::: "memory");
+}
+
+/* 인터럽트가 올 때까지 대기. sti 직후 한 명령은 인터럽트가 지연되므로
+   검사와 hlt 사이에 도착한 인터럽트를 놓치지 않는다. */
+static inline void cpu_wait_for_interrupt() {
+    __asm__ volatile ("sti; hlt" ::: "memory");
+}
+
+#endif //CPU_H
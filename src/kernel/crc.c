@@ -0,0 +1,132 @@
+#include "crc.h"
+#include "cpu.h"
+#include "file.h"
+#include "kprint.h"
+#include "type.h"
+#include "timer.h"
+
+/*=========================*/
+/* 4-1. CRC32C 체크섬 */
+/*=========================*/
+/*
+ * CPUID.1:ECX.SSE4_2 가 있으면 crc32 명령으로 4바이트씩, 없으면 slice-by-8
+ * 테이블로 8바이트씩 계산한다. 테이블은 처음 쓸 때 만든다.
+ */
+#define CRC32C_POLY  0x82F63B78   /* reflected */
+
+typedef uint32 __attribute__((may_alias)) uint32_alias;
+
+static uint32 crc_table[8][256];
+static int crc_ready = 0;
+static int use_hw = 0;
+
+static void crc32c_init() {
+    uint32 i, k, c, eax, ebx, ecx, edx;
+    for (i = 0; i < 256; i++) {
+        c = i;
+        for (k = 0; k < 8; k++) c = (c >> 1) ^ (CRC32C_POLY & (0u - (c & 1)));
+        crc_table[0][i] = c;
+    }
+    for (i = 0; i < 256; i++) {
+        for (k = 1; k < 8; k++)
+            crc_table[k][i] = (crc_table[k - 1][i] >> 8) ^ crc_table[0][crc_table[k - 1][i] & 0xFF];
+    }
+    cpu_cpuid(1, &eax, &ebx, &ecx, &edx);
+    use_hw = (ecx >> 20) & 1;
+    crc_ready = 1;
+}
+
+int crc32c_hw_available() {
+    if (!crc_ready) crc32c_init();
+    return use_hw;
+}
+
+uint32 crc32c_sw(uint32 crc, const void *data, uint32 len) {
+    const uint8 *p = (const uint8*)data;
+    uint32 c = ~crc;
+    if (!crc_ready) crc32c_init();
+    while (len > 0 && ((uint32)p & 3)) {
+        c = crc_table[0][(c ^ *p++) & 0xFF] ^ (c >> 8);
+        len--;
+    }
+    while (len >= 8) {
+        uint32 lo = *(const uint32_alias*)p ^ c;
+        uint32 hi = *(const uint32_alias*)(p + 4);
+        c = crc_table[7][lo & 0xFF] ^ crc_table[6][(lo >> 8) & 0xFF] ^
+            crc_table[5][(lo >> 16) & 0xFF] ^ crc_table[4][lo >> 24] ^
+            crc_table[3][hi & 0xFF] ^ crc_table[2][(hi >> 8) & 0xFF] ^
+            crc_table[1][(hi >> 16) & 0xFF] ^ crc_table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0) c = crc_table[0][(c ^ *p++) & 0xFF] ^ (c >> 8);
+    return ~c;
+}
+
+/* SSE4.2 crc32 명령. 지원 여부는 호출자가 확인한다 */
+uint32 crc32c_hw(uint32 crc, const void *data, uint32 len) {
+    const uint8 *p = (const uint8*)data;
+    uint32 c = ~crc;
+    while (len > 0 && ((uint32)p & 3)) {
+        __asm__ ("crc32b %1, %0" : "+r"(c) : "rm"(*p));
+        p++;
+        len--;
+    }
+    while (len >= 4) {
+        __asm__ ("crc32l %1, %0" : "+r"(c) : "rm"(*(const uint32_alias*)p));
+        p += 4;
+        len -= 4;
+    }
+    while (len-- > 0) {
+        __asm__ ("crc32b %1, %0" : "+r"(c) : "rm"(*p));
+        p++;
+    }
+    return ~c;
+}
+
+uint32 crc32c(uint32 crc, const void *data, uint32 len) {
+    if (!crc_ready) crc32c_init();
+    return use_hw ? crc32c_hw(crc, data, len) : crc32c_sw(crc, data, len);
+}
+
+/*=========================*/
+/* hashbench: djb2 / CRC32C(sw) / CRC32C(hw) 처리량 비교 */
+/*=========================*/
+static uint8 bench_buf[CRC_BENCH_BYTES];
+
+/* bytes/cycle 을 소수 둘째 자리까지 */
+static void print_rate(const char *label, uint32 bytes, uint64 cycles, uint32 result) {
+    uint32 rate = cycles ? (uint32)udiv64((uint64)bytes * 100, (uint32)(cycles > 0xFFFFFFFFu ? 0xFFFFFFFFu : cycles)) : 0;
+    kprint(label);
+    kprint_dec(rate / 100); kprint(".");
+    if (rate % 100 < 10) kprint("0");
+    kprint_dec(rate % 100);
+    kprint(" bytes/cycle, ");
+    kprint_dec(cycles_to_us(cycles)); kprint(" us (");
+    kprint_hex(result); kprint(")\n");
+}
+
+void hash_bench_cmd() {
+    const uint32 rounds = 16;
+    uint32 i, r, result = 0;
+    uint32 total = CRC_BENCH_BYTES * rounds;
+    uint64 t0;
+    for (i = 0; i < CRC_BENCH_BYTES; i++) bench_buf[i] = (uint8)(i * 31 + (i >> 8));
+    if (!crc_ready) crc32c_init();
+
+    t0 = rdtsc();
+    for (r = 0; r < rounds; r++) result = simple_hash(bench_buf, CRC_BENCH_BYTES);
+    print_rate("djb2 (old):   ", total, rdtsc() - t0, result);
+
+    t0 = rdtsc();
+    for (r = 0; r < rounds; r++) result = crc32c_sw(0, bench_buf, CRC_BENCH_BYTES);
+    print_rate("CRC32C sw:    ", total, rdtsc() - t0, result);
+
+    if (use_hw) {
+        t0 = rdtsc();
+        for (r = 0; r < rounds; r++) result = crc32c_hw(0, bench_buf, CRC_BENCH_BYTES);
+        print_rate("CRC32C hw:    ", total, rdtsc() - t0, result);
+    } else {
+        kprint("CRC32C hw:    not supported (no SSE4.2)\n");
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include "dc.h"
+
+/*
+ * CRC32C (Castagnoli). crc 에 이전 결과를 넘기면 이어서 계산한다:
+ *   crc32c(crc32c(0, a, n), b, m) == crc32c(0, a||b, n+m)
+ */
+uint32 crc32c(uint32 crc, const void *data, uint32 len);
+uint32 crc32c_sw(uint32 crc, const void *data, uint32 len);
+uint32 crc32c_hw(uint32 crc, const void *data, uint32 len);
+int crc32c_hw_available();
+void hash_bench_cmd();
+
+#endif //CRC_H
@@ -8,16 +8,75 @@
 #define MAX_BLOCKS                1024
 #define MAX_DIRECT_BLOCKS         10
 #define MAX_CMD_LEN               128
+#define BITMAP_WORDS              (MAX_BLOCKS / 32)
+#define KNIXFS_MAGIC              0x584E4B46  /* "FKNX" */
+#define KNIXFS_VERSION_EXTENT     2           /* extent 기반 inode */
+#define KNIXFS_VERSION_TABLE      3           /* 확장된 파일 테이블 (MAX_FILES) */
+#define KNIXFS_VERSION_DIR        4           /* 계층 디렉터리 */
+#define KNIXFS_VERSION_CRC        5           /* CRC32C 파일 해시 + 블록별 체크섬 */
+#define KNIXFS_VERSION            KNIXFS_VERSION_CRC
+#define KNIXFS_NO_BLOCK           0xFFFFFFFF
+#define INODE_DIRECT_EXTENTS      7
+#define EXTENTS_PER_BLOCK         (BLOCK_SIZE / 4)
+#define INDIRECT_PER_BLOCK        (BLOCK_SIZE / 4)
+#define KNIXFS_MAX_FILE_SIZE      (MAX_BLOCKS * BLOCK_SIZE)
 
 /* 디스크 파라미터 */
 #define DISK_FS_START_SECTOR      100
-#define DISK_FS_SECTOR_COUNT      1032
+#define DISK_FS_SECTOR_COUNT      1025   /* 데이터 블록 1024 + 메타데이터(비트맵) 1 */
+#define DISK_FS_LEGACY_SECTOR_COUNT 1032 /* 블록당 int 비트맵을 쓰던 이전 이미지 */
+
+/* READ/WRITE MULTIPLE 사용 시 DRQ 블록당 최대 섹터 수 */
+#define DISK_MULTIPLE_SECTORS     16
+
+/* 버스 마스터 DMA 파라미터 */
+#define DISK_DMA_DEFAULT          1    /* 1 = 컨트롤러가 있으면 부팅 시 DMA 선택 */
+#define DISK_PRDT_ENTRIES         8
+#define DISK_BENCH_CHUNK          128  /* diskbench 요청당 섹터 수 */
 
 /* 파일 테이블 파라미터 */
 #define MAX_FILENAME_LEN          32
-#define MAX_FILES                 16
-#define DISK_FILETABLE_START_SECTOR  (DISK_FS_START_SECTOR + DISK_FS_SECTOR_COUNT)
-#define DISK_FILETABLE_SECTOR_COUNT  3
+#define MAX_FILES                 2048
+#define FILETABLE_V2_ENTRIES      16    /* 포맷 v2 이하 이미지의 테이블 크기 */
+/* 기존 이미지와 호환되도록 파일 테이블 위치는 이전 FS 크기 기준으로 고정 */
+#define DISK_FILETABLE_START_SECTOR  (DISK_FS_START_SECTOR + DISK_FS_LEGACY_SECTOR_COUNT)
+#define DISK_FILETABLE_SECTOR_COUNT  368   /* MAX_FILES * sizeof(FileEntry) (92) / 512 */
+
+/* 스트리밍 파일 I/O 파라미터 */
+#define MAX_OPEN_FILES            16
+#define FILE_IMAGE_MAX            (BLOCK_SIZE * 128)  /* 실행 파일 복사 한도 (64KB, 블록은 캐시 풀에서 밀려날 수 있어 항상 복사) */
+
+/* 디렉터리 / dentry 캐시 파라미터 */
+#define DIR_MAX_DEPTH             16    /* find, pwd 가 따라가는 최대 깊이 */
+#define DCACHE_ENTRIES            (MAX_FILES * 2)  /* 한 디렉터리에 모든 파일이 있어도 complete 유지 */
+#define DCACHE_BUCKETS            2048
+
+/* 메타데이터 저널 파라미터 (파일 테이블 바로 뒤) */
+#define DISK_JOURNAL_START_SECTOR    (DISK_FILETABLE_START_SECTOR + DISK_FILETABLE_SECTOR_COUNT)
+#define JOURNAL_MAX_SECTORS       120   /* 트랜잭션 하나에 담는 메타데이터 섹터 */
+#define DISK_JOURNAL_SECTOR_COUNT (JOURNAL_MAX_SECTORS + 3)  /* superblock + descriptor + payload + commit */
+#define JOURNAL_OP_RESERVE        16    /* 연산 하나가 바꿀 수 있는 메타데이터 섹터 여유분 */
+#define JOURNAL_MAGIC             0x4C4E524A  /* "JRNL" */
+#define JOURNAL_DESC_MAGIC        0x4353444A  /* "JDSC" */
+#define JOURNAL_COMMIT_MAGIC      0x4D4D434A  /* "JCMM" */
+
+/* 블록별 CRC32C 테이블 (저널 바로 뒤, 블록당 4바이트) */
+#define DISK_CRC_START_SECTOR     (DISK_JOURNAL_START_SECTOR + DISK_JOURNAL_SECTOR_COUNT)
+#define DISK_CRC_SECTOR_COUNT     (MAX_BLOCKS * 4 / BLOCK_SIZE)
+#define CRC_BENCH_BYTES           16384
+
+/* 블록 캐시 파라미터 (FS 시작부터 CRC 테이블 끝까지를 dirty 맵으로 관리) */
+#define CACHE_MAX_REGIONS         4
+#define CACHE_SPAN_SECTORS        (DISK_CRC_START_SECTOR + DISK_CRC_SECTOR_COUNT - DISK_FS_START_SECTOR)
+#define CACHE_FLUSH_INTERVAL      4   /* CLI 명령 수 기준 주기적 flush */
+#define CACHE_MAX_INFLIGHT        8   /* 동시에 진행 가능한 flush 요청 수 */
+#define CACHE_RA_INFLIGHT         8   /* 동시에 진행 가능한 read-ahead 요청 수 */
+#define RA_MIN_BLOCKS             4   /* read-ahead 창 초기값 / 요구 읽기 묶음 */
+#define RA_MAX_BLOCKS             64  /* read-ahead 창 최대값 */
+#define CACHE_POOL_BLOCKS         256 /* 데이터 블록 캐시 슬롯 수 (128KB, 디스크 크기와 무관) */
+#define CACHE_POOL_BUCKETS        128
+#define CACHE_RUN_MAX             32  /* 한 번에 돌려주는 연속 구간 최대 블록 (풀의 1/8) */
+#define CACHE_NO_SECTOR           0xFFFFFFFF
 
 /* USB 파라미터 */
 #define MAX_USB_DEVICES       4
@@ -26,8 +85,76 @@
 #define USB_PROTOCOL_KEYBOARD 0x01
 #define USB_PROTOCOL_MOUSE    0x02
 
+/* PCI 파라미터 */
+#define MAX_PCI_DEVICES       32
+#define PCI_MAX_BUS           256
+#define PCI_CLASS_STORAGE     0x01
+#define PCI_SUBCLASS_IDE      0x01
+
+/* 인터럽트 파라미터 */
+#define IDT_ENTRIES           256
+#define IRQ_BASE_VECTOR       0x20
+#define IRQ_ATA_PRIMARY       14
+#define IRQ_ATA_SECONDARY     15
+#define IRQ_KEYBOARD          1
+#define IRQ_COM1              4
+#define IRQ_NE2K_ISA          9     // QEMU ne2k_isa 기본값
+
+/* 시리얼 콘솔 파라미터 */
+#define SERIAL_TX_RING        8192        /* 2 의 거듭제곱, kprint 가 채우고 THRE IRQ 가 비운다 */
+#define CONSOLE_BENCH_LINES   500
+#define KPRINTF_BUF           256         /* kprintf 가 한 번에 형식화하는 바이트 */
+
+/* 키보드 파라미터 */
+#define KBD_RING_SIZE         256         /* 2 의 거듭제곱 (IRQ1 -> kgetchar) */
+
+/* 타이머 파라미터 */
+#define TIMER_CALIBRATE_MS    10
+
+/* 메모리 관리 파라미터 */
+#define PAGE_SIZE             4096
+#define PAGE_SHIFT            12
+#define MEM_MAX_BYTES         0x10000000  /* 관리하는 물리 메모리 상한 (256MB) */
+#define MEM_MAX_FRAMES        (MEM_MAX_BYTES / PAGE_SIZE)
+#define MEM_LOW_LIMIT         0x100000    /* 1MB 아래 (BIOS, VGA, 부트 정보) 는 할당하지 않음 */
+#define MEM_FALLBACK_BYTES    0x1000000   /* multiboot 정보가 없을 때 가정하는 크기 (16MB) */
+#define BUDDY_MAX_ORDER       10          /* 최대 2^10 페이지 (4MB) 블록 */
+#define SLAB_MIN_SHIFT        4           /* kmalloc 최소 크기 16 바이트 */
+#define SLAB_CLASSES          8           /* 16, 32, ..., 2048 */
+#define SLAB_MAX_CACHES       16
+#define MEM_BENCH_OPS         2048
+#define BOOT_STACK_SIZE       16384
+
+/* 페이징 파라미터 */
+#define KERNEL_VBASE          0xC0000000  /* 커널은 물리 0 을 여기에 그대로 (higher half) 매핑 */
+#define BOOT_MAP_BYTES        0x800000    /* 부트 스텁이 미리 매핑하는 크기 (커널 이미지 포함) */
+#define USER_MIN_VADDR        0x1000      /* 0 번 페이지는 NULL 검출용으로 비워 둔다 */
+#define USER_FLAT_BASE        0x400000    /* flat 바이너리 적재 주소 */
+#define VM_BENCH_ROUNDS       1000
+
 /* 프로세스 관리 파라미터 */
-#define MAX_PROCESSES         4
+#define MAX_PROCESSES         1024        /* 동시에 살아 있는 프로세스 상한 (설명자는 slab 에서) */
+#define PID_HASH_BUCKETS      256         /* pid -> 설명자 해시 (2 의 거듭제곱) */
+#define PROC_FREE_MAX         64          /* 스택을 단 채로 재사용을 기다리는 설명자 */
+#define SPAWN_BENCH_DEFAULT   5000
+#define SCHED_HZ              1000        /* PIT 채널 0 틱 (1ms) */
+#define SCHED_QUANTUM_MS      10          /* 기본 타임 슬라이스 */
+#define SCHED_PRIORITIES      8           /* 0 이 가장 높음 */
+#define SCHED_DEFAULT_PRIO    4
+#define SCHED_KSTACK_ORDER    1           /* 프로세스마다 8KB 커널 스택 */
+#define SCHED_BENCH_SWITCHES  10000
+#define SCHED_BENCH_WORK      4000000     /* CPU 작업 하나의 반복 수 */
+
+/* SMP 파라미터 */
+#define SMP_MAX_CPUS          8
+#define SMP_AP_WAIT_MS        200         /* SIPI 뒤 AP 가 올라오기를 기다리는 시간 */
+#define SMP_BENCH_WORK        64000000    /* smpbench 전체 작업량 (CPU 수로 나눈다) */
+#define AP_TRAMPOLINE         0x8000      /* AP 가 실모드로 시작하는 물리 주소 (4KB 정렬, 1MB 아래) */
+#define AP_STACK_ORDER        1           /* AP 부팅 스택 (= 그 CPU 의 idle 스택) 8KB */
+#define LAPIC_VECTOR_BASE     48          /* 이 위 벡터는 LAPIC 이 보낸다 (EOI 도 LAPIC 으로) */
+#define LAPIC_TIMER_VECTOR    48
+#define LAPIC_SPURIOUS_VECTOR 63
+#define IDT_STUB_COUNT        64
 
 /* NE2000 NIC 기본 I/O 베이스 (환경에 따라 변경) */
 #define NE2K_IO_BASE  0x300
@@ -37,6 +164,7 @@ typedef unsigned int uint32_t;
 typedef unsigned char uint8;
 typedef unsigned char uint8_t;
 typedef unsigned long long size_t;
+typedef unsigned long long uint64;
 typedef unsigned short uint16;  // ELF 헤더 파싱용
 typedef unsigned short uint16_t;
 
@@ -61,7 +189,27 @@ typedef struct {
     uint16 e_shstrndx;
 } Elf32_Ehdr;
 
-/* NE2000 레지스터 오프셋 */
+typedef struct {
+    uint32 p_type;
+    uint32 p_offset;
+    uint32 p_vaddr;
+    uint32 p_paddr;
+    uint32 p_filesz;
+    uint32 p_memsz;
+    uint32 p_flags;
+    uint32 p_align;
+} Elf32_Phdr;
+
+#define ELFCLASS32   1
+#define ELFDATA2LSB  1
+#define ET_EXEC      2
+#define EM_386       3
+#define PT_LOAD      1
+#define PF_X         0x1
+#define PF_W         0x2
+#define PF_R         0x4
+
+/* NE2000 레지스터 오프셋 (페이지 0) */
 #define NE2K_CR       0x00  // Command Register
 #define NE2K_PSTART   0x01  // Page Start
 #define NE2K_PSTOP    0x02  // Page Stop
@@ -70,15 +218,95 @@ typedef struct {
 #define NE2K_TBCR0    0x05  // Transmit Byte Count 0
 #define NE2K_TBCR1    0x06  // Transmit Byte Count 1
 #define NE2K_ISR      0x07  // Interrupt Status
+#define NE2K_RSAR0    0x08  // Remote Start Address
+#define NE2K_RSAR1    0x09
+#define NE2K_RBCR0    0x0A  // Remote Byte Count
+#define NE2K_RBCR1    0x0B
+#define NE2K_RCR      0x0C  // Receive Configuration
+#define NE2K_TCR      0x0D  // Transmit Configuration
+#define NE2K_DCR      0x0E  // Data Configuration
+#define NE2K_IMR      0x0F  // Interrupt Mask
+#define NE2K_DATA     0x10  // Remote DMA 데이터 포트
+#define NE2K_RESET    0x1F
+/* 페이지 1 */
+#define NE2K_PAR0     0x01  // 물리 (MAC) 주소 6 바이트
+#define NE2K_CURR     0x07  // 다음에 받을 페이지
+#define NE2K_MAR0     0x08  // 멀티캐스트 해시 8 바이트
 
 /* NE2000 명령어 플래그 */
 #define CR_STP        0x01  // Stop
 #define CR_STA        0x02  // Start
-#define CR_RD2        0x20  // Remote DMA Command
+#define CR_TXP        0x04  // Transmit
+#define CR_RD0        0x08  // Remote Read
+#define CR_RD1        0x10  // Remote Write
+#define CR_RD2        0x20  // Remote DMA Command (abort / 사용 안 함)
+#define CR_PAGE1      0x40
 
-/* 수신/전송 버퍼 등 기본 파라미터 */
-#define NE2K_RXBUF_START  0x40
+/* ISR 비트 */
+#define ISR_PRX       0x01  // 수신 완료
+#define ISR_PTX       0x02  // 전송 완료
+#define ISR_RXE       0x04
+#define ISR_TXE       0x08
+#define ISR_OVW       0x10  // 수신 링 넘침
+#define ISR_RDC       0x40  // Remote DMA 완료
+#define ISR_RST       0x80
+#define NE2K_IMR_BITS (ISR_PRX | ISR_PTX | ISR_RXE | ISR_TXE | ISR_OVW)  // RDC 는 remote_write 가 직접 기다린다
+
+/* 카드 메모리 (페이지 = 256 바이트, 0x40..0x80 = 16KB) 배치 */
+#define NE2K_TX_PAGE      0x40  // 전송 버퍼 2 개 x 6 페이지 (하나를 보내는 동안 다른 하나를 채운다)
+#define NE2K_TX_PAGES     6
+#define NE2K_TX_SLOTS     2
+#define NE2K_RXBUF_START  0x4C
 #define NE2K_RXBUF_STOP   0x80
-#define NE2K_TX_PAGE      0x20
+
+/* 패킷 버퍼 (mbuf) */
+#define ETH_FRAME_MIN     60    // FCS 제외
+#define ETH_FRAME_MAX     1514
+#define MBUF_HEADROOM     64    // 헤더를 앞으로 붙일 자리 (Ethernet + IPv4 + TCP 옵션)
+#define MBUF_SIZE         (MBUF_HEADROOM + 1536)
+#define MBUF_POOL         64    // RX 와 TX 가 함께 쓰는 버퍼 수
+#define NET_RX_BATCH      16    // 한 번의 ne2k_recv_batch 가 링에서 꺼내는 최대 프레임 수
+#define NET_POLL_BUDGET   64    // bottom half 한 번이 처리하는 최대 프레임 수 (넘으면 폴링 모드 유지)
+#define NET_TX_QUEUE      32    // 카드로 아직 옮기지 않은 송신 프레임
+#define NET_TX_TIMEOUT_MS 100   // 이 안에 PTX/TXE 가 없으면 전송을 실패로 보고 슬롯을 비운다
+#define TX_RETRY_SPINS    100000  // 송신 큐가 빌 때까지 펌프를 돌리는 최대 횟수
+#define UDP_BLAST_DEFAULT 10000
+#define UDP_BLAST_PAYLOAD 64
+
+/* 주소 (QEMU user 네트워크 기본값, 호스트 바이트 순서) */
+#define NET_DEFAULT_IP    0x0A00020F  // 10.0.2.15
+#define NET_DEFAULT_GW    0x0A000202  // 10.0.2.2
+#define NET_DEFAULT_MASK  0xFFFFFF00
+
+/* ARP / IPv4 / ICMP / UDP */
+#define ARP_CACHE_SIZE    64
+#define ARP_HASH_BUCKETS  32    // 2 의 거듭제곱
+#define ARP_TIMEOUT_MS    60000 // 해석된 항목의 수명
+#define ARP_RETRY_MS      1000  // 응답이 없을 때 요청을 다시 보내는 간격
+#define ARP_MAX_TRIES     3     // 그 뒤로는 기다리던 패킷을 버리고 항목을 지운다
+#define IP_DEFAULT_TTL    64
+#define UDP_PORT_SLOTS    8     // udp_bind 로 묶을 수 있는 포트 수
+#define UDP_ECHO_PORT     7
+#define PING_DEFAULT_COUNT 4
+#define PING_PAYLOAD      56
+#define PING_TIMEOUT_MS   1000
+#define CSUM_BENCH_ROUNDS 20000
+
+/* TCP */
+#define TCP_MAX_SOCKS     32    // 소켓 번호 0..TCP_MAX_SOCKS-1 (리스너와 연결 모두)
+#define TCP_HASH_BUCKETS  64    // 4-tuple 해시, 2 의 거듭제곱
+#define TCP_BACKLOG       4     // 리스너마다 accept 를 기다릴 수 있는 연결
+#define TCP_MSS           1460
+#define TCP_SNDBUF        16384 // 2 의 거듭제곱 (시퀀스 번호로 바로 색인)
+#define TCP_RCVBUF        8192  // 2 의 거듭제곱, 광고하는 최대 창
+#define TCP_RTO_INIT_MS   1000
+#define TCP_RTO_MIN_MS    200
+#define TCP_RTO_MAX_MS    30000
+#define TCP_MAX_RETRIES   8     // 같은 세그먼트를 이만큼 다시 보내도 안 되면 끊는다
+#define TCP_DELACK_MS     40
+#define TCP_TIME_WAIT_MS  2000
+#define TCP_EPHEMERAL     49152
+#define TCP_WAIT_FOREVER  0xFFFFFFFF
+#define TCP_FILE_PORT     8080
 
 #endif //DC_H
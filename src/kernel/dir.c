@@ -0,0 +1,402 @@
+#include "dc.h"
+#include "dir.h"
+#include "table.h"
+#include "file.h"
+#include "cache.h"
+#include "type.h"
+#include "kprint.h"
+#include "cpu.h"
+#include "timer.h"
+
+/*=========================*/
+/* 5-1. 디렉터리 & dentry 캐시 */
+/*=========================*/
+
+/*
+ * 디렉터리는 FILE_ENTRY_DIR 슬롯이고, 데이터 블록에 DirEntry 배열을 담는다.
+ * 모든 디렉터리는 부모를 가리키는 ".." 항목을 가진다 (루트는 자기 자신).
+ *
+ * dentry 캐시는 (디렉터리, 이름) -> 슬롯 결과를 LRU 로 보관한다.
+ * 없는 이름도 negative 항목으로 남겨 exec 스크립트가 같은 경로를 반복 조회해도
+ * 디렉터리 블록을 다시 훑지 않는다. 한 번 통째로 스캔한 디렉터리는 complete 로
+ * 표시하여, 캐시에 없으면 곧 "없음" 이다. 그 디렉터리의 positive 항목이
+ * 밀려나면 complete 표시를 지운다.
+ */
+typedef struct {
+    int parent;
+    int child;               /* -1 = negative */
+    int hash_next;           /* 해시 체인, 비어 있으면 free 목록 */
+    int lru_prev;
+    int lru_next;
+    uint32 pos;              /* 디렉터리 안 DirEntry 위치 (positive 일 때) */
+    char name[MAX_FILENAME_LEN];
+} dentry_t;
+
+path_stats_t path_stats;
+
+static dentry_t dcache[DCACHE_ENTRIES];
+static int dcache_hash[DCACHE_BUCKETS];
+static int dcache_free = -1;
+static int lru_head = -1;    /* 가장 최근 사용 */
+static int lru_tail = -1;
+static uint8 dir_complete[MAX_FILES];
+static uint16 dir_free_hint[MAX_FILES];  /* 이 블록 앞에는 빈 DirEntry 가 없다 */
+static int cwd = -1;         /* -1 = 루트 */
+
+static int is_dir(int slot) {
+    return slot >= 0 && slot < MAX_FILES && file_table[slot].in_use == FILE_ENTRY_DIR;
+}
+
+static uint32 dentry_hash(int parent, const char *name) {
+    uint32 hash = 2166136261u ^ (uint32)parent, i;
+    for (i = 0; i < MAX_FILENAME_LEN - 1 && name[i]; i++) {
+        hash ^= (uint8)name[i];
+        hash *= 16777619u;
+    }
+    return hash % DCACHE_BUCKETS;
+}
+
+static void lru_unlink(int d) {
+    if (dcache[d].lru_prev != -1) dcache[dcache[d].lru_prev].lru_next = dcache[d].lru_next;
+    else lru_head = dcache[d].lru_next;
+    if (dcache[d].lru_next != -1) dcache[dcache[d].lru_next].lru_prev = dcache[d].lru_prev;
+    else lru_tail = dcache[d].lru_prev;
+}
+
+static void lru_push(int d) {
+    dcache[d].lru_prev = -1;
+    dcache[d].lru_next = lru_head;
+    if (lru_head != -1) dcache[lru_head].lru_prev = d;
+    lru_head = d;
+    if (lru_tail == -1) lru_tail = d;
+}
+
+static void dentry_drop(int d) {
+    int *link = &dcache_hash[dentry_hash(dcache[d].parent, dcache[d].name)];
+    while (*link != -1) {
+        if (*link == d) { *link = dcache[d].hash_next; break; }
+        link = &dcache[*link].hash_next;
+    }
+    lru_unlink(d);
+    if (dcache[d].child != -1) dir_complete[dcache[d].parent] = 0;
+    dcache[d].hash_next = dcache_free;
+    dcache_free = d;
+}
+
+static int dcache_find(int parent, const char *name) {
+    int d = dcache_hash[dentry_hash(parent, name)];
+    while (d != -1) {
+        if (dcache[d].parent == parent && strcmp(dcache[d].name, name) == 0) {
+            lru_unlink(d);
+            lru_push(d);
+            return d;
+        }
+        d = dcache[d].hash_next;
+    }
+    return -1;
+}
+
+static void dcache_insert(int parent, const char *name, int child, uint32 pos) {
+    uint32 j;
+    int d = dcache_find(parent, name);
+    if (d != -1) { dcache[d].child = child; dcache[d].pos = pos; return; }
+    if (dcache_free == -1) {
+        path_stats.evictions++;
+        dentry_drop(lru_tail);
+    }
+    d = dcache_free;
+    dcache_free = dcache[d].hash_next;
+    dcache[d].parent = parent;
+    dcache[d].child = child;
+    dcache[d].pos = pos;
+    for (j = 0; j < MAX_FILENAME_LEN - 1 && name[j]; j++) dcache[d].name[j] = name[j];
+    dcache[d].name[j] = '\0';
+    uint32 bucket = dentry_hash(parent, dcache[d].name);
+    dcache[d].hash_next = dcache_hash[bucket];
+    dcache_hash[bucket] = d;
+    lru_push(d);
+}
+
+/* 파일 테이블을 다시 읽거나 만든 뒤 호출: 캐시를 비우고 cwd 를 루트로 */
+void dir_init() {
+    int i;
+    for (i = 0; i < DCACHE_BUCKETS; i++) dcache_hash[i] = -1;
+    dcache_free = -1;
+    for (i = DCACHE_ENTRIES - 1; i >= 0; i--) {
+        dcache[i].hash_next = dcache_free;
+        dcache_free = i;
+    }
+    lru_head = lru_tail = -1;
+    memset(dir_complete, 0, sizeof(dir_complete));
+    memset(dir_free_hint, 0, sizeof(dir_free_hint));
+    cwd = -1;
+}
+
+/* 디렉터리 슬롯이 비워질 때: 그 디렉터리 아래 캐시 항목을 모두 버린다 */
+void dir_forget(int dir) {
+    int d, next;
+    for (d = lru_head; d != -1; d = next) {
+        next = dcache[d].lru_next;
+        if (dcache[d].parent == dir) dentry_drop(d);
+    }
+    dir_complete[dir] = 0;
+    dir_free_hint[dir] = 0;
+    if (cwd == dir) cwd = -1;
+}
+
+/* 새 디렉터리 슬롯: ".." 만 가진 상태로 시작하므로 바로 complete */
+int dir_create(int dir, int parent) {
+    dir_forget(dir);
+    if (dir_add_entry(dir, "..", parent) != 0) return -1;
+    dir_complete[dir] = 1;
+    return 0;
+}
+
+static DirEntry *dirent_block(int dir, uint32 file_block) {
+    int block = knixfs_map_block(&file_table[dir].inode, file_block);
+    return block < 0 ? 0 : (DirEntry*)knixfs_block_data((uint32)block);
+}
+
+static uint32 dir_blocks(int dir) {
+    return file_table[dir].inode.size / BLOCK_SIZE;
+}
+
+/*
+ * 디렉터리 전체를 훑으며 항목을 캐시에 채운다. 캐시의 절반 이하로 다 들어가면
+ * complete 로 표시한다 (스캔 도중 같은 디렉터리 항목이 밀려나면 dentry_drop 이 해제).
+ */
+static int dir_scan(int dir, const char *name) {
+    uint32 b, i, cached = 0, found_pos = DIRENT_FREE;
+    int found = -1;
+    path_stats.scans++;
+    dir_complete[dir] = 1;
+    for (b = 0; b < dir_blocks(dir); b++) {
+        DirEntry *ents = dirent_block(dir, b);
+        if (!ents) break;
+        for (i = 0; i < DIRENTS_PER_BLOCK; i++) {
+            if (ents[i].slot == DIRENT_FREE) continue;
+            path_stats.dirents_scanned++;
+            if (found == -1 && strcmp(ents[i].name, name) == 0) {
+                found = (int)ents[i].slot;
+                found_pos = b * DIRENTS_PER_BLOCK + i;
+            }
+            if (cached < DCACHE_ENTRIES / 2) {
+                dcache_insert(dir, ents[i].name, (int)ents[i].slot, b * DIRENTS_PER_BLOCK + i);
+                cached++;
+            } else {
+                dir_complete[dir] = 0;
+            }
+        }
+    }
+    if (found != -1 || !dir_complete[dir]) dcache_insert(dir, name, found, found_pos);
+    return found;
+}
+
+/* 구성요소 하나 해석: 캐시 -> complete 판정 -> 디렉터리 스캔 */
+int dir_lookup(int dir, const char *name) {
+    uint64 t0 = rdtsc();
+    int child;
+    path_stats.components++;
+    int d = dcache_find(dir, name);
+    if (d != -1) {
+        child = dcache[d].child;
+        if (child == -1) path_stats.negative_hits++;
+        else path_stats.hits++;
+        path_stats.cached_cycles += rdtsc() - t0;
+        return child;
+    }
+    if (dir_complete[dir]) {
+        path_stats.complete_misses++;
+        path_stats.cached_cycles += rdtsc() - t0;
+        return -1;
+    }
+    child = dir_scan(dir, name);
+    path_stats.scan_cycles += rdtsc() - t0;
+    return child;
+}
+
+/* 빈 항목을 찾아 기록하고, 없으면 블록을 하나 늘린다 */
+int dir_add_entry(int dir, const char *name, int slot) {
+    uint32 b, i, j;
+    DirEntry *ents = 0;
+    for (b = dir_free_hint[dir]; b < dir_blocks(dir); b++) {
+        DirEntry *blk = dirent_block(dir, b);
+        if (!blk) return -1;
+        for (i = 0; i < DIRENTS_PER_BLOCK; i++) {
+            if (blk[i].slot == DIRENT_FREE) { ents = &blk[i]; break; }
+        }
+        if (ents) break;
+    }
+    if (!ents) {
+        int block = knixfs_append_block(&file_table[dir].inode);
+        if (block < 0) return -1;
+        file_entry_dirty(dir);
+        b = dir_blocks(dir) - 1;
+        i = 0;
+        ents = (DirEntry*)knixfs_block_data((uint32)block);
+        for (j = 0; j < DIRENTS_PER_BLOCK; j++) ents[j].slot = DIRENT_FREE;
+        cache_mark_meta(ents, BLOCK_SIZE);
+    }
+    dir_free_hint[dir] = (uint16)b;
+    ents->slot = (uint32)slot;
+    for (j = 0; j < MAX_FILENAME_LEN - 1 && name[j]; j++) ents->name[j] = name[j];
+    ents->name[j] = '\0';
+    cache_mark_meta(ents, sizeof(DirEntry));
+    dcache_insert(dir, ents->name, slot, b * DIRENTS_PER_BLOCK + i);
+    return 0;
+}
+
+static void dirent_clear(int dir, const char *name, DirEntry *ent, uint32 pos) {
+    ent->slot = DIRENT_FREE;
+    cache_mark_meta(ent, sizeof(DirEntry));
+    if (pos / DIRENTS_PER_BLOCK < dir_free_hint[dir])
+        dir_free_hint[dir] = (uint16)(pos / DIRENTS_PER_BLOCK);
+    dcache_insert(dir, name, -1, DIRENT_FREE);
+}
+
+/*
+ * 항목을 비우고 캐시에는 negative 로 남긴다. 블록은 줄이지 않는다.
+ * 캐시에 위치가 있으면 스캔 없이 바로 지운다.
+ */
+int dir_remove_entry(int dir, const char *name) {
+    uint32 b, i;
+    int d = dcache_find(dir, name);
+    if (d != -1 && dcache[d].child != -1 && dcache[d].pos != DIRENT_FREE) {
+        uint32 pos = dcache[d].pos;
+        DirEntry *ents = dirent_block(dir, pos / DIRENTS_PER_BLOCK);
+        DirEntry *ent = ents ? &ents[pos % DIRENTS_PER_BLOCK] : 0;
+        if (ent && ent->slot != DIRENT_FREE && strcmp(ent->name, name) == 0) {
+            dirent_clear(dir, name, ent, pos);
+            return 0;
+        }
+    }
+    for (b = 0; b < dir_blocks(dir); b++) {
+        DirEntry *ents = dirent_block(dir, b);
+        if (!ents) return -1;
+        for (i = 0; i < DIRENTS_PER_BLOCK; i++) {
+            if (ents[i].slot == DIRENT_FREE || strcmp(ents[i].name, name) != 0) continue;
+            dirent_clear(dir, name, &ents[i], b * DIRENTS_PER_BLOCK + i);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* ".." 외의 항목이 없으면 1 */
+int dir_is_empty(int dir) {
+    uint32 pos = 0;
+    DirEntry ent;
+    while (dir_next_entry(dir, &pos, &ent) == 0) {
+        if (strcmp(ent.name, "..") != 0) return 0;
+    }
+    return 1;
+}
+
+/* 순회: uint32 pos = 0; while (dir_next_entry(dir, &pos, &ent) == 0) { ... } */
+int dir_next_entry(int dir, uint32 *pos, DirEntry *entry) {
+    uint32 total = dir_blocks(dir) * DIRENTS_PER_BLOCK;
+    while (*pos < total) {
+        DirEntry *ents = dirent_block(dir, *pos / DIRENTS_PER_BLOCK);
+        if (!ents) return -1;
+        DirEntry *ent = &ents[*pos % DIRENTS_PER_BLOCK];
+        (*pos)++;
+        if (ent->slot != DIRENT_FREE) {
+            *entry = *ent;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int dir_cwd() {
+    return cwd == -1 ? fs_root_dir() : cwd;
+}
+
+/*
+ * 경로 해석. 마지막 구성요소의 슬롯을 돌려주고(없으면 -1),
+ * parent 에는 그것을 담는(또는 담을) 디렉터리, name 에는 마지막 구성요소를 넣는다.
+ * 중간 구성요소가 없거나 디렉터리가 아니면 parent 는 -1.
+ */
+int path_resolve(const char *path, int *parent, char *name) {
+    int cur = (path[0] == '/') ? fs_root_dir() : dir_cwd();
+    int dir = cur;
+    char comp[MAX_FILENAME_LEN];
+    path_stats.lookups++;
+    if (name) name[0] = '\0';
+    while (1) {
+        uint32 len = 0;
+        while (*path == '/') path++;
+        if (*path == '\0') break;
+        while (*path && *path != '/') {
+            if (len < MAX_FILENAME_LEN - 1) comp[len++] = *path;
+            path++;
+        }
+        comp[len] = '\0';
+        if (!is_dir(cur)) { dir = -1; cur = -1; break; }
+        dir = cur;
+        if (name) memcpy(name, comp, len + 1);
+        if (strcmp(comp, ".") != 0) cur = dir_lookup(dir, comp);
+        if (cur == -1) {
+            while (*path == '/') path++;
+            if (*path != '\0') dir = -1;
+            break;
+        }
+    }
+    if (parent) *parent = dir;
+    return cur;
+}
+
+int dir_chdir(const char *path) {
+    int slot = path_resolve(path, 0, 0);
+    if (!is_dir(slot)) return -1;
+    cwd = slot;
+    return 0;
+}
+
+/* ".." 를 따라 올라가며 절대 경로를 만든다 */
+void dir_path(int dir, char *buf, uint32 size) {
+    int chain[DIR_MAX_DEPTH];
+    int depth = 0, root = fs_root_dir();
+    uint32 pos = 0, j;
+    while (dir != root && dir != -1 && depth < DIR_MAX_DEPTH) {
+        chain[depth++] = dir;
+        dir = dir_lookup(dir, "..");
+    }
+    if (size < 2) return;
+    buf[pos++] = '/';
+    while (depth > 0) {
+        const char *name = file_table[chain[--depth]].name;
+        for (j = 0; name[j] && pos < size - 2; j++) buf[pos++] = name[j];
+        if (depth > 0 && pos < size - 2) buf[pos++] = '/';
+    }
+    buf[pos] = '\0';
+}
+
+static void print_avg(const char *label, uint64 cycles, uint32 count) {
+    kprint(label);
+    kprint_dec(count ? (uint32)udiv64(cycles, count) : 0);
+    kprint(" cycles/component (");
+    kprint_dec(count); kprint(")\n");
+}
+
+void path_stat_cmd(int reset) {
+    if (reset) {
+        memset(&path_stats, 0, sizeof(path_stats));
+        kprint("Path statistics reset.\n");
+        return;
+    }
+    uint32 cached = path_stats.hits + path_stats.negative_hits + path_stats.complete_misses;
+    uint32 scanned = path_stats.components - cached;
+    kprint("Path lookups:   "); kprint_dec(path_stats.lookups);
+    kprint("\nComponents:     "); kprint_dec(path_stats.components);
+    kprint("\nDcache hits:    "); kprint_dec(path_stats.hits);
+    kprint("\nNegative hits:  "); kprint_dec(path_stats.negative_hits);
+    kprint("\nComplete dirs:  "); kprint_dec(path_stats.complete_misses);
+    kprint("\nDir scans:      "); kprint_dec(path_stats.scans);
+    kprint("\nDirents read:   "); kprint_dec(path_stats.dirents_scanned);
+    kprint("\nEvictions:      "); kprint_dec(path_stats.evictions);
+    kprint("\n");
+    print_avg("Cached:  ", path_stats.cached_cycles, cached);
+    print_avg("Scanned: ", path_stats.scan_cycles, scanned);
+    print_avg("Overall: ", path_stats.cached_cycles + path_stats.scan_cycles, path_stats.components);
+}
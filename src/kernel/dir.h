@@ -0,0 +1,45 @@
+#ifndef DIR_H
+#define DIR_H
+
+#include "dc.h"
+
+#define DIRENT_FREE  0xFFFFFFFF
+
+/* 디렉터리 데이터 블록에 저장되는 항목: 이름 -> 파일 테이블 슬롯 */
+typedef struct {
+    uint32 slot;                  /* DIRENT_FREE = 빈 항목 */
+    char name[MAX_FILENAME_LEN];
+} DirEntry;
+
+#define DIRENTS_PER_BLOCK  (BLOCK_SIZE / sizeof(DirEntry))
+
+typedef struct {
+    uint32 lookups;          /* 해석한 경로 수 */
+    uint32 components;       /* 해석한 경로 구성요소 수 */
+    uint32 hits;             /* dcache positive hit */
+    uint32 negative_hits;    /* dcache negative hit */
+    uint32 complete_misses;  /* 전부 캐시된 디렉터리라 스캔 없이 "없음" */
+    uint32 scans;            /* 디렉터리 블록 스캔 */
+    uint32 dirents_scanned;
+    uint32 evictions;
+    uint64 cached_cycles;    /* 캐시로 끝난 구성요소에 쓴 사이클 */
+    uint64 scan_cycles;      /* 스캔이 필요했던 구성요소에 쓴 사이클 */
+} path_stats_t;
+
+extern path_stats_t path_stats;
+
+void dir_init();
+int dir_lookup(int dir, const char *name);
+int dir_add_entry(int dir, const char *name, int slot);
+int dir_remove_entry(int dir, const char *name);
+int dir_is_empty(int dir);
+int dir_next_entry(int dir, uint32 *pos, DirEntry *entry);
+int dir_create(int dir, int parent);
+void dir_forget(int dir);
+int path_resolve(const char *path, int *parent, char *name);
+int dir_cwd();
+int dir_chdir(const char *path);
+void dir_path(int dir, char *buf, uint32 size);
+void path_stat_cmd(int reset);
+
+#endif //DIR_H
@@ -1,4 +1,11 @@
 #include "disk.h"
+#include "idt.h"
+#include "cpu.h"
+#include "pci.h"
+#include "timer.h"
+#include "type.h"
+#include "kprint.h"
+#include "paging.h"
 
 /* I/O 포트 접근을 위한 인라인 어셈블리 */
 static inline uint8_t inb(uint16_t port) {
@@ -21,6 +28,10 @@ static inline void outw(uint16_t port, uint16_t data) {
     asm volatile ("outw %0, %1" : : "a"(data), "Nd"(port));
 }
 
+static inline void outl(uint16_t port, uint32 data) {
+    asm volatile ("outl %0, %1" : : "a"(data), "Nd"(port));
+}
+
 /* IDE 관련 포트 정의 (Primary IDE 채널, 마스터 디바이스 기준) */
 #define ATA_REG_DATA        0x1F0
 #define ATA_REG_ERROR       0x1F1  /* 읽기: 오류정보, 쓰기: Features */
@@ -31,9 +42,31 @@ static inline void outw(uint16_t port, uint16_t data) {
 #define ATA_REG_HDDEVSEL    0x1F6
 #define ATA_REG_STATUS      0x1F7  /* 읽기: 상태, 쓰기: 명령 */
 
+#define ATA_REG_ALTSTATUS   0x3F6  /* 읽기: alternate status, 쓰기: device control */
+#define ATA_REG_CONTROL     0x3F6
+#define ATA_CTRL_NIEN       0x02   /* 1 = 드라이브 인터럽트 비활성 */
+#define ATA_SECONDARY_STATUS 0x177
+
 /* ATA 명령 코드 */
 #define ATA_CMD_READ_SECTORS   0x20
 #define ATA_CMD_WRITE_SECTORS  0x30
+#define ATA_CMD_READ_MULTIPLE  0xC4
+#define ATA_CMD_WRITE_MULTIPLE 0xC5
+#define ATA_CMD_SET_MULTIPLE   0xC6
+#define ATA_CMD_CACHE_FLUSH    0xE7
+#define ATA_CMD_IDENTIFY       0xEC
+#define ATA_CMD_READ_DMA       0xC8
+#define ATA_CMD_WRITE_DMA      0xCA
+
+/* PCI IDE 버스 마스터 레지스터 (BAR4 기준, Primary 채널) */
+#define BM_REG_COMMAND   0x00
+#define BM_REG_STATUS    0x02
+#define BM_REG_PRDT      0x04
+#define BM_CMD_START     0x01
+#define BM_CMD_READ      0x08   /* 1 = 디바이스 -> 메모리 */
+#define BM_SR_ERR        0x02
+#define BM_SR_IRQ        0x04
+#define PRD_EOT          0x8000
 
 /* 상태 레지스터의 비트 */
 #define ATA_SR_BSY   0x80  /* Busy */
@@ -46,6 +79,27 @@ static inline void outw(uint16_t port, uint16_t data) {
 /* 섹터 크기 (바이트) */
 #define SECTOR_SIZE 512
 
+/* 한 명령으로 전송 가능한 최대 섹터 수 (SECCOUNT = 0 은 256을 의미) */
+#define ATA_MAX_SECTORS_PER_CMD 256
+
+/* READ/WRITE MULTIPLE 에서 DRQ 블록당 섹터 수 (0 = 미지원, 단일 섹터 PIO 사용) */
+static uint32 multiple_sectors = 0;
+
+/* Physical Region Descriptor: 64KB 경계를 넘지 않는 버퍼 조각 */
+typedef struct {
+    uint32 addr;
+    uint16 count;    /* 0 = 64KB */
+    uint16 flags;
+} __attribute__((packed)) prd_entry_t;
+
+/* PRDT 자체도 64KB 경계를 넘으면 안 되므로 크기만큼 정렬 */
+static prd_entry_t prdt[DISK_PRDT_ENTRIES] __attribute__((aligned(sizeof(prd_entry_t) * DISK_PRDT_ENTRIES)));
+static uint16_t bm_base = 0;        /* 0 = 버스 마스터 컨트롤러 없음 */
+static int drive_supports_dma = 0;
+static uint32 disk_mode = DISK_MODE_PIO;
+
+disk_stats_t disk_stats;
+
 /* 간단한 대기 함수: BSY 해제 후 DRQ가 셋될 때까지 대기 */
 static int ata_wait_for_drq(void) {
     int timeout = 100000;  // 타임아웃 카운트 (필요시 조정)
@@ -53,7 +107,7 @@ static int ata_wait_for_drq(void) {
     while(timeout--) {
         status = inb(ATA_REG_STATUS);
         if (!(status & ATA_SR_BSY)) {
-            if (status & ATA_SR_ERR) {
+            if (status & (ATA_SR_ERR | ATA_SR_DF)) {
                 return -1;  /* 에러 발생 */
             }
             if (status & ATA_SR_DRQ) {
@@ -64,74 +118,477 @@ static int ata_wait_for_drq(void) {
     return -1;  // 타임아웃
 }
 
-/*
- * disk_read
- *  - sector: 읽기를 시작할 논리 섹터 번호 (LBA 방식)
- *  - buffer: 읽은 데이터를 저장할 메모리 버퍼 포인터 (최소 count * 512 바이트 크기)
- *  - count: 읽을 섹터의 수
- *  - 성공 시 0, 실패 시 -1 반환
- */
-int disk_read(uint32 sector, void *buffer, uint32 count) {
-    uint32 i, j;
-    uint16_t *ptr = (uint16_t *)buffer;
+/* BSY 해제만 기다림 (데이터 없는 명령, 쓰기 완료 확인용) */
+static int ata_wait_not_busy(void) {
+    int timeout = 100000;
+    uint8_t status;
+    while(timeout--) {
+        status = inb(ATA_REG_STATUS);
+        if (!(status & ATA_SR_BSY))
+            return (status & (ATA_SR_ERR | ATA_SR_DF)) ? -1 : 0;
+    }
+    return -1;
+}
 
+/* 드라이브 선택 후 약 400ns 대기 (alternate status 4회 읽기) */
+static void ata_delay400(void) {
+    inb(ATA_REG_ALTSTATUS);
+    inb(ATA_REG_ALTSTATUS);
+    inb(ATA_REG_ALTSTATUS);
+    inb(ATA_REG_ALTSTATUS);
+}
+
+/* LBA28 주소와 섹터 수(1~256)를 설정하고 명령을 보낸다 */
+static void ata_issue(uint32 sector, uint32 count, uint8_t cmd) {
     /* LBA 모드로 드라이브 선택, 마스터 디바이스 선택
        0xE0 : 1110 0000, 상위 4비트에 LBA의 27~24비트를 넣음 */
     outb(ATA_REG_HDDEVSEL, 0xE0 | ((sector >> 24) & 0x0F));
-    /* 읽을 섹터 수 지정 */
-    outb(ATA_REG_SECCOUNT0, (uint8_t)count);
+    ata_delay400();
+    /* 섹터 수 지정 (256 -> 0) */
+    outb(ATA_REG_SECCOUNT0, (uint8_t)(count & 0xFF));
     /* LBA 주소 설정 (하위 24비트) */
     outb(ATA_REG_LBA0, (uint8_t)(sector & 0xFF));
     outb(ATA_REG_LBA1, (uint8_t)((sector >> 8) & 0xFF));
     outb(ATA_REG_LBA2, (uint8_t)((sector >> 16) & 0xFF));
-    /* 읽기 명령 전송 */
-    outb(ATA_REG_STATUS, ATA_CMD_READ_SECTORS);  // 실제로는 명령 포트에 쓰거나 별도 I/O가 필요
-    outb(ATA_REG_STATUS, ATA_CMD_READ_SECTORS);  /* 경우에 따라 두 번 설정 */
+    outb(ATA_REG_STATUS, cmd);
+    disk_stats.commands++;
+}
+
+static void disk_identify(void);
+
+/* PCI 에서 IDE 컨트롤러(QEMU: PIIX3/4)를 찾아 버스 마스터 포트를 설정 */
+static void dma_probe(void) {
+    PCI_Device *ide = pci_find_class(PCI_CLASS_STORAGE, PCI_SUBCLASS_IDE);
+    bm_base = 0;
+    if (!ide || !(ide->prog_if & 0x80)) return;   /* prog_if bit 7: 버스 마스터 지원 */
+    uint32 bar4 = pci_read_bar(ide, 4);
+    if (!(bar4 & 0x01)) return;                    /* I/O 공간 BAR 이어야 함 */
+    pci_enable_bus_master(ide);
+    bm_base = (uint16_t)(bar4 & 0xFFFC);
+}
+
+/*
+ * disk_init
+ *  - IDENTIFY 로 READ/WRITE MULTIPLE 지원 여부를 확인하고 SET MULTIPLE MODE 설정
+ *  - 지원하지 않으면 기존 단일 섹터 PIO 명령을 사용
+ *  - PCI 버스 마스터 컨트롤러와 드라이브가 DMA 를 지원하면 DISK_DMA_DEFAULT 에
+ *    따라 DMA 모드를 선택하고, 아니면 PIO 로 동작 (pci_scan() 이후 호출)
+ */
+void disk_init() {
+    disk_mode = DISK_MODE_PIO;
+    drive_supports_dma = 0;
+    dma_probe();
+    disk_identify();
+    if (DISK_DMA_DEFAULT && disk_dma_available()) disk_mode = DISK_MODE_DMA;
+}
+
+int disk_dma_available() {
+    return bm_base != 0 && drive_supports_dma;
+}
 
-    /* 각 섹터마다 읽기 수행 */
-    for (i = 0; i < count; i++) {
+int disk_set_mode(uint32 mode) {
+    if (mode == DISK_MODE_DMA && !disk_dma_available()) return -1;
+    disk_mode = mode;
+    return 0;
+}
+
+uint32 disk_get_mode() {
+    return disk_mode;
+}
+
+static void disk_identify(void) {
+    uint16_t id[256];
+    uint32 i;
+
+    multiple_sectors = 0;
+    outb(ATA_REG_HDDEVSEL, 0xA0);
+    ata_delay400();
+    outb(ATA_REG_SECCOUNT0, 0);
+    outb(ATA_REG_LBA0, 0);
+    outb(ATA_REG_LBA1, 0);
+    outb(ATA_REG_LBA2, 0);
+    outb(ATA_REG_STATUS, ATA_CMD_IDENTIFY);
+    if (inb(ATA_REG_STATUS) == 0) return;  /* 드라이브 없음 */
+    if (ata_wait_for_drq() != 0) return;
+    for (i = 0; i < 256; i++) id[i] = inw(ATA_REG_DATA);
+
+    /* word 49 bit 8: DMA 지원 */
+    drive_supports_dma = (id[49] & 0x0100) ? 1 : 0;
+
+    /* word 47 하위 바이트: DRQ 블록당 최대 섹터 수 */
+    uint32 max_multiple = id[47] & 0xFF;
+    if (max_multiple == 0) return;
+    if (max_multiple > DISK_MULTIPLE_SECTORS) max_multiple = DISK_MULTIPLE_SECTORS;
+
+    outb(ATA_REG_HDDEVSEL, 0xE0);
+    ata_delay400();
+    outb(ATA_REG_SECCOUNT0, (uint8_t)max_multiple);
+    outb(ATA_REG_STATUS, ATA_CMD_SET_MULTIPLE);
+    if (ata_wait_not_busy() == 0) multiple_sectors = max_multiple;
+}
+
+uint32 disk_multiple_sectors() {
+    return multiple_sectors;
+}
+
+/* 한 번의 ATA 명령으로 count(1~256) 섹터를 전송 */
+static int ata_pio_transfer(uint32 sector, uint16_t *ptr, uint32 count, int write) {
+    uint32 block = multiple_sectors ? multiple_sectors : 1;
+    uint32 done = 0, j;
+    uint8_t cmd;
+
+    if (write)
+        cmd = multiple_sectors ? ATA_CMD_WRITE_MULTIPLE : ATA_CMD_WRITE_SECTORS;
+    else
+        cmd = multiple_sectors ? ATA_CMD_READ_MULTIPLE : ATA_CMD_READ_SECTORS;
+    ata_issue(sector, count, cmd);
+
+    /* DRQ 블록 단위로 데이터 전송 (MULTIPLE 모드면 블록당 여러 섹터) */
+    while (done < count) {
+        uint32 n = (count - done > block) ? block : count - done;
         if (ata_wait_for_drq() != 0) {
             return -1;  /* 에러나 타임아웃 */
         }
-        /* 섹터 당 512바이트 -> 256개의 16비트 워드 읽기 */
-        for (j = 0; j < 256; j++) {
-            ptr[i * 256 + j] = inw(ATA_REG_DATA);
+        /* 섹터 당 512바이트 -> 256개의 16비트 워드 */
+        if (write) {
+            for (j = 0; j < n * 256; j++) outw(ATA_REG_DATA, ptr[j]);
+        } else {
+            for (j = 0; j < n * 256; j++) ptr[j] = inw(ATA_REG_DATA);
         }
+        ptr += n * 256;
+        done += n;
+    }
+    if (write) {
+        if (ata_wait_not_busy() != 0) return -1;
+        disk_stats.sectors_written += count;
+    } else {
+        disk_stats.sectors_read += count;
     }
     return 0;
 }
 
+/* 플러시 명령 (데이터 전송 없음) */
+static int ata_flush_polled(void) {
+    outb(ATA_REG_HDDEVSEL, 0xE0);
+    ata_delay400();
+    outb(ATA_REG_STATUS, ATA_CMD_CACHE_FLUSH);
+    disk_stats.commands++;
+    return ata_wait_not_busy();
+}
+
+/* 폴링 경로: IRQ 모드 이전(부팅 초기)에는 요청을 즉시 동기 처리한다 */
+static int disk_execute_polled(disk_request_t *req) {
+    if (req->op == DISK_OP_FLUSH) return ata_flush_polled();
+    while (req->done < req->count) {
+        uint32 n = req->count - req->done;
+        if (n > ATA_MAX_SECTORS_PER_CMD) n = ATA_MAX_SECTORS_PER_CMD;
+        if (ata_pio_transfer(req->sector + req->done,
+                             (uint16_t *)(req->buffer + req->done * SECTOR_SIZE),
+                             n, req->op == DISK_OP_WRITE) != 0)
+            return -1;
+        req->done += n;
+    }
+    return 0;
+}
+
+/*=========================*/
+/* IRQ 기반 비동기 요청 큐 */
+/*=========================*/
+/*
+ * 요청은 FIFO 큐에 쌓이고 맨 앞 요청만 드라이브에서 진행된다.
+ * 읽기: DRQ 블록이 준비될 때마다 IRQ14 -> 핸들러가 블록을 읽음
+ * 쓰기: 첫 블록은 명령 직후 기록, 이후 블록 기록 완료마다 IRQ14
+ * 256 섹터를 넘는 요청은 한 명령이 끝날 때 다음 명령을 이어서 보낸다.
+ */
+static int irq_mode = 0;
+static disk_request_t *queue_head = 0;
+static disk_request_t *queue_tail = 0;
+static uint32 queue_depth = 0;
+static uint32 chunk_left = 0;   /* 현재 ATA 명령에서 남은 섹터 */
+static int chunk_dma = 0;       /* 현재 명령이 DMA 로 진행 중인지 */
+
+/*
+ * 버퍼를 64KB 경계에서 나누어 PRDT 를 채운다. 항목이 부족하면 -1.
+ * 버퍼는 커널 직접 매핑 안에 있어야 하고 (물리적으로도 연속), 장치에는 물리 주소를 준다.
+ */
+static int prdt_build(uint8 *buffer, uint32 bytes) {
+    uint32 n = 0;
+    if ((uint32)buffer & 1) return -1;            /* 워드 정렬 필요 */
+    while (bytes > 0) {
+        if (n >= DISK_PRDT_ENTRIES) return -1;
+        uint32 addr = virt_to_phys(buffer);
+        uint32 span = 0x10000 - (addr & 0xFFFF);
+        uint32 len = (bytes < span) ? bytes : span;
+        prdt[n].addr = addr;
+        prdt[n].count = (uint16)(len & 0xFFFF);
+        prdt[n].flags = 0;
+        buffer += len;
+        bytes -= len;
+        n++;
+    }
+    prdt[n - 1].flags = PRD_EOT;
+    return 0;
+}
+
+/* 버스 마스터 DMA 로 한 명령(최대 256 섹터) 시작 */
+static int dma_start_chunk(disk_request_t *req, uint32 n) {
+    uint8 *buf = req->buffer + req->done * SECTOR_SIZE;
+    int read = (req->op == DISK_OP_READ);
+    if (prdt_build(buf, n * SECTOR_SIZE) != 0) return -1;
+    outb(bm_base + BM_REG_COMMAND, 0);
+    outl(bm_base + BM_REG_PRDT, virt_to_phys(prdt));
+    outb(bm_base + BM_REG_STATUS, inb(bm_base + BM_REG_STATUS) | BM_SR_ERR | BM_SR_IRQ);
+    outb(bm_base + BM_REG_COMMAND, read ? BM_CMD_READ : 0);
+    ata_issue(req->sector + req->done, n, read ? ATA_CMD_READ_DMA : ATA_CMD_WRITE_DMA);
+    outb(bm_base + BM_REG_COMMAND, (read ? BM_CMD_READ : 0) | BM_CMD_START);
+    return 0;
+}
+
+static void ata_transfer_block(disk_request_t *req) {
+    uint32 block = multiple_sectors ? multiple_sectors : 1;
+    uint32 n = (chunk_left > block) ? block : chunk_left;
+    uint16_t *ptr = (uint16_t *)(req->buffer + req->done * SECTOR_SIZE);
+    uint32 j;
+    if (req->op == DISK_OP_WRITE) {
+        for (j = 0; j < n * 256; j++) outw(ATA_REG_DATA, ptr[j]);
+        disk_stats.sectors_written += n;
+    } else {
+        for (j = 0; j < n * 256; j++) ptr[j] = inw(ATA_REG_DATA);
+        disk_stats.sectors_read += n;
+    }
+    req->done += n;
+    chunk_left -= n;
+}
+
+/* 큐 맨 앞 요청의 다음 ATA 명령 시작 (인터럽트 비활성 상태에서 호출) */
+static int ata_start_chunk(disk_request_t *req) {
+    if (req->op == DISK_OP_FLUSH) {
+        outb(ATA_REG_HDDEVSEL, 0xE0);
+        ata_delay400();
+        outb(ATA_REG_STATUS, ATA_CMD_CACHE_FLUSH);
+        disk_stats.commands++;
+        return 0;
+    }
+    uint32 n = req->count - req->done;
+    if (n > ATA_MAX_SECTORS_PER_CMD) n = ATA_MAX_SECTORS_PER_CMD;
+    chunk_left = n;
+    chunk_dma = 0;
+    if (disk_mode == DISK_MODE_DMA && dma_start_chunk(req, n) == 0) {
+        chunk_dma = 1;
+        return 0;
+    }
+    if (req->op == DISK_OP_WRITE) {
+        ata_issue(req->sector + req->done, n,
+                  multiple_sectors ? ATA_CMD_WRITE_MULTIPLE : ATA_CMD_WRITE_SECTORS);
+        /* 첫 블록은 IRQ 없이 DRQ를 기다린 뒤 바로 기록 */
+        if (ata_wait_for_drq() != 0) return -1;
+        ata_transfer_block(req);
+    } else {
+        ata_issue(req->sector + req->done, n,
+                  multiple_sectors ? ATA_CMD_READ_MULTIPLE : ATA_CMD_READ_SECTORS);
+    }
+    return 0;
+}
+
+static void disk_complete(disk_request_t *req, int ok);
+
+/* 실패한 요청은 disk_complete 가 다시 queue_kick 을 호출해 다음 요청으로 넘어간다 */
+static void queue_kick(void) {
+    if (queue_head && ata_start_chunk(queue_head) != 0)
+        disk_complete(queue_head, 0);
+}
+
+static void disk_complete(disk_request_t *req, int ok) {
+    queue_head = req->next;
+    if (!queue_head) queue_tail = 0;
+    queue_depth--;
+    req->next = 0;
+    req->status = ok ? DISK_REQ_DONE : DISK_REQ_ERROR;
+    if (!ok) disk_stats.errors++;
+    if (req->complete) req->complete(req);
+    queue_kick();
+}
+
+static void ata_primary_irq(interrupt_frame_t *frame) {
+    (void)frame;
+    uint8_t status = inb(ATA_REG_STATUS);  /* 상태 읽기로 인터럽트 해제 */
+    disk_request_t *req = queue_head;
+    disk_stats.irqs++;
+    if (!req) return;
+    if (status & (ATA_SR_ERR | ATA_SR_DF)) {
+        if (chunk_dma) {
+            outb(bm_base + BM_REG_COMMAND, 0);
+            chunk_dma = 0;
+        }
+        disk_complete(req, 0);
+        return;
+    }
+    if (req->op == DISK_OP_FLUSH) { disk_complete(req, 1); return; }
+
+    if (chunk_dma) {
+        uint8_t bm_status = inb(bm_base + BM_REG_STATUS);
+        if (!(bm_status & BM_SR_IRQ)) return;
+        outb(bm_base + BM_REG_COMMAND, 0);
+        outb(bm_base + BM_REG_STATUS, bm_status | BM_SR_ERR | BM_SR_IRQ);
+        chunk_dma = 0;
+        if (bm_status & BM_SR_ERR) { disk_complete(req, 0); return; }
+        if (req->op == DISK_OP_WRITE) disk_stats.sectors_written += chunk_left;
+        else disk_stats.sectors_read += chunk_left;
+        disk_stats.dma_sectors += chunk_left;
+        req->done += chunk_left;
+        chunk_left = 0;
+    } else if (req->op == DISK_OP_READ) {
+        if (!(status & ATA_SR_DRQ)) return;
+        ata_transfer_block(req);
+    } else if (chunk_left > 0) {
+        if (!(status & ATA_SR_DRQ)) return;
+        ata_transfer_block(req);
+        return;
+    }
+    if (chunk_left > 0) return;
+    if (req->done >= req->count) { disk_complete(req, 1); return; }
+    if (ata_start_chunk(req) != 0) disk_complete(req, 0);
+}
+
+/* 보조 채널은 사용하지 않지만 공유 PIC 라인이 막히지 않도록 상태만 읽어 해제 */
+static void ata_secondary_irq(interrupt_frame_t *frame) {
+    (void)frame;
+    inb(ATA_SECONDARY_STATUS);
+}
+
+/* IDT 초기화 이후 호출: 드라이브 인터럽트를 켜고 비동기 경로로 전환 */
+void disk_enable_irq() {
+    irq_register(IRQ_ATA_PRIMARY, ata_primary_irq);
+    irq_register(IRQ_ATA_SECONDARY, ata_secondary_irq);
+    outb(ATA_REG_CONTROL, 0x00);  /* nIEN = 0 */
+    irq_mode = 1;
+}
+
+/*
+ * disk_submit
+ *  - 요청을 큐에 넣고 즉시 반환 (IRQ 모드)
+ *  - 완료 시 req->status 가 DONE/ERROR 로 바뀌고 req->complete 가 IRQ 문맥에서 호출된다
+ *  - IRQ 모드 이전에는 동기적으로 처리한 뒤 완료 콜백을 호출
+ */
+int disk_submit(disk_request_t *req) {
+    req->done = 0;
+    req->next = 0;
+    req->status = DISK_REQ_PENDING;
+    disk_stats.requests++;
+
+    if (!irq_mode) {
+        int ok = (disk_execute_polled(req) == 0);
+        req->status = ok ? DISK_REQ_DONE : DISK_REQ_ERROR;
+        if (!ok) disk_stats.errors++;
+        if (req->complete) req->complete(req);
+        return ok ? 0 : -1;
+    }
+
+    uint32 flags = irq_save();
+    if (queue_tail) queue_tail->next = req; else queue_head = req;
+    queue_tail = req;
+    queue_depth++;
+    if (queue_depth > disk_stats.max_queue_depth) disk_stats.max_queue_depth = queue_depth;
+    if (queue_head == req) queue_kick();
+    irq_restore(flags);
+    return 0;
+}
+
+/* 요청 완료까지 hlt 로 대기 (대기 중에도 다른 IRQ는 처리된다).
+   완료 콜백(IRQ 문맥)에서는 호출하지 말 것. */
+int disk_wait(disk_request_t *req) {
+    uint32 flags = irq_save();
+    while (req->status == DISK_REQ_PENDING) {
+        cpu_wait_for_interrupt();
+        cpu_disable_interrupts();
+    }
+    irq_restore(flags);
+    return req->status == DISK_REQ_DONE ? 0 : -1;
+}
+
+uint32 disk_pending() {
+    return queue_depth;
+}
+
+static int disk_sync_request(uint32 op, uint32 sector, void *buffer, uint32 count) {
+    disk_request_t req;
+    req.op = op;
+    req.sector = sector;
+    req.count = count;
+    req.buffer = (uint8 *)buffer;
+    req.complete = 0;
+    req.ctx = 0;
+    if (disk_submit(&req) != 0) return -1;
+    return disk_wait(&req);
+}
+
+/*
+ * disk_read
+ *  - sector: 읽기를 시작할 논리 섹터 번호 (LBA 방식)
+ *  - buffer: 읽은 데이터를 저장할 메모리 버퍼 포인터 (최소 count * 512 바이트 크기)
+ *  - count: 읽을 섹터의 수 (256 섹터 단위로 나누어 명령 전송)
+ *  - 비동기 요청을 제출하고 완료까지 기다리는 동기 래퍼
+ *  - 성공 시 0, 실패 시 -1 반환
+ */
+int disk_read(uint32 sector, void *buffer, uint32 count) {
+    return disk_sync_request(DISK_OP_READ, sector, buffer, count);
+}
+
 /*
  * disk_write
  *  - sector: 쓰기를 시작할 논리 섹터 번호 (LBA 방식)
  *  - buffer: 기록할 데이터가 저장된 메모리 버퍼 포인터 (최소 count * 512 바이트 크기)
- *  - count: 기록할 섹터의 수
+ *  - count: 기록할 섹터의 수 (256 섹터 단위로 나누어 명령 전송)
+ *  - 비동기 요청을 제출하고 완료까지 기다리는 동기 래퍼
  *  - 성공 시 0, 실패 시 -1 반환
  */
 int disk_write(uint32 sector, const void *buffer, uint32 count) {
-    uint32 i, j;
-    const uint16_t *ptr = (const uint16_t *)buffer;
+    return disk_sync_request(DISK_OP_WRITE, sector, (void *)buffer, count);
+}
 
-    /* LBA 모드, 마스터 디바이스 선택 */
-    outb(ATA_REG_HDDEVSEL, 0xE0 | ((sector >> 24) & 0x0F));
-    /* 쓰기할 섹터 수 지정 */
-    outb(ATA_REG_SECCOUNT0, (uint8_t)count);
-    /* LBA 주소 설정 */
-    outb(ATA_REG_LBA0, (uint8_t)(sector & 0xFF));
-    outb(ATA_REG_LBA1, (uint8_t)((sector >> 8) & 0xFF));
-    outb(ATA_REG_LBA2, (uint8_t)((sector >> 16) & 0xFF));
-    /* 쓰기 명령 전송 */
-    outb(ATA_REG_STATUS, ATA_CMD_WRITE_SECTORS);  // 명령 포트에 쓰기
+/* 드라이브 쓰기 캐시를 매체에 반영 */
+int disk_flush() {
+    return disk_sync_request(DISK_OP_FLUSH, 0, 0, 0);
+}
 
-    /* 각 섹터마다 쓰기 수행 */
-    for (i = 0; i < count; i++) {
-        if (ata_wait_for_drq() != 0) {
-            return -1;  /* 에러나 타임아웃 */
-        }
-        /* 섹터 당 512바이트 -> 256개의 16비트 워드 쓰기 */
-        for (j = 0; j < 256; j++) {
-            outw(ATA_REG_DATA, ptr[i * 256 + j]);
+/*
+ * diskbench: KnixFS 영역을 PIO 와 DMA 로 각각 읽어 처리량 비교 (읽기 전용)
+ */
+static uint8 bench_buf[DISK_BENCH_CHUNK * SECTOR_SIZE] __attribute__((aligned(SECTOR_SIZE)));
+
+static void disk_bench_mode(uint32 mode, const char *name) {
+    uint32 sector, total = DISK_FS_SECTOR_COUNT;
+    disk_mode = mode;
+    uint64 start = rdtsc();
+    for (sector = 0; sector < total; sector += DISK_BENCH_CHUNK) {
+        uint32 n = (total - sector > DISK_BENCH_CHUNK) ? DISK_BENCH_CHUNK : total - sector;
+        if (disk_read(DISK_FS_START_SECTOR + sector, bench_buf, n) != 0) {
+            kprint(name); kprint(": read error\n");
+            return;
         }
     }
-    return 0;
+    uint32 us = cycles_to_us(rdtsc() - start);
+    uint32 bytes = total * SECTOR_SIZE;
+    if (us == 0) us = 1;
+    /* KB/s = bytes * 1000000 / us / 1024 */
+    uint32 kbps = (uint32)udiv64((uint64)bytes * 1000000, us) / 1024;
+    kprint(name); kprint(": ");
+    kprint_dec(bytes / 1024); kprint(" KB in ");
+    kprint_dec(us); kprint(" us, ");
+    kprint_dec(kbps / 1024); kprint(".");
+    uint32 frac = (kbps % 1024) * 100 / 1024;
+    if (frac < 10) kprint("0");
+    kprint_dec(frac); kprint(" MB/s\n");
+}
+
+void disk_bench_cmd() {
+    uint32 saved = disk_mode;
+    if (!irq_mode) { kprint("Disk IRQ mode is not enabled.\n"); return; }
+    disk_bench_mode(DISK_MODE_PIO, "PIO");
+    if (disk_dma_available()) {
+        disk_bench_mode(DISK_MODE_DMA, "DMA");
+    } else {
+        kprint("DMA: no bus master IDE controller\n");
+    }
+    disk_mode = saved;
 }
@@ -3,7 +3,56 @@
 
 #include "dc.h"
 
+#define DISK_OP_READ      0
+#define DISK_OP_WRITE     1
+#define DISK_OP_FLUSH     2
+
+#define DISK_MODE_PIO     0
+#define DISK_MODE_DMA     1
+
+#define DISK_REQ_IDLE     0
+#define DISK_REQ_PENDING  1
+#define DISK_REQ_DONE     2
+#define DISK_REQ_ERROR    3
+
+/* 비동기 디스크 요청 (완료될 때까지 호출자가 메모리를 유지해야 함) */
+typedef struct disk_request {
+    uint32 op;
+    uint32 sector;
+    uint32 count;
+    uint8 *buffer;
+    volatile uint32 status;
+    uint32 done;                                   /* 전송 완료된 섹터 수 */
+    void (*complete)(struct disk_request *req);    /* IRQ 문맥에서 호출 */
+    void *ctx;
+    struct disk_request *next;
+} disk_request_t;
+
+typedef struct {
+    uint32 commands;         /* 드라이브에 보낸 ATA 명령 수 */
+    uint32 sectors_read;
+    uint32 sectors_written;
+    uint32 requests;
+    uint32 irqs;
+    uint32 errors;
+    uint32 max_queue_depth;
+    uint32 dma_sectors;      /* 버스 마스터 DMA 로 전송된 섹터 */
+} disk_stats_t;
+
+extern disk_stats_t disk_stats;
+
+void disk_init();
+uint32 disk_multiple_sectors();
+int disk_dma_available();
+int disk_set_mode(uint32 mode);
+uint32 disk_get_mode();
+void disk_enable_irq();
+int disk_submit(disk_request_t *req);
+int disk_wait(disk_request_t *req);
+uint32 disk_pending();
 int disk_read(uint32 sector, void *buffer, uint32 count);
 int disk_write(uint32 sector, const void *buffer, uint32 count);
+int disk_flush();
+void disk_bench_cmd();
 
 #endif //DISK_H
@@ -0,0 +1,78 @@
+#include "elf.h"
+#include "paging.h"
+#include "type.h"
+
+/*=========================*/
+/* 7-1. ELF 로더 */
+/*=========================*/
+/*
+ * 페이지는 as_map_new 가 0 으로 채워 주므로 memsz 중 파일에 없는 부분 (.bss) 은
+ * 따로 지우지 않는다. 복사는 커널 직접 매핑을 거치므로 CR3 를 바꾸지 않아도 된다.
+ */
+
+int is_elf(const uint8 *image, uint32 size) {
+    return size >= 4 && image[0] == 0x7F && image[1] == 'E' && image[2] == 'L' && image[3] == 'F';
+}
+
+/* [vaddr, vaddr+memsz) 를 매핑하고 앞의 len 바이트를 src 로 채운다 */
+static int map_segment(uint32 cr3, uint32 vaddr, uint32 memsz, const uint8 *src, uint32 len, uint32 flags) {
+    uint32 va = vaddr & ~(PAGE_SIZE - 1), end = vaddr + memsz;
+    for (; va < end; va += PAGE_SIZE) {
+        uint8 *page = (uint8*)as_map_new(cr3, va, flags);
+        if (!page) return -1;
+        uint32 start = va < vaddr ? vaddr - va : 0;
+        uint32 off = va + start - vaddr;   /* 세그먼트 안의 위치 */
+        if (off < len) {
+            uint32 n = PAGE_SIZE - start;
+            if (n > len - off) n = len - off;
+            memcpy(page + start, src + off, n);
+        }
+    }
+    return 0;
+}
+
+int elf_load(const uint8 *image, uint32 size, uint32 cr3, uint32 *entry) {
+    const Elf32_Ehdr *eh = (const Elf32_Ehdr*)image;
+    uint32 i, loaded = 0, entry_ok = 0;
+    if (!is_elf(image, size) || size < sizeof(Elf32_Ehdr)) return -1;
+    if (eh->e_ident[4] != ELFCLASS32 || eh->e_ident[5] != ELFDATA2LSB) return -1;
+    if (eh->e_type != ET_EXEC || eh->e_machine != EM_386) return -1;
+    if (eh->e_phentsize != sizeof(Elf32_Phdr) || eh->e_phnum == 0) return -1;
+    if ((uint64)eh->e_phoff + (uint64)eh->e_phnum * sizeof(Elf32_Phdr) > size) return -1;
+
+    for (i = 0; i < eh->e_phnum; i++) {
+        const Elf32_Phdr *ph = (const Elf32_Phdr*)(image + eh->e_phoff) + i;
+        if (ph->p_type != PT_LOAD || ph->p_memsz == 0) continue;
+        if (ph->p_filesz > ph->p_memsz) return -1;
+        if ((uint64)ph->p_offset + ph->p_filesz > size) return -1;
+        /* 사용자 영역 밖 (커널, 0 번 페이지) 으로는 올리지 않는다 */
+        if (ph->p_vaddr < USER_MIN_VADDR || (uint64)ph->p_vaddr + ph->p_memsz > KERNEL_VBASE) return -1;
+        if (map_segment(cr3, ph->p_vaddr, ph->p_memsz, image + ph->p_offset, ph->p_filesz,
+                        PTE_USER | ((ph->p_flags & PF_W) ? PTE_WRITE : 0)) != 0) return -1;
+        if (eh->e_entry >= ph->p_vaddr && eh->e_entry - ph->p_vaddr < ph->p_memsz) entry_ok = 1;
+        loaded++;
+    }
+    if (!loaded || !entry_ok) return -1;
+    *entry = eh->e_entry;
+    return 0;
+}
+
+int flat_load(const uint8 *image, uint32 size, uint32 cr3, uint32 *entry) {
+    if (size == 0 || size > KERNEL_VBASE - USER_FLAT_BASE) return -1;
+    if (map_segment(cr3, USER_FLAT_BASE, size, image, size, PTE_USER | PTE_WRITE) != 0) return -1;
+    *entry = USER_FLAT_BASE;
+    return 0;
+}
+
+int binary_load(const uint8 *image, uint32 size, uint32 *cr3, uint32 *entry) {
+    uint32 as = as_create();
+    int ret;
+    if (!as) return -1;
+    ret = is_elf(image, size) ? elf_load(image, size, as, entry) : flat_load(image, size, as, entry);
+    if (ret != 0) {
+        as_destroy(as);
+        return -1;
+    }
+    *cr3 = as;
+    return 0;
+}
@@ -0,0 +1,16 @@
+#ifndef ELF_H
+#define ELF_H
+
+#include "dc.h"
+
+/*
+ * 실행 파일을 새 주소 공간에 적재한다. ELF (ET_EXEC, i386) 는 PT_LOAD 세그먼트를
+ * 각자의 가상 주소에, 그 밖의 파일은 flat 바이너리로 USER_FLAT_BASE 에 올린다.
+ * 성공하면 0 과 함께 *cr3 (주소 공간), *entry (진입 주소), 실패하면 -1.
+ */
+int binary_load(const uint8 *image, uint32 size, uint32 *cr3, uint32 *entry);
+int elf_load(const uint8 *image, uint32 size, uint32 cr3, uint32 *entry);
+int flat_load(const uint8 *image, uint32 size, uint32 cr3, uint32 *entry);
+int is_elf(const uint8 *image, uint32 size);
+
+#endif //ELF_H
@@ -1,92 +1,722 @@
 #include "file.h"
 #include "type.h"
 #include "disk.h"
+#include "cache.h"
+#include "crc.h"
+#include "kprint.h"
 
 /*=========================*/
 /* 4. 저장되는 파일 시스템 (KnixFS) */
 /*=========================*/
 KnixFS fs;
 
+/*
+ * 블록별 CRC32C (v5). 블록 안에서 파일 크기 이내의 바이트만 덮는다.
+ * 디렉터리와 indirect 블록은 메타데이터라 저널이 보호하므로 대상이 아니다.
+ */
+static uint32 block_crc[MAX_BLOCKS];
+static int verify_reads = 0;
+static uint32 crc_errors = 0;
+
+static uint8 *fs_block(uint32 block_index) {
+    return (uint8*)cache_get(DISK_FS_START_SECTOR + block_index);
+}
+
 void init_fs() {
     uint32 i;
     memset(&fs, 0, sizeof(KnixFS));
-    for (i = 0; i < MAX_BLOCKS; i++) { fs.free_block_bitmap[i] = 1; }
+    for (i = 0; i < BITMAP_WORDS; i++) { fs.meta.free_block_bitmap[i] = 0xFFFFFFFF; }
+    fs.meta.magic = KNIXFS_MAGIC;
+    fs.meta.version = KNIXFS_VERSION;
+    fs.meta.free_count = MAX_BLOCKS;
+    fs.meta.alloc_hint = 0;
+    memset(block_crc, 0, sizeof(block_crc));
+    cache_register_pool(DISK_FS_START_SECTOR, MAX_BLOCKS);
+    cache_invalidate(DISK_FS_START_SECTOR);
+    cache_register(DISK_FS_START_SECTOR + MAX_BLOCKS, &fs.meta, sizeof(KnixFS_Meta));
+    cache_register(DISK_CRC_START_SECTOR, block_crc, sizeof(block_crc));
 }
 
+/*
+ * 전체 이미지 기록 (초기화 시). 평소에는 dirty 섹터만 cache_sync()로 기록된다.
+ * 데이터 블록은 할당되어 쓰일 때 기록되므로 메타데이터와 CRC 표만 쓴다.
+ */
 int save_fs() {
-    uint32 i;
-    uint8 *ptr = (uint8*)&fs;
-    for (i = 0; i < DISK_FS_SECTOR_COUNT; i++) {
-        int ret = disk_write(DISK_FS_START_SECTOR + i, ptr + i * BLOCK_SIZE, 1);
-        if (ret != 0) return -1;
+    cache_mark_region_dirty(DISK_FS_START_SECTOR + MAX_BLOCKS);
+    cache_mark_region_dirty(DISK_CRC_START_SECTOR);
+    return cache_sync();
+}
+
+static uint32 popcount32(uint32 x) {
+    x = x - ((x >> 1) & 0x55555555);
+    x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+    x = (x + (x >> 4)) & 0x0F0F0F0F;
+    return (x * 0x01010101) >> 24;
+}
+
+/*
+ * 이전 이미지는 데이터 블록 뒤 8섹터에 블록당 int(1 = free)를 저장했다.
+ * 비트맵으로 변환하고, 0/1 이 아닌 값이나 전부 0(빈 디스크)이면 -1.
+ */
+static int convert_legacy_bitmap() {
+    uint32 words[BLOCK_SIZE / sizeof(uint32)];
+    uint32 per_sector = BLOCK_SIZE / sizeof(uint32);
+    uint32 sector, i, any_free = 0;
+    memset(&fs.meta, 0, sizeof(fs.meta));
+    for (sector = 0; sector < DISK_FS_LEGACY_SECTOR_COUNT - MAX_BLOCKS; sector++) {
+        if (disk_read(DISK_FS_START_SECTOR + MAX_BLOCKS + sector, words, 1) != 0) return -1;
+        for (i = 0; i < per_sector; i++) {
+            uint32 block = sector * per_sector + i;
+            if (words[i] > 1) return -1;
+            if (words[i]) {
+                fs.meta.free_block_bitmap[block / 32] |= (1u << (block % 32));
+                any_free = 1;
+            }
+        }
     }
+    if (!any_free) return -1;
+    fs.meta.magic = KNIXFS_MAGIC;
+    cache_mark_meta(&fs.meta, sizeof(fs.meta));
     return 0;
 }
 
+/*
+ * 마운트: 블록 뒤의 메타데이터 섹터 (비트맵 포함) 와 CRC 표만 읽는다.
+ * 데이터 블록은 처음 접근할 때 (또는 read-ahead 로) 캐시 풀에 올라온다.
+ */
 int load_fs() {
     uint32 i;
-    uint8 *ptr = (uint8*)&fs;
-    for (i = 0; i < DISK_FS_SECTOR_COUNT; i++) {
-        int ret = disk_read(DISK_FS_START_SECTOR + i, ptr + i * BLOCK_SIZE, 1);
-        if (ret != 0) return -1;
-    }
+    if (cache_register_pool(DISK_FS_START_SECTOR, MAX_BLOCKS) != 0) return -1;
+    if (cache_invalidate(DISK_FS_START_SECTOR) != 0) return -1;
+    if (cache_register(DISK_FS_START_SECTOR + MAX_BLOCKS, &fs.meta, sizeof(KnixFS_Meta)) != 0) return -1;
+    if (cache_load(DISK_FS_START_SECTOR + MAX_BLOCKS) != 0) return -1;
+    if (fs.meta.magic != KNIXFS_MAGIC && convert_legacy_bitmap() != 0) return -1;
+    /* v5 이전 이미지에서는 쓰레기 값이지만 마이그레이션이 knixfs_rehash() 로 다시 채운다 */
+    if (cache_register(DISK_CRC_START_SECTOR, block_crc, sizeof(block_crc)) != 0) return -1;
+    if (cache_load(DISK_CRC_START_SECTOR) != 0) return -1;
+    /* free_count 는 로드 시 한 번만 다시 계산 */
+    fs.meta.free_count = 0;
+    for (i = 0; i < BITMAP_WORDS; i++) fs.meta.free_count += popcount32(fs.meta.free_block_bitmap[i]);
+    if (fs.meta.alloc_hint >= MAX_BLOCKS) fs.meta.alloc_hint = 0;
     return 0;
 }
 
-uint32 simple_hash(const uint8 *data, size_t size) {
-    uint32 hash = 5381;
+/*
+ * next-fit 블록 할당: alloc_hint 가 가리키는 워드부터 32비트 단위로 훑고,
+ * 0이 아닌 워드에서 __builtin_ctz (bsf/tzcnt) 로 첫 free 비트를 찾는다.
+ */
+int fs_alloc_block() {
+    uint32 n, start_word, word, bits;
+    if (fs.meta.free_count == 0) return -1;
+    start_word = fs.meta.alloc_hint / 32;
+    for (n = 0; n <= BITMAP_WORDS; n++) {
+        word = (start_word + n) % BITMAP_WORDS;
+        bits = fs.meta.free_block_bitmap[word];
+        /* 첫 워드에서는 hint 이전 비트를 건너뛰고, 한 바퀴 돈 뒤에 다시 본다 */
+        if (n == 0) bits &= ~((1u << (fs.meta.alloc_hint % 32)) - 1);
+        if (bits == 0) continue;
+        uint32 block = word * 32 + (uint32)__builtin_ctz(bits);
+        fs.meta.free_block_bitmap[word] &= ~(1u << (block % 32));
+        fs.meta.free_count--;
+        fs.meta.alloc_hint = (block + 1) % MAX_BLOCKS;
+        cache_mark_meta(&fs.meta, sizeof(fs.meta));
+        /* 이전 내용은 의미가 없으므로 디스크에서 읽지 않는다 */
+        cache_set_valid(DISK_FS_START_SECTOR + block, 1);
+        return (int)block;
+    }
+    return -1;
+}
+
+void fs_free_block(uint32 block_index) {
+    uint32 mask = 1u << (block_index % 32);
+    if (block_index >= MAX_BLOCKS) return;
+    if (fs.meta.free_block_bitmap[block_index / 32] & mask) return;
+    fs.meta.free_block_bitmap[block_index / 32] |= mask;
+    fs.meta.free_count++;
+    cache_mark_meta(&fs.meta, sizeof(fs.meta));
+}
+
+uint32 fs_free_blocks() {
+    return fs.meta.free_count;
+}
+
+uint32 fs_version() {
+    return fs.meta.version;
+}
+
+/* 파일 테이블의 inode 변환이 끝난 뒤 호출 */
+void fs_set_version(uint32 version) {
+    fs.meta.version = version;
+    cache_mark_meta(&fs.meta, sizeof(fs.meta));
+}
+
+int fs_root_dir() {
+    return (int)fs.meta.root_dir;
+}
+
+void fs_set_root_dir(int slot) {
+    fs.meta.root_dir = (uint32)slot;
+    cache_mark_meta(&fs.meta, sizeof(fs.meta));
+}
+
+static int block_is_free(uint32 block) {
+    return (fs.meta.free_block_bitmap[block / 32] >> (block % 32)) & 1;
+}
+
+/*
+ * 연속 할당: hint 부터 want 블록 이상의 free 구간을 찾는다.
+ * 그런 구간이 없으면 가장 긴 구간을 돌려주어 파일을 여러 extent 로 나눈다.
+ * 전부 할당된 워드(0)는 통째로 건너뛴다.
+ */
+static uint32 fs_alloc_extent(uint32 want, uint32 *start) {
+    uint32 best_start = 0, best_len = 0;
+    uint32 run_start = 0, run_len = 0;
+    uint32 n, block;
+    if (fs.meta.free_count == 0 || want == 0) return 0;
+    for (n = 0; n < MAX_BLOCKS; ) {
+        block = (fs.meta.alloc_hint + n) % MAX_BLOCKS;
+        /* 구간은 이미지 끝에서 끊는다 (디스크상 연속이어야 하므로) */
+        if (block == 0 && run_len > 0) {
+            if (run_len > best_len) { best_start = run_start; best_len = run_len; }
+            run_len = 0;
+        }
+        if (block % 32 == 0 && fs.meta.free_block_bitmap[block / 32] == 0 && n + 32 <= MAX_BLOCKS) {
+            if (run_len > best_len) { best_start = run_start; best_len = run_len; }
+            run_len = 0;
+            n += 32;
+            continue;
+        }
+        if (block_is_free(block)) {
+            if (run_len == 0) run_start = block;
+            run_len++;
+            if (run_len >= want) { best_start = run_start; best_len = want; break; }
+        } else {
+            if (run_len > best_len) { best_start = run_start; best_len = run_len; }
+            run_len = 0;
+        }
+        n++;
+    }
+    if (run_len > best_len) { best_start = run_start; best_len = run_len; }
+    if (best_len > want) best_len = want;
+    if (best_len > 0xFFFF) best_len = 0xFFFF;
+    for (n = 0; n < best_len; n++) {
+        block = best_start + n;
+        fs.meta.free_block_bitmap[block / 32] &= ~(1u << (block % 32));
+    }
+    if (best_len > 0) {
+        fs.meta.free_count -= best_len;
+        fs.meta.alloc_hint = (best_start + best_len) % MAX_BLOCKS;
+        cache_mark_meta(&fs.meta, sizeof(fs.meta));
+        cache_set_valid(DISK_FS_START_SECTOR + best_start, best_len);
+    }
+    *start = best_start;
+    return best_len;
+}
+
+/* djb2 는 앞에서부터 누적되므로 append 시 이어서 계산할 수 있다 */
+static uint32 hash_update(uint32 hash, const uint8 *data, size_t size) {
     size_t i;
     for (i = 0; i < size; i++) { hash = ((hash << 5) + hash) + data[i]; }
     return hash;
 }
 
+uint32 simple_hash(const uint8 *data, size_t size) {
+    return hash_update(5381, data, size);
+}
+
+void knixfs_init_inode(KnixFS_Inode *inode) {
+    memset(inode, 0, sizeof(KnixFS_Inode));
+    inode->indirect = KNIXFS_NO_BLOCK;
+    inode->double_indirect = KNIXFS_NO_BLOCK;
+}
+
+/* indirect 블록을 extent 배열 / 블록 번호 배열로 본다 */
+static KnixFS_Extent *extent_block(uint32 block_index) {
+    return (KnixFS_Extent*)fs_block(block_index);
+}
+
+static uint32 *pointer_block(uint32 block_index) {
+    return (uint32*)fs_block(block_index);
+}
+
+/* index 번째 extent 가 저장된 위치. 필요한 indirect 블록이 없으면 create 시 할당 */
+static KnixFS_Extent *extent_slot(KnixFS_Inode *inode, uint32 index, int create) {
+    if (index < INODE_DIRECT_EXTENTS) return &inode->extents[index];
+    index -= INODE_DIRECT_EXTENTS;
+
+    if (index < EXTENTS_PER_BLOCK) {
+        if (inode->indirect == KNIXFS_NO_BLOCK) {
+            int b = create ? fs_alloc_block() : -1;
+            if (b < 0) return 0;
+            inode->indirect = (uint32)b;
+        }
+        return &extent_block(inode->indirect)[index];
+    }
+    index -= EXTENTS_PER_BLOCK;
+
+    if (index >= INDIRECT_PER_BLOCK * EXTENTS_PER_BLOCK) return 0;
+    if (inode->double_indirect == KNIXFS_NO_BLOCK) {
+        int b = create ? fs_alloc_block() : -1;
+        if (b < 0) return 0;
+        inode->double_indirect = (uint32)b;
+        memset(pointer_block(b), 0xFF, BLOCK_SIZE);
+        cache_mark_meta(pointer_block(b), BLOCK_SIZE);
+    }
+    uint32 *ptrs = pointer_block(inode->double_indirect);
+    uint32 slot = index / EXTENTS_PER_BLOCK;
+    if (ptrs[slot] == KNIXFS_NO_BLOCK) {
+        int b = create ? fs_alloc_block() : -1;
+        if (b < 0) return 0;
+        ptrs[slot] = (uint32)b;
+        cache_mark_meta(&ptrs[slot], sizeof(uint32));
+    }
+    return &extent_block(ptrs[slot])[index % EXTENTS_PER_BLOCK];
+}
+
+int knixfs_get_extent(const KnixFS_Inode *inode, uint32 index, KnixFS_Extent *extent) {
+    if (index >= inode->extent_count) return -1;
+    KnixFS_Extent *slot = extent_slot((KnixFS_Inode*)inode, index, 0);
+    if (!slot) return -1;
+    *extent = *slot;
+    return 0;
+}
+
+static int inode_append_extent(KnixFS_Inode *inode, uint32 start, uint32 length) {
+    /* 바로 앞 extent 와 이어지면 합친다 */
+    if (inode->extent_count > 0) {
+        KnixFS_Extent *last = extent_slot(inode, inode->extent_count - 1, 0);
+        if (last && last->start + last->length == start && last->length + length <= 0xFFFF) {
+            last->length += (uint16)length;
+            cache_mark_meta(last, sizeof(KnixFS_Extent));
+            return 0;
+        }
+    }
+    KnixFS_Extent *slot = extent_slot(inode, inode->extent_count, 1);
+    if (!slot) return -1;
+    slot->start = (uint16)start;
+    slot->length = (uint16)length;
+    cache_mark_meta(slot, sizeof(KnixFS_Extent));
+    inode->extent_count++;
+    return 0;
+}
+
+/* inode 가 가진 데이터 블록과 indirect 블록을 모두 반환 */
+static void inode_release(KnixFS_Inode *inode) {
+    uint32 i, j;
+    KnixFS_Extent ext;
+    for (i = 0; i < inode->extent_count; i++) {
+        if (knixfs_get_extent(inode, i, &ext) != 0) break;
+        for (j = 0; j < ext.length; j++) fs_free_block(ext.start + j);
+    }
+    if (inode->indirect != KNIXFS_NO_BLOCK) fs_free_block(inode->indirect);
+    if (inode->double_indirect != KNIXFS_NO_BLOCK) {
+        uint32 *ptrs = pointer_block(inode->double_indirect);
+        for (i = 0; i < INDIRECT_PER_BLOCK; i++) {
+            if (ptrs[i] != KNIXFS_NO_BLOCK) fs_free_block(ptrs[i]);
+        }
+        fs_free_block(inode->double_indirect);
+    }
+    knixfs_init_inode(inode);
+}
+
+/*
+ * v1 inode(직접 블록 10개)를 extent 로 변환. 연속된 블록 번호는 하나의 extent 로 합친다.
+ * inode 는 FileEntry 안에서 같은 자리를 쓰므로 먼저 복사해 둔다.
+ */
+int knixfs_migrate_inode(KnixFS_Inode *inode) {
+    KnixFS_InodeV1 old;
+    uint32 i;
+    memcpy(&old, inode, sizeof(old));
+    uint32 blocks_used = (old.size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (blocks_used > MAX_DIRECT_BLOCKS) return -1;
+    knixfs_init_inode(inode);
+    for (i = 0; i < blocks_used; i++) {
+        if (old.blocks[i] >= MAX_BLOCKS) return -1;
+        if (inode_append_extent(inode, old.blocks[i], 1) != 0) return -1;
+    }
+    inode->size = old.size;
+    inode->hash = old.hash;
+    return 0;
+}
+
+/* 파일 안의 블록 번호 -> 디스크 블록 번호. 범위 밖이면 -1 */
+int knixfs_map_block(const KnixFS_Inode *inode, uint32 file_block) {
+    uint32 i;
+    KnixFS_Extent ext;
+    for (i = 0; i < inode->extent_count; i++) {
+        if (knixfs_get_extent(inode, i, &ext) != 0) return -1;
+        if (file_block < ext.length) return ext.start + file_block;
+        file_block -= ext.length;
+    }
+    return -1;
+}
+
+uint8 *knixfs_block_data(uint32 block) {
+    return fs_block(block);
+}
+
+static void set_block_crc(uint32 block, uint32 crc) {
+    block_crc[block] = crc;
+    cache_mark_meta(&block_crc[block], sizeof(uint32));
+}
+
+/*
+ * 디스크상 연속 구간 p[0..bytes) (블록 block 의 skip 바이트 위치부터) 를 방금 기록했을 때
+ * 걸친 블록들의 CRC 를 갱신한다. append 면 첫 블록의 기존 CRC 에 새 바이트만 이어
+ * 계산하고, 아니면 블록 시작부터 기록 끝까지 다시 계산한다. 호출자는 기록 구간이
+ * 파일 끝 또는 블록 끝에서 끝나도록 보장한다 (knixfs_write_at 참고).
+ */
+static void update_crcs(uint32 block, const uint8 *p, uint32 bytes, int append) {
+    uint32 skip = (uint32)(p - fs_block(block));
+    while (bytes > 0) {
+        uint32 chunk = BLOCK_SIZE - skip;
+        if (chunk > bytes) chunk = bytes;
+        if (append && skip > 0) set_block_crc(block, crc32c(block_crc[block], p, chunk));
+        else set_block_crc(block, crc32c(0, p - skip, skip + chunk));
+        p += chunk;
+        bytes -= chunk;
+        block++;
+        skip = 0;
+    }
+}
+
+static uint8 *map_extent(const KnixFS_Inode *inode, uint32 offset, uint32 *len);
+static uint32 inode_blocks(const KnixFS_Inode *inode);
+static uint32 block_of(const uint8 *p);
+
+/*
+ * extent 단위로 연속 할당한 뒤, 캐시 풀에서 메모리상 이어진 구간마다 한 번에 복사한다.
+ * 새 블록은 디스크에서 읽지 않고 0 으로 채운 슬롯을 받는다.
+ */
 int knixfs_write_file(KnixFS_Inode *inode, const uint8 *data, uint32 data_size) {
-    if (data_size > BLOCK_SIZE * MAX_DIRECT_BLOCKS) return -1;
-    uint32 remaining = data_size, offset = 0;
+    if (data_size > KNIXFS_MAX_FILE_SIZE) return -1;
     uint32 blocks_needed = (data_size + BLOCK_SIZE - 1) / BLOCK_SIZE;
-    uint32 i, j;
-    for (i = 0; i < blocks_needed; i++) {
-        int block_index = -1;
-        for (j = 0; j < MAX_BLOCKS; j++) {
-            if (fs.free_block_bitmap[j]) { block_index = j; fs.free_block_bitmap[j] = 0; break; }
-        }
-        if (block_index == -1) return -1;
-        inode->blocks[i] = block_index;
-        uint32 to_copy = (remaining > BLOCK_SIZE) ? BLOCK_SIZE : remaining;
-        memcpy(fs.blocks[block_index].data, data + offset, to_copy);
-        offset += to_copy;
-        remaining -= to_copy;
+    uint32 offset = 0;
+    knixfs_init_inode(inode);
+    if (blocks_needed > fs_free_blocks()) return -1;
+    while (blocks_needed > 0) {
+        uint32 start;
+        uint32 length = fs_alloc_extent(blocks_needed, &start);
+        if (length == 0 || inode_append_extent(inode, start, length) != 0) {
+            if (length) { uint32 j; for (j = 0; j < length; j++) fs_free_block(start + j); }
+            inode_release(inode);
+            return -1;
+        }
+        blocks_needed -= length;
     }
     inode->size = data_size;
-    inode->hash = simple_hash(data, data_size);
-    if (save_fs() != 0) return -1;
+    while (offset < data_size) {
+        uint32 bytes;
+        uint8 *p = map_extent(inode, offset, &bytes);
+        if (!p) {
+            inode_release(inode);
+            return -1;
+        }
+        memcpy(p, data + offset, bytes);
+        cache_mark_dirty(p, bytes);
+        update_crcs(block_of(p), p, bytes, 0);
+        offset += bytes;
+    }
+    inode->hash = crc32c(0, data, data_size);
     return 0;
 }
 
+/* 파일 블록 [first, first + count) 를 extent 별 비동기 요청으로 미리 읽는다. 제출한 섹터 수 */
+uint32 knixfs_prefetch(const KnixFS_Inode *inode, uint32 first, uint32 count) {
+    uint32 i, base = 0, issued = 0, end = first + count;
+    KnixFS_Extent ext;
+    for (i = 0; i < inode->extent_count && base < end; i++) {
+        if (knixfs_get_extent(inode, i, &ext) != 0) break;
+        uint32 lo = first > base ? first - base : 0;
+        uint32 hi = end - base < ext.length ? end - base : ext.length;
+        if (lo < hi && ext.start + ext.length <= MAX_BLOCKS)
+            issued += cache_prefetch(DISK_FS_START_SECTOR + ext.start + lo, hi - lo);
+        base += ext.length;
+    }
+    return issued;
+}
+
+/* 파일 전체를 먼저 요청해 두고 extent 순서대로 복사한다 */
 int knixfs_read_file(KnixFS_Inode *inode, uint8 *buffer, uint32 buffer_size) {
     if (buffer_size < inode->size) return -1;
-    uint32 remaining = inode->size, offset = 0, i;
-    for (i = 0; i < MAX_DIRECT_BLOCKS && remaining > 0; i++) {
-        int block_index = inode->blocks[i];
-        if (block_index < 0 || block_index >= MAX_BLOCKS) break;
-        uint32 to_copy = (remaining > BLOCK_SIZE) ? BLOCK_SIZE : remaining;
-        memcpy(buffer + offset, fs.blocks[block_index].data, to_copy);
-        offset += to_copy;
-        remaining -= to_copy;
+    knixfs_prefetch(inode, 0, (inode->size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    return knixfs_read_at(inode, 0, buffer, inode->size) == (int)inode->size ? 0 : -1;
+}
+
+/*
+ * offset 이 속한 extent 의 나머지 구간 중 메모리에 있는 부분을 복사 없이 가리킨다.
+ * *len 은 파일 끝을 넘지 않는 연속 바이트 수, offset 이 파일 밖이면 0 을 돌려준다.
+ */
+static uint8 *map_extent(const KnixFS_Inode *inode, uint32 offset, uint32 *len) {
+    uint32 i, pos = offset;
+    KnixFS_Extent ext;
+    *len = 0;
+    if (offset >= inode->size) return 0;
+    for (i = 0; i < inode->extent_count; i++) {
+        if (knixfs_get_extent(inode, i, &ext) != 0) return 0;
+        uint32 bytes = ext.length * BLOCK_SIZE;
+        if (pos < bytes) {
+            uint32 first = pos / BLOCK_SIZE, run;
+            if (ext.start + ext.length > MAX_BLOCKS) return 0;
+            /* 이미 메모리에 있는 (또는 방금 읽은) 연속 블록까지만 */
+            uint8 *p = (uint8*)cache_get_run(DISK_FS_START_SECTOR + ext.start + first,
+                                             ext.length - first, &run);
+            if (!p) return 0;
+            *len = run * BLOCK_SIZE - pos % BLOCK_SIZE;
+            if (*len > inode->size - offset) *len = inode->size - offset;
+            return p + pos % BLOCK_SIZE;
+        }
+        pos -= bytes;
+    }
+    return 0;
+}
+
+/* 파일 안 블록 file_block 에 들어 있는 유효 바이트 수 */
+static uint32 block_valid_bytes(const KnixFS_Inode *inode, uint32 file_block) {
+    uint32 start = file_block * BLOCK_SIZE;
+    if (start >= inode->size) return 0;
+    return inode->size - start < BLOCK_SIZE ? inode->size - start : BLOCK_SIZE;
+}
+
+static uint32 block_of(const uint8 *p) {
+    return cache_sector_of(p) - DISK_FS_START_SECTOR;
+}
+
+/*
+ * 읽기 경로의 map. 검증이 켜져 있으면 offset 이 속한 블록 하나만 CRC 를 확인하고
+ * *len 도 그 블록 끝까지로 줄인다 (읽은 만큼만 검사). 불일치면 0.
+ */
+const uint8 *knixfs_map(const KnixFS_Inode *inode, uint32 offset, uint32 *len) {
+    uint8 *p = map_extent(inode, offset, len);
+    if (!p || !verify_reads) return p;
+    uint32 in_block = offset % BLOCK_SIZE;
+    uint32 block = block_of(p);
+    uint32 valid = block_valid_bytes(inode, offset / BLOCK_SIZE);
+    if (crc32c(0, p - in_block, valid) != block_crc[block]) {
+        crc_errors++;
+        kprint("KnixFS: checksum mismatch in block ");
+        kprint_dec(block); kprint("\n");
+        *len = 0;
+        return 0;
+    }
+    *len = valid - in_block;
+    return p;
+}
+
+int knixfs_read_at(const KnixFS_Inode *inode, uint32 offset, uint8 *buffer, uint32 len) {
+    uint32 done = 0, chunk;
+    /* 여러 블록에 걸치면 나머지 블록을 먼저 요청해 첫 블록 복사와 겹친다 */
+    if (len > 0 && offset < inode->size && (offset % BLOCK_SIZE) + len > BLOCK_SIZE) {
+        uint32 end = offset + len < inode->size ? offset + len : inode->size;
+        knixfs_prefetch(inode, offset / BLOCK_SIZE, (end - 1) / BLOCK_SIZE - offset / BLOCK_SIZE + 1);
+    }
+    while (done < len) {
+        const uint8 *src = knixfs_map(inode, offset + done, &chunk);
+        if (!src) {
+            /* 파일 안에서 멈췄으면 끝이 아니라 오류 (CRC 불일치, 캐시 슬롯 없음) */
+            if (offset + done < inode->size) return -1;
+            break;
+        }
+        if (chunk > len - done) chunk = len - done;
+        memcpy(buffer + done, src, chunk);
+        done += chunk;
+    }
+    return (int)done;
+}
+
+static uint32 inode_blocks(const KnixFS_Inode *inode) {
+    uint32 i, blocks = 0;
+    KnixFS_Extent ext;
+    for (i = 0; i < inode->extent_count; i++) {
+        if (knixfs_get_extent(inode, i, &ext) != 0) break;
+        blocks += ext.length;
+    }
+    return blocks;
+}
+
+/*
+ * 파일을 앞의 keep 블록만 남기고 줄인다 (실패한 쓰기를 되돌릴 때).
+ * 더 이상 필요 없는 indirect / double indirect 블록도 돌려준다. size 는 호출자가 맞춘다.
+ */
+static void inode_truncate(KnixFS_Inode *inode, uint32 keep) {
+    uint32 have = inode_blocks(inode), j, slot, needed;
+    KnixFS_Extent *last;
+    while (have > keep && inode->extent_count > 0) {
+        if ((last = extent_slot(inode, inode->extent_count - 1, 0)) == 0) break;
+        uint32 cut = have - keep < last->length ? have - keep : last->length;
+        for (j = last->length - cut; j < last->length; j++) fs_free_block(last->start + j);
+        last->length -= (uint16)cut;
+        cache_mark_meta(last, sizeof(KnixFS_Extent));
+        if (last->length == 0) inode->extent_count--;
+        have -= cut;
+    }
+    if (inode->extent_count <= INODE_DIRECT_EXTENTS && inode->indirect != KNIXFS_NO_BLOCK) {
+        fs_free_block(inode->indirect);
+        inode->indirect = KNIXFS_NO_BLOCK;
+    }
+    if (inode->double_indirect != KNIXFS_NO_BLOCK) {
+        uint32 *ptrs = pointer_block(inode->double_indirect);
+        j = inode->extent_count > INODE_DIRECT_EXTENTS + EXTENTS_PER_BLOCK ?
+            inode->extent_count - INODE_DIRECT_EXTENTS - EXTENTS_PER_BLOCK : 0;
+        needed = (j + EXTENTS_PER_BLOCK - 1) / EXTENTS_PER_BLOCK;
+        for (slot = needed; slot < INDIRECT_PER_BLOCK; slot++) {
+            if (ptrs[slot] == KNIXFS_NO_BLOCK) continue;
+            fs_free_block(ptrs[slot]);
+            ptrs[slot] = KNIXFS_NO_BLOCK;
+            cache_mark_meta(&ptrs[slot], sizeof(uint32));
+        }
+        if (needed == 0) {
+            fs_free_block(inode->double_indirect);
+            inode->double_indirect = KNIXFS_NO_BLOCK;
+        }
+    }
+}
+
+/* 파일 끝에 want 블록을 붙인다. 가능하면 마지막 extent 를 이어서 늘린다 */
+static int inode_grow(KnixFS_Inode *inode, uint32 want) {
+    KnixFS_Extent last;
+    if (want > fs_free_blocks()) return -1;
+    while (want > 0) {
+        uint32 start;
+        if (inode->extent_count > 0 &&
+            knixfs_get_extent(inode, inode->extent_count - 1, &last) == 0 &&
+            last.start + last.length < MAX_BLOCKS && block_is_free(last.start + last.length))
+            fs.meta.alloc_hint = last.start + last.length;
+        uint32 length = fs_alloc_extent(want, &start);
+        if (length == 0) return -1;
+        if (inode_append_extent(inode, start, length) != 0) {
+            uint32 j;
+            for (j = 0; j < length; j++) fs_free_block(start + j);
+            return -1;
+        }
+        want -= length;
     }
     return 0;
 }
 
+/*
+ * 0으로 채운 블록 하나를 파일 끝에 붙이고 디스크 블록 번호를 돌려준다.
+ * 디렉터리처럼 블록 단위로 자라는 inode 용이라 size 도 블록 경계로 맞춘다.
+ */
+int knixfs_append_block(KnixFS_Inode *inode) {
+    uint32 blocks = inode_blocks(inode);
+    if ((blocks + 1) * BLOCK_SIZE > KNIXFS_MAX_FILE_SIZE) return -1;
+    if (inode_grow(inode, 1) != 0) return -1;
+    int block = knixfs_map_block(inode, blocks);
+    if (block < 0) return -1;
+    memset(fs_block(block), 0, BLOCK_SIZE);
+    cache_mark_meta(fs_block(block), BLOCK_SIZE);
+    inode->size = (blocks + 1) * BLOCK_SIZE;
+    return block;
+}
+
+/* 파일 전체 CRC 를 블록 캐시에서 바로 다시 계산 */
+static uint32 file_crc(const KnixFS_Inode *inode) {
+    uint32 crc = 0, pos = 0, chunk;
+    const uint8 *src;
+    while ((src = map_extent(inode, pos, &chunk)) != 0) {
+        crc = crc32c(crc, src, chunk);
+        pos += chunk;
+    }
+    return crc;
+}
+
+/*
+ * offset 위치에 기록하고 필요한 만큼만 블록을 늘린다 (구멍은 허용하지 않음).
+ * 끝에 붙이는 경우에는 파일 CRC 와 마지막 블록 CRC 를 새 바이트만으로 이어서 계산하고,
+ * 중간을 고치면 건드린 블록과 파일 전체 CRC 를 다시 계산한다.
+ * 실패하면 size 와 블록을 원래대로 돌리고, 이미 쓴 바이트가 있으면 CRC 를 내용에 맞춘다.
+ */
+int knixfs_write_at(KnixFS_Inode *inode, uint32 offset, const uint8 *data, uint32 len) {
+    uint32 old_size = inode->size, end = offset + len, done = 0, chunk, pos;
+    int append = (offset == old_size);
+    if (offset > old_size || end > KNIXFS_MAX_FILE_SIZE || end < offset) return -1;
+    uint32 have = inode_blocks(inode);
+    uint32 need = (end + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (need > have && inode_grow(inode, need - have) != 0) goto undo;
+    if (end > old_size) inode->size = end;
+    /* 대상 블록을 모두 캐시에 올릴 수 있는지 먼저 확인한다 (아직 아무것도 바꾸지 않음) */
+    for (pos = offset; pos < end; pos += chunk) {
+        if (!map_extent(inode, pos, &chunk)) goto undo;
+    }
+    while (done < len) {
+        uint8 *dst = map_extent(inode, offset + done, &chunk);
+        if (!dst) goto fail;
+        if (chunk > len - done) chunk = len - done;
+        memcpy(dst, data + done, chunk);
+        cache_mark_dirty(dst, chunk);
+        /* 중간 수정이면 마지막 블록의 기록 끝 뒤 바이트까지 CRC 에 넣는다 */
+        uint32 crc_len = chunk;
+        if (!append) {
+            uint32 tail = block_valid_bytes(inode, (offset + done + chunk - 1) / BLOCK_SIZE);
+            uint32 written_in_tail = (offset + done + chunk - 1) % BLOCK_SIZE + 1;
+            crc_len += tail - written_in_tail;
+        }
+        update_crcs(block_of(dst), dst, crc_len, append);
+        done += chunk;
+    }
+    if (append) {
+        inode->hash = crc32c(old_size ? inode->hash : 0, data, len);
+    } else {
+        inode->hash = file_crc(inode);
+    }
+    return (int)len;
+fail:
+    inode->size = old_size;
+    inode_truncate(inode, have);
+    knixfs_rehash(inode);
+    return -1;
+undo:
+    inode->size = old_size;
+    inode_truncate(inode, have);
+    return -1;
+}
+
 void free_file_blocks(KnixFS_Inode *inode) {
-    uint32 i;
-    for (i = 0; i < MAX_DIRECT_BLOCKS; i++) {
-        int block_index = inode->blocks[i];
-        if (block_index >= 0 && block_index < MAX_BLOCKS) {
-            fs.free_block_bitmap[block_index] = 1;
-            inode->blocks[i] = 0;
+    inode_release(inode);
+}
+
+/* 블록 CRC 와 파일 CRC 를 내용으로부터 다시 만든다 (v5 마이그레이션) */
+void knixfs_rehash(KnixFS_Inode *inode) {
+    uint32 pos = 0, chunk;
+    uint8 *p;
+    while ((p = map_extent(inode, pos, &chunk)) != 0) {
+        update_crcs(block_of(p), p, chunk, 0);
+        pos += chunk;
+    }
+    inode->hash = file_crc(inode);
+}
+
+/*
+ * 저장된 블록 CRC 와 파일 CRC 를 내용과 비교한다.
+ * 반환값은 맞지 않는 블록 수, *hash_ok 는 파일 전체 CRC 일치 여부.
+ */
+uint32 knixfs_verify(const KnixFS_Inode *inode, int *hash_ok) {
+    uint32 pos = 0, chunk, bad = 0;
+    const uint8 *p;
+    while ((p = map_extent(inode, pos, &chunk)) != 0) {
+        uint32 block = block_of(p), off = 0;
+        while (off < chunk) {
+            uint32 valid = chunk - off < BLOCK_SIZE ? chunk - off : BLOCK_SIZE;
+            if (crc32c(0, p + off, valid) != block_crc[block]) bad++;
+            off += valid;
+            block++;
         }
+        pos += chunk;
     }
-    inode->size = 0;
-    inode->hash = 0;
-    save_fs();
+    *hash_ok = (file_crc(inode) == inode->hash);
+    crc_errors += bad;
+    return bad;
+}
+
+void knixfs_set_verify(int on) {
+    verify_reads = on;
+}
+
+int knixfs_verify_enabled() {
+    return verify_reads;
+}
+
+uint32 knixfs_crc_errors() {
+    return crc_errors;
 }
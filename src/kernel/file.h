@@ -3,19 +3,50 @@
 
 #include "dc.h"
 
+/* 연속된 블록 구간 */
 typedef struct {
-    uint8 data[BLOCK_SIZE];
-} Block;
+    uint16 start;
+    uint16 length;
+} KnixFS_Extent;
 
+/*
+ * 포맷 v2 inode: 직접 extent 7개 + single/double indirect 블록.
+ * indirect 블록은 extent 128개, double indirect 블록은 indirect 블록 번호 128개를 담는다.
+ * 크기는 v1 inode 와 같은 48바이트라 FileEntry/파일 테이블 배치는 그대로다.
+ */
 typedef struct {
     uint32 size;                      /* 파일 크기 (바이트) */
-    uint32 blocks[MAX_DIRECT_BLOCKS]; /* 직접 블록 포인터 */
-    uint32 hash;                      /* 파일 내용 해시 */
+    uint32 hash;                      /* 파일 내용 해시 (v5 부터 CRC32C) */
+    uint32 extent_count;              /* 전체 extent 수 */
+    KnixFS_Extent extents[INODE_DIRECT_EXTENTS];
+    uint32 indirect;                  /* KNIXFS_NO_BLOCK = 없음 */
+    uint32 double_indirect;
 } KnixFS_Inode;
 
+/* 포맷 v1 (직접 블록 포인터만 사용) inode, 마이그레이션용 */
 typedef struct {
-    Block blocks[MAX_BLOCKS];
-    int free_block_bitmap[MAX_BLOCKS]; /* 1 = free, 0 = allocated */
+    uint32 size;
+    uint32 blocks[MAX_DIRECT_BLOCKS];
+    uint32 hash;
+} KnixFS_InodeV1;
+
+/* 데이터 블록 뒤 한 섹터에 저장되는 메타데이터 */
+typedef struct {
+    uint32 magic;                      /* KNIXFS_MAGIC */
+    uint32 free_count;                 /* 비트맵과 함께 증분 갱신 */
+    uint32 alloc_hint;                 /* next-fit 탐색 시작 블록 */
+    uint32 free_block_bitmap[BITMAP_WORDS]; /* 비트 1 = free, 0 = allocated */
+    uint32 version;                    /* 0 = v1 (직접 블록 inode), KNIXFS_VERSION = 현재 */
+    uint32 root_dir;                   /* 루트 디렉터리의 파일 테이블 슬롯 (v4 이상) */
+} KnixFS_Meta;
+
+/*
+ * 메모리에 상주하는 것은 메타데이터뿐이다. 데이터 블록은 블록 캐시의 풀
+ * 슬롯으로 필요할 때 올라오므로 knixfs_map() 이 돌려준 포인터는 다음 캐시
+ * 접근 (다른 블록 읽기/쓰기) 전까지만 유효하다.
+ */
+typedef struct {
+    KnixFS_Meta meta;
 } KnixFS;
 
 extern KnixFS fs;
@@ -23,9 +54,32 @@ extern KnixFS fs;
 void init_fs();
 int save_fs();
 int load_fs();
+int fs_alloc_block();
+void fs_free_block(uint32 block_index);
+uint32 fs_free_blocks();
+uint32 fs_version();
+void fs_set_version(uint32 version);
+int fs_root_dir();
+void fs_set_root_dir(int slot);
 uint32 simple_hash(const uint8 *data, size_t size);
+void knixfs_init_inode(KnixFS_Inode *inode);
+int knixfs_migrate_inode(KnixFS_Inode *inode);
+int knixfs_get_extent(const KnixFS_Inode *inode, uint32 index, KnixFS_Extent *extent);
+int knixfs_map_block(const KnixFS_Inode *inode, uint32 file_block);
+int knixfs_append_block(KnixFS_Inode *inode);
+uint8 *knixfs_block_data(uint32 block);
 int knixfs_write_file(KnixFS_Inode *inode, const uint8 *data, uint32 data_size);
+uint32 knixfs_prefetch(const KnixFS_Inode *inode, uint32 first, uint32 count);
 int knixfs_read_file(KnixFS_Inode *inode, uint8 *buffer, uint32 buffer_size);
+const uint8 *knixfs_map(const KnixFS_Inode *inode, uint32 offset, uint32 *len);
+/* 읽은 바이트 (파일 끝이면 짧다), CRC 불일치나 읽기 실패면 -1 */
+int knixfs_read_at(const KnixFS_Inode *inode, uint32 offset, uint8 *buffer, uint32 len);
+int knixfs_write_at(KnixFS_Inode *inode, uint32 offset, const uint8 *data, uint32 len);
 void free_file_blocks(KnixFS_Inode *inode);
+void knixfs_rehash(KnixFS_Inode *inode);
+uint32 knixfs_verify(const KnixFS_Inode *inode, int *hash_ok);
+void knixfs_set_verify(int on);
+int knixfs_verify_enabled();
+uint32 knixfs_crc_errors();
 
 #endif //FILE_H
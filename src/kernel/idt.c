@@ -0,0 +1,226 @@
+#include "idt.h"
+#include "io.h"
+#include "kprint.h"
+#include "type.h"
+#include "process.h"
+#include "smp.h"
+
+/*=========================*/
+/* 10. IDT, PIC, 인터럽트 디스패치 */
+/*=========================*/
+
+typedef struct {
+    uint16 offset_low;
+    uint16 selector;
+    uint8  zero;
+    uint8  type_attr;
+    uint16 offset_high;
+} __attribute__((packed)) idt_entry_t;
+
+typedef struct {
+    uint16 limit;
+    uint32 base;
+} __attribute__((packed)) idt_ptr_t;
+
+static idt_entry_t idt[IDT_ENTRIES];
+static isr_handler_t handlers[IDT_ENTRIES];
+
+/*
+ * 벡터별 진입 스텁. 에러 코드가 없는 예외는 0을 넣어 프레임 모양을 맞춘 뒤
+ * 벡터 번호를 push 하고 isr_common 으로 이동한다.
+ * isr_dispatch 의 반환값을 새 스택 포인터로 사용하므로 핸들러가 다른
+ * 프레임으로 전환(컨텍스트 스위치)할 수 있다.
+ */
+#define ISR_NOERR(n) \
+    ".globl isr_stub_" #n "\n" \
+    "isr_stub_" #n ":\n" \
+    "  pushl $0\n" \
+    "  pushl $" #n "\n" \
+    "  jmp isr_common\n"
+#define ISR_ERR(n) \
+    ".globl isr_stub_" #n "\n" \
+    "isr_stub_" #n ":\n" \
+    "  pushl $" #n "\n" \
+    "  jmp isr_common\n"
+
+__asm__(
+    ".text\n"
+    ISR_NOERR(0)  ISR_NOERR(1)  ISR_NOERR(2)  ISR_NOERR(3)
+    ISR_NOERR(4)  ISR_NOERR(5)  ISR_NOERR(6)  ISR_NOERR(7)
+    ISR_ERR(8)    ISR_NOERR(9)  ISR_ERR(10)   ISR_ERR(11)
+    ISR_ERR(12)   ISR_ERR(13)   ISR_ERR(14)   ISR_NOERR(15)
+    ISR_NOERR(16) ISR_ERR(17)   ISR_NOERR(18) ISR_NOERR(19)
+    ISR_NOERR(20) ISR_NOERR(21) ISR_NOERR(22) ISR_NOERR(23)
+    ISR_NOERR(24) ISR_NOERR(25) ISR_NOERR(26) ISR_NOERR(27)
+    ISR_NOERR(28) ISR_NOERR(29) ISR_ERR(30)   ISR_NOERR(31)
+    ISR_NOERR(32) ISR_NOERR(33) ISR_NOERR(34) ISR_NOERR(35)
+    ISR_NOERR(36) ISR_NOERR(37) ISR_NOERR(38) ISR_NOERR(39)
+    ISR_NOERR(40) ISR_NOERR(41) ISR_NOERR(42) ISR_NOERR(43)
+    ISR_NOERR(44) ISR_NOERR(45) ISR_NOERR(46) ISR_NOERR(47)
+    ISR_NOERR(48) ISR_NOERR(49) ISR_NOERR(50) ISR_NOERR(51)
+    ISR_NOERR(52) ISR_NOERR(53) ISR_NOERR(54) ISR_NOERR(55)
+    ISR_NOERR(56) ISR_NOERR(57) ISR_NOERR(58) ISR_NOERR(59)
+    ISR_NOERR(60) ISR_NOERR(61) ISR_NOERR(62) ISR_NOERR(63)
+    "isr_common:\n"
+    "  pusha\n"
+    "  cld\n"
+    "  pushl %esp\n"
+    "  call isr_dispatch\n"
+    "  movl %eax, %esp\n"
+    "  popa\n"
+    "  addl $8, %esp\n"
+    "  iret\n"
+);
+
+#define ISR_STUB_DECL(n) extern void isr_stub_##n();
+ISR_STUB_DECL(0)  ISR_STUB_DECL(1)  ISR_STUB_DECL(2)  ISR_STUB_DECL(3)
+ISR_STUB_DECL(4)  ISR_STUB_DECL(5)  ISR_STUB_DECL(6)  ISR_STUB_DECL(7)
+ISR_STUB_DECL(8)  ISR_STUB_DECL(9)  ISR_STUB_DECL(10) ISR_STUB_DECL(11)
+ISR_STUB_DECL(12) ISR_STUB_DECL(13) ISR_STUB_DECL(14) ISR_STUB_DECL(15)
+ISR_STUB_DECL(16) ISR_STUB_DECL(17) ISR_STUB_DECL(18) ISR_STUB_DECL(19)
+ISR_STUB_DECL(20) ISR_STUB_DECL(21) ISR_STUB_DECL(22) ISR_STUB_DECL(23)
+ISR_STUB_DECL(24) ISR_STUB_DECL(25) ISR_STUB_DECL(26) ISR_STUB_DECL(27)
+ISR_STUB_DECL(28) ISR_STUB_DECL(29) ISR_STUB_DECL(30) ISR_STUB_DECL(31)
+ISR_STUB_DECL(32) ISR_STUB_DECL(33) ISR_STUB_DECL(34) ISR_STUB_DECL(35)
+ISR_STUB_DECL(36) ISR_STUB_DECL(37) ISR_STUB_DECL(38) ISR_STUB_DECL(39)
+ISR_STUB_DECL(40) ISR_STUB_DECL(41) ISR_STUB_DECL(42) ISR_STUB_DECL(43)
+ISR_STUB_DECL(44) ISR_STUB_DECL(45) ISR_STUB_DECL(46) ISR_STUB_DECL(47)
+ISR_STUB_DECL(48) ISR_STUB_DECL(49) ISR_STUB_DECL(50) ISR_STUB_DECL(51)
+ISR_STUB_DECL(52) ISR_STUB_DECL(53) ISR_STUB_DECL(54) ISR_STUB_DECL(55)
+ISR_STUB_DECL(56) ISR_STUB_DECL(57) ISR_STUB_DECL(58) ISR_STUB_DECL(59)
+ISR_STUB_DECL(60) ISR_STUB_DECL(61) ISR_STUB_DECL(62) ISR_STUB_DECL(63)
+
+static void (*const isr_stubs[IDT_STUB_COUNT])() = {
+    isr_stub_0,  isr_stub_1,  isr_stub_2,  isr_stub_3,
+    isr_stub_4,  isr_stub_5,  isr_stub_6,  isr_stub_7,
+    isr_stub_8,  isr_stub_9,  isr_stub_10, isr_stub_11,
+    isr_stub_12, isr_stub_13, isr_stub_14, isr_stub_15,
+    isr_stub_16, isr_stub_17, isr_stub_18, isr_stub_19,
+    isr_stub_20, isr_stub_21, isr_stub_22, isr_stub_23,
+    isr_stub_24, isr_stub_25, isr_stub_26, isr_stub_27,
+    isr_stub_28, isr_stub_29, isr_stub_30, isr_stub_31,
+    isr_stub_32, isr_stub_33, isr_stub_34, isr_stub_35,
+    isr_stub_36, isr_stub_37, isr_stub_38, isr_stub_39,
+    isr_stub_40, isr_stub_41, isr_stub_42, isr_stub_43,
+    isr_stub_44, isr_stub_45, isr_stub_46, isr_stub_47,
+    isr_stub_48, isr_stub_49, isr_stub_50, isr_stub_51,
+    isr_stub_52, isr_stub_53, isr_stub_54, isr_stub_55,
+    isr_stub_56, isr_stub_57, isr_stub_58, isr_stub_59,
+    isr_stub_60, isr_stub_61, isr_stub_62, isr_stub_63,
+};
+
+/* 8259 PIC 포트 */
+#define PIC1_CMD   0x20
+#define PIC1_DATA  0x21
+#define PIC2_CMD   0xA0
+#define PIC2_DATA  0xA1
+#define PIC_EOI    0x20
+
+static void idt_set_gate(uint8 vector, uint32 handler, uint16 selector) {
+    idt[vector].offset_low = handler & 0xFFFF;
+    idt[vector].selector = selector;
+    idt[vector].zero = 0;
+    idt[vector].type_attr = 0x8E;  /* present, ring 0, 32비트 인터럽트 게이트 */
+    idt[vector].offset_high = (handler >> 16) & 0xFFFF;
+}
+
+/* PIC 재배치: IRQ 0~15 -> 벡터 0x20~0x2F (CPU 예외와 겹치지 않게) */
+static void pic_remap() {
+    outb(PIC1_CMD, 0x11);
+    outb(PIC2_CMD, 0x11);
+    outb(PIC1_DATA, IRQ_BASE_VECTOR);
+    outb(PIC2_DATA, IRQ_BASE_VECTOR + 8);
+    outb(PIC1_DATA, 0x04);  /* 슬레이브는 IRQ2 에 연결 */
+    outb(PIC2_DATA, 0x02);
+    outb(PIC1_DATA, 0x01);  /* 8086 모드 */
+    outb(PIC2_DATA, 0x01);
+    /* 등록된 핸들러가 생길 때까지 모든 IRQ 마스크 */
+    outb(PIC1_DATA, 0xFF);
+    outb(PIC2_DATA, 0xFF);
+}
+
+void irq_mask(uint8 irq) {
+    uint16 port = (irq < 8) ? PIC1_DATA : PIC2_DATA;
+    outb(port, inb(port) | (uint8)(1 << (irq & 7)));
+}
+
+void irq_unmask(uint8 irq) {
+    uint16 port = (irq < 8) ? PIC1_DATA : PIC2_DATA;
+    outb(port, inb(port) & (uint8)~(1 << (irq & 7)));
+    if (irq >= 8) outb(PIC1_DATA, inb(PIC1_DATA) & (uint8)~(1 << 2));
+}
+
+void isr_register(uint8 vector, isr_handler_t handler) {
+    handlers[vector] = handler;
+}
+
+void irq_register(uint8 irq, isr_handler_t handler) {
+    handlers[IRQ_BASE_VECTOR + irq] = handler;
+    irq_unmask(irq);
+}
+
+static void exception_halt(interrupt_frame_t *frame) {
+    kprint("CPU exception ");
+    kprint_dec(frame->vector);
+    kprint(" at EIP ");
+    kprint_hex(frame->eip);
+    kprint(", error ");
+    kprint_hex(frame->error);
+    kprint("\nSystem halted.\n");
+    while (1) { __asm__ volatile ("cli; hlt"); }
+}
+
+uint32 isr_dispatch(interrupt_frame_t *frame) {
+    uint32 vector = frame->vector;
+    if (vector < IRQ_BASE_VECTOR) {
+        if (handlers[vector]) handlers[vector](frame);
+        else exception_halt(frame);
+        return (uint32)frame;
+    }
+    /* LAPIC 인터럽트 (AP 타이머 등): EOI 는 PIC 가 아니라 자기 LAPIC 에 */
+    if (vector >= LAPIC_VECTOR_BASE) {
+        if (handlers[vector]) handlers[vector](frame);
+        if (vector != LAPIC_SPURIOUS_VECTOR) lapic_eoi();
+        sched_irq_exit();
+        return (uint32)frame;
+    }
+    uint32 irq = vector - IRQ_BASE_VECTOR;
+    /* 스퓨리어스 IRQ7/15: ISR 비트가 없으면 EOI 없이 무시 */
+    if (irq == 7 || irq == 15) {
+        outb(irq == 7 ? PIC1_CMD : PIC2_CMD, 0x0B);
+        if (!(inb(irq == 7 ? PIC1_CMD : PIC2_CMD) & 0x80)) {
+            if (irq == 15) outb(PIC1_CMD, PIC_EOI);
+            return (uint32)frame;
+        }
+    }
+    if (handlers[vector]) handlers[vector](frame);
+    if (irq >= 8) outb(PIC2_CMD, PIC_EOI);
+    outb(PIC1_CMD, PIC_EOI);
+    /* EOI 뒤에 전환해야 다음 프로세스에서도 타이머 IRQ 가 들어온다.
+       돌아오면 이 프로세스의 스택에 남은 frame 으로 복귀한다. */
+    sched_irq_exit();
+    return (uint32)frame;
+}
+
+/* IDT 는 모든 CPU 가 함께 쓴다. AP 는 부팅 뒤 이것만 다시 부른다 */
+void idt_load() {
+    idt_ptr_t ptr;
+    ptr.limit = sizeof(idt) - 1;
+    ptr.base = (uint32)idt;
+    __asm__ volatile ("lidt %0" :: "m"(ptr));
+}
+
+void idt_init() {
+    uint32 i;
+    uint16 cs;
+
+    /* 부트 환경(GRUB/부트로더)이 설정한 코드 세그먼트를 그대로 사용 */
+    __asm__ volatile ("mov %%cs, %0" : "=r"(cs));
+    memset(idt, 0, sizeof(idt));
+    memset(handlers, 0, sizeof(handlers));
+    for (i = 0; i < IDT_STUB_COUNT; i++)
+        idt_set_gate((uint8)i, (uint32)isr_stubs[i], cs);
+
+    pic_remap();
+    idt_load();
+}
@@ -0,0 +1,24 @@
+#ifndef IDT_H
+#define IDT_H
+
+#include "dc.h"
+
+/* 인터럽트 진입 시 스택에 저장되는 레지스터 (isr_common 참고) */
+typedef struct {
+    uint32 edi, esi, ebp, esp, ebx, edx, ecx, eax;  /* pusha */
+    uint32 vector;
+    uint32 error;
+    uint32 eip, cs, eflags;                         /* CPU가 push */
+} interrupt_frame_t;
+
+typedef void (*isr_handler_t)(interrupt_frame_t *frame);
+
+void idt_init();
+void idt_load();
+void isr_register(uint8 vector, isr_handler_t handler);
+void irq_register(uint8 irq, isr_handler_t handler);
+void irq_mask(uint8 irq);
+void irq_unmask(uint8 irq);
+uint32 isr_dispatch(interrupt_frame_t *frame);
+
+#endif //IDT_H
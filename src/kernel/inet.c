@@ -0,0 +1,797 @@
+#include "inet.h"
+#include "tcp.h"
+#include "network.h"
+#include "keyboard.h"
+#include "kprint.h"
+#include "spinlock.h"
+#include "timer.h"
+#include "cpu.h"
+#include "type.h"
+
+/*=========================*/
+/* 8-2. ARP / IPv4 / ICMP / UDP */
+/*=========================*/
+/*
+ * network_stack_poll 이 꺼낸 프레임을 EtherType 으로 나눠 받는다. 인터페이스는 NE2000 하나,
+ * 주소는 정적 설정 (QEMU user 네트워크의 10.0.2.15/24, 게이트웨이 10.0.2.2).
+ * 응답 (ICMP echo, UDP echo) 은 받은 mbuf 를 그 자리에서 고쳐 돌려보내고, 바뀐 필드만큼만
+ * 체크섬을 증분으로 고친다. 조각난 IP 는 재조립하지 않는다.
+ */
+#define ARP_HTYPE_ETH     1
+#define ARP_OP_REQUEST    1
+#define ARP_OP_REPLY      2
+#define ICMP_ECHO_REPLY   0
+#define ICMP_ECHO_REQUEST 8
+#define IP_DF             0x4000
+#define IP_FRAG_MASK      0x3FFF   /* MF + offset */
+#define IP_BROADCAST      0xFFFFFFFF
+#define UDP_BLAST_SPORT   40000
+#define UDP_BLAST_PORT    9          /* discard */
+#define MS_TICKS(ms)      ((ms) * SCHED_HZ / 1000)
+
+typedef uint32 __attribute__((may_alias)) uint32_alias;
+typedef uint16 __attribute__((may_alias)) uint16_alias;
+
+enum { ARP_FREE = 0, ARP_PENDING, ARP_RESOLVED };
+
+typedef struct arp_entry {
+    struct arp_entry *next;   /* 해시 체인 */
+    uint32 ip;
+    uint8 mac[6];
+    uint8 state;
+    uint8 tries;              /* PENDING: 보낸 요청 수 */
+    uint32 stamp;             /* RESOLVED: 배운 시각, PENDING: 마지막 요청 시각 (timer_ticks) */
+    uint32 used;              /* 마지막으로 쓴 시각: 가득 찼을 때 내보낼 항목 */
+    mbuf_t *hold;             /* 해석을 기다리는 IP 패킷 하나 */
+} arp_entry_t;
+
+inet_stats_t inet_stats;
+uint32 net_ip = NET_DEFAULT_IP, net_gw = NET_DEFAULT_GW, net_mask = NET_DEFAULT_MASK;
+
+static arp_entry_t arp_table[ARP_CACHE_SIZE];
+static arp_entry_t *arp_hash[ARP_HASH_BUCKETS];
+static spinlock_t arp_lock = SPINLOCK_INIT;
+static uint32 arp_last_sweep = 0;
+static const uint8 eth_broadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+static struct {
+    uint16 port;
+    udp_handler_t handler;
+} udp_ports[UDP_PORT_SLOTS];
+static spinlock_t udp_lock = SPINLOCK_INIT;
+
+static volatile uint16 ip_next_id = 0;
+
+/* ping 이 기다리는 응답 (icmp_input 이 채운다) */
+static volatile struct {
+    uint16 id;
+    uint16 seq;
+    uint32 replied;
+    uint32 ttl;
+    uint64 rtt;
+} ping_wait;
+
+/*=========================*/
+/* 체크섬 */
+/*=========================*/
+/*
+ * 32비트 워드를 64비트 합에 더한다 (i386 에서는 add/adc 한 쌍): 16비트씩 더하며 매번
+ * 접는 것보다 반복 횟수가 반이고, 자리올림은 끝에 한 번만 접는다.
+ */
+uint32 inet_csum_partial(const void *buf, uint32 len, uint32 sum) {
+    const uint8 *p = (const uint8*)buf;
+    uint64 acc = sum;
+    while (len >= 16) {
+        acc += ((const uint32_alias*)p)[0];
+        acc += ((const uint32_alias*)p)[1];
+        acc += ((const uint32_alias*)p)[2];
+        acc += ((const uint32_alias*)p)[3];
+        p += 16;
+        len -= 16;
+    }
+    while (len >= 4) {
+        acc += *(const uint32_alias*)p;
+        p += 4;
+        len -= 4;
+    }
+    if (len >= 2) {
+        acc += *(const uint16_alias*)p;
+        p += 2;
+        len -= 2;
+    }
+    if (len) acc += *p;   /* 홀수 끝 바이트는 상위 바이트 (리틀 엔디언 메모리에서는 하위) */
+    acc = (acc & 0xFFFFFFFF) + (acc >> 32);
+    acc = (acc & 0xFFFFFFFF) + (acc >> 32);
+    return (uint32)acc;
+}
+
+/*=========================*/
+/* Ethernet 송신 */
+/*=========================*/
+/* 큐가 가득 차면 카드가 슬롯을 비울 때까지 펌프한다. 항상 m 을 가진다 */
+static int eth_output(mbuf_t *m, const uint8 *dst, uint16 type) {
+    eth_hdr_t *eh = (eth_hdr_t*)mbuf_prepend(m, sizeof(eth_hdr_t));
+    uint32 spins = TX_RETRY_SPINS;
+    if (!eh) goto drop;
+    memcpy(eh->dst, dst, 6);
+    memcpy(eh->src, ne2k_mac_addr(), 6);
+    eh->type = htons(type);
+    while (ne2k_xmit(m) != 0) {
+        if (!ne2k_present() || --spins == 0) goto drop;
+        ne2k_tx_pump();
+    }
+    return 0;
+drop:
+    inet_stats.tx_drops++;
+    mbuf_free(m);
+    return -1;
+}
+
+/*=========================*/
+/* ARP 캐시 */
+/*=========================*/
+static uint32 arp_bucket(uint32 ip) {
+    ip ^= ip >> 16;
+    ip ^= ip >> 8;
+    return ip & (ARP_HASH_BUCKETS - 1);
+}
+
+/* (arp_lock) */
+static arp_entry_t *arp_find(uint32 ip) {
+    arp_entry_t *e;
+    for (e = arp_hash[arp_bucket(ip)]; e; e = e->next)
+        if (e->ip == ip) return e;
+    return 0;
+}
+
+/* 체인에서 빼고 비운다. 기다리던 패킷이 있으면 돌려준다 (arp_lock) */
+static mbuf_t *arp_remove(arp_entry_t *e) {
+    arp_entry_t **pp = &arp_hash[arp_bucket(e->ip)];
+    mbuf_t *hold = e->hold;
+    while (*pp && *pp != e) pp = &(*pp)->next;
+    if (*pp) *pp = e->next;
+    memset(e, 0, sizeof(*e));
+    return hold;
+}
+
+/* 빈 칸, 없으면 가장 오래 안 쓴 항목을 내보내고 PENDING 으로 (arp_lock) */
+static arp_entry_t *arp_new(uint32 ip, mbuf_t **drop) {
+    arp_entry_t *e, *victim = 0;
+    uint32 i, b;
+    for (i = 0; i < ARP_CACHE_SIZE; i++) {
+        e = &arp_table[i];
+        if (e->state == ARP_FREE) {
+            victim = e;
+            break;
+        }
+        if (!victim || (int)(e->used - victim->used) < 0) victim = e;
+    }
+    if (victim->state != ARP_FREE) *drop = arp_remove(victim);
+    b = arp_bucket(ip);
+    victim->ip = ip;
+    victim->state = ARP_PENDING;
+    victim->used = timer_ticks;
+    victim->next = arp_hash[b];
+    arp_hash[b] = victim;
+    return victim;
+}
+
+static void arp_send(uint16 op, const uint8 *dst_mac, uint32 tpa) {
+    mbuf_t *m = mbuf_alloc();
+    arp_pkt_t *a;
+    if (!m) return;
+    a = (arp_pkt_t*)mbuf_append(m, sizeof(arp_pkt_t));
+    a->htype = htons(ARP_HTYPE_ETH);
+    a->ptype = htons(ETH_P_IP);
+    a->hlen = 6;
+    a->plen = 4;
+    a->op = htons(op);
+    memcpy(a->sha, ne2k_mac_addr(), 6);
+    a->spa = htonl(net_ip);
+    if (op == ARP_OP_REQUEST) memset(a->tha, 0, 6);
+    else memcpy(a->tha, dst_mac, 6);
+    a->tpa = htonl(tpa);
+    if (op == ARP_OP_REQUEST) inet_stats.arp_requests++;
+    else inet_stats.arp_replies++;
+    eth_output(m, dst_mac, ETH_P_ARP);
+}
+
+/* next_hop 의 MAC 으로 보낸다. 모르면 m 을 잡아 두고 요청을 보낸다 (응답이 오면 arp_input 이 보낸다) */
+static int arp_output(mbuf_t *m, uint32 next_hop) {
+    uint32 flags, now = timer_ticks, ask = 0;
+    arp_entry_t *e;
+    mbuf_t *drop = 0;
+    uint8 mac[6];
+
+    flags = spin_lock_irqsave(&arp_lock);
+    e = arp_find(next_hop);
+    if (e && e->state == ARP_RESOLVED && now - e->stamp < MS_TICKS(ARP_TIMEOUT_MS)) {
+        memcpy(mac, e->mac, 6);
+        e->used = now;
+        inet_stats.arp_hits++;
+        spin_unlock_irqrestore(&arp_lock, flags);
+        return eth_output(m, mac, ETH_P_IP);
+    }
+    inet_stats.arp_misses++;
+    if (!e) {
+        e = arp_new(next_hop, &drop);
+        ask = 1;
+    } else if (e->state == ARP_RESOLVED) {
+        e->state = ARP_PENDING;   /* 만료: 다시 묻는다 */
+        e->tries = 0;
+        ask = 1;
+    } else if (now - e->stamp >= MS_TICKS(ARP_RETRY_MS)) {
+        ask = 1;
+    }
+    if (e->hold) drop = e->hold;   /* 잡아 두는 것은 가장 최근 패킷 하나 */
+    if (drop) inet_stats.arp_hold_drops++;
+    e->hold = m;
+    e->used = now;
+    if (ask) {
+        e->stamp = now;
+        e->tries++;
+    }
+    spin_unlock_irqrestore(&arp_lock, flags);
+    if (drop) mbuf_free(drop);
+    if (ask) arp_send(ARP_OP_REQUEST, eth_broadcast, next_hop);
+    return 0;
+}
+
+static void arp_input(mbuf_t *m) {
+    arp_pkt_t *a = (arp_pkt_t*)m->data;
+    uint32 flags, spa, tpa;
+    arp_entry_t *e;
+    mbuf_t *hold = 0, *drop = 0;
+    uint8 sha[6];
+
+    if (m->len < sizeof(arp_pkt_t) || a->htype != htons(ARP_HTYPE_ETH) || a->ptype != htons(ETH_P_IP) ||
+        a->hlen != 6 || a->plen != 4) {
+        mbuf_free(m);
+        return;
+    }
+    spa = ntohl(a->spa);
+    tpa = ntohl(a->tpa);
+    memcpy(sha, a->sha, 6);
+
+    /* 아는 주소면 갱신하고, 우리에게 묻거나 답한 쪽은 새로 넣는다 (RFC 826) */
+    flags = spin_lock_irqsave(&arp_lock);
+    e = spa ? arp_find(spa) : 0;
+    if (!e && spa && tpa == net_ip) e = arp_new(spa, &drop);
+    if (e) {
+        memcpy(e->mac, sha, 6);
+        e->state = ARP_RESOLVED;
+        e->stamp = e->used = timer_ticks;
+        e->tries = 0;
+        hold = e->hold;
+        e->hold = 0;
+    }
+    spin_unlock_irqrestore(&arp_lock, flags);
+
+    if (drop) {
+        inet_stats.arp_hold_drops++;
+        mbuf_free(drop);
+    }
+    if (hold) eth_output(hold, sha, ETH_P_IP);
+    if (a->op == htons(ARP_OP_REQUEST) && tpa == net_ip) arp_send(ARP_OP_REPLY, sha, spa);
+    mbuf_free(m);
+}
+
+/* 오래된 항목을 지우고, 답이 없는 요청은 ARP_MAX_TRIES 번까지 다시 보낸다 */
+void inet_poll() {
+    uint32 flags, now = timer_ticks, i, n = 0;
+    uint32 retry[ARP_CACHE_SIZE];
+    arp_entry_t *e;
+    mbuf_t *hold;
+
+    if (now - arp_last_sweep < MS_TICKS(ARP_RETRY_MS)) return;
+    flags = spin_lock_irqsave(&arp_lock);
+    arp_last_sweep = now;
+    for (i = 0; i < ARP_CACHE_SIZE; i++) {
+        e = &arp_table[i];
+        if (e->state == ARP_RESOLVED && now - e->stamp >= MS_TICKS(ARP_TIMEOUT_MS)) {
+            arp_remove(e);
+        } else if (e->state == ARP_PENDING && now - e->stamp >= MS_TICKS(ARP_RETRY_MS)) {
+            if (e->tries >= ARP_MAX_TRIES) {
+                if ((hold = arp_remove(e)) != 0) {
+                    inet_stats.arp_hold_drops++;
+                    mbuf_free(hold);
+                }
+                continue;
+            }
+            e->stamp = now;
+            e->tries++;
+            retry[n++] = e->ip;
+        }
+    }
+    spin_unlock_irqrestore(&arp_lock, flags);
+    for (i = 0; i < n; i++) arp_send(ARP_OP_REQUEST, eth_broadcast, retry[i]);
+}
+
+/* 해석될 때까지 요청을 보내며 기다린다 (ms 안에 못 하면 -1) */
+static int arp_resolve_wait(uint32 ip, uint32 ms) {
+    uint32 flags, start = timer_ticks, last = 0, resolved = 0;
+    arp_entry_t *e;
+    while (1) {
+        flags = spin_lock_irqsave(&arp_lock);
+        e = arp_find(ip);
+        resolved = e && e->state == ARP_RESOLVED;
+        spin_unlock_irqrestore(&arp_lock, flags);
+        if (resolved) return 0;
+        if (timer_ticks - start >= MS_TICKS(ms)) return -1;
+        if (last == 0 || timer_ticks - last >= MS_TICKS(ARP_RETRY_MS)) {
+            last = timer_ticks | 1;
+            arp_send(ARP_OP_REQUEST, eth_broadcast, ip);
+        }
+        network_stack_poll();
+        network_idle();
+    }
+}
+
+/*=========================*/
+/* IPv4 */
+/*=========================*/
+static int ip_route(mbuf_t *m, uint32 dst) {
+    inet_stats.ip_out++;
+    if (dst == IP_BROADCAST || dst == (net_ip | ~net_mask)) return eth_output(m, eth_broadcast, ETH_P_IP);
+    return arp_output(m, (dst & net_mask) == (net_ip & net_mask) ? dst : net_gw);
+}
+
+int ip_output(mbuf_t *m, uint32 dst, uint8 proto) {
+    ipv4_hdr_t *ip = (ipv4_hdr_t*)mbuf_prepend(m, sizeof(ipv4_hdr_t));
+    if (!ip) {
+        inet_stats.tx_drops++;
+        mbuf_free(m);
+        return -1;
+    }
+    ip->ver_ihl = 0x45;
+    ip->tos = 0;
+    ip->len = htons((uint16)m->len);
+    ip->id = htons(__sync_fetch_and_add(&ip_next_id, 1));
+    ip->frag = htons(IP_DF);
+    ip->ttl = IP_DEFAULT_TTL;
+    ip->proto = proto;
+    ip->csum = 0;
+    ip->src = htonl(net_ip);
+    ip->dst = htonl(dst);
+    ip->csum = inet_checksum(ip, sizeof(ipv4_hdr_t));
+    return ip_route(m, dst);
+}
+
+/*
+ * 주소를 맞바꾸는 것은 IP 헤더와 TCP/UDP 의사 헤더의 합을 바꾸지 않으므로
+ * TTL 만 증분으로 고친다. 우리 주소로 온 것만 (브로드캐스트에는 답하지 않는다).
+ */
+int ip_reflect(mbuf_t *m) {
+    ipv4_hdr_t *ip = (ipv4_hdr_t*)m->data;
+    uint32 src = ip->src;
+    uint16 old;
+    if (ip->dst != htonl(net_ip)) {
+        mbuf_free(m);
+        return -1;
+    }
+    ip->src = ip->dst;
+    ip->dst = src;
+    old = *(uint16_alias*)&ip->ttl;   /* ttl 과 proto 는 한 워드 */
+    ip->ttl = IP_DEFAULT_TTL;
+    ip->csum = inet_csum_update16(ip->csum, old, *(uint16_alias*)&ip->ttl);
+    return ip_route(m, ntohl(src));
+}
+
+static void icmp_input(mbuf_t *m, ipv4_hdr_t *ip, uint32 hl) {
+    icmp_hdr_t *ic = (icmp_hdr_t*)((uint8*)ip + hl);
+    uint32 len = m->len - hl;
+    uint16 old;
+    uint64 sent;
+
+    if (len < sizeof(icmp_hdr_t) || inet_checksum(ic, len) != 0) {
+        inet_stats.ip_bad++;
+        mbuf_free(m);
+        return;
+    }
+    if (ic->type == ICMP_ECHO_REQUEST && ic->code == 0) {
+        /* 받은 버퍼가 그대로 답장: type 만 바꾸고 체크섬은 증분으로 */
+        inet_stats.icmp_echo_in++;
+        old = *(uint16_alias*)ic;
+        ic->type = ICMP_ECHO_REPLY;
+        ic->csum = inet_csum_update16(ic->csum, old, *(uint16_alias*)ic);
+        if (ip_reflect(m) == 0) inet_stats.icmp_echo_out++;
+        return;
+    }
+    if (ic->type == ICMP_ECHO_REPLY && ntohs(ic->id) == ping_wait.id && ntohs(ic->seq) == ping_wait.seq &&
+        len >= sizeof(icmp_hdr_t) + sizeof(uint64)) {
+        memcpy(&sent, ic + 1, sizeof(sent));   /* 보낼 때 넣은 TSC */
+        ping_wait.rtt = rdtsc() - sent;
+        ping_wait.ttl = ip->ttl;
+        ping_wait.replied = 1;
+    }
+    mbuf_free(m);
+}
+
+static void udp_input(mbuf_t *m, ipv4_hdr_t *ip, uint32 hl) {
+    udp_hdr_t *uh = (udp_hdr_t*)((uint8*)ip + hl);
+    uint32 len = ntohs(uh->len), i;
+    udp_handler_t handler = 0;
+
+    if (m->len - hl < sizeof(udp_hdr_t) || len < sizeof(udp_hdr_t) || len > m->len - hl ||
+        (uh->csum && inet_csum_fold(inet_csum_partial(uh, len,
+                        inet_pseudo_sum(ip->src, ip->dst, IP_PROTO_UDP, (uint16)len))) != 0)) {
+        inet_stats.udp_bad++;
+        mbuf_free(m);
+        return;
+    }
+    inet_stats.udp_in++;
+    for (i = 0; i < UDP_PORT_SLOTS; i++) {
+        if (udp_ports[i].port == ntohs(uh->dport)) {
+            handler = udp_ports[i].handler;
+            break;
+        }
+    }
+    if (!handler) {
+        inet_stats.udp_no_port++;
+        mbuf_free(m);
+        return;
+    }
+    handler(m, ip, uh);
+}
+
+static void ip_input(mbuf_t *m) {
+    ipv4_hdr_t *ip = (ipv4_hdr_t*)m->data;
+    uint32 hl, len, dst;
+
+    inet_stats.ip_in++;
+    if (m->len < sizeof(ipv4_hdr_t)) goto bad;
+    hl = (ip->ver_ihl & 0x0F) * 4;
+    len = ntohs(ip->len);
+    if ((ip->ver_ihl >> 4) != 4 || hl < sizeof(ipv4_hdr_t) || len < hl || len > m->len ||
+        inet_checksum(ip, hl) != 0) goto bad;
+    m->len = len;   /* 최소 프레임 길이를 채운 패딩을 잘라 낸다 */
+    dst = ntohl(ip->dst);
+    if (dst != net_ip && dst != IP_BROADCAST && dst != (net_ip | ~net_mask)) {
+        inet_stats.ip_not_ours++;
+        mbuf_free(m);
+        return;
+    }
+    if (ntohs(ip->frag) & IP_FRAG_MASK) {
+        inet_stats.ip_frags++;
+        mbuf_free(m);
+        return;
+    }
+    switch (ip->proto) {
+        case IP_PROTO_ICMP: icmp_input(m, ip, hl); return;
+        case IP_PROTO_UDP: udp_input(m, ip, hl); return;
+        case IP_PROTO_TCP: tcp_input(m, ip, hl); return;
+    }
+    inet_stats.unknown_type++;
+    mbuf_free(m);
+    return;
+bad:
+    inet_stats.ip_bad++;
+    mbuf_free(m);
+}
+
+void inet_input(mbuf_t *m) {
+    eth_hdr_t *eh = (eth_hdr_t*)m->data;
+    uint16 type;
+    if (m->len < sizeof(eth_hdr_t)) {
+        mbuf_free(m);
+        return;
+    }
+    type = ntohs(eh->type);
+    mbuf_pull(m, sizeof(eth_hdr_t));
+    if (type == ETH_P_IP) ip_input(m);
+    else if (type == ETH_P_ARP) arp_input(m);
+    else {
+        inet_stats.unknown_type++;
+        mbuf_free(m);
+    }
+}
+
+/*=========================*/
+/* UDP */
+/*=========================*/
+int udp_output(mbuf_t *m, uint16 sport, uint32 dst, uint16 dport) {
+    udp_hdr_t *uh = (udp_hdr_t*)mbuf_prepend(m, sizeof(udp_hdr_t));
+    uint16 csum;
+    if (!uh) {
+        inet_stats.tx_drops++;
+        mbuf_free(m);
+        return -1;
+    }
+    uh->sport = htons(sport);
+    uh->dport = htons(dport);
+    uh->len = htons((uint16)m->len);
+    uh->csum = 0;
+    csum = inet_csum_fold(inet_csum_partial(uh, m->len,
+               inet_pseudo_sum(htonl(net_ip), htonl(dst), IP_PROTO_UDP, (uint16)m->len)));
+    uh->csum = csum ? csum : 0xFFFF;   /* 0 은 "체크섬 없음" */
+    inet_stats.udp_out++;
+    return ip_output(m, dst, IP_PROTO_UDP);
+}
+
+int udp_bind(uint16 port, udp_handler_t handler) {
+    uint32 flags = spin_lock_irqsave(&udp_lock), i, slot = UDP_PORT_SLOTS;
+    for (i = 0; i < UDP_PORT_SLOTS; i++) {
+        if (udp_ports[i].port == port) slot = UDP_PORT_SLOTS + 1;
+        if (udp_ports[i].port == 0 && slot == UDP_PORT_SLOTS) slot = i;
+    }
+    if (slot >= UDP_PORT_SLOTS) {
+        spin_unlock_irqrestore(&udp_lock, flags);
+        return -1;
+    }
+    udp_ports[slot].handler = handler;
+    __asm__ volatile ("" ::: "memory");   /* 핸들러를 쓴 뒤에 포트를 보인다 */
+    udp_ports[slot].port = port;
+    spin_unlock_irqrestore(&udp_lock, flags);
+    return 0;
+}
+
+void udp_unbind(uint16 port) {
+    uint32 flags = spin_lock_irqsave(&udp_lock), i;
+    for (i = 0; i < UDP_PORT_SLOTS; i++)
+        if (udp_ports[i].port == port) udp_ports[i].port = 0;
+    spin_unlock_irqrestore(&udp_lock, flags);
+}
+
+void inet_init() {
+    uint32 flags = spin_lock_irqsave(&arp_lock);
+    memset(arp_table, 0, sizeof(arp_table));
+    memset(arp_hash, 0, sizeof(arp_hash));
+    spin_unlock_irqrestore(&arp_lock, flags);
+    memset(udp_ports, 0, sizeof(udp_ports));
+    memset(&inet_stats, 0, sizeof(inet_stats));
+}
+
+/*=========================*/
+/* 주소 표기 */
+/*=========================*/
+int ip_parse(const char *s, uint32 *ip) {
+    uint32 v = 0, part, i;
+    for (i = 0; i < 4; i++) {
+        if (*s < '0' || *s > '9') return -1;
+        part = 0;
+        while (*s >= '0' && *s <= '9') {
+            part = part * 10 + (uint32)(*s++ - '0');
+            if (part > 255) return -1;
+        }
+        v = (v << 8) | part;
+        if (i < 3 && *s++ != '.') return -1;
+    }
+    if (*s) return -1;
+    *ip = v;
+    return 0;
+}
+
+void inet_print_addr(uint32 ip) {
+    kprintf("%u.%u.%u.%u", ip >> 24, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF);
+}
+
+/*=========================*/
+/* 명령어: arp, ping, csumbench, udpblast */
+/*=========================*/
+void arp_cmd() {
+    static arp_entry_t snap[ARP_CACHE_SIZE];   /* 셸에서만 부른다 */
+    uint32 flags, i, n = 0, now = timer_ticks;
+
+    flags = spin_lock_irqsave(&arp_lock);
+    for (i = 0; i < ARP_CACHE_SIZE; i++)
+        if (arp_table[i].state != ARP_FREE) snap[n++] = arp_table[i];
+    spin_unlock_irqrestore(&arp_lock, flags);
+
+    kprint("Address          HW address         State     Age (ms)\n");
+    for (i = 0; i < n; i++) {
+        inet_print_addr(snap[i].ip);
+        kprint("  ");
+        if (snap[i].state == ARP_RESOLVED)
+            kprintf("%02x:%02x:%02x:%02x:%02x:%02x  resolved ",
+                    snap[i].mac[0], snap[i].mac[1], snap[i].mac[2],
+                    snap[i].mac[3], snap[i].mac[4], snap[i].mac[5]);
+        else
+            kprintf("(incomplete)       pending%u ", (uint32)snap[i].tries);
+        kprintf(" %u\n", (now - snap[i].stamp) * 1000 / SCHED_HZ);
+    }
+    kprintf("%u entries. Requests %u, replies %u, hits %u, misses %u, held packets dropped %u\n",
+            n, inet_stats.arp_requests, inet_stats.arp_replies, inet_stats.arp_hits,
+            inet_stats.arp_misses, inet_stats.arp_hold_drops);
+    kprintf("IP: in %u, out %u, bad %u, not ours %u, fragments %u; ICMP echo in %u, out %u\n",
+            inet_stats.ip_in, inet_stats.ip_out, inet_stats.ip_bad, inet_stats.ip_not_ours,
+            inet_stats.ip_frags, inet_stats.icmp_echo_in, inet_stats.icmp_echo_out);
+    kprintf("UDP: in %u, out %u, bad %u, no port %u; TX drops %u, unknown types %u\n",
+            inet_stats.udp_in, inet_stats.udp_out, inet_stats.udp_bad, inet_stats.udp_no_port,
+            inet_stats.tx_drops, inet_stats.unknown_type);
+}
+
+static void print_ms(uint32 us) {
+    kprintf("%u.%03u ms", us / 1000, us % 1000);
+}
+
+void ping_cmd(const char *host, uint32 count) {
+    uint32 dst, seq, start, us, sent = 0, received = 0, min = 0xFFFFFFFF, max = 0, total = 0, i;
+    uint64 now;
+    icmp_hdr_t *ic;
+    uint8 *p;
+    mbuf_t *m;
+
+    if (!host || ip_parse(host, &dst) != 0) {
+        kprint("Usage: ping <a.b.c.d> [count]\n");
+        return;
+    }
+    if (!ne2k_present()) {
+        kprint("ping: no NIC\n");
+        return;
+    }
+    if (count == 0) count = PING_DEFAULT_COUNT;
+    ping_wait.id = (uint16)(timer_ticks ^ 0x4B4E);
+    kprintf("PING %s: %u data bytes (any key stops)\n", host, PING_PAYLOAD);
+
+    for (seq = 1; seq <= count; seq++) {
+        while ((m = mbuf_alloc()) == 0) network_stack_poll();
+        p = mbuf_append(m, PING_PAYLOAD);
+        for (i = sizeof(uint64); i < PING_PAYLOAD; i++) p[i] = (uint8)i;
+        ic = (icmp_hdr_t*)mbuf_prepend(m, sizeof(icmp_hdr_t));
+        ic->type = ICMP_ECHO_REQUEST;
+        ic->code = 0;
+        ic->id = htons(ping_wait.id);
+        ic->seq = htons((uint16)seq);
+        ping_wait.seq = (uint16)seq;
+        ping_wait.replied = 0;
+        start = timer_ticks;
+        now = rdtsc();
+        memcpy(ic + 1, &now, sizeof(now));
+        ic->csum = 0;
+        ic->csum = inet_checksum(ic, m->len);
+        ip_output(m, dst, IP_PROTO_ICMP);
+        sent++;
+
+        while (!ping_wait.replied && timer_ticks - start < MS_TICKS(PING_TIMEOUT_MS) && !kbd_pending()) {
+            network_stack_poll();
+            network_idle();
+        }
+        if (ping_wait.replied) {
+            us = cycles_to_us(ping_wait.rtt);
+            received++;
+            total += us;
+            if (us < min) min = us;
+            if (us > max) max = us;
+            kprintf("%u bytes from %s: icmp_seq=%u ttl=%u time=",
+                    (uint32)(sizeof(icmp_hdr_t) + PING_PAYLOAD), host, seq, ping_wait.ttl);
+            print_ms(us);
+            kprint("\n");
+        } else if (!kbd_pending()) {
+            kprintf("Request timeout for icmp_seq %u\n", seq);
+        }
+        /* 다음 요청은 1 초 간격으로 */
+        while (seq < count && timer_ticks - start < MS_TICKS(1000) && !kbd_pending()) {
+            network_stack_poll();
+            network_idle();
+        }
+        if (kbd_pending()) {
+            kbd_getchar();
+            break;
+        }
+    }
+    kprintf("--- %s ping statistics ---\n", host);
+    kprintf("%u packets transmitted, %u received, %u%% packet loss\n",
+            sent, received, sent ? (sent - received) * 100 / sent : 0);
+    if (received) {
+        kprint("rtt min/avg/max = ");
+        print_ms(min); kprint(" / ");
+        print_ms(total / received); kprint(" / ");
+        print_ms(max); kprint("\n");
+    }
+}
+
+/* 비교 기준: 16비트씩 더하며 매번 자리올림을 접는 교과서 구현 */
+static uint16 csum_reference(const uint8 *p, uint32 len) {
+    uint32 sum = 0;
+    while (len > 1) {
+        sum += *(const uint16_alias*)p;
+        sum = (sum & 0xFFFF) + (sum >> 16);
+        p += 2;
+        len -= 2;
+    }
+    if (len) sum += *p;
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16)~sum;
+}
+
+static uint8 csum_buf[ETH_FRAME_MAX];
+
+void csum_bench_cmd() {
+    uint32 i, len = ETH_FRAME_MAX - sizeof(eth_hdr_t), rounds = CSUM_BENCH_ROUNDS;
+    volatile uint16 sink = 0;
+    ipv4_hdr_t *ip = (ipv4_hdr_t*)csum_buf;
+    uint64 t0, ref, fast, full, incr;
+    uint16 old;
+
+    for (i = 0; i < sizeof(csum_buf); i++) csum_buf[i] = (uint8)(i * 31 + 7);
+    if (csum_reference(csum_buf, len) != inet_checksum(csum_buf, len) ||
+        csum_reference(csum_buf, len - 1) != inet_checksum(csum_buf, len - 1)) {
+        kprint("csumbench: checksum mismatch\n");
+        return;
+    }
+
+    t0 = rdtsc();
+    for (i = 0; i < rounds; i++) sink += csum_reference(csum_buf, len);
+    ref = rdtsc() - t0;
+    t0 = rdtsc();
+    for (i = 0; i < rounds; i++) sink += inet_checksum(csum_buf, len);
+    fast = rdtsc() - t0;
+
+    /* TTL 을 바꾼 IP 헤더: 전체 재계산 vs 증분 */
+    ip->csum = 0;
+    ip->csum = inet_checksum(ip, sizeof(ipv4_hdr_t));
+    t0 = rdtsc();
+    for (i = 0; i < rounds; i++) {
+        ip->ttl = (uint8)i;
+        ip->csum = 0;
+        ip->csum = inet_checksum(ip, sizeof(ipv4_hdr_t));
+    }
+    full = rdtsc() - t0;
+    t0 = rdtsc();
+    for (i = 0; i < rounds; i++) {
+        old = *(uint16_alias*)&ip->ttl;
+        ip->ttl = (uint8)(i + 1);
+        ip->csum = inet_csum_update16(ip->csum, old, *(uint16_alias*)&ip->ttl);
+    }
+    incr = rdtsc() - t0;
+    if (inet_checksum(ip, sizeof(ipv4_hdr_t)) != 0) kprint("csumbench: incremental update drifted\n");
+    (void)sink;
+
+    kprintf("Checksum over %u bytes, %u rounds:\n", len, rounds);
+    kprintf("  16-bit fold per word:   %u cycles/packet, %u MB/s\n",
+            (uint32)udiv64(ref, rounds), (uint32)udiv64((uint64)len * rounds, cycles_to_us(ref) ? cycles_to_us(ref) : 1));
+    kprintf("  32-bit words, 64 acc:   %u cycles/packet, %u MB/s\n",
+            (uint32)udiv64(fast, rounds), (uint32)udiv64((uint64)len * rounds, cycles_to_us(fast) ? cycles_to_us(fast) : 1));
+    kprintf("IP header TTL rewrite: full %u cycles, incremental %u cycles\n",
+            (uint32)udiv64(full, rounds), (uint32)udiv64(incr, rounds));
+}
+
+void udp_blast_cmd(uint32 count, uint32 size, uint32 dst, uint16 port) {
+    uint32 i, us, pkts, retries = 0;
+    net_stats_t before = net_stats;
+    uint64 t0;
+    uint8 *p;
+    mbuf_t *m;
+
+    if (!ne2k_present()) {
+        kprint("udpblast: no NIC\n");
+        return;
+    }
+    if (count == 0) count = UDP_BLAST_DEFAULT;
+    if (size == 0) size = UDP_BLAST_PAYLOAD;
+    if (size > ETH_FRAME_MAX - 42) size = ETH_FRAME_MAX - 42;
+    if (dst == 0) dst = net_gw;
+    if (port == 0) port = UDP_BLAST_PORT;
+    if (dst != IP_BROADCAST &&
+        arp_resolve_wait((dst & net_mask) == (net_ip & net_mask) ? dst : net_gw, PING_TIMEOUT_MS) != 0) {
+        kprint("udpblast: no ARP reply from next hop\n");
+        return;
+    }
+
+    t0 = rdtsc();
+    for (i = 0; i < count; i++) {
+        while ((m = mbuf_alloc()) == 0) {
+            retries++;
+            ne2k_tx_pump();   /* mbuf 가 모두 큐에 있음: 슬롯이 비어야 돌아온다 */
+        }
+        /* 페이로드를 채우고 UDP, IPv4, Ethernet 헤더를 그 앞에 붙인다 (복사 없음) */
+        p = mbuf_append(m, size);
+        memset(p, (uint8)i, size);
+        if (size >= 4) *(uint32_alias*)p = htonl(i);
+        udp_output(m, UDP_BLAST_SPORT, dst, port);
+    }
+    ne2k_tx_flush();
+    us = cycles_to_us(rdtsc() - t0);
+    if (us == 0) us = 1;
+    pkts = net_stats.tx_frames - before.tx_frames;
+
+    kprintf("Sent %u UDP datagrams (%u byte payload) to ", pkts, size);
+    inet_print_addr(dst);
+    kprintf(":%u in %u ms\n", port, us / 1000);
+    kprintf("  %u packets/s, %u KB/s on the wire\n",
+            (uint32)udiv64((uint64)pkts * 1000000, us),
+            (uint32)udiv64((uint64)(net_stats.tx_bytes - before.tx_bytes) * 1000000 / 1024, us));
+    kprintf("  %u loads overlapped a transmit, %u queue-full waits, %u buffer waits, %u errors\n",
+            net_stats.tx_overlap - before.tx_overlap, net_stats.tx_queue_full - before.tx_queue_full,
+            retries, net_stats.tx_errors - before.tx_errors);
+}
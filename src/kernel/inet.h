@@ -0,0 +1,140 @@
+#ifndef INET_H
+#define INET_H
+
+#include "dc.h"
+#include "mbuf.h"
+#include "network.h"
+
+#define ETH_P_IP      0x0800
+#define ETH_P_ARP     0x0806
+#define IP_PROTO_ICMP 1
+#define IP_PROTO_TCP  6
+#define IP_PROTO_UDP  17
+
+/* 헤더의 다중 바이트 필드는 모두 네트워크 바이트 순서 */
+typedef struct {
+    uint8 dst[6];
+    uint8 src[6];
+    uint16 type;
+} __attribute__((packed)) eth_hdr_t;
+
+typedef struct {
+    uint16 htype;
+    uint16 ptype;
+    uint8 hlen;
+    uint8 plen;
+    uint16 op;
+    uint8 sha[6];
+    uint32 spa;
+    uint8 tha[6];
+    uint32 tpa;
+} __attribute__((packed)) arp_pkt_t;
+
+typedef struct {
+    uint8 ver_ihl;
+    uint8 tos;
+    uint16 len;
+    uint16 id;
+    uint16 frag;
+    uint8 ttl;
+    uint8 proto;
+    uint16 csum;
+    uint32 src;
+    uint32 dst;
+} __attribute__((packed)) ipv4_hdr_t;
+
+typedef struct {
+    uint8 type;
+    uint8 code;
+    uint16 csum;
+    uint16 id;
+    uint16 seq;
+} __attribute__((packed)) icmp_hdr_t;
+
+typedef struct {
+    uint16 sport;
+    uint16 dport;
+    uint16 len;
+    uint16 csum;
+} __attribute__((packed)) udp_hdr_t;
+
+typedef struct {
+    uint32 arp_requests;      /* 보낸 요청 */
+    uint32 arp_replies;       /* 우리 주소를 묻는 요청에 보낸 응답 */
+    uint32 arp_hits;
+    uint32 arp_misses;
+    uint32 arp_hold_drops;    /* 해석을 기다리던 패킷이 다음 패킷에 밀려남 */
+    uint32 ip_in;
+    uint32 ip_bad;            /* 헤더 길이/버전/체크섬 오류 */
+    uint32 ip_not_ours;
+    uint32 ip_frags;          /* 조각은 재조립하지 않고 버린다 */
+    uint32 ip_out;
+    uint32 icmp_echo_in;
+    uint32 icmp_echo_out;
+    uint32 udp_in;
+    uint32 udp_bad;
+    uint32 udp_no_port;
+    uint32 udp_out;
+    uint32 tx_drops;          /* 송신 큐가 끝내 비지 않음 */
+    uint32 unknown_type;      /* 모르는 EtherType / IP 프로토콜 */
+} inet_stats_t;
+
+extern inet_stats_t inet_stats;
+extern uint32 net_ip, net_gw, net_mask;   /* 호스트 바이트 순서 */
+
+/*
+ * Internet 체크섬 (RFC 1071). inet_csum_partial 은 접지 않은 32비트 합을 돌려주므로
+ * 의사 헤더와 본문을 이어서 더한 뒤 inet_csum_fold 로 마무리한다.
+ * 1 의 보수 합은 바이트 순서와 무관해서 메모리의 값을 그대로 더하고 결과도 그대로 저장한다.
+ */
+uint32 inet_csum_partial(const void *buf, uint32 len, uint32 sum);
+
+static inline uint16 inet_csum_fold(uint32 sum) {
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16)~sum;
+}
+
+static inline uint16 inet_checksum(const void *buf, uint32 len) {
+    return inet_csum_fold(inet_csum_partial(buf, len, 0));
+}
+
+/* 필드 하나가 old 에서 new 로 바뀔 때 전체를 다시 더하지 않고 고친 체크섬 (RFC 1624 식 3) */
+static inline uint16 inet_csum_update16(uint16 csum, uint16 old, uint16 new_val) {
+    return inet_csum_fold((uint32)(uint16)~csum + (uint16)~old + new_val);
+}
+
+static inline uint16 inet_csum_update32(uint16 csum, uint32 old, uint32 new_val) {
+    csum = inet_csum_update16(csum, (uint16)old, (uint16)new_val);
+    return inet_csum_update16(csum, (uint16)(old >> 16), (uint16)(new_val >> 16));
+}
+
+/* TCP/UDP 의사 헤더의 합 (주소는 네트워크 바이트 순서 그대로) */
+static inline uint32 inet_pseudo_sum(uint32 src, uint32 dst, uint8 proto, uint16 len) {
+    return (src & 0xFFFF) + (src >> 16) + (dst & 0xFFFF) + (dst >> 16) + htons(proto) + htons(len);
+}
+
+/* m->data 는 IP 헤더, ip 와 uh 는 같은 버퍼 안. 핸들러가 m 을 가진다 (보내거나 풀어 준다) */
+typedef void (*udp_handler_t)(mbuf_t *m, ipv4_hdr_t *ip, udp_hdr_t *uh);
+
+void inet_init();
+/* ARP 항목 만료와 재요청 (network_stack_poll 이 부른다) */
+void inet_poll();
+/* Ethernet 헤더가 붙은 받은 프레임 하나. m 을 가진다 */
+void inet_input(mbuf_t *m);
+/* m->data 앞에 IPv4 헤더를 붙여 보낸다 (dst 는 호스트 바이트 순서). 항상 m 을 가진다 */
+int ip_output(mbuf_t *m, uint32 dst, uint8 proto);
+/* 받은 IPv4 패킷 (m->data 가 IP 헤더) 을 보낸 쪽으로 되돌린다: 주소를 맞바꾸고 TTL 을 고친다 */
+int ip_reflect(mbuf_t *m);
+int udp_output(mbuf_t *m, uint16 sport, uint32 dst, uint16 dport);
+int udp_bind(uint16 port, udp_handler_t handler);
+void udp_unbind(uint16 port);
+int ip_parse(const char *s, uint32 *ip);
+void inet_print_addr(uint32 ip);
+
+void arp_cmd();
+void ping_cmd(const char *host, uint32 count);
+void csum_bench_cmd();
+void udp_blast_cmd(uint32 count, uint32 size, uint32 dst, uint16 port);
+
+#endif //INET_H
@@ -0,0 +1,197 @@
+#include "dc.h"
+#include "journal.h"
+#include "disk.h"
+#include "cache.h"
+#include "file.h"
+#include "type.h"
+#include "kprint.h"
+#include "crc.h"
+
+/*=========================*/
+/* 3-2. Metadata Journal */
+/*=========================*/
+/*
+ * 파일 테이블, 비트맵, 디렉터리/indirect 블록 같은 메타데이터 섹터는 제자리에
+ * 바로 쓰지 않고 한 트랜잭션으로 묶어 저널에 먼저 기록한다 (ordered 모드).
+ *
+ *   데이터 섹터 -> FLUSH -> descriptor+payload -> FLUSH -> commit -> FLUSH
+ *   -> 제자리 기록(checkpoint) -> FLUSH -> superblock(checkpointed = seq)
+ *
+ * 디스크 요청 큐는 FIFO 이고 FLUSH 가 앞선 기록을 매체에 내리므로 이 순서가
+ * 그대로 지켜진다. 저널에는 한 번에 한 트랜잭션만 있으며, 마운트 시
+ * commit 까지 기록되었지만 checkpoint 가 끝나지 않은 트랜잭션을 다시 적용한다.
+ */
+
+journal_stats_t journal_stats;
+
+static int enabled = 0;
+static uint32 seq = 0;                 /* 마지막으로 커밋한 트랜잭션 번호 */
+static uint32 staged = 0;
+static uint32 jbuf_words[(1 + JOURNAL_MAX_SECTORS) * BLOCK_SIZE / 4];  /* descriptor + payload */
+static uint8 *jbuf = (uint8*)jbuf_words;
+static journal_desc_t *desc = (journal_desc_t*)jbuf_words;
+static uint32 commit_words[BLOCK_SIZE / 4];
+static uint32 super_words[BLOCK_SIZE / 4];
+
+static disk_request_t barrier_reqs[4];
+static disk_request_t log_req;
+static disk_request_t commit_req;
+static disk_request_t super_req;
+static disk_request_t ckpt_reqs[JOURNAL_MAX_SECTORS];
+static uint32 ckpt_count = 0;
+
+typedef char journal_desc_fits[(sizeof(journal_desc_t) <= BLOCK_SIZE) ? 1 : -1];
+
+static uint8 *payload(uint32 i) {
+    return jbuf + (1 + i) * BLOCK_SIZE;
+}
+
+/* IRQ 문맥: 실패하면 이번 트랜잭션의 섹터를 다시 dirty 로 돌려 다음 커밋에 싣는다 */
+static void journal_complete(disk_request_t *req) {
+    uint32 i;
+    if (req->status == DISK_REQ_DONE) return;
+    journal_stats.errors++;
+    for (i = 0; i < desc->count; i++) cache_redirty_meta(desc->sectors[i]);
+}
+
+static void submit(disk_request_t *req, uint32 op, uint32 sector, uint8 *buffer, uint32 count) {
+    req->op = op;
+    req->sector = sector;
+    req->buffer = buffer;
+    req->count = count;
+    req->complete = journal_complete;
+    req->ctx = 0;
+    disk_submit(req);
+}
+
+int journal_enabled() {
+    return enabled;
+}
+
+/* 앞 트랜잭션이 끝날 때까지 기다린 뒤 staging 버퍼를 비운다 */
+void journal_begin() {
+    journal_wait();
+    memset(desc, 0, BLOCK_SIZE);
+    staged = 0;
+}
+
+/* len 이 한 섹터보다 짧으면 (영역 끝 부분 섹터) 나머지는 0 으로 채운다 */
+int journal_add(uint32 sector, const void *data, uint32 len) {
+    if (staged >= JOURNAL_MAX_SECTORS) return -1;
+    memcpy(payload(staged), data, len);
+    if (len < BLOCK_SIZE) memset(payload(staged) + len, 0, BLOCK_SIZE - len);
+    desc->sectors[staged++] = sector;
+    return 0;
+}
+
+uint32 journal_staged() {
+    return staged;
+}
+
+/* 모아 둔 섹터를 한 트랜잭션으로 제출하고 바로 반환 (group commit) */
+void journal_commit() {
+    uint32 i, run;
+    journal_commit_t *commit = (journal_commit_t*)commit_words;
+    journal_super_t *super = (journal_super_t*)super_words;
+    if (staged == 0) return;
+
+    desc->magic = JOURNAL_DESC_MAGIC;
+    desc->seq = ++seq;
+    desc->count = staged;
+    memset(commit_words, 0, sizeof(commit_words));
+    commit->magic = JOURNAL_COMMIT_MAGIC;
+    commit->seq = seq;
+    commit->count = staged;
+    commit->checksum = crc32c(0, jbuf, (1 + staged) * BLOCK_SIZE);
+    memset(super_words, 0, sizeof(super_words));
+    super->magic = JOURNAL_MAGIC;
+    super->checkpointed = seq;
+
+    submit(&barrier_reqs[0], DISK_OP_FLUSH, 0, 0, 0);
+    submit(&log_req, DISK_OP_WRITE, DISK_JOURNAL_START_SECTOR + 1, jbuf, 1 + staged);
+    submit(&barrier_reqs[1], DISK_OP_FLUSH, 0, 0, 0);
+    submit(&commit_req, DISK_OP_WRITE, DISK_JOURNAL_START_SECTOR + 2 + staged,
+           (uint8*)commit_words, 1);
+    submit(&barrier_reqs[2], DISK_OP_FLUSH, 0, 0, 0);
+    /* checkpoint: 섹터 번호 순으로 모았으므로 연속 구간은 한 요청으로 */
+    ckpt_count = 0;
+    for (i = 0; i < staged; i += run) {
+        run = 1;
+        while (i + run < staged && desc->sectors[i + run] == desc->sectors[i] + run) run++;
+        submit(&ckpt_reqs[ckpt_count++], DISK_OP_WRITE, desc->sectors[i], payload(i), run);
+    }
+    submit(&barrier_reqs[3], DISK_OP_FLUSH, 0, 0, 0);
+    submit(&super_req, DISK_OP_WRITE, DISK_JOURNAL_START_SECTOR, (uint8*)super_words, 1);
+
+    journal_stats.commits++;
+    journal_stats.sectors += staged;
+    journal_stats.last_commit_sectors = staged;
+}
+
+static int wait_req(disk_request_t *req) {
+    if (req->status == DISK_REQ_PENDING) disk_wait(req);
+    return req->status == DISK_REQ_ERROR ? -1 : 0;
+}
+
+int journal_wait() {
+    uint32 i;
+    int ret = 0;
+    for (i = 0; i < 4; i++) ret |= wait_req(&barrier_reqs[i]);
+    ret |= wait_req(&log_req);
+    ret |= wait_req(&commit_req);
+    for (i = 0; i < ckpt_count; i++) ret |= wait_req(&ckpt_reqs[i]);
+    ret |= wait_req(&super_req);
+    return ret;
+}
+
+/* 저널에 commit 까지 남아 있는 트랜잭션을 제자리에 다시 기록 */
+static int journal_replay() {
+    journal_commit_t *commit = (journal_commit_t*)commit_words;
+    journal_super_t *super = (journal_super_t*)super_words;
+    uint32 i;
+    if (disk_read(DISK_JOURNAL_START_SECTOR + 1, jbuf, 1) != 0) return -1;
+    if (desc->magic != JOURNAL_DESC_MAGIC || desc->seq != seq + 1 ||
+        desc->count == 0 || desc->count > JOURNAL_MAX_SECTORS) return 0;
+    if (disk_read(DISK_JOURNAL_START_SECTOR + 2, payload(0), desc->count) != 0) return -1;
+    if (disk_read(DISK_JOURNAL_START_SECTOR + 2 + desc->count, commit_words, 1) != 0) return -1;
+    /* commit 이 없거나 내용이 맞지 않으면 중간에 끊긴 트랜잭션이므로 버린다 */
+    if (commit->magic != JOURNAL_COMMIT_MAGIC || commit->seq != desc->seq ||
+        commit->count != desc->count ||
+        commit->checksum != crc32c(0, jbuf, (1 + desc->count) * BLOCK_SIZE)) return 0;
+
+    for (i = 0; i < desc->count; i++) {
+        if (disk_write(desc->sectors[i], payload(i), 1) != 0) return -1;
+    }
+    if (disk_flush() != 0) return -1;
+    seq = desc->seq;
+    super->magic = JOURNAL_MAGIC;
+    super->checkpointed = seq;
+    if (disk_write(DISK_JOURNAL_START_SECTOR, super_words, 1) != 0) return -1;
+    journal_stats.replays++;
+    journal_stats.replayed_sectors += desc->count;
+    kprint("Journal: replayed transaction, sectors: ");
+    kprint_dec(desc->count); kprint("\n");
+    return 0;
+}
+
+/* 마운트 시 (load_fs 전) 호출: 저널이 없으면 만들고, 있으면 replay */
+int journal_init() {
+    journal_super_t *super = (journal_super_t*)super_words;
+    enabled = 0;
+    staged = 0;
+    ckpt_count = 0;
+    memset(&journal_stats, 0, sizeof(journal_stats));
+    if (disk_read(DISK_JOURNAL_START_SECTOR, super_words, 1) != 0) return -1;
+    if (super->magic != JOURNAL_MAGIC) {
+        memset(super_words, 0, sizeof(super_words));
+        super->magic = JOURNAL_MAGIC;
+        super->checkpointed = 0;
+        if (disk_write(DISK_JOURNAL_START_SECTOR, super_words, 1) != 0) return -1;
+        seq = 0;
+    } else {
+        seq = super->checkpointed;
+        if (journal_replay() != 0) return -1;
+    }
+    enabled = 1;
+    return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "dc.h"
+
+/* 저널 첫 섹터: 제자리 기록까지 끝난 마지막 트랜잭션 번호 */
+typedef struct {
+    uint32 magic;                      /* JOURNAL_MAGIC */
+    uint32 checkpointed;
+} journal_super_t;
+
+/* payload 앞 섹터: 각 payload 섹터가 돌아갈 위치 */
+typedef struct {
+    uint32 magic;                      /* JOURNAL_DESC_MAGIC */
+    uint32 seq;
+    uint32 count;
+    uint32 sectors[JOURNAL_MAX_SECTORS];
+} journal_desc_t;
+
+/* payload 뒤 섹터: 이것까지 기록되어야 트랜잭션이 유효 */
+typedef struct {
+    uint32 magic;                      /* JOURNAL_COMMIT_MAGIC */
+    uint32 seq;
+    uint32 count;
+    uint32 checksum;                   /* descriptor + payload 의 CRC32C */
+} journal_commit_t;
+
+typedef struct {
+    uint32 commits;
+    uint32 sectors;             /* 저널을 거쳐 기록된 메타데이터 섹터 */
+    uint32 last_commit_sectors;
+    uint32 replays;
+    uint32 replayed_sectors;
+    uint32 errors;
+} journal_stats_t;
+
+extern journal_stats_t journal_stats;
+
+int journal_init();
+int journal_enabled();
+void journal_begin();
+int journal_add(uint32 sector, const void *data, uint32 len);
+uint32 journal_staged();
+void journal_commit();
+int journal_wait();
+
+#endif //JOURNAL_H
@@ -0,0 +1,43 @@
+#ifndef KAPI_H
+#define KAPI_H
+
+#include "dc.h"
+
+/*
+ * execbin / fork 로 띄운 프로그램에 넘기는 커널 호출 표.
+ * 프로그램은 ring 0 에서 자기 주소 공간으로 돌지만 커널 (KERNEL_VBASE 위) 은 모든
+ * 주소 공간에 같은 자리로 매핑되어 있으므로, 진입점이 받은 표의 함수를 바로 부르면 된다:
+ *
+ *     void _start(const knix_api_t *api) {
+ *         int sd = api->sock_connect(0x0A000202, 7, 1000);
+ *         ...
+ *     }
+ *
+ * 심볼을 내보내지 않으므로 프로그램은 이 헤더만 포함해 빌드한다.
+ * 필드는 뒤에만 붙이고 version 을 올린다 (size 로 가진 필드를 확인할 수 있다).
+ */
+#define KNIX_API_VERSION 1
+
+typedef struct {
+    uint32 version;
+    uint32 size;                      /* sizeof(knix_api_t) */
+    void (*print)(const char *str);
+    /* 소켓 (tcp.h 와 같은 의미) */
+    int (*sock_listen)(uint16 port);
+    int (*sock_accept)(int sd, uint32 timeout_ms);
+    int (*sock_connect)(uint32 ip, uint16 port, uint32 timeout_ms);
+    int (*sock_send)(int sd, const void *buf, uint32 len);
+    int (*sock_recv)(int sd, void *buf, uint32 len, uint32 timeout_ms);
+    int (*sock_flush)(int sd, uint32 timeout_ms);
+    int (*sock_peer)(int sd, uint32 *ip, uint16 *port);
+    void (*sock_close)(int sd);
+    void (*sock_set_nodelay)(int sd, int on);
+    void (*sock_wait)();
+} knix_api_t;
+
+/* execbin / fork 프로그램의 진입점 (커널 작업의 void (*)(void) 와 따로 둔다) */
+typedef void (*knix_entry_t)(const knix_api_t *api);
+
+extern const knix_api_t knix_api;
+
+#endif //KAPI_H
@@ -13,26 +13,122 @@
 #include "process.h"
 #include "network.h"
 #include "command.h"
+#include "cache.h"
+#include "journal.h"
+#include "disk.h"
+#include "cpu.h"
+#include "idt.h"
+#include "pci.h"
+#include "timer.h"
+#include "multiboot.h"
+#include "mm.h"
+#include "slab.h"
+#include "paging.h"
+#include "smp.h"
+#include "keyboard.h"
+#include "serial.h"
 
 /*=========================*/
 /* 14. Kernel Main */
 /*=========================*/
-void kmain() {
+/*
+ * GRUB 이 찾는 multiboot 헤더 (linker.ld 가 이미지 맨 앞에 둔다).
+ * 메모리 정보 (mmap) 를 요청하고, 진입 시 eax = 매직, ebx = 정보 구조체 주소.
+ */
+#define MULTIBOOT_HEADER_FLAGS  (MULTIBOOT_PAGE_ALIGN | MULTIBOOT_MEMORY_INFO)
+__attribute__((section(".multiboot_header"), used))
+static const uint32 multiboot_header[3] = {
+    MULTIBOOT_HEADER_MAGIC,
+    MULTIBOOT_HEADER_FLAGS,
+    (uint32)-(MULTIBOOT_HEADER_MAGIC + MULTIBOOT_HEADER_FLAGS)
+};
+
+/* multiboot 은 스택을 정해 주지 않으므로 진입하자마자 커널 스택으로 바꾼다 */
+uint8 boot_stack[BOOT_STACK_SIZE] __attribute__((aligned(16)));
+
+/*
+ * _start 는 물리 주소 (1MB 위) 에서 페이징 없이 실행된다.
+ * kernel_page_dir 의 부트 매핑 (identity + higher half, 4MB 페이지) 으로 페이징을 켠 뒤
+ * KERNEL_VBASE 쪽 higher_half 로 점프한다. eax/ebx (multiboot) 는 그대로 넘긴다.
+ */
+#define STR_(x) #x
+#define STR(x)  STR_(x)
+__asm__(
+    ".pushsection .text.start\n"
+    ".global _start\n"
+    "_start:\n"
+    "    movl $(kernel_page_dir - " STR(KERNEL_VBASE) "), %ecx\n"
+    "    movl %ecx, %cr3\n"
+    "    movl %cr4, %ecx\n"
+    "    orl $" STR(CR4_PSE) ", %ecx\n"
+    "    movl %ecx, %cr4\n"
+    "    movl %cr0, %ecx\n"
+    "    orl $" STR(CR0_PG) ", %ecx\n"
+    "    movl %ecx, %cr0\n"
+    "    movl $higher_half, %ecx\n"
+    "    jmp *%ecx\n"
+    ".popsection\n"
+    ".pushsection .text\n"
+    "higher_half:\n"
+    "    movl $(boot_stack + " STR(BOOT_STACK_SIZE) "), %esp\n"
+    "    pushl %ebx\n"
+    "    pushl %eax\n"
+    "    call kmain\n"
+    "1:  hlt\n"
+    "    jmp 1b\n"
+    ".popsection\n");
+
+void kmain(uint32 boot_magic, uint32 boot_info) {
+    uint64 boot_start = rdtsc();
     kprint("OK\n");
     int ret;
+    int fs_fresh = 0;
     char cmdline[MAX_CMD_LEN] = {0};
 
+    /* identity 매핑을 지우기 전에 GDT 를 바꾸므로 idt_init 보다 먼저 (IDT 가 새 CS 를 쓴다) */
+    paging_init();
+    idt_init();
+    serial_init();   /* 이후 kprint 는 송신 링 + THRE 인터럽트 */
+    isr_register(14, page_fault_handler);
+    mem_init(boot_magic, boot_info);
+    slab_init();
+    kprint("Memory: ");
+    kprint_dec(mem_stats.free_pages * (PAGE_SIZE / 1024));
+    kprint(" KB free");
+    kprint(boot_magic == MULTIBOOT_BOOTLOADER_MAGIC ? " (multiboot map)\n" : " (no multiboot, assumed)\n");
+    timer_calibrate_tsc();
+    pci_scan();
+    disk_init();
+    kprint(disk_get_mode() == DISK_MODE_DMA ? "Disk mode: DMA\n" : "Disk mode: PIO\n");
+    disk_enable_irq();
+    cpu_enable_interrupts();
+    cache_init();
+    /* FS 를 읽기 전에 끝나지 않은 메타데이터 트랜잭션을 먼저 반영 */
+    if (journal_init() != 0) kprint("Journal unavailable, metadata is written in place.\n");
+
+    uint64 load_start = rdtsc();
+    uint32 load_cmds = disk_stats.commands;
+    uint32 load_sectors = disk_stats.sectors_read;
     ret = load_fs();
     if (ret != 0) {
         init_fs();
+        fs_fresh = 1;
         ret = save_fs();
         if (ret != 0) while(1);
         kprint("New FS initialization completed.\n");
     } else {
         kprint("Existing FS load completed.\n");
     }
+    kprint("FS load: ");
+    kprint_dec(cycles_to_kcycles(rdtsc() - load_start));
+    kprint(" Kcycles, ");
+    kprint_dec(disk_stats.commands - load_cmds);
+    kprint(" disk commands, ");
+    kprint_dec(disk_stats.sectors_read - load_sectors);
+    kprint(" sectors read\n");
 
-    ret = load_file_table();
+    /* 새로 만든 FS 에 이전 파일 테이블이 남아 있으면 블록을 잘못 가리키므로 같이 초기화 */
+    ret = fs_fresh ? -1 : load_file_table();
     if (ret != 0) {
         init_file_table();
         ret = save_file_table();
@@ -43,6 +139,10 @@ void kmain() {
     }
 
     init_processes();
+    timer_init(SCHED_HZ);
+    kbd_init();
+    /* 주소 공간을 하나라도 만들기 전에: LAPIC 매핑이 커널 PDE 로 복사된다 */
+    smp_init();
 
     usb_scan();
     kprint("The USB device scan is complete.\n");
@@ -50,18 +150,21 @@ void kmain() {
 
     network_stack_init();
 
-    /* 메인 CLI 루프와 함께 주기적으로 네트워킹 패킷 폴링 */
+    /* 부팅 시간: kmain 진입부터 첫 프롬프트까지 (TSC 보정 이전 구간 포함) */
+    kprint("Time to prompt: ");
+    kprint_dec(cycles_to_us(rdtsc() - boot_start) / 1000);
+    kprint(" ms, ");
+    kprint_dec(disk_stats.sectors_read);
+    kprint(" sectors read\n");
+
+    /* 메인 CLI 루프. 입력을 기다리는 동안 kgetchar 가 네트워킹 패킷을 폴링한다 */
     while (1) {
         kprint("knix> ");
         kgets(cmdline, MAX_CMD_LEN);
         process_command(cmdline);
+        cache_tick();
         network_stack_poll();
     }
 
     while(1);
 }
-
-void _start() {
-    kmain();
-    while (1) {}
-}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "keyboard.h"
+#include "idt.h"
+#include "io.h"
+#include "type.h"
+
+/*=========================*/
+/* 17. PS/2 키보드 (IRQ1) */
+/*=========================*/
+/*
+ * IRQ1 핸들러가 스캔코드 (set 1) 를 shift/caps/ctrl 상태와 E0 확장 키까지 풀어
+ * 링 버퍼에 넣고, kgetchar 가 꺼낸다. 넣는 쪽은 IRQ 하나, 꺼내는 쪽은 BSP 에 고정된
+ * 셸 하나라 (single producer / single consumer) head 와 tail 을 각자만 쓰므로 락이 없다.
+ */
+#define KBD_DATA        0x60
+#define KBD_STATUS      0x64
+#define KBD_OUT_FULL    0x01
+
+#define SC_LSHIFT       0x2A
+#define SC_RSHIFT       0x36
+#define SC_CTRL         0x1D
+#define SC_CAPS         0x3A
+#define SC_EXTENDED     0xE0
+#define SC_RELEASE      0x80
+
+static const char keymap[0x3A] = {
+    0,  27, '1','2','3','4','5','6','7','8','9','0','-','=', '\b', /* 0x00-0x0E */
+    '\t','q','w','e','r','t','y','u','i','o','p','[',']','\n',     /* 0x0F-0x1C */
+    0,   'a','s','d','f','g','h','j','k','l',';','\'','`',         /* 0x1D-0x29 */
+    0,  '\\','z','x','c','v','b','n','m',',','.','/', 0,           /* 0x2A-0x36 */
+    '*', 0,  ' ',                                                  /* 0x37-0x39 */
+};
+
+static const char keymap_shift[0x3A] = {
+    0,  27, '!','@','#','$','%','^','&','*','(',')','_','+', '\b',
+    '\t','Q','W','E','R','T','Y','U','I','O','P','{','}','\n',
+    0,   'A','S','D','F','G','H','J','K','L',':','"','~',
+    0,  '|','Z','X','C','V','B','N','M','<','>','?', 0,
+    '*', 0,  ' ',
+};
+
+static volatile uint8 ring[KBD_RING_SIZE];
+static volatile uint32 ring_head = 0;   /* IRQ 만 쓴다 */
+static volatile uint32 ring_tail = 0;   /* kbd_getchar 만 쓴다 */
+static uint32 shift = 0, ctrl = 0, caps = 0, extended = 0;
+kbd_stats_t kbd_stats;
+
+static void ring_put(uint8 c) {
+    if (ring_head - ring_tail >= KBD_RING_SIZE) {
+        kbd_stats.dropped++;
+        return;
+    }
+    ring[ring_head & (KBD_RING_SIZE - 1)] = c;
+    __asm__ volatile ("" ::: "memory");   /* 글자를 쓴 뒤에 head 를 민다 */
+    ring_head++;
+    kbd_stats.keys++;
+}
+
+static uint8 decode_extended(uint8 sc) {
+    switch (sc) {
+        case 0x48: return KEY_UP;
+        case 0x50: return KEY_DOWN;
+        case 0x4B: return KEY_LEFT;
+        case 0x4D: return KEY_RIGHT;
+        case 0x47: return KEY_HOME;
+        case 0x4F: return KEY_END;
+        case 0x53: return KEY_DELETE;
+        case 0x1C: return '\n';   /* 키패드 Enter */
+        case 0x35: return '/';    /* 키패드 / */
+        default: return 0;
+    }
+}
+
+static uint8 decode(uint8 sc) {
+    char c;
+    if (sc >= sizeof(keymap)) return 0;
+    c = shift ? keymap_shift[sc] : keymap[sc];
+    if (caps && ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) c ^= 0x20;
+    if (ctrl && c >= 'a' && c <= 'z') c = (char)(c - 'a' + 1);
+    return (uint8)c;
+}
+
+static void kbd_irq(interrupt_frame_t *frame) {
+    uint8 sc, c;
+    uint32 release;
+    (void)frame;
+    kbd_stats.irqs++;
+    if (!(inb(KBD_STATUS) & KBD_OUT_FULL)) return;
+    sc = inb(KBD_DATA);
+    if (sc == SC_EXTENDED) {
+        extended = 1;
+        return;
+    }
+    release = sc & SC_RELEASE;
+    sc &= ~SC_RELEASE;
+    if (extended) {
+        extended = 0;
+        if (sc == SC_CTRL) ctrl = !release;   /* 오른쪽 Ctrl */
+        else if (!release && (c = decode_extended(sc)) != 0) ring_put(c);
+        return;
+    }
+    switch (sc) {
+        case SC_LSHIFT:
+        case SC_RSHIFT: shift = !release; return;
+        case SC_CTRL: ctrl = !release; return;
+        case SC_CAPS: if (!release) caps = !caps; return;
+    }
+    if (!release && (c = decode(sc)) != 0) ring_put(c);
+}
+
+void kbd_init() {
+    memset(&kbd_stats, 0, sizeof(kbd_stats));
+    ring_head = ring_tail = 0;
+    /* 부팅 중 눌린 키가 남아 있으면 IRQ1 이 다시 오지 않으므로 비운다 */
+    while (inb(KBD_STATUS) & KBD_OUT_FULL) inb(KBD_DATA);
+    irq_register(IRQ_KEYBOARD, kbd_irq);
+}
+
+int kbd_pending() {
+    return ring_head != ring_tail;
+}
+
+int kbd_getchar() {
+    uint8 c;
+    if (ring_head == ring_tail) return -1;
+    __asm__ volatile ("" ::: "memory");   /* head 를 본 뒤에 글자를 읽는다 */
+    c = ring[ring_tail & (KBD_RING_SIZE - 1)];
+    __asm__ volatile ("" ::: "memory");
+    ring_tail++;
+    return c;
+}
@@ -0,0 +1,27 @@
+#ifndef KEYBOARD_H
+#define KEYBOARD_H
+
+#include "dc.h"
+
+/* 0x80 이상: ASCII 가 아닌 확장 키 (E0 접두) */
+#define KEY_UP     0x80
+#define KEY_DOWN   0x81
+#define KEY_LEFT   0x82
+#define KEY_RIGHT  0x83
+#define KEY_HOME   0x84
+#define KEY_END    0x85
+#define KEY_DELETE 0x86
+
+typedef struct {
+    uint32 irqs;
+    uint32 keys;          /* 링에 넣은 글자/키 */
+    uint32 dropped;       /* 링이 가득 차 버린 키 */
+} kbd_stats_t;
+
+extern kbd_stats_t kbd_stats;
+
+void kbd_init();
+int kbd_getchar();        /* 링이 비었으면 -1 (막히지 않음) */
+int kbd_pending();
+
+#endif //KEYBOARD_H
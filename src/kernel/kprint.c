@@ -4,21 +4,102 @@
 #include "process.h"
 #include "command.h"
 #include "type.h"
+#include "dir.h"
+#include "stream.h"
+#include "paging.h"
+#include "elf.h"
+#include "serial.h"
+#include <stdarg.h>
+#include "keyboard.h"
+#include "network.h"
+#include "smp.h"
+#include "cpu.h"
 
 /*=========================*/
 /* 9. CLI, 스크립트, 바이너리 실행, 텍스트 편집, 파일 검색 */
 /*=========================*/
 
+/* 송신 링에 복사만 하고 돌아온다 (serial.c) */
 void kprint(const char *str) {
-    while (*str) {
-        __asm__ volatile (
-            "movb %0, %%al\n"
-            "outb %%al, $0x3F8\n"
-            :
-            : "r" (*str)
-        );
-        str++;
+    serial_write(str, strlen(str));
+}
+
+/* 길이가 정해진 문자열 출력 (NUL 을 만나면 멈춘다). 출력한 글자 수를 돌려준다 */
+uint32 kprint_len(const char *str, uint32 len) {
+    uint32 n = 0;
+    while (n < len && str[n]) n++;
+    serial_write(str, n);
+    return n;
+}
+
+/* 부호 없는 수를 base 진법으로 out 에 (뒤에서부터) 쓰고 글자 수를 돌려준다 */
+static uint32 format_num(char *out, uint32 num, uint32 base, uint32 width, char pad) {
+    char tmp[12];
+    uint32 n = 0, i = 0;
+    do {
+        tmp[n++] = "0123456789abcdef"[num % base];
+        num /= base;
+    } while (num);
+    while (width > n && i < width - n) out[i++] = pad;
+    while (n) out[i++] = tmp[--n];
+    return i;
+}
+
+/*
+ * %s %c %d %u %x %% 와 폭 (%08x 처럼 0 채움) 을 지원한다.
+ * 한 줄을 스택 버퍼에 다 만든 뒤 serial_write 한 번으로 내보낸다.
+ */
+void kprintf(const char *fmt, ...) {
+    char buf[KPRINTF_BUF];
+    uint32 len = 0, width;
+    char pad;
+    va_list ap;
+    va_start(ap, fmt);
+    for (; *fmt; fmt++) {
+        if (len > sizeof(buf) - 16) {
+            serial_write(buf, len);
+            len = 0;
+        }
+        if (*fmt != '%') {
+            buf[len++] = *fmt;
+            continue;
+        }
+        fmt++;
+        pad = ' ';
+        width = 0;
+        if (*fmt == '0') { pad = '0'; fmt++; }
+        while (*fmt >= '0' && *fmt <= '9') width = width * 10 + (uint32)(*fmt++ - '0');
+        if (width > 10) width = 10;
+        switch (*fmt) {
+            case 'd': {
+                int v = va_arg(ap, int);
+                uint32 u = (uint32)v;
+                if (v < 0) { buf[len++] = '-'; u = 0u - u; }
+                len += format_num(buf + len, u, 10, width, pad);
+                break;
+            }
+            case 'u': len += format_num(buf + len, va_arg(ap, uint32), 10, width, pad); break;
+            case 'x': len += format_num(buf + len, va_arg(ap, uint32), 16, width, pad); break;
+            case 'c': buf[len++] = (char)va_arg(ap, int); break;
+            case 's': {
+                const char *str = va_arg(ap, const char*);
+                if (!str) str = "(null)";
+                while (*str) {
+                    if (len == sizeof(buf)) {
+                        serial_write(buf, len);
+                        len = 0;
+                    }
+                    buf[len++] = *str++;
+                }
+                break;
+            }
+            case '%': buf[len++] = '%'; break;
+            case '\0': fmt--; break;
+            default: buf[len++] = '%'; buf[len++] = *fmt; break;
+        }
     }
+    va_end(ap);
+    if (len) serial_write(buf, len);
 }
 
 void kprint_hex(uint32 num) {
@@ -36,40 +117,42 @@ void kprint_hex(uint32 num) {
     kprint("0x");
     kprint(buffer);
 }
-int kgetchar() {
-    unsigned char status;
-    unsigned char scancode;
 
-    // Wait until the output buffer is full (bit 0 of 0x64 is set)
-    do {
-        __asm__ volatile ("inb $0x64, %0" : "=a"(status));
-    } while ((status & 0x01) == 0);
-
-    // Read from keyboard data port
-    __asm__ volatile ("inb $0x60, %0" : "=a"(scancode));
-
-    // Simple US QWERTY keymap for demonstration (only lowercase letters and digits)
-    static char scancode_table[128] = {
-        0,  27, '1','2','3','4','5','6','7','8','9','0','-','=', '\b', /* 0x00-0x0E */
-        '\t','q','w','e','r','t','y','u','i','o','p','[',']','\n',     /* 0x0F-0x1C */
-        0,   'a','s','d','f','g','h','j','k','l',';','\'','`',         /* 0x1D-0x29 */
-        0,  '\\','z','x','c','v','b','n','m',',','.','/', 0,           /* 0x2A-0x35 */
-        '*', 0,  ' ', /* rest ignored */
-    };
-
-    // Handle only key-press (not key-release: high bit set)
-    if (scancode & 0x80) {
-        return 0; // key release, ignore
-    } else {
-        return scancode_table[scancode];
+void kprint_dec(uint32 num) {
+    char numbuf[16];
+    simple_itoa(num, numbuf);
+    kprint(numbuf);
+}
+/*
+ * 키 입력이 올 때까지 CPU 를 쉬게 한다. 이 CPU 큐에 기다리는 프로세스가 있으면
+ * 양보하고, 없으면 수신 패킷을 처리한 뒤 다음 인터럽트 (키, NIC, 타이머 틱) 까지 hlt.
+ */
+int kgetchar() {
+    int ch;
+    while ((ch = kbd_getchar()) < 0) {
+        network_stack_poll();
+        if (this_cpu()->nr_queued) {
+            sched_yield();
+            continue;
+        }
+        cpu_disable_interrupts();
+        if (kbd_pending() || network_poll_pending()) cpu_enable_interrupts();
+        else cpu_wait_for_interrupt();   /* sti; hlt: 검사 뒤에 온 IRQ1/NIC IRQ 도 놓치지 않는다 */
     }
+    return ch;
 }
+
 void kgets(char *buffer, size_t maxlen) {
     size_t i = 0;
     int ch;
     while(i < maxlen - 1) {
         ch = kgetchar();
         if (ch == '\n' || ch == '\r') break;
+        if (ch == '\b') {
+            if (i > 0) i--;
+            continue;
+        }
+        if (ch >= 0x80) continue;   /* 화살표 등 확장 키는 한 줄 입력에서 무시 */
         buffer[i++] = (char)ch;
     }
     buffer[i] = '\0';
@@ -100,96 +183,121 @@ int tokenize(const char *cmd, char tokens[][MAX_CMD_LEN], int max_tokens) {
     return token_count;
 }
 
+/*
+ * 스크립트를 블록 캐시에서 조각 단위로 읽으며 한 줄씩 실행한다.
+ * 명령이 파일을 바꿀 수 있으므로 실행 후에는 현재 위치에서 다시 map 한다.
+ */
 void exec_file(const char *filename) {
-    int idx = find_file_index(filename);
-    if (idx == -1) { kprint("File not found.\n"); return; }
-    uint8 buffer[BLOCK_SIZE * MAX_DIRECT_BLOCKS];
-    if (knixfs_read_file(&file_table[idx].inode, buffer, sizeof(buffer)) != 0) {
-       kprint("File read error.\n");
-       return;
-    }
-    char *ptr = (char*)buffer;
-    while (*ptr != '\0') {
-        char command[MAX_CMD_LEN];
-        uint32 i = 0;
-        while (*ptr != '\n' && *ptr != '\0' && i < MAX_CMD_LEN - 1)
-            command[i++] = *ptr++;
+    int fh = file_open(filename, FILE_OPEN_READ);
+    if (fh == -1) { kprint("File not found.\n"); return; }
+    char command[MAX_CMD_LEN];
+    uint32 i = 0, len, n;
+    int done = 0;
+    while (!done) {
+        const char *ptr = (const char*)file_map(fh, &len);
+        if (!ptr) break;
+        for (n = 0; n < len; n++) {
+            if (ptr[n] == '\0') { done = 1; break; }
+            if (ptr[n] == '\n') break;
+            if (i < MAX_CMD_LEN - 1) command[i++] = ptr[n];
+        }
+        if (n == len && !done) { file_seek(fh, file_tell(fh) + len); continue; }
+        file_seek(fh, file_tell(fh) + n + 1);
         command[i] = '\0';
+        i = 0;
         if (command[0] != '\0') process_command(command);
-        if (*ptr == '\n') ptr++;
     }
+    if (!done && file_tell(fh) < file_size(fh)) {
+        kprint("Script read error.\n");   /* 체크섬 불일치: 남은 줄을 실행하지 않는다 */
+        file_close(fh);
+        return;
+    }
+    command[i] = '\0';
+    if (!done && command[0] != '\0') process_command(command);
+    file_close(fh);
 }
 
 void exec_binary_extended(const char *filename) {
-    int idx = find_file_index(filename);
-    if (idx == -1) { kprint("The binary file could not be found.\n"); return; }
-    uint8 buffer[BLOCK_SIZE * MAX_DIRECT_BLOCKS];
-    if (knixfs_read_file(&file_table[idx].inode, buffer, sizeof(buffer)) != 0) {
+    int fh = file_open(filename, FILE_OPEN_READ);
+    if (fh == -1) { kprint("The binary file could not be found.\n"); return; }
+    uint32 size;
+    const uint8 *image = file_image(fh, &size);
+    file_close(fh);
+    if (!image || size < 4) {
          kprint("Binary file read error.\n");
          return;
     }
-    if (buffer[0] == 0x7F && buffer[1] == 'E' &&
-        buffer[2] == 'L' && buffer[3] == 'F') {
-         kprint("ELF binary detected.\n");
-         Elf32_Ehdr *header = (Elf32_Ehdr*)buffer;
-         char numbuf[16];
-         kprint("Entry Point: ");
-         simple_itoa(header->e_entry, numbuf);
-         kprint(numbuf); kprint("\n");
-         void (*entry_point)() = (void (*)())(buffer + (header->e_entry));
-         entry_point();
-    } else {
-         kprint("Running flat binary...\n");
-         void (*entry_point)() = (void (*)())buffer;
-         entry_point();
+    kprint(is_elf(image, size) ? "ELF binary detected.\n" : "Running flat binary...\n");
+    /* 새 주소 공간에 적재하고, 실행하는 동안만 그 CR3 로 바꾼다 */
+    uint32 cr3, entry;
+    if (binary_load(image, size, &cr3, &entry) != 0) {
+         kprint("Binary load error.\n");
+         return;
     }
+    char numbuf[16];
+    kprint("Entry Point: ");
+    simple_itoa(entry, numbuf);
+    kprint(numbuf); kprint("\n");
+    process_run_in(cr3, (knix_entry_t)entry);
+    as_destroy(cr3);
 }
 
+/* 기존 내용을 조각 단위로 보여 주고, 새 줄은 끝에만 덧붙인다 */
 void edit_file(const char *filename) {
-    char buffer[BLOCK_SIZE * MAX_DIRECT_BLOCKS];
     int idx = find_file_index(filename);
+    if (file_is_dir(idx)) { kprint("Is a directory.\n"); return; }
+    kprint("Current File Content:\n");
     if (idx != -1) {
-        if (knixfs_read_file(&file_table[idx].inode, (uint8*)buffer, sizeof(buffer)) != 0) {
-            kprint("File read error.\n");
-            return;
+        int fh = file_open(filename, FILE_OPEN_READ);
+        const char *chunk;
+        uint32 len;
+        while ((chunk = (const char*)file_map(fh, &len)) != 0) {
+            if (kprint_len(chunk, len) < len) break;
+            file_seek(fh, file_tell(fh) + len);
         }
-    } else {
-        buffer[0] = '\0';
+        if (!chunk && file_tell(fh) < file_size(fh)) kprint("\nFile read error.");
+        file_close(fh);
     }
-    kprint("Current File Content:\n");
-    kprint(buffer);
     kprint("\nPlease enter new content (one line):\n");
-    char new_line[MAX_CMD_LEN];
-    kgets(new_line, MAX_CMD_LEN);
-    uint32 current_len = strlen(buffer);
-    if (current_len + strlen(new_line) + 1 < sizeof(buffer)) {
-        if (current_len > 0) buffer[current_len++] = '\n';
-        uint32 k = 0;
-        while(new_line[k] && current_len < sizeof(buffer) - 1)
-            buffer[current_len++] = new_line[k++];
-        buffer[current_len] = '\0';
-        if (idx != -1)
-            update_file(filename, (const uint8*)buffer, current_len);
-        else
-            create_file(filename, (const uint8*)buffer, current_len);
-        kprint("File saved.\n");
-    } else {
-        kprint("File content is too long.\n");
-    }
+    char new_line[MAX_CMD_LEN + 1];
+    new_line[0] = '\n';
+    kgets(new_line + 1, MAX_CMD_LEN);
+    int ret;
+    if (idx == -1)
+        ret = create_file(filename, (const uint8*)new_line + 1, strlen(new_line + 1)) == -1 ? -1 : 0;
+    else if (file_table[idx].inode.size == 0)
+        ret = append_file(filename, (const uint8*)new_line + 1, strlen(new_line + 1));
+    else
+        ret = append_file(filename, (const uint8*)new_line, strlen(new_line));
+    kprint(ret == 0 ? "File saved.\n" : "File content is too long.\n");
 }
 
-void find_file(const char *pattern) {
-    uint32 i;
+/* 현재 디렉터리부터 깊이 우선으로 내려가며 이름에 pattern 이 들어간 항목의 경로를 출력 */
+static int find_in_dir(int dir, char *path, uint32 len, const char *pattern, uint32 depth) {
+    uint32 pos = 0, j;
     int found = 0;
-    for (i = 0; i < MAX_FILES; i++) {
-        if (file_table[i].in_use) {
-            if (strstr(file_table[i].name, pattern) != 0) {
-                kprint(file_table[i].name); kprint("\n");
-                found = 1;
-            }
+    DirEntry ent;
+    while (dir_next_entry(dir, &pos, &ent) == 0) {
+        if (strcmp(ent.name, "..") == 0) continue;
+        uint32 end = len;
+        if (end > 0 && end < DIR_MAX_DEPTH * MAX_FILENAME_LEN - 1) path[end++] = '/';
+        for (j = 0; ent.name[j] && end < DIR_MAX_DEPTH * MAX_FILENAME_LEN - 1; j++)
+            path[end++] = ent.name[j];
+        path[end] = '\0';
+        if (strstr(ent.name, pattern) != 0) {
+            kprint(path); kprint("\n");
+            found = 1;
         }
+        if (file_is_dir((int)ent.slot) && depth + 1 < DIR_MAX_DEPTH)
+            found |= find_in_dir((int)ent.slot, path, end, pattern, depth + 1);
     }
-    if (!found) kprint("No matching file exists.\n");
+    return found;
+}
+
+void find_file(const char *pattern) {
+    static char path[DIR_MAX_DEPTH * MAX_FILENAME_LEN];
+    path[0] = '\0';
+    if (!find_in_dir(dir_cwd(), path, 0, pattern, 0)) kprint("No matching file exists.\n");
 }
 
 char *strstr(const char *haystack, const char *needle) {
@@ -4,7 +4,10 @@
 #include "dc.h"
 
 void kprint(const char *str);
+uint32 kprint_len(const char *str, uint32 len);
 void kprint_hex(uint32 num);
+void kprint_dec(uint32 num);
+void kprintf(const char *fmt, ...);
 int kgetchar();
 void kgets(char *buffer, size_t maxlen);
 int tokenize(const char *cmd, char tokens[][MAX_CMD_LEN], int max_tokens);
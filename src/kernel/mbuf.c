@@ -0,0 +1,85 @@
+#include "mbuf.h"
+#include "slab.h"
+#include "spinlock.h"
+#include "type.h"
+
+/*=========================*/
+/* 8-1. 패킷 버퍼 (mbuf) 풀 */
+/*=========================*/
+/*
+ * 부팅 때 MBUF_POOL 개를 한 번에 할당해 free 리스트에 건다.
+ * 수신 (ne2k_recv_batch) 과 송신 (프로토콜 계층) 이 같은 풀을 쓴다.
+ */
+static mbuf_t *pool = 0;
+static mbuf_t *free_list = 0;
+static spinlock_t mbuf_lock = SPINLOCK_INIT;
+mbuf_stats_t mbuf_stats;
+
+int mbuf_init() {
+    uint32 i;
+    if (pool) return 0;
+    pool = (mbuf_t*)kmalloc(MBUF_POOL * sizeof(mbuf_t));
+    if (!pool) return -1;
+    memset(&mbuf_stats, 0, sizeof(mbuf_stats));
+    for (i = 0; i < MBUF_POOL; i++) {
+        pool[i].next = free_list;
+        free_list = &pool[i];
+    }
+    mbuf_stats.total = mbuf_stats.free = mbuf_stats.low_water = MBUF_POOL;
+    return 0;
+}
+
+mbuf_t *mbuf_alloc() {
+    mbuf_t *m;
+    uint32 flags = spin_lock_irqsave(&mbuf_lock);
+    if ((m = free_list) == 0) {
+        mbuf_stats.failures++;
+        spin_unlock_irqrestore(&mbuf_lock, flags);
+        return 0;
+    }
+    free_list = m->next;
+    mbuf_stats.free--;
+    mbuf_stats.allocs++;
+    if (mbuf_stats.free < mbuf_stats.low_water) mbuf_stats.low_water = mbuf_stats.free;
+    spin_unlock_irqrestore(&mbuf_lock, flags);
+    m->next = 0;
+    m->data = m->buf + MBUF_HEADROOM;
+    m->len = 0;
+    m->refs = 1;
+    return m;
+}
+
+void mbuf_ref(mbuf_t *m) {
+    __sync_fetch_and_add(&m->refs, 1);
+}
+
+void mbuf_free(mbuf_t *m) {
+    uint32 flags;
+    if (!m || __sync_sub_and_fetch(&m->refs, 1) != 0) return;
+    flags = spin_lock_irqsave(&mbuf_lock);
+    m->next = free_list;
+    free_list = m;
+    mbuf_stats.free++;
+    spin_unlock_irqrestore(&mbuf_lock, flags);
+}
+
+uint8 *mbuf_prepend(mbuf_t *m, uint32 n) {
+    if ((uint32)(m->data - m->buf) < n) return 0;
+    m->data -= n;
+    m->len += n;
+    return m->data;
+}
+
+uint8 *mbuf_append(mbuf_t *m, uint32 n) {
+    uint8 *tail = m->data + m->len;
+    if ((uint32)(m->buf + MBUF_SIZE - tail) < n) return 0;
+    m->len += n;
+    return tail;
+}
+
+uint8 *mbuf_pull(mbuf_t *m, uint32 n) {
+    if (m->len < n) return 0;
+    m->data += n;
+    m->len -= n;
+    return m->data;
+}
@@ -0,0 +1,40 @@
+#ifndef MBUF_H
+#define MBUF_H
+
+#include "dc.h"
+
+/*
+ * 고정 크기 패킷 버퍼. data 는 buf 안에서 움직이는 프레임 시작이고,
+ * 프로토콜 계층은 페이로드를 복사하지 않고 data 앞 (headroom) 에 헤더를 붙인다.
+ * 여러 곳이 같은 버퍼를 잡을 수 있도록 참조 수를 센다 (마지막 mbuf_free 가 풀로 돌려준다).
+ */
+typedef struct mbuf {
+    struct mbuf *next;        /* free 리스트 / 송신 큐 */
+    uint8 *data;
+    uint32 len;
+    volatile uint32 refs;
+    uint8 buf[MBUF_SIZE];
+} mbuf_t;
+
+typedef struct {
+    uint32 total;
+    uint32 free;
+    uint32 low_water;         /* free 가 가장 적었던 때 */
+    uint32 allocs;
+    uint32 failures;
+} mbuf_stats_t;
+
+extern mbuf_stats_t mbuf_stats;
+
+int mbuf_init();
+mbuf_t *mbuf_alloc();
+void mbuf_ref(mbuf_t *m);
+void mbuf_free(mbuf_t *m);
+/* data 앞에 n 바이트를 붙이고 새 시작 주소 (headroom 이 모자라면 0) */
+uint8 *mbuf_prepend(mbuf_t *m, uint32 n);
+/* 끝에 n 바이트를 늘리고 그 자리 (공간이 모자라면 0) */
+uint8 *mbuf_append(mbuf_t *m, uint32 n);
+/* 앞에서 n 바이트를 떼어 낸다 (받은 프레임의 헤더를 벗길 때) */
+uint8 *mbuf_pull(mbuf_t *m, uint32 n);
+
+#endif //MBUF_H
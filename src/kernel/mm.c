@@ -0,0 +1,260 @@
+#include "mm.h"
+#include "paging.h"
+#include "multiboot.h"
+#include "kprint.h"
+#include "type.h"
+#include "cpu.h"
+#include "spinlock.h"
+
+/*=========================*/
+/* 15-1. 물리 페이지 (buddy) 할당자 */
+/*=========================*/
+/*
+ * 페이지마다 1바이트 (상위 4비트 상태, 하위 4비트 order) 를 둔다.
+ * free 블록은 첫 페이지에 리스트 노드를 담고 order 별 이중 연결 리스트에 걸린다.
+ * 블록을 풀 때 같은 order 의 buddy (index ^ 2^order) 가 free 머리면 합친다.
+ */
+#define FRAME_RESERVED  0x00   /* 메모리 맵에 없거나 커널이 쓰는 페이지 */
+#define FRAME_FREE      0x10   /* free 블록의 첫 페이지 */
+#define FRAME_USED      0x20   /* 할당된 블록의 첫 페이지 */
+#define FRAME_SLAB      0x30   /* slab 이 쓰는 페이지 (블록 전체) */
+#define FRAME_TAIL      0x40   /* 블록의 나머지 페이지 */
+#define FRAME_AVAIL     0x50   /* 초기화 중: 메모리 맵상 사용 가능 */
+
+#define FRAME_STATE(f)  (frame_info[f] & 0xF0)
+#define FRAME_ORDER(f)  (frame_info[f] & 0x0F)
+
+typedef struct free_block {
+    struct free_block *next;
+    struct free_block *prev;
+} free_block_t;
+
+extern uint8 _kernel_end[];   /* linker.ld */
+
+mem_stats_t mem_stats;
+static uint8 frame_info[MEM_MAX_FRAMES];
+static free_block_t *free_list[BUDDY_MAX_ORDER + 1];
+static spinlock_t mm_lock = SPINLOCK_INIT;   /* free 리스트, frame_info, mem_stats (모든 CPU 공용) */
+static uint32 frame_limit = 0;   /* 이 페이지 번호부터는 관리하지 않음 */
+
+/* 페이지는 커널 직접 매핑 (KERNEL_VBASE + 물리) 주소로 주고받는다 */
+static void *frame_addr(uint32 frame) {
+    return phys_to_virt(frame << PAGE_SHIFT);
+}
+
+static uint32 addr_frame(const void *addr) {
+    return virt_to_phys(addr) >> PAGE_SHIFT;
+}
+
+static void list_push(uint32 frame, uint32 order) {
+    free_block_t *b = (free_block_t*)frame_addr(frame);
+    b->prev = 0;
+    b->next = free_list[order];
+    if (b->next) b->next->prev = b;
+    free_list[order] = b;
+    frame_info[frame] = (uint8)(FRAME_FREE | order);
+    mem_stats.nr_free[order]++;
+}
+
+static void list_remove(uint32 frame, uint32 order) {
+    free_block_t *b = (free_block_t*)frame_addr(frame);
+    if (b->prev) b->prev->next = b->next;
+    else free_list[order] = b->next;
+    if (b->next) b->next->prev = b->prev;
+    frame_info[frame] = FRAME_TAIL;
+    mem_stats.nr_free[order]--;
+}
+
+/* 사용 가능 구간 [start, end) 을 정렬된 최대 블록들로 쪼개 넣는다 */
+static void add_range(uint32 start, uint32 end) {
+    while (start < end) {
+        uint32 order = BUDDY_MAX_ORDER;
+        while (order > 0 && ((start & ((1u << order) - 1)) || start + (1u << order) > end)) order--;
+        uint32 i;
+        for (i = 1; i < (1u << order); i++) frame_info[start + i] = FRAME_TAIL;
+        list_push(start, order);
+        mem_stats.free_pages += 1u << order;
+        start += 1u << order;
+    }
+}
+
+static void mark_avail(uint64 addr, uint64 len) {
+    uint64 end = addr + len;
+    uint32 first, last, f;
+    if (addr >= MEM_MAX_BYTES) return;
+    if (end > MEM_MAX_BYTES) end = MEM_MAX_BYTES;
+    first = (uint32)((addr + PAGE_SIZE - 1) >> PAGE_SHIFT);
+    last = (uint32)(end >> PAGE_SHIFT);
+    for (f = first; f < last; f++) {
+        if (frame_info[f] != FRAME_AVAIL) mem_stats.total_pages++;
+        frame_info[f] = FRAME_AVAIL;
+    }
+    if (last > frame_limit) frame_limit = last;
+}
+
+/*
+ * 부트 시 한 번: multiboot 메모리 맵 (없으면 mem_upper, 그것도 없으면
+ * MEM_FALLBACK_BYTES) 에서 사용 가능한 페이지를 모으고, 1MB 아래와
+ * 커널 이미지 (_kernel_end 까지) 를 뺀 나머지를 buddy 리스트에 넣는다.
+ */
+void mem_init(uint32 magic, uint32 info_addr) {
+    uint32 f, reserve_end, run_start = 0, in_run = 0;
+    memset(frame_info, FRAME_RESERVED, sizeof(frame_info));
+    memset(free_list, 0, sizeof(free_list));
+    memset(&mem_stats, 0, sizeof(mem_stats));
+    frame_limit = 0;
+
+    /* 부트로더가 넘긴 주소는 물리 주소 */
+    const multiboot_info_t *mbi = (const multiboot_info_t*)phys_to_virt(info_addr);
+    if (magic == MULTIBOOT_BOOTLOADER_MAGIC && (mbi->flags & MULTIBOOT_INFO_MEM_MAP)) {
+        uint32 p = mbi->mmap_addr, end = mbi->mmap_addr + mbi->mmap_length;
+        while (p < end) {
+            const multiboot_mmap_entry_t *e = (const multiboot_mmap_entry_t*)phys_to_virt(p);
+            if (e->type == MULTIBOOT_MEMORY_AVAILABLE) mark_avail(e->addr, e->len);
+            mem_stats.map_entries++;
+            p += e->size + 4;
+        }
+    } else if (magic == MULTIBOOT_BOOTLOADER_MAGIC && (mbi->flags & MULTIBOOT_INFO_MEMORY)) {
+        mark_avail(MEM_LOW_LIMIT, (uint64)mbi->mem_upper * 1024);
+        mem_stats.map_entries = 1;
+    } else {
+        mark_avail(MEM_LOW_LIMIT, MEM_FALLBACK_BYTES - MEM_LOW_LIMIT);
+    }
+
+    reserve_end = (virt_to_phys(_kernel_end) + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    if (reserve_end < (MEM_LOW_LIMIT >> PAGE_SHIFT)) reserve_end = MEM_LOW_LIMIT >> PAGE_SHIFT;
+    for (f = 0; f < reserve_end && f < frame_limit; f++) {
+        if (frame_info[f] == FRAME_AVAIL) {
+            frame_info[f] = FRAME_RESERVED;
+            mem_stats.reserved_pages++;
+        }
+    }
+    for (f = reserve_end; f <= frame_limit; f++) {
+        int avail = f < frame_limit && frame_info[f] == FRAME_AVAIL;
+        if (avail && !in_run) { run_start = f; in_run = 1; }
+        if (!avail && in_run) { add_range(run_start, f); in_run = 0; }
+    }
+}
+
+/* bytes 를 담는 최소 order. 가장 큰 블록보다 크면 BUDDY_MAX_ORDER + 1 (page_alloc 이 거절) */
+uint32 page_order_for(uint32 bytes) {
+    uint32 order = 0;
+    while (order <= BUDDY_MAX_ORDER && ((uint32)PAGE_SIZE << order) < bytes) order++;
+    return order;
+}
+
+/* 2^order 연속 페이지. 큰 블록을 반씩 나눠 남는 쪽은 free 리스트로 */
+void *page_alloc(uint32 order) {
+    uint32 o, frame, flags;
+    if (order > BUDDY_MAX_ORDER) return 0;
+    flags = spin_lock_irqsave(&mm_lock);
+    for (o = order; o <= BUDDY_MAX_ORDER && !free_list[o]; o++);
+    if (o > BUDDY_MAX_ORDER) {
+        mem_stats.failures++;
+        spin_unlock_irqrestore(&mm_lock, flags);
+        return 0;
+    }
+    frame = addr_frame(free_list[o]);
+    list_remove(frame, o);
+    while (o > order) {
+        o--;
+        list_push(frame + (1u << o), o);
+        mem_stats.splits++;
+    }
+    frame_info[frame] = (uint8)(FRAME_USED | order);
+    mem_stats.free_pages -= 1u << order;
+    mem_stats.allocs++;
+    spin_unlock_irqrestore(&mm_lock, flags);
+    return frame_addr(frame);
+}
+
+void page_free(void *addr) {
+    uint32 frame = addr_frame(addr), order, flags;
+    if (frame >= frame_limit || ((uint32)addr & (PAGE_SIZE - 1))) return;
+    flags = spin_lock_irqsave(&mm_lock);
+    if (FRAME_STATE(frame) != FRAME_USED) {
+        spin_unlock_irqrestore(&mm_lock, flags);
+        return;   /* 이중 해제, 할당되지 않은 주소, 아직 slab 표시가 남은 블록 */
+    }
+    order = FRAME_ORDER(frame);
+    mem_stats.free_pages += 1u << order;
+    mem_stats.frees++;
+    frame_info[frame] = FRAME_TAIL;
+    while (order < BUDDY_MAX_ORDER) {
+        uint32 buddy = frame ^ (1u << order);
+        if (buddy >= frame_limit || frame_info[buddy] != (uint8)(FRAME_FREE | order)) break;
+        list_remove(buddy, order);
+        if (buddy < frame) frame = buddy;
+        order++;
+        mem_stats.merges++;
+    }
+    list_push(frame, order);
+    spin_unlock_irqrestore(&mm_lock, flags);
+}
+
+uint32 frame_alloc() {
+    void *p = page_alloc(0);
+    return p ? virt_to_phys(p) : 0;
+}
+
+void frame_free(uint32 phys) {
+    page_free(phys_to_virt(phys));
+}
+
+/* slab 블록의 모든 페이지에 slab 표시 (order 는 각 페이지에 같이 저장) */
+void page_mark_slab(void *addr, uint32 order, int on) {
+    uint32 frame = addr_frame(addr), i;
+    for (i = 0; i < (1u << order); i++)
+        frame_info[frame + i] = (uint8)((on ? FRAME_SLAB : (i ? FRAME_TAIL : FRAME_USED)) | order);
+}
+
+/* addr 가 slab 페이지 안이면 그 slab 블록의 시작 주소, 아니면 0 */
+void *page_slab_head(const void *addr) {
+    uint32 frame = addr_frame(addr);
+    if (frame >= frame_limit || FRAME_STATE(frame) != FRAME_SLAB) return 0;
+    return (void*)((uint32)addr & ~((PAGE_SIZE << FRAME_ORDER(frame)) - 1));
+}
+
+/*=========================*/
+/* meminfo: 메모리 맵, order 별 free 블록, 외부 단편화 */
+/*=========================*/
+/*
+ * order k 요청에 쓸 수 없는 free 메모리 비율 (unusable free space index):
+ * k 보다 작은 블록에 흩어진 free 페이지 / 전체 free 페이지.
+ */
+static uint32 unusable_percent(uint32 order) {
+    uint32 o, usable = 0;
+    if (mem_stats.free_pages == 0) return 0;
+    for (o = order; o <= BUDDY_MAX_ORDER; o++) usable += mem_stats.nr_free[o] << o;
+    return (mem_stats.free_pages - usable) * 100 / mem_stats.free_pages;
+}
+
+void mem_stat_cmd() {
+    uint32 o, largest = 0;
+    kprint("Physical memory:\n");
+    kprint("  Map entries: ");
+    if (mem_stats.map_entries) kprint_dec(mem_stats.map_entries);
+    else kprint("none (assumed 16MB)");
+    kprint("\n  Usable: "); kprint_dec(mem_stats.total_pages * (PAGE_SIZE / 1024));
+    kprint(" KB, kernel/low reserved: "); kprint_dec(mem_stats.reserved_pages * (PAGE_SIZE / 1024));
+    kprint(" KB (image ends at "); kprint_hex(virt_to_phys(_kernel_end));
+    kprint(")\n  Free: "); kprint_dec(mem_stats.free_pages * (PAGE_SIZE / 1024));
+    kprint(" KB in "); kprint_dec(mem_stats.free_pages); kprint(" pages\n");
+    kprint("  Allocs: "); kprint_dec(mem_stats.allocs);
+    kprint(", frees: "); kprint_dec(mem_stats.frees);
+    kprint(", splits: "); kprint_dec(mem_stats.splits);
+    kprint(", merges: "); kprint_dec(mem_stats.merges);
+    kprint(", failures: "); kprint_dec(mem_stats.failures);
+    kprint("\n  Order  Blocks  Unusable%\n");
+    for (o = 0; o <= BUDDY_MAX_ORDER; o++) {
+        if (mem_stats.nr_free[o]) largest = o;
+        kprint("  ");
+        if (o < 10) kprint(" ");
+        kprint_dec(o); kprint("     ");
+        kprint_dec(mem_stats.nr_free[o]); kprint("       ");
+        kprint_dec(unusable_percent(o)); kprint("\n");
+    }
+    kprint("  Largest free block: ");
+    kprint_dec(mem_stats.free_pages ? (PAGE_SIZE << largest) / 1024 : 0);
+    kprint(" KB\n");
+}
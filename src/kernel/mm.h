@@ -0,0 +1,41 @@
+#ifndef MM_H
+#define MM_H
+
+#include "dc.h"
+
+/*
+ * 물리 페이지 할당자 (buddy). multiboot 메모리 맵의 사용 가능 구간으로 채우고
+ * 2^order 페이지 단위로 나누고 합친다. 포인터는 커널 직접 매핑 주소 (paging.h).
+ */
+typedef struct {
+    uint32 total_pages;     /* 메모리 맵에서 사용 가능으로 보고된 페이지 (MEM_MAX_BYTES 이하) */
+    uint32 reserved_pages;  /* 그중 커널 이미지 / 1MB 아래라 제외한 페이지 */
+    uint32 free_pages;
+    uint32 nr_free[BUDDY_MAX_ORDER + 1];  /* order 별 free 블록 수 */
+    uint32 allocs;
+    uint32 frees;
+    uint32 splits;
+    uint32 merges;
+    uint32 failures;
+    uint32 map_entries;     /* 0 이면 multiboot 정보 없이 기본값 사용 */
+} mem_stats_t;
+
+extern mem_stats_t mem_stats;
+
+void mem_init(uint32 magic, uint32 info_addr);
+void *page_alloc(uint32 order);
+void page_free(void *addr);
+/* 너무 크면 BUDDY_MAX_ORDER + 1 */
+uint32 page_order_for(uint32 bytes);
+
+/* 단일 프레임 (물리 주소, 실패 시 0) */
+uint32 frame_alloc();
+void frame_free(uint32 phys);
+
+/* slab 이 쓰는 페이지 표시: kfree 가 포인터만으로 slab 머리를 찾는다 */
+void page_mark_slab(void *addr, uint32 order, int on);
+void *page_slab_head(const void *addr);
+
+void mem_stat_cmd();
+
+#endif //MM_H
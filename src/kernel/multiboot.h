@@ -0,0 +1,39 @@
+#ifndef MULTIBOOT_H
+#define MULTIBOOT_H
+
+#include "dc.h"
+
+/* Multiboot (v1) 헤더와 부트로더가 넘겨 주는 정보 구조체 (필요한 필드만) */
+#define MULTIBOOT_HEADER_MAGIC      0x1BADB002
+#define MULTIBOOT_BOOTLOADER_MAGIC  0x2BADB002
+#define MULTIBOOT_PAGE_ALIGN        0x00000001
+#define MULTIBOOT_MEMORY_INFO       0x00000002
+
+/* multiboot_info_t.flags */
+#define MULTIBOOT_INFO_MEMORY       0x00000001  /* mem_lower / mem_upper 유효 */
+#define MULTIBOOT_INFO_MEM_MAP      0x00000040  /* mmap_length / mmap_addr 유효 */
+
+#define MULTIBOOT_MEMORY_AVAILABLE  1
+
+typedef struct {
+    uint32 flags;
+    uint32 mem_lower;      /* KB, 0 부터 */
+    uint32 mem_upper;      /* KB, 1MB 부터 */
+    uint32 boot_device;
+    uint32 cmdline;
+    uint32 mods_count;
+    uint32 mods_addr;
+    uint32 syms[4];
+    uint32 mmap_length;
+    uint32 mmap_addr;
+} __attribute__((packed)) multiboot_info_t;
+
+/* size 는 자기 자신을 뺀 엔트리 크기라 다음 엔트리는 addr + size + 4 */
+typedef struct {
+    uint32 size;
+    uint64 addr;
+    uint64 len;
+    uint32 type;
+} __attribute__((packed)) multiboot_mmap_entry_t;
+
+#endif //MULTIBOOT_H
@@ -1,73 +1,594 @@
 #include "network.h"
+#include "inet.h"
+#include "tcp.h"
+#include "keyboard.h"
 #include "kprint.h"
 #include "type.h"
+#include "pci.h"
+#include "slab.h"
+#include "timer.h"
+#include "cpu.h"
+#include "spinlock.h"
+#include "idt.h"
 
 /*=========================*/
 /* 8. NE2000 NIC & 간단 네트워킹 스택 */
 /*=========================*/
-void ne2k_init() {
-    outb(NE2K_IO_BASE + NE2K_CR, CR_STP);
-    outb(NE2K_IO_BASE + NE2K_PSTART, NE2K_RXBUF_START);
-    outb(NE2K_IO_BASE + NE2K_PSTOP, NE2K_RXBUF_STOP);
-    outb(NE2K_IO_BASE + NE2K_TPSR, NE2K_TX_PAGE);
-    outb(NE2K_IO_BASE + NE2K_CR, CR_STA);
+/*
+ * 카드 메모리 0x40..0x80 중 앞 12 페이지는 전송 슬롯 두 개, 나머지는 수신 링이다.
+ * 카드는 CURR 페이지부터 [4 바이트 헤더 | 프레임] 을 쓰고, 우리는 BNRY 다음부터
+ * CURR 앞까지를 remote DMA 로 읽은 뒤 BNRY 를 밀어 자리를 돌려준다.
+ * 데이터 포트는 16비트 모드 (DCR.WTS) 로 읽어 포트 I/O 횟수를 반으로 줄인다.
+ * 송신은 mbuf 큐에서 빈 슬롯으로 옮기고, 한 슬롯이 전송되는 동안 다른 슬롯을 채운다.
+ * 카드 레지스터와 remote DMA 는 nic_lock 하나로 지킨다.
+ *
+ * 수신은 NAPI 방식이다. IRQ (top half) 는 IMR 을 0 으로 내려 선을 떨어뜨리고
+ * rx_scheduled 만 세운다. bottom half (network_stack_poll) 는 IRQ 문맥 밖에서 돌며
+ * NET_POLL_BUDGET 까지 처리하고, 일이 남으면 인터럽트를 끈 채 다음 호출에서 다시 폴링하고,
+ * 다 비웠으면 IMR 을 되살린다. 그 사이 도착한 프레임은 ISR 에 남아 있어 IMR 을 켜는 순간
+ * 다시 IRQ 가 선다. 가벼운 부하에서는 프레임마다 IRQ 로 바로 깨어나고,
+ * 무거운 부하에서는 인터럽트 없이 폴링만 한다.
+ */
+#define NE2K_PCI_VENDOR   0x10EC   /* Realtek RTL8029 (QEMU ne2k_pci) */
+#define NE2K_PCI_DEVICE   0x8029
+#define PCI_CLASS_NETWORK 0x02
+#define DCR_WORD_FIFO8    0x49     /* 16비트 전송, 일반 모드, FIFO 8 바이트 */
+#define RCR_BROADCAST     0x04
+#define RCR_MONITOR       0x20
+#define TCR_LOOPBACK      0x02
+#define NE2K_RESET_SPINS  100000
+
+typedef struct {
+    uint8 status;
+    uint8 next;          /* 다음 프레임의 페이지 */
+    uint16 count;        /* 헤더 4 바이트 포함 길이 */
+} __attribute__((packed)) ne2k_rx_header_t;
+
+net_stats_t net_stats;
+static uint16 ne2k_io = NE2K_IO_BASE;
+static uint8 ne2k_irq = 0;
+static uint8 ne2k_mac[6];
+static int ne2k_found = 0;
+static const char *ne2k_bus = "none";
+static uint8 rx_next = NE2K_RXBUF_START + 1;   /* 다음에 읽을 링 페이지 */
+static spinlock_t nic_lock = SPINLOCK_INIT;
+
+/* 송신: 큐 -> 슬롯 (fill 순서) -> 전송 (같은 순서) */
+static mbuf_t *txq_head = 0, *txq_tail = 0;
+static uint32 txq_len = 0;
+static uint16 slot_len[NE2K_TX_SLOTS];   /* 0 이면 빈 슬롯 */
+static uint32 tx_fill_slot = 0, tx_send_slot = 0;
+static uint32 tx_busy = 0;
+static uint32 tx_started = 0;   /* 전송을 시작한 timer_ticks (watchdog) */
+
+/* NAPI: top half 가 세우고 bottom half 가 내린다 */
+static volatile uint32 rx_scheduled = 0;
+static uint32 irq_mode = 0;   /* IRQ 를 등록했다 (0 이면 매번 폴링) */
+
+static inline void ne2k_out(uint8 reg, uint8 value) {
+    outb(ne2k_io + reg, value);
+}
+
+static inline uint8 ne2k_in(uint8 reg) {
+    return inb(ne2k_io + reg);
+}
+
+/*=========================*/
+/* Remote DMA */
+/*=========================*/
+static void remote_setup(uint16 addr, uint16 len, uint8 cmd) {
+    ne2k_out(NE2K_CR, CR_RD2 | CR_STA);
+    ne2k_out(NE2K_RBCR0, len & 0xFF);
+    ne2k_out(NE2K_RBCR1, len >> 8);
+    ne2k_out(NE2K_RSAR0, addr & 0xFF);
+    ne2k_out(NE2K_RSAR1, addr >> 8);
+    ne2k_out(NE2K_CR, cmd | CR_STA);
+}
+
+static void remote_finish() {
+    uint32 spins = NE2K_RESET_SPINS;
+    while (!(ne2k_in(NE2K_ISR) & ISR_RDC) && --spins) cpu_relax();
+    ne2k_out(NE2K_ISR, ISR_RDC);
+}
+
+/* 카드 메모리 addr 에서 len 바이트. 워드 단위로 읽으므로 buf 는 짝수로 올린 길이만큼 있어야 한다 */
+static void remote_read(uint16 addr, void *buf, uint16 len) {
+    uint16 *p = (uint16*)buf, words = (uint16)((len + 1) / 2), i;
+    remote_setup(addr, (uint16)(words * 2), CR_RD0);
+    for (i = 0; i < words; i++) p[i] = inw(ne2k_io + NE2K_DATA);
+    remote_finish();
+}
+
+static void remote_write(uint16 addr, const void *buf, uint16 len) {
+    const uint16 *p = (const uint16*)buf;
+    uint16 words = (uint16)((len + 1) / 2), i;
+    remote_setup(addr, (uint16)(words * 2), CR_RD1);
+    for (i = 0; i < words; i++) outw(ne2k_io + NE2K_DATA, p[i]);
+    remote_finish();
+}
+
+/*=========================*/
+/* 초기화 */
+/*=========================*/
+/* PCI (RTL8029) 가 있으면 그 I/O BAR, 없으면 ISA 기본 주소 */
+static void ne2k_locate() {
+    PCI_Device *dev = pci_find_class(PCI_CLASS_NETWORK, 0x00);
+    if (dev && dev->vendor_id == NE2K_PCI_VENDOR && dev->device_id == NE2K_PCI_DEVICE) {
+        ne2k_io = (uint16)(pci_read_bar(dev, 0) & ~3u);
+        ne2k_irq = dev->irq_line;
+        ne2k_bus = "PCI";
+        pci_enable_bus_master(dev);
+        return;
+    }
+    ne2k_io = NE2K_IO_BASE;
+    ne2k_irq = IRQ_NE2K_ISA;
+    ne2k_bus = "ISA";
+}
+
+/* 리셋 포트를 읽고 쓰면 ISR.RST 가 선다. 카드가 없으면 0xFF 나 0 이 그대로 */
+static int ne2k_reset() {
+    uint32 spins = NE2K_RESET_SPINS;
+    ne2k_out(NE2K_RESET, ne2k_in(NE2K_RESET));
+    while (!(ne2k_in(NE2K_ISR) & ISR_RST)) {
+        if (--spins == 0) return -1;
+        cpu_relax();
+    }
+    ne2k_out(NE2K_ISR, 0xFF);
+    return ne2k_in(NE2K_CR) == 0xFF ? -1 : 0;
+}
+
+int ne2k_init() {
+    uint16 prom[6];
+    uint32 i;
+    ne2k_locate();
+    if (ne2k_reset() != 0) {
+        ne2k_found = 0;
+        return -1;
+    }
+    ne2k_out(NE2K_CR, CR_RD2 | CR_STP);
+    ne2k_out(NE2K_DCR, DCR_WORD_FIFO8);
+    ne2k_out(NE2K_RBCR0, 0);
+    ne2k_out(NE2K_RBCR1, 0);
+    ne2k_out(NE2K_IMR, 0);
+    ne2k_out(NE2K_ISR, 0xFF);
+    ne2k_out(NE2K_RCR, RCR_MONITOR);
+    ne2k_out(NE2K_TCR, TCR_LOOPBACK);
+
+    /* PROM 의 MAC: 16비트 모드에서는 바이트마다 한 워드 */
+    ne2k_out(NE2K_CR, CR_RD2 | CR_STA);
+    remote_read(0, prom, sizeof(prom));
+    ne2k_out(NE2K_CR, CR_RD2 | CR_STP);
+    for (i = 0; i < 6; i++) ne2k_mac[i] = (uint8)prom[i];
+
+    ne2k_out(NE2K_PSTART, NE2K_RXBUF_START);
+    ne2k_out(NE2K_PSTOP, NE2K_RXBUF_STOP);
+    ne2k_out(NE2K_BNRY, NE2K_RXBUF_START);
+    ne2k_out(NE2K_TPSR, NE2K_TX_PAGE);
+
+    ne2k_out(NE2K_CR, CR_PAGE1 | CR_RD2 | CR_STP);
+    for (i = 0; i < 6; i++) ne2k_out(NE2K_PAR0 + i, ne2k_mac[i]);
+    for (i = 0; i < 8; i++) ne2k_out(NE2K_MAR0 + i, 0xFF);
+    ne2k_out(NE2K_CURR, NE2K_RXBUF_START + 1);
+    rx_next = NE2K_RXBUF_START + 1;
+    slot_len[0] = slot_len[1] = 0;
+    tx_fill_slot = tx_send_slot = tx_busy = 0;
+
+    ne2k_out(NE2K_CR, CR_RD2 | CR_STA);
+    ne2k_out(NE2K_ISR, 0xFF);
+    ne2k_out(NE2K_TCR, 0);
+    ne2k_out(NE2K_RCR, RCR_BROADCAST);
+    ne2k_found = 1;
+    return 0;
+}
+
+/* top half: 우리 카드의 인터럽트면 IMR 을 내리고 bottom half 를 예약한다 (공유 PCI 선 고려) */
+static void ne2k_irq_handler(interrupt_frame_t *frame) {
+    (void)frame;
+    spin_lock(&nic_lock);
+    if (ne2k_in(NE2K_ISR) & NE2K_IMR_BITS) {
+        ne2k_out(NE2K_IMR, 0);   /* ISR 은 그대로: bottom half 가 읽고 지운다 */
+        rx_scheduled = 1;
+        net_stats.irqs++;
+    }
+    spin_unlock(&nic_lock);
+}
+
+/* 0 이나 2 (캐스케이드), 0xFF (미할당) 면 IRQ 없이 폴링만 */
+static void ne2k_irq_enable() {
+    uint32 flags;
+    if (ne2k_irq == 0 || ne2k_irq == 2 || ne2k_irq >= 16) return;
+    irq_register(ne2k_irq, ne2k_irq_handler);
+    flags = spin_lock_irqsave(&nic_lock);
+    irq_mode = 1;
+    rx_scheduled = 1;   /* 켜기 전에 쌓인 것부터 */
+    spin_unlock_irqrestore(&nic_lock, flags);
+}
+
+int ne2k_present() {
+    return ne2k_found;
+}
+
+const uint8 *ne2k_mac_addr() {
+    return ne2k_mac;
+}
+
+/*=========================*/
+/* 송신 / 수신 */
+/*=========================*/
+static void tx_start(uint32 slot) {
+    ne2k_out(NE2K_TPSR, NE2K_TX_PAGE + slot * NE2K_TX_PAGES);
+    ne2k_out(NE2K_TBCR0, slot_len[slot] & 0xFF);
+    ne2k_out(NE2K_TBCR1, slot_len[slot] >> 8);
+    ne2k_out(NE2K_CR, CR_RD2 | CR_TXP | CR_STA);
+    tx_send_slot = slot;
+    tx_busy = 1;
+    tx_started = timer_ticks;
+}
+
+/* 전송 완료를 거두고, 빈 슬롯을 큐에서 채우고, 쉬고 있으면 다음 슬롯을 보낸다 (nic_lock) */
+static void tx_pump_locked() {
+    uint8 isr;
+    mbuf_t *m;
+    if (tx_busy && (isr = ne2k_in(NE2K_ISR) & (ISR_PTX | ISR_TXE)) != 0) {
+        ne2k_out(NE2K_ISR, isr);
+        if (isr & ISR_PTX) {
+            net_stats.tx_frames++;
+            net_stats.tx_bytes += slot_len[tx_send_slot];
+        } else {
+            net_stats.tx_errors++;
+        }
+        slot_len[tx_send_slot] = 0;
+        tx_send_slot ^= 1;
+        tx_busy = 0;
+    } else if (tx_busy && timer_ticks - tx_started >= NET_TX_TIMEOUT_MS * SCHED_HZ / 1000) {
+        /* watchdog: 완료가 사라졌거나 카드가 멈췄다. 슬롯을 버려 큐가 영원히 막히지 않게 한다 */
+        ne2k_out(NE2K_ISR, ISR_PTX | ISR_TXE);
+        net_stats.tx_errors++;
+        net_stats.tx_timeouts++;
+        slot_len[tx_send_slot] = 0;
+        tx_send_slot ^= 1;
+        tx_busy = 0;
+    }
+    while (txq_head && slot_len[tx_fill_slot] == 0) {
+        m = txq_head;
+        txq_head = m->next;
+        if (!txq_head) txq_tail = 0;
+        txq_len--;
+        remote_write((uint16)((NE2K_TX_PAGE + tx_fill_slot * NE2K_TX_PAGES) << 8), m->data, (uint16)m->len);
+        slot_len[tx_fill_slot] = (uint16)m->len;
+        if (tx_busy) net_stats.tx_overlap++;
+        tx_fill_slot ^= 1;
+        mbuf_free(m);
+    }
+    if (!tx_busy && slot_len[tx_send_slot]) tx_start(tx_send_slot);
+}
+
+void ne2k_tx_pump() {
+    uint32 flags;
+    if (!ne2k_found) return;
+    flags = spin_lock_irqsave(&nic_lock);
+    tx_pump_locked();
+    spin_unlock_irqrestore(&nic_lock, flags);
+}
+
+int ne2k_xmit(mbuf_t *m) {
+    uint32 flags;
+    uint8 *pad;
+    if (!ne2k_found || m->len > ETH_FRAME_MAX) return -1;
+    if (m->len < ETH_FRAME_MIN && (pad = mbuf_append(m, ETH_FRAME_MIN - m->len)) != 0)
+        memset(pad, 0, (uint8*)m->data + m->len - pad);
+    flags = spin_lock_irqsave(&nic_lock);
+    if (txq_len >= NET_TX_QUEUE) {
+        net_stats.tx_queue_full++;
+        spin_unlock_irqrestore(&nic_lock, flags);
+        return -1;
+    }
+    m->next = 0;
+    if (txq_tail) txq_tail->next = m;
+    else txq_head = m;
+    txq_tail = m;
+    if (++txq_len > net_stats.tx_max_queue) net_stats.tx_max_queue = txq_len;
+    tx_pump_locked();
+    spin_unlock_irqrestore(&nic_lock, flags);
+    return 0;
 }
 
+/* 큐와 두 슬롯이 모두 빌 때까지 */
+void ne2k_tx_flush() {
+    uint32 spins = NE2K_RESET_SPINS * 10;
+    while (ne2k_found && (txq_head || tx_busy || slot_len[0] || slot_len[1]) && --spins) {
+        ne2k_tx_pump();
+        cpu_relax();
+    }
+}
+
+/* 복사해서 보낸다 (큐가 차 있으면 TX_RETRY_SPINS 번까지 펌프를 돌리며 기다린다) */
 int ne2k_send(const uint8 *buf, uint16 len) {
-    outb(NE2K_IO_BASE + NE2K_TBCR0, len & 0xFF);
-    outb(NE2K_IO_BASE + NE2K_TBCR1, (len >> 8) & 0xFF);
-    /* 전송 버퍼에 데이터 복사 (실제 구현에서는 DMA 필요) - 생략 */
-    outb(NE2K_IO_BASE + NE2K_CR, CR_STA | 0x08); // 0x08: 가상 전송 명령
+    uint32 spins = TX_RETRY_SPINS;
+    mbuf_t *m;
+    uint8 *p;
+    if (!ne2k_found || len > ETH_FRAME_MAX || (m = mbuf_alloc()) == 0) return -1;
+    p = mbuf_append(m, len);
+    memcpy(p, buf, len);
+    while (ne2k_xmit(m) != 0) {
+        if (!ne2k_found || --spins == 0) {
+            mbuf_free(m);
+            return -1;
+        }
+        ne2k_tx_pump();
+    }
     return 0;
 }
 
-int ne2k_recv(uint8 *buf, uint16 len) {
-    uint16 i;
-    for (i = 0; i < len; i++) {
-        buf[i] = inb(NE2K_IO_BASE + 0x10);  // 가상의 데이터 포트
+static uint8 read_curr() {
+    uint8 curr;
+    ne2k_out(NE2K_CR, CR_PAGE1 | CR_RD2 | CR_STA);
+    curr = ne2k_in(NE2K_CURR);
+    ne2k_out(NE2K_CR, CR_RD2 | CR_STA);
+    return curr;
+}
+
+/* 읽은 페이지까지 카드에 돌려준다: BNRY 는 다음에 읽을 페이지 바로 앞 */
+static void release_to(uint8 next) {
+    rx_next = next;
+    ne2k_out(NE2K_BNRY, next == NE2K_RXBUF_START ? NE2K_RXBUF_STOP - 1 : next - 1);
+}
+
+/*
+ * 수신 링 넘침 (OVW) 복구, DP8390 데이터시트 순서 (nic_lock).
+ * 넘친 칩은 멈춘 채로 있으므로 STOP 으로 세우고 remote DMA 를 끊은 뒤 loopback 으로
+ * 다시 시작한다. 호출자가 링을 비운 뒤 overrun_finish 가 OVW 를 지우고 TCR 을 되돌린다.
+ * 멈출 때 끝나지 않은 전송이 있었으면 1 (다시 보내야 함).
+ */
+static int overrun_start() {
+    uint32 spins = NE2K_RESET_SPINS;
+    int was_tx = (ne2k_in(NE2K_CR) & CR_TXP) != 0;
+    ne2k_out(NE2K_CR, CR_RD2 | CR_STP);
+    while (!(ne2k_in(NE2K_ISR) & ISR_RST) && --spins) cpu_relax();
+    ne2k_out(NE2K_RBCR0, 0);
+    ne2k_out(NE2K_RBCR1, 0);
+    /* 전송이 끝나 PTX/TXE 가 이미 섰으면 다시 보내지 않는다 */
+    was_tx = was_tx && !(ne2k_in(NE2K_ISR) & (ISR_PTX | ISR_TXE));
+    ne2k_out(NE2K_TCR, TCR_LOOPBACK);
+    ne2k_out(NE2K_CR, CR_RD2 | CR_STA);
+    return was_tx;
+}
+
+static void overrun_finish(int resend) {
+    ne2k_out(NE2K_ISR, ISR_OVW | ISR_RST);
+    ne2k_out(NE2K_TCR, 0);
+    if (resend && tx_busy) tx_start(tx_send_slot);
+}
+
+/*
+ * 링에 쌓인 프레임을 max 개까지 풀 버퍼로 옮긴다. ISR 을 먼저 보고
+ * 아무것도 없으면 포트 몇 번만 읽고 돌아간다.
+ */
+uint32 ne2k_recv_batch(mbuf_t **out, uint32 max) {
+    ne2k_rx_header_t hdr;
+    uint32 n = 0, len, first, flags;
+    uint16 addr;
+    uint8 isr, curr;
+    int overrun = 0, resend = 0;
+    mbuf_t *b;
+
+    if (!ne2k_found) return 0;
+    flags = spin_lock_irqsave(&nic_lock);
+    isr = ne2k_in(NE2K_ISR);
+    if (isr & ISR_OVW) {
+        net_stats.rx_overflows++;
+        overrun = 1;
+        resend = overrun_start();
+    }
+    if (isr & (ISR_PRX | ISR_RXE)) ne2k_out(NE2K_ISR, isr & (ISR_PRX | ISR_RXE));
+
+    curr = read_curr();
+    while (rx_next != curr && n < max) {
+        remote_read((uint16)(rx_next << 8), &hdr, sizeof(hdr));
+        len = hdr.count >= sizeof(hdr) ? hdr.count - sizeof(hdr) : 0;
+        if (hdr.next < NE2K_RXBUF_START || hdr.next >= NE2K_RXBUF_STOP ||
+            len < ETH_FRAME_MIN || len > ETH_FRAME_MAX + 4) {
+            /* 헤더가 깨졌다: 남은 것을 버리고 CURR 로 다시 맞춘다 */
+            net_stats.rx_errors++;
+            release_to(curr);
+            break;
+        }
+        if ((b = mbuf_alloc()) == 0) {
+            net_stats.rx_no_buf++;
+        } else {
+            addr = (uint16)((rx_next << 8) + sizeof(hdr));
+            first = ((uint32)NE2K_RXBUF_STOP << 8) - addr;
+            if (len <= first) {
+                remote_read(addr, b->data, (uint16)len);
+            } else {
+                /* 링 끝을 넘는 프레임은 두 번에 (first 는 페이지 경계까지라 짝수) */
+                remote_read(addr, b->data, (uint16)first);
+                remote_read(NE2K_RXBUF_START << 8, b->data + first, (uint16)(len - first));
+            }
+            b->len = len;   /* data 는 headroom 뒤: 응답 헤더를 그 자리에 다시 붙일 수 있다 */
+            out[n++] = b;
+            net_stats.rx_frames++;
+            net_stats.rx_bytes += len;
+        }
+        release_to(hdr.next);
+        if (rx_next == curr) curr = read_curr();   /* 읽는 동안 더 들어왔을 수 있다 */
     }
-    return len;
+    if (overrun) overrun_finish(resend);
+    spin_unlock_irqrestore(&nic_lock, flags);
+    return n;
 }
 
 void network_stack_init() {
-    ne2k_init();
+    inet_init();
+    tcp_init();
+    if (mbuf_init() != 0) {
+        kprint("Network: no memory for packet buffers.\n");
+        return;
+    }
+    if (ne2k_init() != 0) {
+        kprint("NE2000 NIC not found.\n");
+        return;
+    }
+    ne2k_irq_enable();
     kprint("NE2000 NIC initialization completed.\n");
 }
 
+static uint32 poll_bucket(uint32 n) {
+    if (n < 2) return n;
+    if (n < 8) return 2;
+    return n < 32 ? 3 : 4;
+}
+
+/* 예약된 bottom half: budget 까지 받고, 다 비웠으면 인터럽트 모드로 돌아간다 */
+static void ne2k_poll() {
+    mbuf_t *batch[NET_RX_BATCH];
+    uint32 n, i, total = 0, flags;
+
+    rx_scheduled = 0;
+    net_stats.polls++;
+    while (total < NET_POLL_BUDGET &&
+           (n = ne2k_recv_batch(batch, NET_POLL_BUDGET - total < NET_RX_BATCH ? NET_POLL_BUDGET - total : NET_RX_BATCH)) > 0) {
+        for (i = 0; i < n; i++) inet_input(batch[i]);
+        total += n;
+    }
+    ne2k_tx_pump();   /* 끝난 전송을 거두고 다음 슬롯을 보낸다 */
+    if (total) net_stats.busy_polls++;
+    if (total > net_stats.max_batch) net_stats.max_batch = total;
+    net_stats.poll_hist[poll_bucket(total)]++;
+    if (!irq_mode) return;
+    flags = spin_lock_irqsave(&nic_lock);
+    if (total >= NET_POLL_BUDGET || txq_head) {
+        /* 부하가 남았다: 인터럽트는 끈 채로 다음 호출에서 다시 */
+        rx_scheduled = 1;
+        if (total >= NET_POLL_BUDGET) net_stats.budget_exhausted++;
+    } else {
+        ne2k_out(NE2K_IMR, NE2K_IMR_BITS);
+        net_stats.irq_rearms++;
+    }
+    spin_unlock_irqrestore(&nic_lock, flags);
+}
+
 void network_stack_poll() {
-    uint8 packet[1500];
-    int received = ne2k_recv(packet, sizeof(packet));
-    if (received > 0) {
-        kprint("Packets received, size: ");
-        char numbuf[16];
-        simple_itoa(received, numbuf);
-        kprint(numbuf);
-        kprint(" bytes\n");
-        // 이후 Ethernet 프레임 처리 (ARP, IP 등) 확장 가능
+    if (!ne2k_found) return;
+    if (!irq_mode || rx_scheduled) ne2k_poll();
+    inet_poll();
+    tcp_timer();
+}
+
+int network_poll_pending() {
+    return irq_mode && rx_scheduled;
+}
+
+void network_idle() {
+    if (!irq_mode) {
+        cpu_relax();
+        return;
     }
+    cpu_disable_interrupts();
+    if (rx_scheduled || kbd_pending()) cpu_enable_interrupts();
+    else cpu_wait_for_interrupt();   /* NIC, 키, 타이머 틱 중 먼저 오는 것 */
 }
 
 /* 네트워킹 명령어: netinfo, nettest, netapp */
+static void print_mac(const uint8 *mac) {
+    uint32 i;
+    for (i = 0; i < 6; i++) {
+        kprintf("%02x", mac[i]);
+        if (i < 5) kprint(":");
+    }
+}
+
 void netinfo_cmd() {
     kprint("NE2000 NIC Information:\n");
-    kprint("Base I/O: 0x300\n");
-    kprint("RX buffer: 0x40 to 0x80\n");
-    kprint("TX Page: 0x20\n");
+    if (!ne2k_found) {
+        kprint("  not present\n");
+        return;
+    }
+    kprintf("  Bus: %s, base I/O 0x%x, IRQ %u (%s)\n", ne2k_bus, ne2k_io, ne2k_irq,
+            !irq_mode ? "not used, polled" : rx_scheduled ? "masked, polling" : "armed");
+    kprint("  MAC: "); print_mac(ne2k_mac); kprint("\n");
+    kprintf("  TX slots 0x%x and 0x%x, RX ring 0x%x to 0x%x (next 0x%x)\n",
+            NE2K_TX_PAGE, NE2K_TX_PAGE + NE2K_TX_PAGES, NE2K_RXBUF_START, NE2K_RXBUF_STOP, rx_next);
+    kprintf("  RX: %u frames, %u bytes, largest batch %u, %u/%u polls busy\n",
+            net_stats.rx_frames, net_stats.rx_bytes, net_stats.max_batch,
+            net_stats.busy_polls, net_stats.polls);
+    kprintf("  NAPI: %u IRQs, %u polls, %u budget-exhausted, %u IRQ re-arms, %u.%02u frames/busy poll\n",
+            net_stats.irqs, net_stats.polls, net_stats.budget_exhausted, net_stats.irq_rearms,
+            net_stats.busy_polls ? net_stats.rx_frames / net_stats.busy_polls : 0,
+            net_stats.busy_polls ? net_stats.rx_frames % net_stats.busy_polls * 100 / net_stats.busy_polls : 0);
+    kprintf("  Frames per poll: 0:%u 1:%u 2-7:%u 8-31:%u 32+:%u\n",
+            net_stats.poll_hist[0], net_stats.poll_hist[1], net_stats.poll_hist[2],
+            net_stats.poll_hist[3], net_stats.poll_hist[4]);
+    kprintf("  RX drops: %u no buffer, %u bad header, %u ring overflows\n",
+            net_stats.rx_no_buf, net_stats.rx_errors, net_stats.rx_overflows);
+    kprintf("  TX: %u frames, %u bytes, %u errors (%u timeouts), %u queued now (max %u), %u overlapped loads, %u queue-full\n",
+            net_stats.tx_frames, net_stats.tx_bytes, net_stats.tx_errors, net_stats.tx_timeouts, txq_len,
+            net_stats.tx_max_queue, net_stats.tx_overlap, net_stats.tx_queue_full);
+    kprintf("  mbufs: %u of %u free (low water %u), %u allocs, %u failures\n",
+            mbuf_stats.free, mbuf_stats.total, mbuf_stats.low_water,
+            mbuf_stats.allocs, mbuf_stats.failures);
 }
 
+/* 브로드캐스트로 테스트 프레임 하나 (EtherType 0x88B5: 실험용) */
 void nettest_cmd() {
     uint8 test_packet[64];
     uint16 i;
-    for (i = 0; i < 64; i++) {
-        test_packet[i] = i;
+    for (i = 0; i < 6; i++) test_packet[i] = 0xFF;
+    memcpy(test_packet + 6, ne2k_mac, 6);
+    test_packet[12] = 0x88;
+    test_packet[13] = 0xB5;
+    for (i = 14; i < 64; i++) test_packet[i] = (uint8)i;
+    if (ne2k_send(test_packet, 64) != 0) {
+        kprint("Test packet transmission failed.\n");
+        return;
     }
-    ne2k_send(test_packet, 64);
     kprint("Test packet transmission completed.\n");
 }
 
-void netapp_cmd() {
-    kprint("Running a networking application...\n");
-    network_stack_poll();
-    kprint("Shutting down the application.\n");
+/* UDP echo (RFC 862): 포트와 주소를 맞바꾸는 것은 UDP 체크섬을 바꾸지 않는다 */
+static uint32 echo_packets, echo_bytes;
+
+static void udp_echo(mbuf_t *m, ipv4_hdr_t *ip, udp_hdr_t *uh) {
+    uint16 port = uh->sport;
+    (void)ip;
+    uh->sport = uh->dport;
+    uh->dport = port;
+    echo_packets++;
+    echo_bytes += ntohs(uh->len) - sizeof(udp_hdr_t);
+    ip_reflect(m);
 }
 
+void netapp_cmd() {
+    net_stats_t before = net_stats;
+    uint32 us;
+    uint64 t0;
+
+    if (!ne2k_found) {
+        kprint("netapp: no NIC\n");
+        return;
+    }
+    if (udp_bind(UDP_ECHO_PORT, udp_echo) != 0) {
+        kprint("netapp: echo port already bound\n");
+        return;
+    }
+    echo_packets = echo_bytes = 0;
+    kprint("UDP echo server on ");
+    inet_print_addr(net_ip);
+    kprintf(" port %u, press any key to stop\n", UDP_ECHO_PORT);
+    t0 = rdtsc();
+    while (!kbd_pending()) {
+        network_stack_poll();
+        network_idle();
+    }
+    kbd_getchar();
+    us = cycles_to_us(rdtsc() - t0);
+    udp_unbind(UDP_ECHO_PORT);
+    if (us == 0) us = 1;
+
+    kprintf("Echoed %u datagrams (%u payload bytes) in %u ms: %u datagrams/s\n",
+            echo_packets, echo_bytes, us / 1000, (uint32)udiv64((uint64)echo_packets * 1000000, us));
+    kprintf("  RX %u frames, largest batch %u, %u no-buffer drops; TX %u frames, %u queue-full\n",
+            net_stats.rx_frames - before.rx_frames, net_stats.max_batch,
+            net_stats.rx_no_buf - before.rx_no_buf, net_stats.tx_frames - before.tx_frames,
+            net_stats.tx_queue_full - before.tx_queue_full);
+}
@@ -2,26 +2,66 @@
 #define NETWORK_H
 
 #include "dc.h"
+#include "io.h"
+#include "mbuf.h"
 
-/* 포트 입출력 함수 (인라인 어셈블리) */
-static inline uint8 inb(uint16 port) {
-    uint8 ret;
-    asm volatile ("inb %1, %0" : "=a"(ret) : "Nd"(port));
-    return ret;
+/* 네트워크 바이트 순서 (빅 엔디언) */
+static inline uint16 htons(uint16 v) {
+    return (uint16)((v << 8) | (v >> 8));
 }
 
-static inline void outb(uint16 port, uint8 data) {
-    asm volatile ("outb %0, %1" : : "a"(data), "Nd"(port));
+static inline uint32 htonl(uint32 v) {
+    return __builtin_bswap32(v);
 }
 
-static inline uint8 inb(uint16 port);  // 이미 선언됨
-static inline void outb(uint16 port, uint8 data);  // 이미 선언됨
+#define ntohs(v) htons(v)
+#define ntohl(v) htonl(v)
 
-void ne2k_init();
+#define NET_POLL_HIST 5       /* poll 당 프레임 수: 0, 1, 2-7, 8-31, 32 이상 */
+
+typedef struct {
+    uint32 irqs;              /* 우리 카드가 올린 NIC 인터럽트 */
+    uint32 polls;             /* 카드를 들여다본 bottom half 실행 */
+    uint32 busy_polls;        /* 그중 프레임이 있었던 실행 */
+    uint32 poll_hist[NET_POLL_HIST];
+    uint32 budget_exhausted;  /* budget 을 다 써서 인터럽트를 끈 채 다시 폴링 */
+    uint32 irq_rearms;        /* 일이 떨어져 인터럽트 모드로 돌아감 */
+    uint32 rx_frames;
+    uint32 rx_bytes;
+    uint32 max_batch;         /* 한 poll 에서 꺼낸 최대 프레임 수 */
+    uint32 rx_no_buf;         /* mbuf 풀이 비어 버린 프레임 */
+    uint32 rx_errors;         /* 깨진 링 헤더 (링을 CURR 로 다시 맞춤) */
+    uint32 rx_overflows;      /* OVW: 카드 링이 넘침 */
+    uint32 tx_frames;
+    uint32 tx_bytes;
+    uint32 tx_errors;
+    uint32 tx_timeouts;       /* 그중 완료 인터럽트가 끝내 오지 않은 전송 */
+    uint32 tx_queue_full;     /* 큐가 가득 차 ne2k_xmit 이 거절 */
+    uint32 tx_overlap;        /* 한 슬롯이 전송 중일 때 다른 슬롯을 채운 횟수 */
+    uint32 tx_max_queue;
+} net_stats_t;
+
+extern net_stats_t net_stats;
+
+int ne2k_init();
+int ne2k_present();
+const uint8 *ne2k_mac_addr();
+/* m 의 참조 하나를 넘긴다. 큐가 가득 차면 -1 이고 m 은 호출자에게 남는다 */
+int ne2k_xmit(mbuf_t *m);
 int ne2k_send(const uint8 *buf, uint16 len);
-int ne2k_recv(uint8 *buf, uint16 len);
+void ne2k_tx_pump();
+void ne2k_tx_flush();
+uint32 ne2k_recv_batch(mbuf_t **out, uint32 max);
 void network_stack_init();
+/*
+ * bottom half: NIC 인터럽트 (또는 남은 일) 가 있을 때만 카드를 NET_POLL_BUDGET 까지 폴링하고
+ * ARP/TCP 타이머를 돌린다. IRQ 가 없는 카드는 부를 때마다 폴링한다.
+ */
 void network_stack_poll();
+/* IRQ 가 예약한 NIC 일이 남았는가 (hlt 하기 전에 인터럽트를 끄고 확인). IRQ 가 없으면 항상 0 */
+int network_poll_pending();
+/* 기다리는 루프용: 일이 없으면 다음 인터럽트까지 쉰다 (IRQ 가 없으면 cpu_relax) */
+void network_idle();
 void netinfo_cmd();
 void nettest_cmd();
 void netapp_cmd();
@@ -0,0 +1,274 @@
+#include "paging.h"
+#include "mm.h"
+#include "kprint.h"
+#include "type.h"
+#include "cpu.h"
+
+/*=========================*/
+/* 15-3. 페이징 & 주소 공간 */
+/*=========================*/
+/*
+ * 부트 스텁 (kernel.c) 은 아래 정적 디렉터리로 물리 0..BOOT_MAP_BYTES 를
+ * 0 과 KERNEL_VBASE 두 곳에 매핑한 뒤 higher half 로 점프한다.
+ * paging_init 이 나머지 커널 매핑을 채우고 0 쪽 (identity) 매핑을 지운다.
+ */
+#define KERNEL_PDE   (KERNEL_VBASE >> 22)
+#define BOOT_PDE     (PDE_LARGE | PTE_WRITE | PTE_PRESENT)
+
+__attribute__((aligned(PAGE_SIZE)))
+uint32 kernel_page_dir[1024] = {
+    [0] = 0x000000 | BOOT_PDE,
+    [1] = 0x400000 | BOOT_PDE,
+    [KERNEL_PDE] = 0x000000 | BOOT_PDE,
+    [KERNEL_PDE + 1] = 0x400000 | BOOT_PDE,
+};
+
+/* 종료한 프로세스의 주소 공간은 그 프로세스가 돌던 CPU 가 풀므로 카운터는 원자적으로 더한다 */
+paging_stats_t paging_stats;
+#define STAT_ADD(field, n)  __sync_fetch_and_add(&paging_stats.field, (n))
+
+/*
+ * GRUB 의 GDT 는 1MB 아래 어딘가에 있어 identity 매핑을 지우면 보이지 않는다.
+ * 인터럽트가 CS 디스크립터를 다시 읽으므로 커널 안에 평면 GDT 를 두고 바꾼다.
+ */
+static const uint64 gdt[3] = {
+    0,
+    0x00CF9A000000FFFFull,   /* 0x08: 코드, base 0, limit 4GB */
+    0x00CF92000000FFFFull    /* 0x10: 데이터 */
+};
+
+typedef struct {
+    uint16 limit;
+    uint32 base;
+} __attribute__((packed)) gdt_ptr_t;
+
+/* AP 도 보호 모드에 들어온 뒤 같은 GDT 로 바꾼다 */
+void gdt_load() {
+    gdt_ptr_t ptr;
+    ptr.limit = sizeof(gdt) - 1;
+    ptr.base = (uint32)gdt;
+    __asm__ volatile (
+        "lgdt %0\n"
+        "ljmp $0x08, $1f\n"
+        "1:\n"
+        "mov $0x10, %%ax\n"
+        "mov %%ax, %%ds\n"
+        "mov %%ax, %%es\n"
+        "mov %%ax, %%fs\n"
+        "mov %%ax, %%gs\n"
+        "mov %%ax, %%ss\n"
+        :: "m"(ptr) : "eax", "memory");
+}
+
+void paging_init() {
+    uint32 a, b, c, d, i, flags = BOOT_PDE;
+    gdt_load();
+    memset(&paging_stats, 0, sizeof(paging_stats));
+    cpu_cpuid(1, &a, &b, &c, &d);
+    paging_stats.pse = (d >> 3) & 1;    /* 부트 스텁이 이미 PSE 를 켰으므로 사실상 항상 1 */
+    paging_stats.pge = (d >> 13) & 1;
+    if (paging_stats.pge) flags |= PTE_GLOBAL;
+
+    /* 4MB 페이지 64 개로 256MB 를 덮는다: 4KB 페이지라면 TLB 항목 1024 배 */
+    for (i = 0; i < (MEM_MAX_BYTES >> 22); i++)
+        kernel_page_dir[KERNEL_PDE + i] = (i << 22) | flags;
+    paging_stats.kernel_pdes = i;
+    for (i = 0; i < KERNEL_PDE; i++) kernel_page_dir[i] = 0;
+
+    if (paging_stats.pge) cpu_write_cr4(cpu_read_cr4() | CR4_PGE);
+    cpu_write_cr3(virt_to_phys(kernel_page_dir));
+}
+
+/*
+ * phys 가 든 4MB 를 같은 가상 주소에 캐시 없이 매핑 (LAPIC/IOAPIC 레지스터).
+ * 커널 PDE 는 as_create 때 복사되므로 첫 주소 공간을 만들기 전에 불러야 한다.
+ */
+void *paging_map_mmio(uint32 phys) {
+    uint32 base = phys & ~0x3FFFFFu;
+    if ((base >> 22) < KERNEL_PDE + paging_stats.kernel_pdes) return 0;   /* 직접 매핑과 겹침 */
+    kernel_page_dir[base >> 22] = base | PDE_LARGE | PTE_PCD | PTE_PWT | PTE_WRITE | PTE_PRESENT;
+    cpu_invlpg(base);
+    return (void*)phys;
+}
+
+/* AP 가 실모드 트램폴린에서 페이징을 켜는 동안만 물리 0..4MB identity 매핑을 되살린다 */
+void paging_boot_identity(int on) {
+    kernel_page_dir[0] = on ? BOOT_PDE : 0;
+    cpu_write_cr3(virt_to_phys(kernel_page_dir));
+}
+
+void page_fault_handler(interrupt_frame_t *frame) {
+    kprint("Page fault at ");
+    kprint_hex(cpu_read_cr2());
+    kprint(" (EIP ");
+    kprint_hex(frame->eip);
+    kprint(frame->error & 1 ? ", protection" : ", not present");
+    kprint(frame->error & 2 ? ", write" : ", read");
+    kprint(", CR3 ");
+    kprint_hex(cpu_read_cr3());
+    kprint(")\nSystem halted.\n");
+    while (1) { __asm__ volatile ("cli; hlt"); }
+}
+
+/*=========================*/
+/* 주소 공간 */
+/*=========================*/
+/* 새 페이지 디렉터리: 사용자 영역은 비우고 커널 PDE (768..1023) 는 그대로 복사 */
+uint32 as_create() {
+    uint32 *pd = (uint32*)page_alloc(0);
+    if (!pd) return 0;
+    memset(pd, 0, KERNEL_PDE * sizeof(uint32));
+    memcpy(pd + KERNEL_PDE, kernel_page_dir + KERNEL_PDE, (1024 - KERNEL_PDE) * sizeof(uint32));
+    STAT_ADD(as_created, 1);
+    return virt_to_phys(pd);
+}
+
+void *as_map_new(uint32 cr3, uint32 vaddr, uint32 flags) {
+    uint32 *pd = (uint32*)phys_to_virt(cr3), *pt;
+    uint32 pdi = vaddr >> 22, pti = (vaddr >> PAGE_SHIFT) & 1023;
+    void *page;
+    if (pdi >= KERNEL_PDE) return 0;
+    if (!(pd[pdi] & PTE_PRESENT)) {
+        if ((pt = (uint32*)page_alloc(0)) == 0) return 0;
+        memset(pt, 0, PAGE_SIZE);
+        /* 권한은 PTE 에서 좁히므로 PDE 는 넓게 */
+        pd[pdi] = virt_to_phys(pt) | PTE_USER | PTE_WRITE | PTE_PRESENT;
+        STAT_ADD(page_tables, 1);
+    }
+    pt = (uint32*)phys_to_virt(pd[pdi] & PTE_ADDR_MASK);
+    if (pt[pti] & PTE_PRESENT) {
+        pt[pti] |= flags & (PTE_WRITE | PTE_USER);
+        return phys_to_virt(pt[pti] & PTE_ADDR_MASK);
+    }
+    if ((page = page_alloc(0)) == 0) return 0;
+    memset(page, 0, PAGE_SIZE);
+    pt[pti] = virt_to_phys(page) | (flags & (PTE_WRITE | PTE_USER)) | PTE_OWNED | PTE_PRESENT;
+    STAT_ADD(user_pages, 1);
+    if (cpu_read_cr3() == cr3) cpu_invlpg(vaddr);
+    return page;
+}
+
+/* 사용자 영역의 소유 프레임, 페이지 테이블, 디렉터리 순으로 해제 */
+void as_destroy(uint32 cr3) {
+    uint32 *pd, *pt, pdi, pti, pages = 0, tables = 0;
+    if (!cr3 || cr3 == as_kernel()) return;
+    if (cpu_read_cr3() == cr3) as_switch(as_kernel());
+    pd = (uint32*)phys_to_virt(cr3);
+    for (pdi = 0; pdi < KERNEL_PDE; pdi++) {
+        if (!(pd[pdi] & PTE_PRESENT)) continue;
+        pt = (uint32*)phys_to_virt(pd[pdi] & PTE_ADDR_MASK);
+        for (pti = 0; pti < 1024; pti++) {
+            if ((pt[pti] & (PTE_PRESENT | PTE_OWNED)) != (PTE_PRESENT | PTE_OWNED)) continue;
+            page_free(phys_to_virt(pt[pti] & PTE_ADDR_MASK));
+            pages++;
+        }
+        page_free(pt);
+        tables++;
+    }
+    page_free(pd);
+    STAT_ADD(user_pages, -pages);
+    STAT_ADD(page_tables, -tables);
+    STAT_ADD(as_destroyed, 1);
+}
+
+/* global 커널 매핑은 CR3 를 바꿔도 TLB 에 남는다 */
+void as_switch(uint32 cr3) {
+    if (cpu_read_cr3() == cr3) return;
+    cpu_write_cr3(cr3);
+    STAT_ADD(cr3_switches, 1);
+}
+
+uint32 as_current() {
+    return cpu_read_cr3();
+}
+
+uint32 as_kernel() {
+    return virt_to_phys(kernel_page_dir);
+}
+
+/*=========================*/
+/* vminfo / vmbench */
+/*=========================*/
+void vm_stat_cmd() {
+    kprint("Paging:\n");
+    kprint("  Kernel: "); kprint_dec(paging_stats.kernel_pdes);
+    kprint(paging_stats.pse ? " x 4MB pages" : " x 4MB pages (PSE not reported)");
+    kprint(" at "); kprint_hex(KERNEL_VBASE);
+    kprint(", global: "); kprint(paging_stats.pge ? "yes\n" : "no (CPU lacks PGE)\n");
+    kprint("  Address spaces: "); kprint_dec(paging_stats.as_created - paging_stats.as_destroyed);
+    kprint(" live, "); kprint_dec(paging_stats.as_created);
+    kprint(" created, "); kprint_dec(paging_stats.as_destroyed); kprint(" destroyed\n");
+    kprint("  User page tables: "); kprint_dec(paging_stats.page_tables);
+    kprint(", user pages: "); kprint_dec(paging_stats.user_pages);
+    kprint("\n  CR3 switches: "); kprint_dec(paging_stats.cr3_switches);
+    kprint(", current CR3: "); kprint_hex(as_current()); kprint("\n");
+}
+
+/* 커널 직접 매핑의 4MB 페이지마다 한 바이트씩 읽어 TLB 항목을 채운다 */
+static uint32 touch_kernel(uint32 regions) {
+    uint32 i, sum = 0;
+    for (i = 0; i < regions; i++) sum += *(volatile uint8*)phys_to_virt(i << 22);
+    return sum;
+}
+
+/* 주소 공간 전환 왕복 + 커널 접근 비용 (사이클) */
+static uint64 switch_rounds(uint32 cr3, uint32 regions) {
+    uint32 i, kernel = as_kernel();
+    uint64 t0 = rdtsc();
+    for (i = 0; i < VM_BENCH_ROUNDS; i++) {
+        as_switch(cr3);
+        touch_kernel(regions);
+        as_switch(kernel);
+        touch_kernel(regions);
+    }
+    return rdtsc() - t0;
+}
+
+static void print_cycles(const char *label, uint64 cycles, uint32 ops) {
+    kprint(label);
+    kprint_dec((uint32)udiv64(cycles, ops));
+    kprint(" cycles/op\n");
+}
+
+void vm_bench_cmd() {
+    uint32 i, cr3, regions, flags;
+    uint64 t0, on, off;
+
+    /* 주소 공간 생성 + 16 페이지 매핑 + 해제 (execbin 한 번의 고정 비용) */
+    t0 = rdtsc();
+    for (i = 0; i < VM_BENCH_ROUNDS / 10; i++) {
+        uint32 va;
+        if ((cr3 = as_create()) == 0) break;
+        for (va = USER_FLAT_BASE; va < USER_FLAT_BASE + 16 * PAGE_SIZE; va += PAGE_SIZE)
+            as_map_new(cr3, va, PTE_USER | PTE_WRITE);
+        as_destroy(cr3);
+    }
+    if (i == 0) { kprint("Out of memory.\n"); return; }
+    print_cycles("as_create+16 pages+destroy: ", rdtsc() - t0, i);
+
+    if ((cr3 = as_create()) == 0) { kprint("Out of memory.\n"); return; }
+    as_map_new(cr3, USER_FLAT_BASE, PTE_USER | PTE_WRITE);
+    regions = (mem_stats.total_pages + 1023) >> 10;
+    if (regions > paging_stats.kernel_pdes) regions = paging_stats.kernel_pdes;
+
+    flags = irq_save();
+    on = switch_rounds(cr3, regions);
+    if (paging_stats.pge) {
+        /* PGE 를 끄면 CR3 를 쓸 때마다 커널 항목도 버려진다 (CR4 쓰기가 TLB 전체를 비움) */
+        cpu_write_cr4(cpu_read_cr4() & ~CR4_PGE);
+        off = switch_rounds(cr3, regions);
+        cpu_write_cr4(cpu_read_cr4() | CR4_PGE);
+    } else {
+        off = on;
+    }
+    irq_restore(flags);
+    as_destroy(cr3);
+
+    kprint("CR3 round trip, touching "); kprint_dec(regions);
+    kprint(" kernel 4MB pages per side:\n");
+    print_cycles("  global kernel pages:     ", on, VM_BENCH_ROUNDS);
+    print_cycles("  non-global (PGE off):    ", off, VM_BENCH_ROUNDS);
+    if (!paging_stats.pge) kprint("  (CPU lacks PGE, both runs are non-global)\n");
+    kprint("  4KB pages would need "); kprint_dec(regions * 1024);
+    kprint(" TLB entries for the same span\n");
+}
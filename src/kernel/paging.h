@@ -0,0 +1,67 @@
+#ifndef PAGING_H
+#define PAGING_H
+
+#include "dc.h"
+#include "idt.h"
+
+/*
+ * 32비트 2단계 페이징. 커널은 모든 주소 공간의 KERNEL_VBASE 위에
+ * 4MB (PSE) global 페이지로 물리 0..MEM_MAX_BYTES 를 매핑하고,
+ * 프로세스마다 자기 페이지 디렉터리 (CR3) 에 사용자 영역 (0..KERNEL_VBASE) 을 둔다.
+ */
+#define PTE_PRESENT   0x001
+#define PTE_WRITE     0x002
+#define PTE_USER      0x004
+#define PTE_PWT       0x008
+#define PTE_PCD       0x010   /* 캐시 끔 (MMIO) */
+#define PDE_LARGE     0x080   /* PDE: 4MB 페이지 */
+#define PTE_GLOBAL    0x100   /* CR3 를 바꿔도 TLB 에 남는다 (CR4.PGE) */
+#define PTE_OWNED     0x200   /* 소프트웨어 비트: 주소 공간이 소유한 프레임 (as_destroy 가 해제) */
+#define PTE_ADDR_MASK 0xFFFFF000
+
+#define CR0_PG        0x80000000
+#define CR4_PSE       0x00000010
+#define CR4_PGE       0x00000080
+
+/* 커널 직접 매핑 영역의 주소 <-> 물리 주소 */
+static inline void *phys_to_virt(uint32 phys) {
+    return (void*)(phys + KERNEL_VBASE);
+}
+
+static inline uint32 virt_to_phys(const void *addr) {
+    return (uint32)addr - KERNEL_VBASE;
+}
+
+typedef struct {
+    uint32 pse;             /* 4MB 페이지 지원 */
+    uint32 pge;             /* global 페이지 사용 중 */
+    uint32 kernel_pdes;     /* 커널 4MB 매핑 개수 */
+    uint32 as_created;
+    uint32 as_destroyed;
+    uint32 page_tables;     /* 현재 사용자 페이지 테이블 수 */
+    uint32 user_pages;      /* 현재 사용자 영역에 매핑된 (소유) 페이지 수 */
+    uint32 cr3_switches;
+} paging_stats_t;
+
+extern paging_stats_t paging_stats;
+extern uint32 kernel_page_dir[1024];   /* 부트 스텁이 물리 주소로 CR3 에 넣는다 */
+
+void paging_init();
+void gdt_load();
+void *paging_map_mmio(uint32 phys);
+void paging_boot_identity(int on);
+void page_fault_handler(interrupt_frame_t *frame);
+
+/* 주소 공간: 페이지 디렉터리의 물리 주소 (CR3 값) 로 다룬다. 실패 시 0 */
+uint32 as_create();
+void as_destroy(uint32 cr3);
+void as_switch(uint32 cr3);
+uint32 as_current();
+uint32 as_kernel();
+/* vaddr 가 든 페이지를 (없으면 0 으로 채운 새 프레임으로) 매핑하고 그 페이지의 커널 주소 */
+void *as_map_new(uint32 cr3, uint32 vaddr, uint32 flags);
+
+void vm_stat_cmd();
+void vm_bench_cmd();
+
+#endif //PAGING_H
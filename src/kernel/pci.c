@@ -0,0 +1,119 @@
+#include "pci.h"
+#include "io.h"
+#include "kprint.h"
+
+/*=========================*/
+/* 13-1. PCI 버스 열거 (Configuration Mechanism #1) */
+/*=========================*/
+#define PCI_CONFIG_ADDRESS  0xCF8
+#define PCI_CONFIG_DATA     0xCFC
+
+#define PCI_REG_VENDOR      0x00
+#define PCI_REG_COMMAND     0x04
+#define PCI_REG_CLASS       0x08
+#define PCI_REG_HEADER      0x0C
+#define PCI_REG_BAR0        0x10
+#define PCI_REG_INTERRUPT   0x3C
+
+#define PCI_CMD_IO          0x0001
+#define PCI_CMD_BUS_MASTER  0x0004
+
+PCI_Device pci_devices[MAX_PCI_DEVICES];
+uint32 pci_device_count = 0;
+
+static inline uint32 inl(uint16 port) {
+    uint32 result;
+    __asm__ volatile ("inl %1, %0" : "=a"(result) : "dN"(port));
+    return result;
+}
+
+static inline void outl(uint16 port, uint32 data) {
+    __asm__ volatile ("outl %1, %0" :: "dN"(port), "a"(data));
+}
+
+uint32 pci_config_read(uint8 bus, uint8 device, uint8 function, uint8 offset) {
+    uint32 address = 0x80000000 | ((uint32)bus << 16) | ((uint32)(device & 0x1F) << 11) |
+                     ((uint32)(function & 0x07) << 8) | (offset & 0xFC);
+    outl(PCI_CONFIG_ADDRESS, address);
+    return inl(PCI_CONFIG_DATA);
+}
+
+void pci_config_write(uint8 bus, uint8 device, uint8 function, uint8 offset, uint32 value) {
+    uint32 address = 0x80000000 | ((uint32)bus << 16) | ((uint32)(device & 0x1F) << 11) |
+                     ((uint32)(function & 0x07) << 8) | (offset & 0xFC);
+    outl(PCI_CONFIG_ADDRESS, address);
+    outl(PCI_CONFIG_DATA, value);
+}
+
+uint32 pci_read_bar(PCI_Device *dev, uint32 index) {
+    return pci_config_read(dev->bus, dev->device, dev->function, PCI_REG_BAR0 + index * 4);
+}
+
+void pci_enable_bus_master(PCI_Device *dev) {
+    uint32 cmd = pci_config_read(dev->bus, dev->device, dev->function, PCI_REG_COMMAND);
+    cmd |= PCI_CMD_IO | PCI_CMD_BUS_MASTER;
+    pci_config_write(dev->bus, dev->device, dev->function, PCI_REG_COMMAND, cmd & 0xFFFF);
+}
+
+static void pci_add_function(uint8 bus, uint8 device, uint8 function, uint32 id) {
+    if (pci_device_count >= MAX_PCI_DEVICES) return;
+    PCI_Device *dev = &pci_devices[pci_device_count++];
+    uint32 class_reg = pci_config_read(bus, device, function, PCI_REG_CLASS);
+    dev->bus = bus;
+    dev->device = device;
+    dev->function = function;
+    dev->vendor_id = id & 0xFFFF;
+    dev->device_id = (id >> 16) & 0xFFFF;
+    dev->class_code = (class_reg >> 24) & 0xFF;
+    dev->subclass = (class_reg >> 16) & 0xFF;
+    dev->prog_if = (class_reg >> 8) & 0xFF;
+    dev->irq_line = pci_config_read(bus, device, function, PCI_REG_INTERRUPT) & 0xFF;
+}
+
+/* 모든 버스/디바이스/펑션을 훑어 존재하는 장치를 기록 */
+void pci_scan() {
+    uint32 bus, device, function;
+    pci_device_count = 0;
+    for (bus = 0; bus < PCI_MAX_BUS; bus++) {
+        for (device = 0; device < 32; device++) {
+            uint32 id = pci_config_read(bus, device, 0, PCI_REG_VENDOR);
+            if ((id & 0xFFFF) == 0xFFFF) continue;
+            uint32 header = (pci_config_read(bus, device, 0, PCI_REG_HEADER) >> 16) & 0xFF;
+            uint32 functions = (header & 0x80) ? 8 : 1;
+            for (function = 0; function < functions; function++) {
+                if (function > 0) {
+                    id = pci_config_read(bus, device, function, PCI_REG_VENDOR);
+                    if ((id & 0xFFFF) == 0xFFFF) continue;
+                }
+                pci_add_function(bus, device, function, id);
+            }
+        }
+    }
+}
+
+PCI_Device *pci_find_class(uint8 class_code, uint8 subclass) {
+    uint32 i;
+    for (i = 0; i < pci_device_count; i++) {
+        if (pci_devices[i].class_code == class_code && pci_devices[i].subclass == subclass)
+            return &pci_devices[i];
+    }
+    return 0;
+}
+
+void pci_list_cmd() {
+    uint32 i;
+    kprint("PCI devices: ");
+    kprint_dec(pci_device_count);
+    kprint("\n");
+    for (i = 0; i < pci_device_count; i++) {
+        PCI_Device *dev = &pci_devices[i];
+        kprint("  "); kprint_dec(dev->bus);
+        kprint(":"); kprint_dec(dev->device);
+        kprint("."); kprint_dec(dev->function);
+        kprint("  vendor "); kprint_hex(dev->vendor_id);
+        kprint(" device "); kprint_hex(dev->device_id);
+        kprint(" class "); kprint_hex((dev->class_code << 8) | dev->subclass);
+        kprint(" irq "); kprint_dec(dev->irq_line);
+        kprint("\n");
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef PCI_H
+#define PCI_H
+
+#include "dc.h"
+
+typedef struct {
+    uint8 bus;
+    uint8 device;
+    uint8 function;
+    uint16 vendor_id;
+    uint16 device_id;
+    uint8 class_code;
+    uint8 subclass;
+    uint8 prog_if;
+    uint8 irq_line;
+} PCI_Device;
+
+extern PCI_Device pci_devices[MAX_PCI_DEVICES];
+extern uint32 pci_device_count;
+
+uint32 pci_config_read(uint8 bus, uint8 device, uint8 function, uint8 offset);
+void pci_config_write(uint8 bus, uint8 device, uint8 function, uint8 offset, uint32 value);
+uint32 pci_read_bar(PCI_Device *dev, uint32 index);
+void pci_enable_bus_master(PCI_Device *dev);
+void pci_scan();
+PCI_Device *pci_find_class(uint8 class_code, uint8 subclass);
+void pci_list_cmd();
+
+#endif //PCI_H
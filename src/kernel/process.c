@@ -1,53 +1,718 @@
 #include "process.h"
+#include "paging.h"
+#include "mm.h"
+#include "cpu.h"
+#include "timer.h"
+#include "kprint.h"
+#include "type.h"
+#include "smp.h"
+#include "slab.h"
+#include "tcp.h"
 
 /*=========================*/
 /* 7. Process Management */
 /*=========================*/
+/*
+ * 프로세스마다 커널 스택을 두고 switch_to 로 스택을 바꿔 전환한다.
+ * 타이머 IRQ 가 타임 슬라이스를 깎고, 다 쓰면 IRQ 를 나가는 길 (sched_irq_exit) 에서 선점한다.
+ * CPU 마다 우선순위별 FIFO 와 비트맵을 두어 다음 프로세스를 O(1) 에 고르고,
+ * 자기 큐가 비면 다른 CPU 의 큐에서 훔쳐 온다 (work stealing).
+ * 설명자는 slab 에서 받고 pid 해시로 찾는다. 종료한 설명자는 커널 스택을 단 채로
+ * free 리스트에 남겨 다음 생성이 buddy 를 거치지 않게 한다.
+ * 잠든 프로세스는 run queue 가 아닌 대기 리스트에 있으므로 스케줄 비용과 무관하다.
+ * boot_process 는 부팅 문맥 (CLI 셸, 부트 스택) 이고 BSP 에 고정된다.
+ */
+#define PID_HASH(pid)  ((uint32)(pid) & (PID_HASH_BUCKETS - 1))
+#define PS_MAX_ROWS    32
 
-process_t process_table[MAX_PROCESSES];
-int current_process = 0;
+static process_t boot_process;
 int next_pid = 1;
+uint32 sched_quantum_ticks = 1;
+proc_stats_t proc_stats;
 
-void init_processes() {
-    uint32 i;
-    for (i = 0; i < MAX_PROCESSES; i++)
-        process_table[i].state = PROC_TERMINATED;
+/* pid 해시, 전체 리스트, free 리스트, 대기 리스트, next_pid, proc_stats 를 지킨다 */
+static spinlock_t proc_lock = SPINLOCK_INIT;
+static kmem_cache_t *proc_cache = 0;
+static process_t *pid_hash[PID_HASH_BUCKETS];
+static process_t *all_head = 0, *all_tail = 0;
+static process_t *free_procs = 0;         /* 종료한 설명자 (kstack 을 단 채로) */
+static uint32 free_count = 0;
+static process_t *wait_list = 0;          /* process_wait_all 로 잠든 프로세스 */
+static uint32 cpu_limit = SMP_MAX_CPUS;   /* 배치와 훔치기에 쓰는 CPU 수 (smpbench) */
+static uint32 place_hint = 0;
+
+/*
+ * void switch_to(uint32 *save_esp, uint32 new_esp)
+ * callee-saved 레지스터와 EFLAGS 를 현재 스택에 쌓고 스택 포인터를 바꾼 뒤
+ * 새 스택에서 같은 모양으로 꺼내 복귀한다.
+ */
+void switch_to(uint32 *save_esp, uint32 new_esp);
+__asm__(
+    ".pushsection .text\n"
+    ".global switch_to\n"
+    "switch_to:\n"
+    "    movl 4(%esp), %eax\n"
+    "    movl 8(%esp), %edx\n"
+    "    pushfl\n"
+    "    pushl %ebp\n"
+    "    pushl %ebx\n"
+    "    pushl %esi\n"
+    "    pushl %edi\n"
+    "    movl %esp, (%eax)\n"
+    "    movl %edx, %esp\n"
+    "    popl %edi\n"
+    "    popl %esi\n"
+    "    popl %ebx\n"
+    "    popl %ebp\n"
+    "    popfl\n"
+    "    ret\n"
+    ".popsection\n");
+
+/* run queue 조작은 cpu->rq_lock 을 잡고 */
+static void run_enqueue(cpu_t *cpu, process_t *p) {
+    p->next = 0;
+    if (cpu->run_tail[p->priority]) cpu->run_tail[p->priority]->next = p;
+    else cpu->run_head[p->priority] = p;
+    cpu->run_tail[p->priority] = p;
+    cpu->run_bitmap |= 1u << p->priority;
+    cpu->nr_queued++;
+}
+
+static void run_unlink(cpu_t *cpu, uint32 prio, process_t *prev, process_t *p) {
+    if (prev) prev->next = p->next;
+    else cpu->run_head[prio] = p->next;
+    if (cpu->run_tail[prio] == p) cpu->run_tail[prio] = prev;
+    if (!cpu->run_head[prio]) cpu->run_bitmap &= ~(1u << prio);
+    cpu->nr_queued--;
+}
+
+static process_t *run_dequeue(cpu_t *cpu) {
+    uint32 prio;
+    process_t *p;
+    if (!cpu->run_bitmap) return 0;
+    prio = (uint32)__builtin_ctz(cpu->run_bitmap);   /* bsf */
+    p = cpu->run_head[prio];
+    run_unlink(cpu, prio, 0, p);
+    return p;
 }
 
-int create_process(void (*entry)()) {
+/* 고정되지 않은 프로세스 중 우선순위가 가장 높은 것 하나 */
+static process_t *run_steal(cpu_t *cpu) {
+    uint32 bits = cpu->run_bitmap;
+    while (bits) {
+        uint32 prio = (uint32)__builtin_ctz(bits);
+        process_t *prev = 0, *p;
+        for (p = cpu->run_head[prio]; p; prev = p, p = p->next) {
+            if (p->pinned) continue;
+            run_unlink(cpu, prio, prev, p);
+            return p;
+        }
+        bits &= ~(1u << prio);
+    }
+    return 0;
+}
+
+static void enqueue_on(cpu_t *cpu, process_t *p) {
+    spin_lock(&cpu->rq_lock);
+    run_enqueue(cpu, p);
+    spin_unlock(&cpu->rq_lock);
+}
+
+/* 자기 큐에서 먼저, 비었으면 다른 CPU 의 큐에서 (잠겨 있으면 건너뛴다) */
+static process_t *pick_next(cpu_t *cpu) {
+    process_t *p;
     uint32 i;
-    for (i = 0; i < MAX_PROCESSES; i++) {
-        if (process_table[i].state == PROC_TERMINATED) {
-            process_table[i].pid = next_pid++;
-            process_table[i].state = PROC_READY;
-            process_table[i].entry_point = entry;
-            process_table[i].sp = 127;  /* 스택 최상위 인덱스 */
-            return process_table[i].pid;
+    spin_lock(&cpu->rq_lock);
+    p = run_dequeue(cpu);
+    spin_unlock(&cpu->rq_lock);
+    if (p || cpu->id >= cpu_limit) return p;
+    for (i = 1; i < SMP_MAX_CPUS; i++) {
+        cpu_t *victim = &cpus[(cpu->id + i) % SMP_MAX_CPUS];
+        if (!victim->online || !victim->nr_queued) continue;
+        if (!spin_trylock(&victim->rq_lock)) continue;
+        p = run_steal(victim);
+        spin_unlock(&victim->rq_lock);
+        if (p) {
+            cpu->stats.steals++;
+            return p;
         }
     }
-    return -1;
+    return 0;
+}
+
+/* pid 해시와 전체 리스트에 건다 (proc_lock) */
+static void proc_link(process_t *p) {
+    uint32 b = PID_HASH(p->pid);
+    p->hash_next = pid_hash[b];
+    pid_hash[b] = p;
+    p->all_next = 0;
+    p->all_prev = all_tail;
+    if (all_tail) all_tail->all_next = p;
+    else all_head = p;
+    all_tail = p;
+}
+
+static void proc_unlink(process_t *p) {
+    process_t **pp = &pid_hash[PID_HASH(p->pid)];
+    while (*pp && *pp != p) pp = &(*pp)->hash_next;
+    if (*pp) *pp = p->hash_next;
+    if (p->all_prev) p->all_prev->all_next = p->all_next;
+    else all_head = p->all_next;
+    if (p->all_next) p->all_next->all_prev = p->all_prev;
+    else all_tail = p->all_prev;
+}
+
+/* 종료한 설명자: free 리스트에 자리가 있으면 스택째 남기고, 없으면 slab / buddy 로 */
+static void proc_release(process_t *p) {
+    spin_lock(&proc_lock);
+    if (free_count < PROC_FREE_MAX) {
+        p->next = free_procs;
+        free_procs = p;
+        free_count++;
+        spin_unlock(&proc_lock);
+        return;
+    }
+    proc_stats.freed++;
+    spin_unlock(&proc_lock);
+    page_free(p->kstack);
+    kmem_cache_free(proc_cache, p);
+}
+
+/* 큐 길이 + 실행 중 여부가 가장 작은 CPU (cpu_limit 안에서) */
+static cpu_t *least_loaded() {
+    cpu_t *best = &cpus[0];
+    uint32 i, best_load = 0xFFFFFFFF, limit = cpu_limit < smp_cpu_count ? cpu_limit : smp_cpu_count;
+    place_hint++;
+    for (i = 0; i < SMP_MAX_CPUS; i++) {
+        cpu_t *c = &cpus[(place_hint + i) % SMP_MAX_CPUS];
+        uint32 load;
+        if (!c->online || c->id >= limit) continue;
+        load = c->nr_queued + (c->current != &c->idle);
+        if (load < best_load) { best = c; best_load = load; }
+    }
+    return best;
+}
+
+/* 전환 직후 새 스택에서: 이전 프로세스를 놓아 주고, 종료했으면 주소 공간과 설명자를 푼다 */
+static void finish_switch() {
+    cpu_t *cpu = this_cpu();
+    process_t *dead = cpu->dead;
+    if (cpu->prev) {
+        __sync_synchronize();
+        cpu->prev->on_cpu = 0;
+        cpu->prev = 0;
+    }
+    if (!dead) return;
+    cpu->dead = 0;
+    as_destroy(dead->cr3);
+    dead->cr3 = 0;
+    proc_release(dead);
+}
+
+/*
+ * 다음 프로세스로 전환. 인터럽트를 끈 상태에서, 호출자가 현재 프로세스를
+ * 큐에 넣거나 (READY) 상태를 바꾼 (WAITING/TERMINATED) 뒤 부른다.
+ * 큐에 넣은 순간 다른 CPU 가 가져갈 수 있으므로, 가져간 쪽은 on_cpu 가
+ * 풀릴 때까지 (= 이 CPU 가 switch_to 로 esp 를 저장할 때까지) 기다린다.
+ */
+static void schedule() {
+    cpu_t *cpu = this_cpu();
+    process_t *prev = cpu->current, *next = pick_next(cpu);
+    uint64 now;
+    if (!next) next = &cpu->idle;
+    cpu->need_resched = 0;
+    next->state = PROC_RUNNING;
+    next->ticks_left = sched_quantum_ticks;
+    if (next == prev) return;
+
+    while (next->on_cpu) cpu_relax();
+    next->on_cpu = 1;
+    next->cpu = cpu->id;
+    next->switches++;
+    now = rdtsc();
+    prev->runtime += now - cpu->switch_stamp;
+    cpu->switch_stamp = now;
+    cpu->stats.switches++;
+    if (next == &cpu->idle) cpu->stats.idle_switches++;
+    as_switch(next->cr3 ? next->cr3 : as_kernel());
+    cpu->current = next;
+    cpu->prev = prev;
+    switch_to(&prev->esp, next->esp);
+    finish_switch();
+}
+
+/* 새 프로세스는 switch_to 의 ret 으로 여기서 시작한다 */
+static void process_start() {
+    finish_switch();
+    cpu_enable_interrupts();
+    process_t *self = process_current();
+    if (self->bin_entry) self->bin_entry(&knix_api);
+    else self->entry_point();
+    process_exit();
 }
 
-/* 단순 라운드 로빈 스케줄러 */
-void schedule() {
-    while(1) {
-        int i;
-        for (i = 0; i < MAX_PROCESSES; i++) {
-            if (process_table[i].state == PROC_READY) {
-                process_table[i].state = PROC_RUNNING;
-                process_table[i].entry_point();
-                process_table[i].state = PROC_TERMINATED;
-            }
+static void idle_loop() {
+    while (1) cpu_wait_for_interrupt();
+}
+
+/* switch_to 가 꺼낼 모양 (edi, esi, ebx, ebp, EFLAGS, 복귀 주소) 으로 p->kstack 을 채운다 */
+static void prepare_stack(process_t *p, uint32 order) {
+    uint32 *sp = (uint32*)(p->kstack + ((uint32)PAGE_SIZE << order));
+    *--sp = 0;                        /* process_start 의 (쓰이지 않는) 복귀 주소 */
+    *--sp = (uint32)process_start;
+    *--sp = 0x002;                    /* EFLAGS: IF=0, process_start 가 켠다 */
+    *--sp = 0; *--sp = 0; *--sp = 0; *--sp = 0;
+    p->esp = (uint32)sp;
+}
+
+static void init_idle(cpu_t *cpu) {
+    memset(&cpu->idle, 0, sizeof(cpu->idle));
+    cpu->idle.pid = -1;
+    cpu->idle.entry_point = idle_loop;
+    cpu->idle.pinned = 1;
+    cpu->idle.cpu = cpu->id;
+    cpu->idle.priority = SCHED_PRIORITIES - 1;
+}
+
+void init_processes() {
+    cpu_t *cpu = &cpus[0];
+    memset(pid_hash, 0, sizeof(pid_hash));
+    memset(&proc_stats, 0, sizeof(proc_stats));
+    all_head = all_tail = 0;
+    free_procs = 0;
+    free_count = 0;
+    wait_list = 0;
+    if (!proc_cache) proc_cache = kmem_cache_create("process", sizeof(process_t));
+    sched_set_quantum(SCHED_QUANTUM_MS);
+
+    /* 지금 실행 중인 부팅 문맥 (셸). 첫 전환 때 esp 가 채워진다 */
+    memset(&boot_process, 0, sizeof(boot_process));
+    boot_process.pid = 0;
+    boot_process.state = PROC_RUNNING;
+    boot_process.priority = SCHED_DEFAULT_PRIO;
+    boot_process.pinned = 1;
+    boot_process.on_cpu = 1;
+    proc_link(&boot_process);
+    init_idle(cpu);
+    if ((cpu->idle.kstack = (uint8*)page_alloc(0)) == 0) while (1);
+    prepare_stack(&cpu->idle, 0);
+    cpu->switch_stamp = rdtsc();
+    cpu->current = &boot_process;
+}
+
+/* AP: 지금 스택이 그대로 이 CPU 의 idle 프로세스가 된다 */
+void sched_ap_enter(cpu_t *cpu) {
+    init_idle(cpu);
+    cpu->idle.state = PROC_RUNNING;
+    cpu->idle.on_cpu = 1;
+    cpu->switch_stamp = rdtsc();
+    cpu->current = &cpu->idle;
+    cpu->online = 1;
+    idle_loop();
+}
+
+process_t *process_current() {
+    uint32 flags = irq_save();
+    process_t *p = this_cpu()->current;
+    irq_restore(flags);
+    return p;
+}
+
+process_t *process_find(int pid) {
+    process_t *p;
+    uint32 flags = spin_lock_irqsave(&proc_lock);
+    for (p = pid_hash[PID_HASH(pid)]; p && p->pid != pid; p = p->hash_next);
+    spin_unlock_irqrestore(&proc_lock, flags);
+    return p;
+}
+
+int create_process(void (*entry)(void)) {
+    return create_process_as(entry, 0);
+}
+
+/*
+ * cr3 의 소유권은 프로세스로 넘어가고, 끝나면 전환 직후 (finish_switch) 해제된다.
+ * bin_entry 가 있으면 (fork) entry 대신 그것을 knix_api 와 함께 부른다.
+ */
+static int spawn_process(void (*entry)(void), knix_entry_t bin_entry, uint32 cr3) {
+    process_t *p;
+    uint8 *kstack = 0;
+    int pid;
+    uint32 flags = spin_lock_irqsave(&proc_lock);
+    if (proc_stats.live >= MAX_PROCESSES - 1) {
+        proc_stats.failures++;
+        spin_unlock_irqrestore(&proc_lock, flags);
+        return -1;
+    }
+    if ((p = free_procs) != 0) {
+        free_procs = p->next;
+        free_count--;
+        kstack = p->kstack;
+        proc_stats.reused++;
+    }
+    proc_stats.live++;   /* 자리를 먼저 잡아 두고 할당은 락 밖에서 */
+    spin_unlock(&proc_lock);
+
+    if (!p) {
+        if ((p = (process_t*)kmem_cache_alloc(proc_cache)) != 0 &&
+            (kstack = (uint8*)page_alloc(SCHED_KSTACK_ORDER)) == 0) {
+            kmem_cache_free(proc_cache, p);
+            p = 0;
+        }
+        spin_lock(&proc_lock);
+        if (p) proc_stats.allocated++;
+        else {
+            proc_stats.live--;
+            proc_stats.failures++;
+            spin_unlock_irqrestore(&proc_lock, flags);
+            return -1;
         }
-        int all_terminated = 1;
-        for (i = 0; i < MAX_PROCESSES; i++) {
-            if (process_table[i].state != PROC_TERMINATED) { all_terminated = 0; break; }
+        spin_unlock(&proc_lock);
+    }
+    memset(p, 0, sizeof(*p));
+    p->kstack = kstack;
+    prepare_stack(p, SCHED_KSTACK_ORDER);
+    p->entry_point = entry;
+    p->bin_entry = bin_entry;
+    p->cr3 = cr3;
+    p->priority = SCHED_DEFAULT_PRIO;
+    p->state = PROC_READY;
+
+    spin_lock(&proc_lock);
+    pid = p->pid = next_pid++;
+    proc_link(p);
+    proc_stats.spawned++;
+    if (proc_stats.live > proc_stats.peak) proc_stats.peak = proc_stats.live;
+    spin_unlock(&proc_lock);
+    enqueue_on(least_loaded(), p);   /* 이 뒤로 p 는 다른 CPU 에서 끝나 재사용될 수 있다 */
+    irq_restore(flags);
+    return pid;
+}
+
+int create_process_as(void (*entry)(void), uint32 cr3) {
+    return spawn_process(entry, 0, cr3);
+}
+
+void sched_yield() {
+    uint32 flags = irq_save();
+    cpu_t *cpu = this_cpu();
+    cpu->stats.yields++;
+    if (cpu->current != &cpu->idle) {
+        cpu->current->state = PROC_READY;
+        enqueue_on(cpu, cpu->current);
+    }
+    schedule();
+    irq_restore(flags);
+}
+
+void process_exit() {
+    cpu_t *cpu;
+    process_t *p, *wake = 0;
+    cpu_disable_interrupts();
+    cpu = this_cpu();
+    p = cpu->current;
+    if (p == &boot_process || p == &cpu->idle) {
+        cpu_enable_interrupts();
+        return;   /* 부팅 문맥과 idle 은 끝나지 않는다 */
+    }
+    p->state = PROC_TERMINATED;
+    spin_lock(&proc_lock);
+    proc_unlink(p);
+    proc_stats.live--;
+    proc_stats.exited++;
+    if (proc_stats.live == 0) {
+        wake = wait_list;
+        wait_list = 0;
+    }
+    spin_unlock(&proc_lock);
+    while (wake) {
+        process_t *w = wake;
+        wake = w->next;
+        w->state = PROC_READY;
+        enqueue_on(&cpus[w->cpu], w);   /* 고정된 셸은 자기 CPU 로 */
+    }
+    cpu->dead = p;
+    schedule();
+    while (1);   /* 돌아오지 않는다 */
+}
+
+/* boot_process 가 아닌 프로세스가 모두 끝날 때까지 잠든다 */
+void process_wait_all() {
+    uint32 flags = irq_save();
+    while (1) {
+        process_t *self = this_cpu()->current;
+        spin_lock(&proc_lock);
+        if (proc_stats.live == 0) {
+            spin_unlock(&proc_lock);
+            break;
         }
-        if (all_terminated) break;
+        self->state = PROC_WAITING;
+        self->next = wait_list;
+        wait_list = self;
+        spin_unlock(&proc_lock);
+        schedule();
+    }
+    irq_restore(flags);
+}
+
+/* execbin / fork 프로그램이 진입점에서 받는 표 (kapi.h) */
+const knix_api_t knix_api = {
+    KNIX_API_VERSION, sizeof(knix_api_t), kprint,
+    sock_listen, sock_accept, sock_connect, sock_send, sock_recv,
+    sock_flush, sock_peer, sock_close, sock_set_nodelay, sock_wait
+};
+
+/* 현재 프로세스가 잠시 다른 주소 공간에서 entry 를 실행 (execbin). entry 는 커널 호출 표를 받는다 */
+void process_run_in(uint32 cr3, knix_entry_t entry) {
+    process_t *self = process_current();
+    uint32 saved = self->cr3;
+    self->cr3 = cr3;
+    as_switch(cr3);
+    entry(&knix_api);
+    self->cr3 = saved;
+    as_switch(saved ? saved : as_kernel());
+}
+
+void sched_set_quantum(uint32 ms) {
+    uint32 ticks = ms * SCHED_HZ / 1000;
+    sched_quantum_ticks = ticks ? ticks : 1;
+}
+
+void sched_set_cpu_limit(uint32 n) {
+    cpu_limit = n ? n : 1;
+}
+
+/* 다른 CPU 큐에 훔쳐 올 만한 것이 있는지 (잠그지 않는 힌트) */
+static int work_elsewhere(cpu_t *cpu) {
+    uint32 i;
+    if (cpu->id >= cpu_limit) return 0;
+    for (i = 0; i < SMP_MAX_CPUS; i++)
+        if (&cpus[i] != cpu && cpus[i].online && cpus[i].nr_queued) return 1;
+    return 0;
+}
+
+/* 타이머 IRQ (BSP 는 PIT, AP 는 LAPIC 타이머): 슬라이스를 다 썼고 기다리는 프로세스가 있으면 전환 예약 */
+void sched_tick() {
+    cpu_t *cpu = this_cpu();
+    process_t *p = cpu->current;
+    cpu->stats.ticks++;
+    if (!p) return;
+    if (p == &cpu->idle) {
+        if (cpu->nr_queued || work_elsewhere(cpu)) cpu->need_resched = 1;
+        return;
+    }
+    if (p->ticks_left > 0) p->ticks_left--;
+    if (p->ticks_left == 0 && cpu->nr_queued) cpu->need_resched = 1;
+}
+
+/* IRQ 핸들러와 EOI 가 끝난 뒤 (isr_dispatch) */
+void sched_irq_exit() {
+    cpu_t *cpu = this_cpu();
+    process_t *p = cpu->current;
+    if (!cpu->need_resched || !p) return;
+    if (p != &cpu->idle) {
+        p->state = PROC_READY;
+        p->preempted++;
+        cpu->stats.preemptions++;
+        enqueue_on(cpu, p);
     }
+    schedule();
 }
 
 /* 시스템 호출 예제 */
-int sys_create_process(void (*entry)()) {
-    return create_process(entry);
-}
\ No newline at end of file
+int sys_create_process(knix_entry_t entry, uint32 cr3) {
+    return spawn_process(0, entry, cr3);
+}
+
+/*=========================*/
+/* ps / schedbench / spawnbench */
+/*=========================*/
+static const char *state_name(proc_state_t s) {
+    switch (s) {
+        case PROC_READY: return "READY  ";
+        case PROC_RUNNING: return "RUNNING";
+        case PROC_WAITING: return "WAITING";
+        default: return "DEAD   ";
+    }
+}
+
+/* 모든 CPU 의 통계 합 */
+static void sched_totals(sched_stats_t *sum) {
+    uint32 i;
+    memset(sum, 0, sizeof(*sum));
+    for (i = 0; i < SMP_MAX_CPUS; i++) {
+        sched_stats_t *st = &cpus[i].stats;
+        sum->ticks += st->ticks;
+        sum->switches += st->switches;
+        sum->preemptions += st->preemptions;
+        sum->yields += st->yields;
+        sum->idle_switches += st->idle_switches;
+        sum->steals += st->steals;
+    }
+}
+
+/* 출력 중에 프로세스가 끝나 설명자가 재사용될 수 있으므로 앞쪽 일부를 복사해 찍는다 */
+static process_t ps_rows[PS_MAX_ROWS];
+
+void ps_cmd() {
+    uint32 i, rows = 0, live, flags;
+    process_t *p;
+    flags = spin_lock_irqsave(&proc_lock);
+    for (p = all_head; p && rows < PS_MAX_ROWS; p = p->all_next) ps_rows[rows++] = *p;
+    live = proc_stats.live;
+    spin_unlock_irqrestore(&proc_lock, flags);
+
+    kprint("PID  State    CPU  Prio  Switches  Preempted  Runtime(ms)\n");
+    for (i = 0; i < rows; i++) {
+        p = &ps_rows[i];
+        kprint_dec(p->pid); kprint(p->pid < 10 ? "    " : "   ");
+        kprint(state_name(p->state)); kprint("  ");
+        kprint_dec(p->cpu); kprint("    ");
+        kprint_dec(p->priority); kprint("     ");
+        kprint_dec(p->switches); kprint("  ");
+        kprint_dec(p->preempted); kprint("  ");
+        kprint_dec(cycles_to_us(p->runtime) / 1000);
+        if (p->cr3) kprint("  (own address space)");
+        kprint("\n");
+    }
+    if (live + 1 > rows) {
+        kprint("... "); kprint_dec(live + 1 - rows); kprint(" more\n");
+    }
+    kprint("Processes: "); kprint_dec(live); kprint(" live (peak "); kprint_dec(proc_stats.peak);
+    kprint("), spawned "); kprint_dec(proc_stats.spawned);
+    kprint(", exited "); kprint_dec(proc_stats.exited);
+    kprint(", descriptors reused "); kprint_dec(proc_stats.reused);
+    kprint(" / new "); kprint_dec(proc_stats.allocated);
+    kprint(" / freed "); kprint_dec(proc_stats.freed);
+    kprint(", cached "); kprint_dec(free_count); kprint("\n");
+    kprint("Quantum: "); kprint_dec(sched_quantum_ticks * 1000 / SCHED_HZ); kprint(" ms\n");
+    for (i = 0; i < SMP_MAX_CPUS; i++) {
+        cpu_t *c = &cpus[i];
+        if (!c->online) continue;
+        kprint("CPU "); kprint_dec(i);
+        kprint(": ticks "); kprint_dec(c->stats.ticks);
+        kprint(", switches "); kprint_dec(c->stats.switches);
+        kprint(", preemptions "); kprint_dec(c->stats.preemptions);
+        kprint(", yields "); kprint_dec(c->stats.yields);
+        kprint(", idle "); kprint_dec(c->stats.idle_switches);
+        kprint(", steals "); kprint_dec(c->stats.steals);
+        kprint(", queued "); kprint_dec(c->nr_queued); kprint("\n");
+    }
+}
+
+static volatile uint32 bench_sink;
+
+static void yield_task() {
+    uint32 i;
+    for (i = 0; i < SCHED_BENCH_SWITCHES / 2; i++) sched_yield();
+}
+
+static void work_task() {
+    uint32 i, x = 1;
+    for (i = 0; i < SCHED_BENCH_WORK; i++) x = x * 1103515245 + 12345;
+    bench_sink += x;
+}
+
+/* N 개의 CPU 작업을 동시에 돌려 끝날 때까지의 시간 (us) */
+static uint32 run_workers(uint32 tasks, uint32 *created) {
+    uint32 i;
+    uint64 t0 = rdtsc();
+    for (i = 0; i < tasks && create_process(work_task) != -1; i++);
+    *created = i;
+    process_wait_all();
+    return cycles_to_us(rdtsc() - t0);
+}
+
+/* 스케줄러 자체의 비용을 보려고 CPU 0 하나에서만 돌린다 (여러 CPU 확장은 smpbench) */
+void sched_bench_cmd(uint32 tasks) {
+    static const uint32 quanta[3] = { 1, 10, 50 };
+    uint32 i, n, us, saved = sched_quantum_ticks;
+    sched_stats_t before, after;
+    uint64 t0;
+
+    if (tasks == 0) tasks = 4;
+    if (tasks > MAX_PROCESSES - 1) tasks = MAX_PROCESSES - 1;
+    process_wait_all();   /* 남아 있는 프로세스가 측정을 흐리지 않게 */
+    sched_set_cpu_limit(1);
+
+    /* 두 프로세스가 서로 양보: 전환 한 번당 사이클 */
+    sched_totals(&before);
+    t0 = rdtsc();
+    create_process(yield_task);
+    create_process(yield_task);
+    process_wait_all();
+    t0 = rdtsc() - t0;
+    sched_totals(&after);
+    n = after.switches - before.switches;
+    kprint("Context switch (yield ping-pong): ");
+    kprint_dec((uint32)udiv64(t0, n ? n : 1));
+    kprint(" cycles/switch over "); kprint_dec(n); kprint(" switches\n");
+
+    /* 같은 일을 셸에서 순서대로: 전환 없는 기준선 */
+    t0 = rdtsc();
+    for (i = 0; i < tasks; i++) work_task();
+    kprint_dec(tasks); kprint(" CPU-bound tasks sequentially: ");
+    kprint_dec(cycles_to_us(rdtsc() - t0) / 1000); kprint(" ms\n");
+
+    for (i = 0; i < 3; i++) {
+        sched_set_quantum(quanta[i]);
+        sched_totals(&before);
+        us = run_workers(tasks, &n);
+        sched_totals(&after);
+        kprint("  quantum "); kprint_dec(quanta[i]); kprint(" ms: ");
+        kprint_dec(n); kprint(" tasks in "); kprint_dec(us / 1000);
+        kprint(" ms, "); kprint_dec(after.switches - before.switches);
+        kprint(" switches, "); kprint_dec(after.preemptions - before.preemptions);
+        kprint(" preemptions\n");
+    }
+    sched_quantum_ticks = saved;
+    sched_set_cpu_limit(SMP_MAX_CPUS);
+}
+
+static volatile uint32 spawn_done;
+
+static void spawn_task() {
+    __sync_fetch_and_add(&spawn_done, 1);
+}
+
+/* 바로 끝나는 프로세스를 count 개 만들어 생성 비용과 생성-실행-종료 처리량을 잰다 */
+void spawn_bench_cmd(uint32 count) {
+    uint32 i = 0, retries = 0, total_us;
+    proc_stats_t before;
+    uint64 t0, t, create_cycles = 0;
+
+    if (count == 0) count = SPAWN_BENCH_DEFAULT;
+    process_wait_all();
+    before = proc_stats;
+    spawn_done = 0;
+    t0 = rdtsc();
+    while (i < count) {
+        t = rdtsc();
+        if (create_process(spawn_task) >= 0) {
+            create_cycles += rdtsc() - t;
+            i++;
+            continue;
+        }
+        if (proc_stats.live == 0) break;   /* 아무것도 돌지 않는데 실패: 메모리 부족 */
+        retries++;
+        sched_yield();   /* 상한에 닿음: 끝난 프로세스가 정리되도록 양보 */
+    }
+    process_wait_all();
+    total_us = cycles_to_us(rdtsc() - t0);
+    if (total_us == 0) total_us = 1;
+
+    kprint("Spawned "); kprint_dec(i); kprint(" tasks, "); kprint_dec(spawn_done);
+    kprint(" ran, in "); kprint_dec(total_us / 1000); kprint(" ms (");
+    kprint_dec(retries); kprint(" retries at the limit)\n");
+    kprint("  create: "); kprint_dec((uint32)udiv64(create_cycles, i ? i : 1));
+    kprint(" cycles/spawn, ");
+    kprint_dec((uint32)udiv64((uint64)i * 1000000, cycles_to_us(create_cycles) ? cycles_to_us(create_cycles) : 1));
+    kprint(" spawns/s\n");
+    kprint("  spawn+run+exit: ");
+    kprint_dec((uint32)udiv64((uint64)(proc_stats.exited - before.exited) * 1000000, total_us));
+    kprint(" exits/s, peak live "); kprint_dec(proc_stats.peak);
+    kprint("\n  descriptors: reused "); kprint_dec(proc_stats.reused - before.reused);
+    kprint(", new "); kprint_dec(proc_stats.allocated - before.allocated);
+    kprint(", freed "); kprint_dec(proc_stats.freed - before.freed);
+    kprint(", failed creates "); kprint_dec(proc_stats.failures - before.failures); kprint("\n");
+}
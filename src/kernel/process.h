@@ -6,25 +6,77 @@
 #define PROCESS_H
 
 #include "dc.h"
+#include "kapi.h"
 #include <stdint.h>
 
 typedef enum { PROC_READY, PROC_RUNNING, PROC_WAITING, PROC_TERMINATED } proc_state_t;
 
-typedef struct {
+typedef struct process {
     int pid;
     proc_state_t state;
-    void (*entry_point)();
-    uint32_t stack[128];  /* 단순화된 스택 공간 */
-    uint32_t sp;          /* 스택 포인터 (인덱스) */
+    void (*entry_point)(void);   /* 커널 작업 */
+    knix_entry_t bin_entry;       /* 0 이 아니면 fork 한 바이너리: entry_point 대신 knix_api 와 함께 부른다 */
+    uint8 *kstack;        /* page_alloc 한 커널 스택 (0 이면 부트 스택 / 빈 슬롯) */
+    uint32_t esp;         /* 전환될 때 저장된 스택 포인터 (switch_to) */
+    uint32 cr3;           /* 주소 공간 (페이지 디렉터리 물리 주소), 0 이면 커널 공간 */
+    uint32 priority;      /* run queue 번호, 0 이 가장 높음 */
+    uint32 ticks_left;    /* 남은 타임 슬라이스 (틱) */
+    uint32 cpu;           /* 마지막으로 (또는 지금) 실행한 CPU */
+    uint32 pinned;        /* 1 이면 다른 CPU 가 훔쳐 가지 않는다 (셸: 드라이버가 BSP 전제) */
+    volatile uint32 on_cpu;  /* 어떤 CPU 의 스택에서 아직 내려오지 않음 */
+    struct process *next; /* run queue / 대기 리스트 / free 리스트 연결 */
+    struct process *hash_next;              /* pid 해시 버킷 */
+    struct process *all_next, *all_prev;    /* 살아 있는 프로세스 전체 (ps) */
+    uint32 switches;      /* CPU 를 받은 횟수 */
+    uint32 preempted;     /* 그중 타임 슬라이스를 다 써서 뺏긴 횟수 */
+    uint64 runtime;       /* 누적 실행 사이클 */
 } process_t;
 
-extern process_t process_table[MAX_PROCESSES];
-extern int current_process;
+/* CPU 별 스케줄러 통계 (smp.h 의 cpu_t) */
+typedef struct {
+    uint32 ticks;
+    uint32 switches;
+    uint32 preemptions;
+    uint32 yields;
+    uint32 idle_switches;
+    uint32 steals;        /* 다른 CPU 의 큐에서 가져온 횟수 */
+} sched_stats_t;
+
+/* 설명자 할당/재사용 통계 (spawnbench, ps) */
+typedef struct {
+    uint32 live;          /* 셸을 뺀 살아 있는 프로세스 */
+    uint32 peak;
+    uint32 spawned;
+    uint32 exited;
+    uint32 reused;        /* free 리스트에서 스택째 다시 쓴 설명자 */
+    uint32 allocated;     /* slab + buddy 에서 새로 만든 설명자 */
+    uint32 freed;         /* free 리스트가 차서 돌려준 설명자 */
+    uint32 failures;
+} proc_stats_t;
+
 extern int next_pid;
+extern proc_stats_t proc_stats;
+extern uint32 sched_quantum_ticks;
 
 void init_processes();
-int create_process(void (*entry)());
-void schedule();
-int sys_create_process(void (*entry)());
+process_t *process_current();
+process_t *process_find(int pid);
+int create_process(void (*entry)(void));
+int create_process_as(void (*entry)(void), uint32 cr3);
+void sched_yield();
+void process_exit();
+void process_wait_all();
+void process_run_in(uint32 cr3, knix_entry_t entry);
+void sched_set_quantum(uint32 ms);
+void sched_set_cpu_limit(uint32 cpus);
+int sys_create_process(knix_entry_t entry, uint32 cr3);
+
+/* timer / idt 에서 호출 (IRQ 문맥) */
+void sched_tick();
+void sched_irq_exit();
+
+void ps_cmd();
+void sched_bench_cmd(uint32 tasks);
+void spawn_bench_cmd(uint32 count);
 
 #endif //PROCESS_H
@@ -0,0 +1,214 @@
+#include "serial.h"
+#include "idt.h"
+#include "io.h"
+#include "cpu.h"
+#include "timer.h"
+#include "kprint.h"
+#include "spinlock.h"
+#include "type.h"
+
+/*=========================*/
+/* 18. 16550 UART 콘솔 */
+/*=========================*/
+/*
+ * kprint 는 글자를 송신 링에 복사만 하고, UART 는 THR 이 비었다는 인터럽트 (THRE) 마다
+ * FIFO 를 16 바이트씩 채운다. 호출자는 포트 I/O 없이 돌아가고 LSR 을 보고 쓰므로
+ * 실제 하드웨어에서도 글자를 잃지 않는다.
+ * 인터럽트를 받을 수 없는 문맥 (예외 핸들러, IF=0) 과 serial_init 이전에는 폴링으로 내보낸다.
+ */
+#define COM1            0x3F8
+#define UART_THR        0       /* DLAB=0 */
+#define UART_DLL        0       /* DLAB=1 */
+#define UART_IER        1
+#define UART_DLM        1
+#define UART_IIR        2       /* 읽기 */
+#define UART_FCR        2       /* 쓰기 */
+#define UART_LCR        3
+#define UART_MCR        4
+#define UART_LSR        5
+
+#define IER_THRE        0x02
+#define FCR_ENABLE      0x07    /* FIFO 켬, 송수신 FIFO 비움 */
+#define FCR_TRIGGER_14  0xC0
+#define LCR_8N1         0x03
+#define LCR_DLAB        0x80
+#define MCR_DTR_RTS     0x03
+#define MCR_OUT2        0x08    /* PC 에서는 OUT2 가 IRQ 선을 연결한다 */
+#define LSR_THRE        0x20
+#define UART_FIFO_SIZE  16
+#define UART_DIVISOR    1       /* 115200 baud */
+
+static char tx_ring[SERIAL_TX_RING];
+static uint32 tx_head = 0, tx_tail = 0;
+static uint32 tx_armed = 0;             /* IER 에 THRE 를 켜 두었음 */
+static uint32 tx_ready = 0;             /* serial_init 이후 */
+static spinlock_t tx_lock = SPINLOCK_INIT;
+serial_stats_t serial_stats;
+
+static void put_polled(char c) {
+    while (!(inb(COM1 + UART_LSR) & LSR_THRE)) cpu_relax();
+    outb(COM1 + UART_THR, (uint8)c);
+}
+
+/* THR 이 비었으면 FIFO 크기만큼 링에서 옮긴다 (tx_lock) */
+static void tx_fill() {
+    uint32 n = 0;
+    if (!(inb(COM1 + UART_LSR) & LSR_THRE)) return;
+    while (n < UART_FIFO_SIZE && tx_tail != tx_head) {
+        outb(COM1 + UART_THR, (uint8)tx_ring[tx_tail & (SERIAL_TX_RING - 1)]);
+        tx_tail++;
+        n++;
+    }
+    if (n) serial_stats.fifo_fills++;
+}
+
+/* 링을 다 비울 때까지 LSR 을 보며 직접 내보낸다 (tx_lock) */
+static void tx_drain_polled() {
+    uint32 start = tx_tail;
+    while (tx_tail != tx_head) {
+        while (!(inb(COM1 + UART_LSR) & LSR_THRE)) cpu_relax();
+        tx_fill();
+    }
+    serial_stats.polled += tx_tail - start;
+}
+
+/* 보낼 것이 있는데 THRE 가 꺼져 있으면 FIFO 를 채우고 인터럽트를 켠다 (tx_lock) */
+static void tx_kick() {
+    if (tx_armed || tx_tail == tx_head) return;
+    tx_fill();
+    if (tx_tail == tx_head) return;
+    tx_armed = 1;
+    outb(COM1 + UART_IER, IER_THRE);
+}
+
+static void serial_irq(interrupt_frame_t *frame) {
+    (void)frame;
+    spin_lock(&tx_lock);
+    serial_stats.irqs++;
+    inb(COM1 + UART_IIR);   /* THRE 인터럽트 확인 (읽으면 내려간다) */
+    tx_fill();
+    if (tx_tail == tx_head && tx_armed) {
+        tx_armed = 0;
+        outb(COM1 + UART_IER, 0);
+    }
+    spin_unlock(&tx_lock);
+}
+
+void serial_init() {
+    outb(COM1 + UART_IER, 0);
+    outb(COM1 + UART_LCR, LCR_DLAB);
+    outb(COM1 + UART_DLL, UART_DIVISOR & 0xFF);
+    outb(COM1 + UART_DLM, UART_DIVISOR >> 8);
+    outb(COM1 + UART_LCR, LCR_8N1);
+    outb(COM1 + UART_FCR, FCR_ENABLE | FCR_TRIGGER_14);
+    outb(COM1 + UART_MCR, MCR_DTR_RTS | MCR_OUT2);
+    memset(&serial_stats, 0, sizeof(serial_stats));
+    tx_head = tx_tail = 0;
+    tx_armed = 0;
+    irq_register(IRQ_COM1, serial_irq);
+    tx_ready = 1;
+}
+
+void serial_write(const char *buf, uint32 len) {
+    uint32 flags = spin_lock_irqsave(&tx_lock), n, i;
+    if (!tx_ready) {
+        while (len--) put_polled(*buf++);
+        spin_unlock_irqrestore(&tx_lock, flags);
+        return;
+    }
+    while (len) {
+        n = SERIAL_TX_RING - (tx_head - tx_tail);
+        if (n == 0) {
+            /* 링이 가득 참: 콘솔 속도보다 빨리 쓰는 중이므로 여기서 기다린다 */
+            serial_stats.stalls++;
+            tx_drain_polled();
+            continue;
+        }
+        if (n > len) n = len;
+        for (i = 0; i < n; i++) tx_ring[(tx_head + i) & (SERIAL_TX_RING - 1)] = buf[i];
+        tx_head += n;
+        buf += n;
+        len -= n;
+        serial_stats.bytes += n;
+    }
+    if (!(flags & 0x200)) tx_drain_polled();   /* 호출자가 IF=0: THRE 를 기다릴 수 없다 */
+    else tx_kick();
+    spin_unlock_irqrestore(&tx_lock, flags);
+}
+
+/* 링에 남은 것을 모두 내보낸다 (벤치마크, 재부팅/종료 전) */
+void serial_flush() {
+    uint32 flags = spin_lock_irqsave(&tx_lock);
+    tx_drain_polled();
+    spin_unlock_irqrestore(&tx_lock, flags);
+}
+
+/*=========================*/
+/* consolebench: 줄 출력 처리량 */
+/*=========================*/
+static const char bench_line[] = "consolebench 0123456789 abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ\n";
+
+static void print_rate(const char *label, uint32 lines, uint64 cycles) {
+    uint32 us = cycles_to_us(cycles);
+    kprint(label);
+    kprint_dec((uint32)udiv64((uint64)lines * 1000000, us ? us : 1));
+    kprint(" lines/s, ");
+    kprint_dec((uint32)udiv64(cycles, lines ? lines : 1));
+    kprint(" cycles/line\n");
+}
+
+void console_bench_cmd(uint32 lines) {
+    uint32 i, flags, len = sizeof(bench_line) - 1;
+    const char *c;
+    uint64 t0, raw, polled, caller, drained, fmt;
+    serial_stats_t before;
+
+    if (lines == 0) lines = CONSOLE_BENCH_LINES;
+    serial_flush();
+
+    /* 1. 예전 kprint: 글자마다 outb, LSR/FIFO 확인 없음 */
+    flags = spin_lock_irqsave(&tx_lock);
+    t0 = rdtsc();
+    for (i = 0; i < lines; i++)
+        for (c = bench_line; *c; c++) outb(COM1 + UART_THR, (uint8)*c);
+    raw = rdtsc() - t0;
+    spin_unlock_irqrestore(&tx_lock, flags);
+
+    /* 2. 버퍼 없이 LSR 을 보며 한 글자씩 (유실은 없지만 호출자가 전송 속도에 묶인다) */
+    flags = spin_lock_irqsave(&tx_lock);
+    t0 = rdtsc();
+    for (i = 0; i < lines; i++)
+        for (c = bench_line; *c; c++) put_polled(*c);
+    polled = rdtsc() - t0;
+    spin_unlock_irqrestore(&tx_lock, flags);
+
+    /* 3. 링 버퍼 + THRE 인터럽트: 호출자 경로와, 실제로 다 나갈 때까지 */
+    before = serial_stats;
+    t0 = rdtsc();
+    for (i = 0; i < lines; i++) serial_write(bench_line, len);
+    caller = rdtsc() - t0;
+    while (1) {
+        flags = spin_lock_irqsave(&tx_lock);
+        if (tx_tail == tx_head) break;
+        spin_unlock_irqrestore(&tx_lock, flags);
+        cpu_relax();
+    }
+    spin_unlock_irqrestore(&tx_lock, flags);
+    drained = rdtsc() - t0;
+
+    /* 4. kprintf 로 형식화해 한 번에 */
+    t0 = rdtsc();
+    for (i = 0; i < lines; i++) kprintf("consolebench %u %x %s\n", i, i, "kprintf");
+    fmt = rdtsc() - t0;
+    serial_flush();
+
+    kprint("\n");
+    print_rate("Per-char outb (old kprint):   ", lines, raw);
+    print_rate("Polled with LSR check:        ", lines, polled);
+    print_rate("Ring buffer, caller path:     ", lines, caller);
+    print_rate("Ring buffer, until drained:   ", lines, drained);
+    print_rate("kprintf, caller path:         ", lines, fmt);
+    kprint("  "); kprint_dec(serial_stats.irqs - before.irqs); kprint(" THRE interrupts, ");
+    kprint_dec(serial_stats.fifo_fills - before.fifo_fills); kprint(" FIFO fills, ");
+    kprint_dec(serial_stats.stalls - before.stalls); kprint(" ring-full stalls\n");
+}
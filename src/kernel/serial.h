@@ -0,0 +1,21 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include "dc.h"
+
+typedef struct {
+    uint32 bytes;         /* 링에 넣은 바이트 */
+    uint32 irqs;          /* THRE 인터럽트 */
+    uint32 fifo_fills;    /* FIFO 를 (최대 16 바이트) 채운 횟수 */
+    uint32 stalls;        /* 링이 가득 차 호출자가 직접 비운 횟수 */
+    uint32 polled;        /* 인터럽트를 못 받는 문맥이라 폴링으로 내보낸 바이트 */
+} serial_stats_t;
+
+extern serial_stats_t serial_stats;
+
+void serial_init();
+void serial_write(const char *buf, uint32 len);
+void serial_flush();
+void console_bench_cmd(uint32 lines);
+
+#endif //SERIAL_H
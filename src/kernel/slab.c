@@ -0,0 +1,264 @@
+#include "slab.h"
+#include "mm.h"
+#include "kprint.h"
+#include "type.h"
+#include "cpu.h"
+#include "timer.h"
+#include "table.h"
+#include "process.h"
+
+/*=========================*/
+/* 15-2. Slab 캐시 & kmalloc */
+/*=========================*/
+/*
+ * 캐시 구조체는 정적 배열에 두므로 kmalloc 없이도 만들 수 있다.
+ * kfree 는 buddy 의 페이지 표시로 slab 머리 (= 캐시) 를 찾으므로 크기를 받지 않는다.
+ */
+#define SLAB_HEADER_SIZE  ((sizeof(slab_t) + 7) & ~7u)
+#define SLAB_MAX_ORDER    3
+
+static kmem_cache_t caches[SLAB_MAX_CACHES];
+static uint32 cache_count = 0;
+static kmem_cache_t *size_caches[SLAB_CLASSES];
+static const char *size_names[SLAB_CLASSES] = {
+    "kmalloc-16", "kmalloc-32", "kmalloc-64", "kmalloc-128",
+    "kmalloc-256", "kmalloc-512", "kmalloc-1024", "kmalloc-2048"
+};
+static uint32 kmalloc_requested = 0;   /* 누적: 요청한 바이트 */
+static uint32 kmalloc_granted = 0;     /* 누적: 실제로 내준 바이트 (size class / 페이지) */
+static uint32 kmalloc_large = 0;       /* buddy 로 바로 간 요청 수 */
+
+static void slab_unlink(slab_t **list, slab_t *s) {
+    if (s->prev) s->prev->next = s->next;
+    else *list = s->next;
+    if (s->next) s->next->prev = s->prev;
+}
+
+static void slab_link(slab_t **list, slab_t *s) {
+    s->prev = 0;
+    s->next = *list;
+    if (s->next) s->next->prev = s;
+    *list = s;
+}
+
+void slab_init() {
+    uint32 i;
+    memset(caches, 0, sizeof(caches));
+    cache_count = 0;
+    kmalloc_requested = kmalloc_granted = kmalloc_large = 0;
+    for (i = 0; i < SLAB_CLASSES; i++)
+        size_caches[i] = kmem_cache_create(size_names[i], 1u << (SLAB_MIN_SHIFT + i));
+}
+
+/* 낭비가 slab 의 1/8 이하가 되는 가장 작은 order (최대 SLAB_MAX_ORDER) */
+kmem_cache_t *kmem_cache_create(const char *name, uint32 size) {
+    kmem_cache_t *c;
+    uint32 order, bytes, per = 0;
+    if (cache_count >= SLAB_MAX_CACHES || size == 0) return 0;
+    size = (size + 7) & ~7u;
+    if (size + SLAB_HEADER_SIZE > (PAGE_SIZE << SLAB_MAX_ORDER)) return 0;
+    for (order = 0; order <= SLAB_MAX_ORDER; order++) {
+        bytes = (PAGE_SIZE << order) - SLAB_HEADER_SIZE;
+        per = bytes / size;
+        if (per > 0 && (bytes - per * size) * 8 <= ((uint32)PAGE_SIZE << order)) break;
+    }
+    if (order > SLAB_MAX_ORDER) {
+        order = SLAB_MAX_ORDER;
+        per = ((PAGE_SIZE << order) - SLAB_HEADER_SIZE) / size;
+    }
+    c = &caches[cache_count++];
+    memset(c, 0, sizeof(*c));
+    c->name = name;
+    c->obj_size = size;
+    c->order = order;
+    c->per_slab = per;
+    return c;
+}
+
+static slab_t *slab_grow(kmem_cache_t *c) {
+    uint8 *base = (uint8*)page_alloc(c->order);
+    uint32 i;
+    if (!base) return 0;
+    page_mark_slab(base, c->order, 1);
+    slab_t *s = (slab_t*)base;
+    s->cache = c;
+    s->inuse = 0;
+    s->free = 0;
+    /* 앞쪽 객체부터 나가도록 뒤에서부터 쌓는다 */
+    for (i = c->per_slab; i > 0; i--) {
+        void **obj = (void**)(base + SLAB_HEADER_SIZE + (i - 1) * c->obj_size);
+        *obj = s->free;
+        s->free = obj;
+    }
+    c->slabs++;
+    return s;
+}
+
+void *kmem_cache_alloc(kmem_cache_t *c) {
+    slab_t *s;
+    void **obj;
+    uint32 flags = spin_lock_irqsave(&c->lock);
+    if ((s = c->partial) != 0) {
+        slab_unlink(&c->partial, s);
+    } else if ((s = c->empty) != 0) {
+        slab_unlink(&c->empty, s);
+    } else if ((s = slab_grow(c)) == 0) {
+        spin_unlock_irqrestore(&c->lock, flags);
+        return 0;
+    }
+    obj = (void**)s->free;
+    s->free = *obj;
+    s->inuse++;
+    slab_link(s->inuse == c->per_slab ? &c->full : &c->partial, s);
+    c->active++;
+    c->allocs++;
+    spin_unlock_irqrestore(&c->lock, flags);
+    return obj;
+}
+
+void kmem_cache_free(kmem_cache_t *c, void *obj) {
+    slab_t *s = (slab_t*)page_slab_head(obj);
+    if (!s || s->cache != c) return;
+    uint32 flags = spin_lock_irqsave(&c->lock);
+    slab_unlink(s->inuse == c->per_slab ? &c->full : &c->partial, s);
+    *(void**)obj = s->free;
+    s->free = obj;
+    s->inuse--;
+    c->active--;
+    c->frees++;
+    if (s->inuse > 0) {
+        slab_link(&c->partial, s);
+    } else if (c->empty) {
+        /* 빈 slab 은 하나만 남겨 alloc/free 가 반복될 때 buddy 를 오가지 않게 한다 */
+        page_mark_slab(s, c->order, 0);
+        page_free(s);
+        c->slabs--;
+    } else {
+        slab_link(&c->empty, s);
+    }
+    spin_unlock_irqrestore(&c->lock, flags);
+}
+
+void *kmalloc(uint32 size) {
+    uint32 cls = 0;
+    if (size == 0) return 0;
+    __sync_fetch_and_add(&kmalloc_requested, size);
+    if (size > (1u << (SLAB_MIN_SHIFT + SLAB_CLASSES - 1))) {
+        uint32 order = page_order_for(size);
+        if (order > BUDDY_MAX_ORDER) return 0;   /* 가장 큰 buddy 블록보다 크다 */
+        __sync_fetch_and_add(&kmalloc_granted, PAGE_SIZE << order);
+        __sync_fetch_and_add(&kmalloc_large, 1);
+        return page_alloc(order);
+    }
+    while ((1u << (SLAB_MIN_SHIFT + cls)) < size) cls++;
+    __sync_fetch_and_add(&kmalloc_granted, 1u << (SLAB_MIN_SHIFT + cls));
+    return kmem_cache_alloc(size_caches[cls]);
+}
+
+void kfree(void *ptr) {
+    slab_t *s;
+    if (!ptr) return;
+    s = (slab_t*)page_slab_head(ptr);
+    if (s) kmem_cache_free(s->cache, ptr);
+    else page_free(ptr);
+}
+
+/* slabinfo: 캐시별 객체/slab 수와 slab 안의 사용률 */
+void slab_stat_cmd() {
+    uint32 i;
+    kprint("Name            Size  Active/Total  Slabs  Pages  Used%\n");
+    for (i = 0; i < cache_count; i++) {
+        kmem_cache_t *c = &caches[i];
+        uint32 total = c->slabs * c->per_slab;
+        uint32 bytes = c->slabs * (PAGE_SIZE << c->order);
+        uint32 n = strlen(c->name);
+        kprint(c->name);
+        while (n++ < 16) kprint(" ");
+        kprint_dec(c->obj_size); kprint("  ");
+        kprint_dec(c->active); kprint("/"); kprint_dec(total); kprint("  ");
+        kprint_dec(c->slabs); kprint("  ");
+        kprint_dec(c->slabs << c->order); kprint("  ");
+        kprint_dec(bytes ? (uint32)udiv64((uint64)c->active * c->obj_size * 100, bytes) : 0);
+        kprint("\n");
+    }
+    kprint("kmalloc: requested "); kprint_dec(kmalloc_requested);
+    kprint(" bytes, granted "); kprint_dec(kmalloc_granted);
+    kprint(" (internal fragmentation ");
+    kprint_dec(kmalloc_granted ? (uint32)udiv64((uint64)(kmalloc_granted - kmalloc_requested) * 100, kmalloc_granted) : 0);
+    kprint("%), large: "); kprint_dec(kmalloc_large); kprint("\n");
+}
+
+/*=========================*/
+/* membench: buddy / slab / kmalloc 할당-해제 비용과 단편화 */
+/*=========================*/
+static void *bench_ptrs[MEM_BENCH_OPS];
+static uint8 bench_order[MEM_BENCH_OPS];
+static kmem_cache_t *file_entry_cache = 0, *process_cache = 0, *packet_cache = 0;
+
+static void print_per_op(const char *label, uint64 cycles, uint32 ops) {
+    kprint(label);
+    kprint_dec((uint32)udiv64(cycles, ops ? ops : 1));
+    kprint(" cycles/op (");
+    kprint_dec(cycles_to_us(cycles)); kprint(" us for ");
+    kprint_dec(ops); kprint(" ops)\n");
+}
+
+/* count 개 할당 후 전부 해제, 할당과 해제를 합친 한 쌍당 사이클 */
+static void bench_cache(const char *label, kmem_cache_t *c, uint32 count) {
+    uint32 i;
+    uint64 t0 = rdtsc();
+    for (i = 0; i < count; i++) bench_ptrs[i] = kmem_cache_alloc(c);
+    for (i = 0; i < count; i++) kmem_cache_free(c, bench_ptrs[i]);
+    print_per_op(label, rdtsc() - t0, count);
+}
+
+void mem_bench_cmd() {
+    uint32 i, n, seed = 12345, before = mem_stats.free_pages;
+    uint64 t0;
+
+    if (!file_entry_cache) {
+        file_entry_cache = kmem_cache_create("file_entry", sizeof(FileEntry));
+        process_cache = kmem_cache_create("process_t", sizeof(process_t));
+        packet_cache = kmem_cache_create("packet", 1518);
+    }
+
+    /* 단일 페이지: 할당 후 역순 해제 (합치기 포함) */
+    t0 = rdtsc();
+    for (n = 0; n < MEM_BENCH_OPS && (bench_ptrs[n] = page_alloc(0)) != 0; n++);
+    for (i = n; i > 0; i--) page_free(bench_ptrs[i - 1]);
+    print_per_op("page_alloc(0)+free:   ", rdtsc() - t0, n);
+
+    /* order 0-3 를 섞어 할당하고 절반을 무작위로 풀어 단편화를 만든다 */
+    for (n = 0; n < MEM_BENCH_OPS / 4; n++) {
+        seed = seed * 1103515245 + 12345;
+        bench_order[n] = (uint8)((seed >> 16) & 3);
+        if ((bench_ptrs[n] = page_alloc(bench_order[n])) == 0) break;
+    }
+    for (i = 0; i < n; i++) {
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) & 1) { page_free(bench_ptrs[i]); bench_ptrs[i] = 0; }
+    }
+    kprint("mixed orders, half freed: ");
+    kprint_dec(mem_stats.nr_free[0]); kprint(" order-0 / ");
+    kprint_dec(mem_stats.nr_free[1] + mem_stats.nr_free[2]); kprint(" order-1..2 free blocks\n");
+    for (i = 0; i < n; i++) if (bench_ptrs[i]) page_free(bench_ptrs[i]);
+    kprint("all freed, pages restored: ");
+    kprint(mem_stats.free_pages == before ? "yes\n" : "NO\n");
+
+    t0 = rdtsc();
+    for (i = 0; i < MEM_BENCH_OPS; i++) bench_ptrs[i] = kmalloc(32);
+    for (i = 0; i < MEM_BENCH_OPS; i++) kfree(bench_ptrs[i]);
+    print_per_op("kmalloc(32)+kfree:    ", rdtsc() - t0, MEM_BENCH_OPS);
+
+    t0 = rdtsc();
+    for (i = 0; i < MEM_BENCH_OPS; i++) {
+        seed = seed * 1103515245 + 12345;
+        bench_ptrs[i] = kmalloc(16 + (seed >> 16) % 2033);
+    }
+    for (i = 0; i < MEM_BENCH_OPS; i++) kfree(bench_ptrs[i]);
+    print_per_op("kmalloc(16..2048):    ", rdtsc() - t0, MEM_BENCH_OPS);
+
+    bench_cache("file_entry cache:     ", file_entry_cache, MEM_BENCH_OPS);
+    bench_cache("process_t cache:      ", process_cache, MEM_BENCH_OPS);
+    bench_cache("packet cache:         ", packet_cache, MEM_BENCH_OPS / 4);
+}
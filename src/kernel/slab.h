@@ -0,0 +1,46 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include "dc.h"
+#include "spinlock.h"
+
+/*
+ * 크기가 같은 커널 객체의 캐시. slab 하나는 buddy 에서 받은 2^order 페이지이고
+ * 맨 앞에 slab_t 헤더, 그 뒤에 객체들이 놓인다. 빈 객체는 slab 안에서 연결 리스트.
+ */
+typedef struct slab {
+    struct slab *next;
+    struct slab *prev;
+    struct kmem_cache *cache;
+    void *free;           /* 빈 객체 리스트 */
+    uint32 inuse;
+} slab_t;
+
+typedef struct kmem_cache {
+    spinlock_t lock;      /* 캐시마다 따로 잠가 CPU 끼리 다른 크기를 동시에 할당한다 */
+    const char *name;
+    uint32 obj_size;      /* 8 바이트 단위로 올림 */
+    uint32 order;         /* slab 하나의 페이지 order */
+    uint32 per_slab;
+    slab_t *partial;
+    slab_t *full;
+    slab_t *empty;        /* 하나만 남기고 buddy 로 돌려준다 */
+    uint32 slabs;
+    uint32 active;
+    uint32 allocs;
+    uint32 frees;
+} kmem_cache_t;
+
+void slab_init();
+kmem_cache_t *kmem_cache_create(const char *name, uint32 size);
+void *kmem_cache_alloc(kmem_cache_t *cache);
+void kmem_cache_free(kmem_cache_t *cache, void *obj);
+
+/* 2048 바이트까지는 크기별 slab, 그보다 크면 buddy 페이지 */
+void *kmalloc(uint32 size);
+void kfree(void *ptr);
+
+void slab_stat_cmd();
+void mem_bench_cmd();
+
+#endif //SLAB_H
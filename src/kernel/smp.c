@@ -0,0 +1,309 @@
+#include "smp.h"
+#include "paging.h"
+#include "mm.h"
+#include "idt.h"
+#include "timer.h"
+#include "kprint.h"
+#include "type.h"
+#include "cpu.h"
+
+/*=========================*/
+/* 16. SMP (LAPIC, AP 부팅) */
+/*=========================*/
+/*
+ * BSP 는 부팅을 마친 뒤 INIT-SIPI-SIPI 를 "자신을 뺀 모두" 에게 보낸다 (MADT 를 읽지 않음).
+ * AP 는 AP_TRAMPOLINE 에 복사된 실모드 코드에서 보호 모드, 페이징을 켜고
+ * 번호를 하나 받아 ap_main 으로 들어간 뒤 그 CPU 의 idle 이 된다.
+ * PIC 인터럽트는 BSP 로만 오므로 AP 의 스케줄러 틱은 LAPIC 타이머가 만든다.
+ */
+#define IA32_APIC_BASE_MSR  0x1B
+
+#define LAPIC_ID            0x020
+#define LAPIC_TPR           0x080
+#define LAPIC_EOI           0x0B0
+#define LAPIC_SVR           0x0F0
+#define LAPIC_ICR_LOW       0x300
+#define LAPIC_ICR_HIGH      0x310
+#define LAPIC_LVT_TIMER     0x320
+#define LAPIC_TIMER_INIT    0x380
+#define LAPIC_TIMER_CUR     0x390
+#define LAPIC_TIMER_DIV     0x3E0
+
+#define LAPIC_SVR_ENABLE    0x100
+#define LAPIC_ICR_PENDING   0x1000
+#define LAPIC_ICR_INIT      0x000C4500   /* 자신을 뺀 모두, INIT, assert, edge (bit 15 = 0: deassert 짝이 필요 없다) */
+#define LAPIC_ICR_SIPI      0x000C4600   /* 자신을 뺀 모두, Start-up (하위 8비트 = 시작 페이지) */
+#define LAPIC_LVT_MASKED    0x10000
+#define LAPIC_LVT_PERIODIC  0x20000
+#define LAPIC_DIV_16        0x3
+#define LAPIC_CALIBRATE_MS  10
+
+#define STR_(x) #x
+#define STR(x)  STR_(x)
+#define TRAMP(sym) STR(AP_TRAMPOLINE) " + (" #sym " - ap_trampoline_start)"
+
+cpu_t cpus[SMP_MAX_CPUS];
+uint32 smp_cpu_count = 1;
+
+static volatile uint32 *lapic = 0;
+static uint32 lapic_base = 0;
+static uint32 lapic_ticks_per_ms = 0;
+static uint8 apic_to_cpu[256];
+
+/* 트램폴린이 읽는다: 받아 갈 번호와 번호별 스택 꼭대기 */
+volatile uint32 ap_next_index = 0;
+uint32 ap_stacks[SMP_MAX_CPUS];
+
+void ap_main(uint32 index);
+
+/*
+ * AP 시작 코드. SIPI 는 CS = AP_TRAMPOLINE >> 4, IP = 0 에서 시작하므로
+ * 복사된 위치 기준의 절대 주소만 쓴다 (TRAMP). 페이징을 켠 뒤에는 identity 매핑
+ * (paging_boot_identity) 위에서 돌다가 간접 call 로 higher half 의 ap_main 에 들어간다.
+ */
+__asm__(
+    ".pushsection .rodata\n"
+    ".globl ap_trampoline_start\n"
+    ".globl ap_trampoline_end\n"
+    ".balign 16\n"
+    ".code16\n"
+    "ap_trampoline_start:\n"
+    "  cli\n"
+    "  xorw %ax, %ax\n"
+    "  movw %ax, %ds\n"
+    "  lgdtl " TRAMP(ap_tr_gdt_ptr) "\n"
+    "  movl %cr0, %eax\n"
+    "  orl $1, %eax\n"
+    "  movl %eax, %cr0\n"
+    "  ljmpl $0x08, $(" TRAMP(ap_tr_32) ")\n"
+    ".code32\n"
+    "ap_tr_32:\n"
+    "  movw $0x10, %ax\n"
+    "  movw %ax, %ds\n"
+    "  movw %ax, %es\n"
+    "  movw %ax, %fs\n"
+    "  movw %ax, %gs\n"
+    "  movw %ax, %ss\n"
+    "  movl " TRAMP(ap_tr_cr4) ", %eax\n"
+    "  movl %eax, %cr4\n"
+    "  movl " TRAMP(ap_tr_cr3) ", %eax\n"
+    "  movl %eax, %cr3\n"
+    "  movl %cr0, %eax\n"
+    "  orl $0x80000000, %eax\n"
+    "  movl %eax, %cr0\n"
+    "  movl $1, %eax\n"
+    "  lock xaddl %eax, ap_next_index\n"
+    "  incl %eax\n"
+    "  cmpl $" STR(SMP_MAX_CPUS) ", %eax\n"
+    "  jae 1f\n"
+    "  movl ap_stacks(,%eax,4), %esp\n"
+    "  testl %esp, %esp\n"
+    "  jz 1f\n"
+    "  pushl %eax\n"
+    "  movl $ap_main, %ecx\n"
+    "  call *%ecx\n"
+    "1:\n"
+    "  cli\n"
+    "  hlt\n"
+    "  jmp 1b\n"
+    ".balign 8\n"
+    "ap_tr_gdt:\n"
+    "  .quad 0\n"
+    "  .quad 0x00CF9A000000FFFF\n"
+    "  .quad 0x00CF92000000FFFF\n"
+    "ap_tr_gdt_ptr:\n"
+    "  .word 23\n"
+    "  .long " TRAMP(ap_tr_gdt) "\n"
+    "ap_tr_cr3:\n"
+    "  .long 0\n"
+    "ap_tr_cr4:\n"
+    "  .long 0\n"
+    "ap_trampoline_end:\n"
+    ".popsection\n"
+);
+
+extern const uint8 ap_trampoline_start[], ap_trampoline_end[];
+extern const uint8 ap_tr_cr3[], ap_tr_cr4[];
+
+static inline uint32 lapic_read(uint32 reg) {
+    return lapic[reg >> 2];
+}
+
+static inline void lapic_write(uint32 reg, uint32 value) {
+    lapic[reg >> 2] = value;
+}
+
+cpu_t *this_cpu() {
+    if (!lapic) return &cpus[0];
+    return &cpus[apic_to_cpu[lapic_read(LAPIC_ID) >> 24]];
+}
+
+void lapic_eoi() {
+    if (lapic) lapic_write(LAPIC_EOI, 0);
+}
+
+static void lapic_enable() {
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+}
+
+/* LAPIC 타이머 클록은 CPU 마다 같으므로 BSP 에서 한 번만 잰다 */
+static void lapic_calibrate() {
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+    timer_delay_us(LAPIC_CALIBRATE_MS * 1000);
+    lapic_ticks_per_ms = (0xFFFFFFFF - lapic_read(LAPIC_TIMER_CUR)) / LAPIC_CALIBRATE_MS;
+    lapic_write(LAPIC_TIMER_INIT, 0);
+}
+
+static void lapic_timer_start() {
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_PERIODIC | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, lapic_ticks_per_ms * 1000 / SCHED_HZ);
+}
+
+static void lapic_timer_irq(interrupt_frame_t *frame) {
+    (void)frame;
+    sched_tick();
+}
+
+static void lapic_send_ipi(uint32 icr) {
+    lapic_write(LAPIC_ICR_HIGH, 0);
+    lapic_write(LAPIC_ICR_LOW, icr);
+    while (lapic_read(LAPIC_ICR_LOW) & LAPIC_ICR_PENDING) cpu_relax();
+}
+
+/* 복사된 트램폴린 안에서 sym 의 커널 주소 */
+static uint32 *trampoline_slot(const uint8 *sym) {
+    return (uint32*)((uint8*)phys_to_virt(AP_TRAMPOLINE) + (sym - ap_trampoline_start));
+}
+
+/* 트램폴린에서 들어온다. 부팅 스택이 그대로 이 CPU 의 idle 스택이 된다 */
+void ap_main(uint32 index) {
+    cpu_t *cpu = &cpus[index];
+    gdt_load();
+    idt_load();
+    cpu->apic_id = lapic_read(LAPIC_ID) >> 24;
+    apic_to_cpu[cpu->apic_id] = (uint8)index;
+    lapic_enable();
+    lapic_timer_start();
+    sched_ap_enter(cpu);
+}
+
+/* 셸이 어떤 프로세스도 만들기 전에 불러야 한다: LAPIC 매핑이 이후 주소 공간에 복사된다 */
+void smp_init() {
+    uint32 a, b, c, d, i;
+    uint8 *stack;
+
+    cpu_cpuid(1, &a, &b, &c, &d);
+    if (!(d & (1u << 9))) {
+        kprint("SMP: no local APIC, running on one CPU.\n");
+        return;
+    }
+    lapic_base = (uint32)cpu_rdmsr(IA32_APIC_BASE_MSR) & 0xFFFFF000;
+    if ((lapic = (volatile uint32*)paging_map_mmio(lapic_base)) == 0) {
+        kprint("SMP: local APIC overlaps the kernel map, running on one CPU.\n");
+        return;
+    }
+    cpus[0].apic_id = lapic_read(LAPIC_ID) >> 24;
+    apic_to_cpu[cpus[0].apic_id] = 0;
+    lapic_enable();
+    lapic_calibrate();
+    isr_register(LAPIC_TIMER_VECTOR, lapic_timer_irq);
+
+    for (i = 1; i < SMP_MAX_CPUS; i++) {
+        cpus[i].id = i;
+        stack = (uint8*)page_alloc(AP_STACK_ORDER);
+        ap_stacks[i] = stack ? (uint32)stack + ((uint32)PAGE_SIZE << AP_STACK_ORDER) : 0;
+    }
+    memcpy(phys_to_virt(AP_TRAMPOLINE), ap_trampoline_start, ap_trampoline_end - ap_trampoline_start);
+    *trampoline_slot(ap_tr_cr3) = as_kernel();
+    *trampoline_slot(ap_tr_cr4) = cpu_read_cr4();
+
+    paging_boot_identity(1);
+    lapic_send_ipi(LAPIC_ICR_INIT);
+    timer_delay_us(10000);
+    for (i = 0; i < 2; i++) {
+        lapic_send_ipi(LAPIC_ICR_SIPI | (AP_TRAMPOLINE >> 12));
+        timer_delay_us(200);
+    }
+    timer_delay_us(SMP_AP_WAIT_MS * 1000);
+    paging_boot_identity(0);
+
+    /* 번호는 도착 순서대로 1 부터 빈틈없이 나간다 */
+    for (i = 1; i < SMP_MAX_CPUS && cpus[i].online; i++);
+    smp_cpu_count = i;
+    kprint("SMP: ");
+    kprint_dec(smp_cpu_count);
+    kprint(smp_cpu_count == 1 ? " CPU online\n" : " CPUs online\n");
+}
+
+/*=========================*/
+/* cpus / smpbench */
+/*=========================*/
+void smp_info_cmd() {
+    uint32 i;
+    kprint("Local APIC: ");
+    if (!lapic) {
+        kprint("not used\n");
+    } else {
+        kprint_hex(lapic_base);
+        kprint(", timer ");
+        kprint_dec(lapic_ticks_per_ms);
+        kprint(" ticks/ms (div 16)\n");
+    }
+    kprint("CPU  APIC  Current  Queued  Ticks  Switches  Steals\n");
+    for (i = 0; i < smp_cpu_count; i++) {
+        cpu_t *cpu = &cpus[i];
+        kprint_dec(i); kprint("    ");
+        kprint_dec(cpu->apic_id); kprint("     ");
+        if (cpu->current == &cpu->idle) kprint("idle");
+        else kprint_dec(cpu->current ? (uint32)cpu->current->pid : 0);
+        kprint("      ");
+        kprint_dec(cpu->nr_queued); kprint("       ");
+        kprint_dec(cpu->stats.ticks); kprint("  ");
+        kprint_dec(cpu->stats.switches); kprint("  ");
+        kprint_dec(cpu->stats.steals); kprint("\n");
+    }
+}
+
+static volatile uint32 bench_iters;
+static volatile uint32 bench_sink;
+
+/* 메모리를 건드리지 않는 계산만 하므로 CPU 수만큼 빨라져야 한다 */
+static void bench_worker() {
+    uint32 i, x = 1, n = bench_iters;
+    for (i = 0; i < n; i++) x = x * 1103515245 + 12345;
+    __sync_fetch_and_add(&bench_sink, x);
+}
+
+/* 같은 총 작업량을 k 개로 나눠 k 개 CPU 에서 돌린다 (k = 1..max_cpus) */
+void smp_bench_cmd(uint32 max_cpus) {
+    uint32 k, i, ms, base_ms = 0, speedup;
+    uint64 start;
+    if (max_cpus == 0 || max_cpus > smp_cpu_count) max_cpus = smp_cpu_count;
+    kprint("CPUs  Time(ms)  Speedup\n");
+    for (k = 1; k <= max_cpus; k++) {
+        sched_set_cpu_limit(k);
+        bench_iters = SMP_BENCH_WORK / k;
+        start = rdtsc();
+        for (i = 0; i < k; i++) {
+            if (create_process(bench_worker) < 0) {
+                kprint("smpbench: no free process slot\n");
+                break;
+            }
+        }
+        process_wait_all();
+        ms = cycles_to_us(rdtsc() - start) / 1000;
+        if (ms == 0) ms = 1;
+        if (k == 1) base_ms = ms;
+        speedup = base_ms * 100 / ms;
+        kprint_dec(k); kprint("     ");
+        kprint_dec(ms); kprint("      ");
+        kprint_dec(speedup / 100); kprint(".");
+        if (speedup % 100 < 10) kprint("0");
+        kprint_dec(speedup % 100); kprint("x\n");
+    }
+    sched_set_cpu_limit(SMP_MAX_CPUS);
+}
@@ -0,0 +1,43 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include "dc.h"
+#include "process.h"
+#include "spinlock.h"
+
+/*
+ * CPU 별 자료. 스케줄러는 자기 CPU 의 run queue 만 잠그고,
+ * 큐가 비면 다른 CPU 의 큐에서 프로세스를 훔쳐 온다.
+ */
+typedef struct cpu {
+    uint32 id;                     /* cpus[] 번호, 0 = BSP */
+    uint32 apic_id;
+    volatile uint32 online;
+    process_t *current;
+    process_t *prev;               /* 방금 내려온 프로세스 (finish_switch 가 on_cpu 를 푼다) */
+    process_t *dead;               /* 전환 뒤 스택을 풀 종료 프로세스 */
+    process_t idle;                /* 실행할 것이 없을 때 hlt (AP 는 부팅 스택 그대로) */
+    volatile uint32 need_resched;
+    spinlock_t rq_lock;
+    process_t *run_head[SCHED_PRIORITIES];
+    process_t *run_tail[SCHED_PRIORITIES];
+    uint32 run_bitmap;             /* 비트 i: 우선순위 i 큐가 비어 있지 않음 */
+    volatile uint32 nr_queued;     /* 큐에 걸린 프로세스 수 (잠그지 않고 읽는 힌트) */
+    uint64 switch_stamp;           /* 마지막 전환 시각 (runtime 계산) */
+    sched_stats_t stats;
+} cpu_t;
+
+extern cpu_t cpus[SMP_MAX_CPUS];
+extern uint32 smp_cpu_count;
+
+cpu_t *this_cpu();
+void smp_init();
+void lapic_eoi();
+
+/* process.c: AP 가 부팅을 마치고 idle 로 들어간다 (돌아오지 않음) */
+void sched_ap_enter(cpu_t *cpu);
+
+void smp_info_cmd();
+void smp_bench_cmd(uint32 max_cpus);
+
+#endif //SMP_H
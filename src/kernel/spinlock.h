@@ -0,0 +1,47 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include "dc.h"
+#include "cpu.h"
+
+/*
+ * 티켓 락: 번호표 (next) 를 원자적으로 뽑고 owner 가 그 번호가 될 때까지 돈다.
+ * 기다린 순서대로 들어가므로 CPU 가 늘어도 한 CPU 만 계속 밀리는 일이 없다.
+ * IRQ 핸들러와 함께 쓰는 자료는 _irqsave 판을 쓴다 (같은 CPU 에서의 재진입 방지).
+ */
+typedef struct {
+    volatile uint32 next;
+    volatile uint32 owner;
+} spinlock_t;
+
+#define SPINLOCK_INIT  { 0, 0 }
+
+static inline void spin_lock(spinlock_t *lock) {
+    uint32 ticket = __sync_fetch_and_add(&lock->next, 1);
+    while (lock->owner != ticket) cpu_relax();
+    __asm__ volatile ("" ::: "memory");
+}
+
+/* 아무도 잡지 않았을 때만 번호표를 뽑는다. 성공하면 1 */
+static inline int spin_trylock(spinlock_t *lock) {
+    uint32 owner = lock->owner;
+    return __sync_bool_compare_and_swap(&lock->next, owner, owner + 1);
+}
+
+static inline void spin_unlock(spinlock_t *lock) {
+    __asm__ volatile ("" ::: "memory");
+    lock->owner++;
+}
+
+static inline uint32 spin_lock_irqsave(spinlock_t *lock) {
+    uint32 flags = irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *lock, uint32 flags) {
+    spin_unlock(lock);
+    irq_restore(flags);
+}
+
+#endif //SPINLOCK_H
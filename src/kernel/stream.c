@@ -0,0 +1,176 @@
+#include "dc.h"
+#include "stream.h"
+#include "table.h"
+#include "file.h"
+#include "type.h"
+#include "cache.h"
+
+/*=========================*/
+/* 5-2. 스트리밍 파일 I/O */
+/*=========================*/
+
+/*
+ * 파일 핸들: 파일 테이블 슬롯과 현재 위치.
+ * file_map() 은 블록 캐시 안의 연속 구간을 그대로 돌려주므로
+ * 호출자는 파일 전체를 스택 버퍼로 복사하지 않고 조각 단위로 읽는다.
+ *
+ * read-ahead: 핸들마다 마지막으로 읽은 구간을 기억해 그 구간 안이나 바로 다음
+ * 블록을 읽으면 순차로 본다. 순차 읽기가 미리 읽은 구간의 절반을 지나면
+ * 다음 창을 한 번에 요청하고 창을 두 배로 키운다 (RA_MAX_BLOCKS 까지).
+ * 다른 곳으로 건너뛰면 창을 처음 크기로 되돌리고 prefetch 를 멈춘다.
+ */
+typedef struct {
+    int in_use;
+    int idx;
+    uint32 offset;
+    uint32 flags;
+    uint32 ra_prev;      /* 마지막으로 읽은 구간의 첫 파일 블록 */
+    uint32 ra_last;      /* 마지막으로 읽은 구간의 끝 파일 블록 */
+    uint32 ra_end;       /* 이 파일 블록 앞까지 prefetch 를 요청함 */
+    uint32 ra_window;    /* 다음에 요청할 블록 수 */
+    int ra_seq;          /* 지금 순차 읽기 중인지 */
+} file_handle_t;
+
+static file_handle_t handles[MAX_OPEN_FILES];
+
+/* 실행 파일을 이어 붙일 곳 (스택 대신 정적 영역) */
+static uint8 image_buffer[FILE_IMAGE_MAX];
+
+/* 핸들이 가리키는 슬롯이 그 사이 지워졌으면 0 */
+static file_handle_t *handle_get(int fh) {
+    if (fh < 0 || fh >= MAX_OPEN_FILES || !handles[fh].in_use) return 0;
+    if (file_table[handles[fh].idx].in_use != FILE_ENTRY_FILE) return 0;
+    return &handles[fh];
+}
+
+static void readahead(file_handle_t *h) {
+    const KnixFS_Inode *inode = &file_table[h->idx].inode;
+    uint32 block = h->offset / BLOCK_SIZE;
+    uint32 blocks = (inode->size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    if (block >= blocks) return;
+    if (block >= h->ra_prev && block <= h->ra_last + 1) {
+        ra_stats.sequential++;
+        if (!h->ra_seq || block + h->ra_window / 2 >= h->ra_end) {
+            uint32 start = h->ra_end > block ? h->ra_end : block;
+            if (start < blocks) {
+                uint32 count = h->ra_window < blocks - start ? h->ra_window : blocks - start;
+                knixfs_prefetch(inode, start, count);
+                h->ra_end = start + count;
+                if (h->ra_window > ra_stats.window_max) ra_stats.window_max = h->ra_window;
+                if (h->ra_window < RA_MAX_BLOCKS) h->ra_window *= 2;
+            }
+        }
+        h->ra_seq = 1;
+    } else {
+        ra_stats.random++;
+        h->ra_seq = 0;
+        h->ra_window = RA_MIN_BLOCKS;
+        h->ra_end = block;
+    }
+    h->ra_prev = block;
+}
+
+/* 이번에 읽은 (map 한) 구간의 끝을 기록 */
+static void readahead_done(file_handle_t *h, uint32 len) {
+    uint32 end = h->offset + len;
+    h->ra_last = end > 0 ? (end - 1) / BLOCK_SIZE : 0;
+}
+
+int file_open(const char *path, uint32 flags) {
+    int fh, idx;
+    for (fh = 0; fh < MAX_OPEN_FILES; fh++) {
+        if (!handles[fh].in_use) break;
+    }
+    if (fh == MAX_OPEN_FILES) return -1;
+    idx = find_file_index(path);
+    if (idx == -1 && (flags & FILE_OPEN_CREATE))
+        idx = create_file(path, (const uint8*)"", 0);
+    if (idx == -1 || file_is_dir(idx)) return -1;
+    handles[fh].in_use = 1;
+    handles[fh].idx = idx;
+    handles[fh].offset = 0;
+    handles[fh].flags = flags;
+    /* 처음부터 읽는 것은 순차 읽기의 시작으로 본다 */
+    handles[fh].ra_prev = 0;
+    handles[fh].ra_last = 0;
+    handles[fh].ra_end = 0;
+    handles[fh].ra_window = RA_MIN_BLOCKS;
+    handles[fh].ra_seq = 0;
+    return fh;
+}
+
+void file_close(int fh) {
+    if (fh >= 0 && fh < MAX_OPEN_FILES) handles[fh].in_use = 0;
+}
+
+int file_read(int fh, uint8 *buffer, uint32 len) {
+    file_handle_t *h = handle_get(fh);
+    if (!h || !(h->flags & FILE_OPEN_READ)) return -1;
+    readahead(h);
+    int n = knixfs_read_at(&file_table[h->idx].inode, h->offset, buffer, len);
+    if (n < 0) return -1;   /* 짧은 읽기와 구별: 호출자가 파일 끝으로 여기지 않게 */
+    readahead_done(h, (uint32)n);
+    h->offset += (uint32)n;
+    return n;
+}
+
+int file_write(int fh, const uint8 *data, uint32 len) {
+    file_handle_t *h = handle_get(fh);
+    if (!h || !(h->flags & FILE_OPEN_WRITE)) return -1;
+    if (h->flags & FILE_OPEN_APPEND) h->offset = file_table[h->idx].inode.size;
+    int n = knixfs_write_at(&file_table[h->idx].inode, h->offset, data, len);
+    if (n < 0) return -1;
+    file_entry_dirty(h->idx);
+    cache_op_end();
+    h->offset += (uint32)n;
+    return n;
+}
+
+int file_seek(int fh, uint32 offset) {
+    file_handle_t *h = handle_get(fh);
+    if (!h || offset > file_table[h->idx].inode.size) return -1;
+    h->offset = offset;
+    return 0;
+}
+
+uint32 file_tell(int fh) {
+    file_handle_t *h = handle_get(fh);
+    return h ? h->offset : 0;
+}
+
+uint32 file_size(int fh) {
+    file_handle_t *h = handle_get(fh);
+    return h ? file_table[h->idx].inode.size : 0;
+}
+
+/*
+ * 현재 위치부터 연속된 구간을 복사 없이 돌려준다 (위치는 옮기지 않음).
+ * 포인터는 다음 파일 시스템 접근 전까지만 유효하다 (블록이 캐시 풀에서 밀려날 수 있음).
+ */
+const uint8 *file_map(int fh, uint32 *len) {
+    file_handle_t *h = handle_get(fh);
+    *len = 0;
+    if (!h || !(h->flags & FILE_OPEN_READ)) return 0;
+    readahead(h);
+    const uint8 *p = knixfs_map(&file_table[h->idx].inode, h->offset, len);
+    readahead_done(h, *len);
+    return p;
+}
+
+/*
+ * 실행용으로 파일 전체를 연속된 메모리로 본다.
+ * 데이터 블록은 캐시 풀에서 언제든 밀려날 수 있으므로 실행 중에도 남아 있도록
+ * 항상 image_buffer 로 복사한다 (다음 호출 때 덮어씀). 복사 전에 전체를 prefetch.
+ */
+const uint8 *file_image(int fh, uint32 *size) {
+    file_handle_t *h = handle_get(fh);
+    *size = 0;
+    if (!h || !(h->flags & FILE_OPEN_READ)) return 0;
+    const KnixFS_Inode *inode = &file_table[h->idx].inode;
+    if (inode->size == 0 || inode->size > sizeof(image_buffer)) return 0;
+    knixfs_prefetch(inode, 0, (inode->size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    int n = knixfs_read_at(inode, 0, image_buffer, inode->size);
+    if (n < 0 || n != (int)inode->size) return 0;   /* 검증 실패는 잘린 이미지로 실행하지 않는다 */
+    *size = inode->size;
+    return image_buffer;
+}
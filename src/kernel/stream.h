@@ -0,0 +1,22 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "dc.h"
+
+/* file_open() flags */
+#define FILE_OPEN_READ    0x1
+#define FILE_OPEN_WRITE   0x2
+#define FILE_OPEN_CREATE  0x4   /* 없으면 빈 파일을 만든다 */
+#define FILE_OPEN_APPEND  0x8   /* 쓰기 전 항상 파일 끝으로 이동 */
+
+int file_open(const char *path, uint32 flags);
+void file_close(int fh);
+int file_read(int fh, uint8 *buffer, uint32 len);
+int file_write(int fh, const uint8 *data, uint32 len);
+int file_seek(int fh, uint32 offset);
+uint32 file_tell(int fh);
+uint32 file_size(int fh);
+const uint8 *file_map(int fh, uint32 *len);
+const uint8 *file_image(int fh, uint32 *size);
+
+#endif //STREAM_H
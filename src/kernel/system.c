@@ -1,6 +1,8 @@
 #include "system.h"
 #include "kprint.h"
 #include "io.h"
+#include "cache.h"
+#include "serial.h"
 
 
 void sysinfo() {
@@ -11,6 +13,8 @@ void sysinfo() {
 
 void reboot_system() {
     kprint("Rebooting system...\n");
+    cache_sync();
+    serial_flush();   /* 링에 남은 출력을 먼저 내보낸다 */
 
     // x86 아키텍처에서 키보드 컨트롤러를 이용한 소프트 리부트
     unsigned char good = 0x02;
@@ -23,6 +27,8 @@ void reboot_system() {
 
 void shutdown_system() {
     kprint("Shutting down system...\n");
+    cache_sync();
+    serial_flush();   /* 링에 남은 출력을 먼저 내보낸다 */
 
     // ACPI를 통한 시스템 종료 (x86 환경에서 사용 가능)
     outw(0xB004, 0x2000);  // Bochs, QEMU에서 동작
@@ -3,6 +3,11 @@
 #include "disk.h"
 #include "type.h"
 #include "file.h"
+#include "cache.h"
+#include "kprint.h"
+#include "cpu.h"
+#include "timer.h"
+#include "dir.h"
 
 /*=========================*/
 /* 5. File Table & Operations */
@@ -10,118 +15,467 @@
 
 FileEntry file_table[MAX_FILES];
 
+typedef char file_table_fits_on_disk[(sizeof(file_table) <= DISK_FILETABLE_SECTOR_COUNT * BLOCK_SIZE) ? 1 : -1];
+
+/*
+ * 메모리 전용 인덱스 (디스크에는 저장하지 않고 로드 시 다시 만든다)
+ *  - free_head/free_next: 빈 슬롯 스택
+ *  - used_head/used_next/used_prev: 사용 중 슬롯 목록
+ * 이름 조회는 디렉터리와 dentry 캐시(dir.c)가 맡는다.
+ */
+static int free_head = -1;
+static int free_next[MAX_FILES];
+static int used_head = -1;
+static int used_next[MAX_FILES];
+static int used_prev[MAX_FILES];
+static uint32 used_count = 0;
+
+static void index_insert(int idx) {
+    used_prev[idx] = -1;
+    used_next[idx] = used_head;
+    if (used_head != -1) used_prev[used_head] = idx;
+    used_head = idx;
+    used_count++;
+}
+
+static void index_remove(int idx) {
+    if (used_prev[idx] != -1) used_next[used_prev[idx]] = used_next[idx];
+    else used_head = used_next[idx];
+    if (used_next[idx] != -1) used_prev[used_next[idx]] = used_prev[idx];
+    used_count--;
+}
+
+static int slot_alloc() {
+    int idx = free_head;
+    if (idx != -1) free_head = free_next[idx];
+    return idx;
+}
+
+static void slot_free(int idx) {
+    free_next[idx] = free_head;
+    free_head = idx;
+}
+
+/* 테이블 내용으로부터 인덱스와 빈 슬롯 목록을 다시 만든다 */
+static void rebuild_index() {
+    int i;
+    free_head = -1;
+    used_head = -1;
+    used_count = 0;
+    /* 낮은 번호 슬롯부터 재사용되도록 역순으로 push */
+    for (i = MAX_FILES - 1; i >= 0; i--) {
+        if (file_table[i].in_use) index_insert(i);
+        else slot_free(i);
+    }
+    dir_init();
+}
+
+static void set_entry_name(int idx, const char *name) {
+    uint32 j;
+    for (j = 0; j < MAX_FILENAME_LEN - 1 && name[j]; j++)
+        file_table[idx].name[j] = name[j];
+    file_table[idx].name[j] = '\0';
+}
+
+/* 빈 디렉터리 슬롯을 만든다. parent == -1 이면 루트 (".." 가 자기 자신) */
+static int new_directory(const char *name, int parent) {
+    int idx = slot_alloc();
+    if (idx == -1) return -1;
+    set_entry_name(idx, name);
+    file_table[idx].mode = 755;
+    file_table[idx].owner = 0;
+    knixfs_init_inode(&file_table[idx].inode);
+    file_table[idx].in_use = FILE_ENTRY_DIR;
+    index_insert(idx);
+    if (dir_create(idx, parent == -1 ? idx : parent) != 0) {
+        index_remove(idx);
+        file_table[idx].in_use = FILE_ENTRY_FREE;
+        slot_free(idx);
+        return -1;
+    }
+    file_entry_dirty(idx);
+    return idx;
+}
+
 void init_file_table() {
     uint32 i;
     for (i = 0; i < MAX_FILES; i++) {
-        file_table[i].in_use = 0;
+        memset(file_table[i].name, 0, MAX_FILENAME_LEN);
+        file_table[i].in_use = FILE_ENTRY_FREE;
         file_table[i].mode = 644;
         file_table[i].owner = 0;
+        knixfs_init_inode(&file_table[i].inode);
     }
+    rebuild_index();
+    fs_set_root_dir(new_directory("/", -1));
 }
 
+/* 전체 테이블 기록 (초기화 시). 개별 변경은 file_entry_dirty()로 표시한다. */
 int save_file_table() {
+    cache_register(DISK_FILETABLE_START_SECTOR, file_table, sizeof(file_table));
+    cache_mark_region_dirty(DISK_FILETABLE_START_SECTOR);
+    return cache_sync();
+}
+
+/*
+ * 이전 포맷 이미지 변환
+ *  - v1: 직접 블록 inode -> extent inode
+ *  - v1/v2: 테이블은 FILETABLE_V2_ENTRIES 개뿐이었으므로 나머지 슬롯은 비운다
+ */
+static void migrate_file_table(uint32 version) {
     uint32 i;
-    uint8 *ptr = (uint8*)file_table;
-    for (i = 0; i < DISK_FILETABLE_SECTOR_COUNT; i++) {
-        int ret = disk_write(DISK_FILETABLE_START_SECTOR + i, ptr + i * BLOCK_SIZE, 1);
-        if (ret != 0) return -1;
+    for (i = 0; i < MAX_FILES; i++) {
+        if (i >= FILETABLE_V2_ENTRIES) {
+            memset(&file_table[i], 0, sizeof(FileEntry));
+            file_table[i].mode = 644;
+            knixfs_init_inode(&file_table[i].inode);
+        } else if (!file_table[i].in_use) {
+            if (version < KNIXFS_VERSION_EXTENT) knixfs_init_inode(&file_table[i].inode);
+        } else if (version < KNIXFS_VERSION_EXTENT &&
+                   knixfs_migrate_inode(&file_table[i].inode) != 0) {
+            kprint("Migration failed, dropping file: ");
+            kprint(file_table[i].name); kprint("\n");
+            file_table[i].in_use = FILE_ENTRY_FREE;
+            knixfs_init_inode(&file_table[i].inode);
+        }
     }
-    return 0;
+    cache_mark_region_dirty(DISK_FILETABLE_START_SECTOR);
 }
 
-int load_file_table() {
-    uint32 i;
-    uint8 *ptr = (uint8*)file_table;
-    for (i = 0; i < DISK_FILETABLE_SECTOR_COUNT; i++) {
-        int ret = disk_read(DISK_FILETABLE_START_SECTOR + i, ptr + i * BLOCK_SIZE, 1);
-        if (ret != 0) return -1;
+/* v3 이하: 평면 이름 공간의 파일을 모두 새 루트 디렉터리에 넣는다 */
+static int migrate_to_directories() {
+    int i, root;
+    for (i = file_table_first(); i != -1; i = file_table_next(i))
+        file_table[i].in_use = FILE_ENTRY_FILE;
+    root = new_directory("/", -1);
+    if (root == -1) return -1;
+    for (i = file_table_first(); i != -1; i = file_table_next(i)) {
+        if (i == root) continue;
+        if (dir_add_entry(root, file_table[i].name, i) != 0) return -1;
     }
+    fs_set_root_dir(root);
     return 0;
 }
 
-int find_file_index(const char *name) {
-    uint32 i;
-    for (i = 0; i < MAX_FILES; i++) {
-        if (file_table[i].in_use && strcmp(file_table[i].name, name) == 0)
-            return (int)i;
+/* v4 이하: djb2 해시를 CRC32C 로 바꾸고 블록별 CRC 테이블을 채운다 */
+static void migrate_to_crc() {
+    int i;
+    for (i = file_table_first(); i != -1; i = file_table_next(i)) {
+        if (file_table[i].in_use != FILE_ENTRY_FILE) continue;
+        knixfs_rehash(&file_table[i].inode);
+        file_entry_dirty(i);
     }
-    return -1;
 }
 
-int create_file(const char *name, const uint8 *data, uint32 size) {
-    if (find_file_index(name) != -1) return -1;
-    uint32 i, j;
-    for (i = 0; i < MAX_FILES; i++) {
-        if (!file_table[i].in_use) {
-            file_table[i].in_use = 1;
-            for (j = 0; j < MAX_FILENAME_LEN - 1 && name[j]; j++)
-                file_table[i].name[j] = name[j];
-            file_table[i].name[j] = '\0';
-            file_table[i].mode = 644;
-            file_table[i].owner = 0;
-            if (knixfs_write_file(&file_table[i].inode, data, size) != 0) {
-                file_table[i].in_use = 0;
-                return -1;
-            }
-            save_file_table();
-            return (int)i;
-        }
+int load_file_table() {
+    uint32 version = fs_version();
+    if (cache_register(DISK_FILETABLE_START_SECTOR, file_table, sizeof(file_table)) != 0)
+        return -1;
+    if (cache_load(DISK_FILETABLE_START_SECTOR) != 0) return -1;
+    if (version < KNIXFS_VERSION_TABLE) migrate_file_table(version);
+    rebuild_index();
+    if (version < KNIXFS_VERSION_DIR && migrate_to_directories() != 0) return -1;
+    if (!file_is_dir(fs_root_dir())) return -1;
+    if (version < KNIXFS_VERSION_CRC) migrate_to_crc();
+    if (version != KNIXFS_VERSION) {
+        fs_set_version(KNIXFS_VERSION);
+        kprint("File system migrated to format version ");
+        kprint_dec(KNIXFS_VERSION); kprint(".\n");
     }
-    return -1;
+    return 0;
+}
+
+void file_entry_dirty(int idx) {
+    cache_mark_meta(&file_table[idx], sizeof(FileEntry));
+}
+
+/* 절대 경로 또는 현재 디렉터리 기준 상대 경로 */
+int find_file_index(const char *path) {
+    return path_resolve(path, 0, 0);
+}
+
+int file_is_dir(int idx) {
+    return idx >= 0 && idx < MAX_FILES && file_table[idx].in_use == FILE_ENTRY_DIR;
+}
+
+/* 사용 중 슬롯 순회: for (i = file_table_first(); i != -1; i = file_table_next(i)) */
+int file_table_first() {
+    return used_head;
+}
+
+int file_table_next(int idx) {
+    return used_next[idx];
 }
 
-int update_file(const char *name, const uint8 *data, uint32 size) {
-    int idx = find_file_index(name);
+uint32 file_table_count() {
+    return used_count;
+}
+
+static int valid_name(const char *name) {
+    return name[0] != '\0' && strcmp(name, ".") != 0 && strcmp(name, "..") != 0;
+}
+
+int create_file(const char *path, const uint8 *data, uint32 size) {
+    int parent;
+    char name[MAX_FILENAME_LEN];
+    if (path_resolve(path, &parent, name) != -1 || parent == -1 || !valid_name(name))
+        return -1;
+    int idx = slot_alloc();
     if (idx == -1) return -1;
-    free_file_blocks(&file_table[idx].inode);
-    if (knixfs_write_file(&file_table[idx].inode, data, size) != 0)
+    set_entry_name(idx, name);
+    file_table[idx].mode = 644;
+    file_table[idx].owner = 0;
+    /* 실패해도 이미 블록 할당/해제가 일어났으므로 연산은 닫는다 */
+    if (knixfs_write_file(&file_table[idx].inode, data, size) != 0) {
+        slot_free(idx);
+        cache_op_end();
         return -1;
-    save_file_table();
-    return 0;
+    }
+    if (dir_add_entry(parent, name, idx) != 0) {
+        free_file_blocks(&file_table[idx].inode);
+        slot_free(idx);
+        cache_op_end();
+        return -1;
+    }
+    file_table[idx].in_use = FILE_ENTRY_FILE;
+    index_insert(idx);
+    file_entry_dirty(idx);
+    cache_op_end();
+    return idx;
 }
 
-int delete_file(const char *name) {
-    int idx = find_file_index(name);
-    if (idx == -1) return -1;
+int update_file(const char *path, const uint8 *data, uint32 size) {
+    int idx = find_file_index(path);
+    if (idx == -1 || file_is_dir(idx)) return -1;
     free_file_blocks(&file_table[idx].inode);
-    file_table[idx].in_use = 0;
-    save_file_table();
+    file_entry_dirty(idx);
+    int ret = knixfs_write_file(&file_table[idx].inode, data, size);
+    cache_op_end();
+    return ret;
+}
+
+static void release_slot(int idx) {
+    free_file_blocks(&file_table[idx].inode);
+    index_remove(idx);
+    file_table[idx].in_use = FILE_ENTRY_FREE;
+    slot_free(idx);
+    file_entry_dirty(idx);
+}
+
+int delete_file(const char *path) {
+    int parent;
+    char name[MAX_FILENAME_LEN];
+    int idx = path_resolve(path, &parent, name);
+    if (idx == -1 || file_is_dir(idx)) return -1;
+    if (dir_remove_entry(parent, name) != 0) return -1;
+    release_slot(idx);
+    cache_op_end();
     return 0;
 }
 
+/*
+ * 원본을 블록 단위로 바운스 버퍼에 읽어 대상에 이어 쓴다. knixfs_map 포인터를 그대로 넘기면
+ * 대상 쪽 쓰기가 캐시 슬롯을 비우는 동안 원본 슬롯이 다른 블록으로 바뀔 수 있다.
+ */
 int copy_file(const char *src, const char *dst) {
+    static uint8 bounce[BLOCK_SIZE];
     int src_idx = find_file_index(src);
-    if (src_idx == -1) return -1;
-    uint8 buffer[BLOCK_SIZE * MAX_DIRECT_BLOCKS];
-    if (knixfs_read_file(&file_table[src_idx].inode, buffer, sizeof(buffer)) != 0)
+    if (src_idx == -1 || file_is_dir(src_idx)) return -1;
+    int dst_idx = create_file(dst, (const uint8*)"", 0);
+    if (dst_idx == -1) return -1;
+    uint32 offset = 0;
+    int len;
+    while ((len = knixfs_read_at(&file_table[src_idx].inode, offset, bounce, BLOCK_SIZE)) > 0) {
+        if (knixfs_write_at(&file_table[dst_idx].inode, offset, bounce, (uint32)len) < 0) {
+            delete_file(dst);
+            return -1;
+        }
+        offset += (uint32)len;
+    }
+    if (len < 0) {
+        delete_file(dst);
         return -1;
-    return create_file(dst, buffer, file_table[src_idx].inode.size);
+    }
+    file_entry_dirty(dst_idx);
+    cache_op_end();
+    return dst_idx;
 }
 
+/* dir 이 ancestor 자신이거나 그 아래에 있으면 1 */
+static int dir_is_within(int dir, int ancestor) {
+    int root = fs_root_dir(), depth;
+    for (depth = 0; dir != -1 && depth < MAX_FILES; depth++) {
+        if (dir == ancestor) return 1;
+        if (dir == root) return 0;
+        dir = dir_lookup(dir, "..");
+    }
+    return 0;
+}
+
+/* dst 가 기존 디렉터리면 그 안으로 같은 이름으로 옮긴다 */
 int rename_file(const char *src, const char *dst) {
-    int src_idx = find_file_index(src);
-    if (src_idx == -1) return -1;
-    if (find_file_index(dst) != -1) return -1;
-    uint32 j = 0;
-    while(j < MAX_FILENAME_LEN - 1 && dst[j]) {
-        file_table[src_idx].name[j] = dst[j];
-        j++;
-    }
-    file_table[src_idx].name[j] = '\0';
-    save_file_table();
+    int src_parent, dst_parent;
+    char src_name[MAX_FILENAME_LEN], dst_name[MAX_FILENAME_LEN];
+    int idx = path_resolve(src, &src_parent, src_name);
+    if (idx == -1 || idx == fs_root_dir() || !valid_name(src_name)) return -1;
+    int dst_idx = path_resolve(dst, &dst_parent, dst_name);
+    if (file_is_dir(dst_idx)) {
+        dst_parent = dst_idx;
+        memcpy(dst_name, src_name, MAX_FILENAME_LEN);
+        if (dir_lookup(dst_parent, dst_name) != -1) return -1;
+    } else if (dst_idx != -1) {
+        return -1;
+    }
+    if (dst_parent == -1 || !valid_name(dst_name)) return -1;
+    if (file_is_dir(idx) && dir_is_within(dst_parent, idx)) return -1;
+
+    if (dir_remove_entry(src_parent, src_name) != 0) return -1;
+    if (dir_add_entry(dst_parent, dst_name, idx) != 0) {
+        dir_add_entry(src_parent, src_name, idx);
+        return -1;
+    }
+    set_entry_name(idx, dst_name);
+    file_entry_dirty(idx);
+    if (file_is_dir(idx) && dst_parent != src_parent) {
+        /* 항목 하나를 비운 직후라 다시 추가할 때 블록 할당이 필요 없다 */
+        dir_remove_entry(idx, "..");
+        dir_add_entry(idx, "..", dst_parent);
+    }
+    cache_op_end();
     return 0;
 }
 
+/* 끝 블록부터만 기록한다 (기존 내용은 다시 쓰지 않음) */
 int append_file(const char *filename, const uint8 *data, uint32 data_size) {
     int idx = find_file_index(filename);
-    if (idx == -1) return -1;
-    uint8 buffer[BLOCK_SIZE * MAX_DIRECT_BLOCKS];
-    uint32 old_size = file_table[idx].inode.size;
-    if (knixfs_read_file(&file_table[idx].inode, buffer, sizeof(buffer)) != 0)
+    if (idx == -1 || file_is_dir(idx)) return -1;
+    KnixFS_Inode *inode = &file_table[idx].inode;
+    if (knixfs_write_at(inode, inode->size, data, data_size) < 0) return -1;
+    file_entry_dirty(idx);
+    cache_op_end();
+    return 0;
+}
+
+int make_directory(const char *path) {
+    int parent;
+    char name[MAX_FILENAME_LEN];
+    if (path_resolve(path, &parent, name) != -1 || parent == -1 || !valid_name(name))
         return -1;
-    if (old_size + data_size > BLOCK_SIZE * MAX_DIRECT_BLOCKS)
+    int idx = new_directory(name, parent);
+    if (idx == -1) return -1;
+    if (dir_add_entry(parent, name, idx) != 0) {
+        dir_forget(idx);
+        release_slot(idx);
         return -1;
-    uint32 i;
-    for (i = 0; i < data_size; i++) { buffer[old_size + i] = data[i]; }
-    return update_file(filename, buffer, old_size + data_size);
+    }
+    cache_op_end();
+    return 0;
+}
+
+/* 비어 있는 디렉터리만 지운다 */
+int remove_directory(const char *path) {
+    int parent;
+    char name[MAX_FILENAME_LEN];
+    int idx = path_resolve(path, &parent, name);
+    if (!file_is_dir(idx) || idx == fs_root_dir() || !valid_name(name)) return -1;
+    if (!dir_is_empty(idx)) return -1;
+    if (dir_remove_entry(parent, name) != 0) return -1;
+    dir_forget(idx);
+    release_slot(idx);
+    cache_op_end();
+    return 0;
+}
+
+/*
+ * fsstress: 빈 파일 count 개를 생성/조회/삭제하며 초당 연산 수를 잰다.
+ * 빈 슬롯보다 많으면 가능한 만큼씩 나누어 반복한다.
+ */
+static void stress_name(char *buf, uint32 n) {
+    memcpy(buf, "stress", 6);
+    simple_itoa(n, buf + 6);
+}
+
+static void print_rate(const char *label, uint32 ops, uint64 cycles) {
+    uint32 us = cycles_to_us(cycles);
+    if (us == 0) us = 1;
+    kprint(label);
+    kprint_dec(ops); kprint(" ops, ");
+    kprint_dec(us); kprint(" us, ");
+    kprint_dec((uint32)udiv64((uint64)ops * 1000000, us)); kprint(" ops/sec\n");
+}
+
+void file_table_stress_cmd(uint32 count) {
+    char name[MAX_FILENAME_LEN];
+    uint64 t_create = 0, t_lookup = 0, t_delete = 0, t0;
+    uint32 done = 0, batch, i, errors = 0;
+    uint32 capacity = MAX_FILES - used_count;
+    if (capacity == 0) { kprint("File table is full.\n"); return; }
+
+    while (done < count) {
+        batch = (count - done > capacity) ? capacity : count - done;
+        t0 = rdtsc();
+        for (i = 0; i < batch; i++) {
+            stress_name(name, done + i);
+            if (create_file(name, (const uint8*)"", 0) == -1) errors++;
+        }
+        t_create += rdtsc() - t0;
+        t0 = rdtsc();
+        for (i = 0; i < batch; i++) {
+            stress_name(name, done + i);
+            if (find_file_index(name) == -1) errors++;
+        }
+        t_lookup += rdtsc() - t0;
+        t0 = rdtsc();
+        for (i = 0; i < batch; i++) {
+            stress_name(name, done + i);
+            if (delete_file(name) != 0) errors++;
+        }
+        t_delete += rdtsc() - t0;
+        done += batch;
+    }
+    print_rate("create: ", count, t_create);
+    print_rate("lookup: ", count, t_lookup);
+    print_rate("delete: ", count, t_delete);
+    if (errors) { kprint("errors: "); kprint_dec(errors); kprint("\n"); }
+}
+
+/*
+ * scrub: 루트부터 모든 파일의 블록 CRC 와 파일 CRC 를 검사해
+ * 맞지 않는 파일을 경로와 함께 보고한다.
+ */
+static void scrub_dir(int dir, char *path, uint32 len, uint32 depth, uint32 *files, uint32 *bad_files) {
+    uint32 pos = 0, j, bad;
+    int hash_ok;
+    DirEntry ent;
+    while (dir_next_entry(dir, &pos, &ent) == 0) {
+        if (strcmp(ent.name, "..") == 0) continue;
+        uint32 end = len;
+        if (end < DIR_MAX_DEPTH * MAX_FILENAME_LEN - 1) path[end++] = '/';
+        for (j = 0; ent.name[j] && end < DIR_MAX_DEPTH * MAX_FILENAME_LEN - 1; j++)
+            path[end++] = ent.name[j];
+        path[end] = '\0';
+        if (file_is_dir((int)ent.slot)) {
+            if (depth + 1 < DIR_MAX_DEPTH) scrub_dir((int)ent.slot, path, end, depth + 1, files, bad_files);
+            continue;
+        }
+        (*files)++;
+        bad = knixfs_verify(&file_table[ent.slot].inode, &hash_ok);
+        if (bad == 0 && hash_ok) continue;
+        (*bad_files)++;
+        kprint(path); kprint(": ");
+        kprint_dec(bad); kprint(" bad block(s)");
+        if (!hash_ok) kprint(", file checksum mismatch");
+        kprint("\n");
+    }
+}
+
+void scrub_cmd() {
+    static char path[DIR_MAX_DEPTH * MAX_FILENAME_LEN];
+    uint32 files = 0, bad_files = 0;
+    uint64 t0 = rdtsc();
+    path[0] = '\0';
+    scrub_dir(fs_root_dir(), path, 0, 0, &files, &bad_files);
+    kprint("Scrubbed "); kprint_dec(files); kprint(" files in ");
+    kprint_dec(cycles_to_us(rdtsc() - t0)); kprint(" us, ");
+    kprint_dec(bad_files); kprint(" damaged.\n");
 }
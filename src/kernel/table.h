@@ -4,10 +4,15 @@
 #include "dc.h"
 #include "file.h"
 
+/* FileEntry.in_use 값 */
+#define FILE_ENTRY_FREE  0
+#define FILE_ENTRY_FILE  1
+#define FILE_ENTRY_DIR   2
+
 typedef struct {
-    char name[MAX_FILENAME_LEN];
+    char name[MAX_FILENAME_LEN];   /* 부모 디렉터리 안에서의 이름 */
     KnixFS_Inode inode;
-    int in_use;
+    int in_use;                    /* FILE_ENTRY_* */
     uint32 mode;
     uint32 owner;
 } FileEntry;
@@ -17,12 +22,21 @@ extern FileEntry file_table[MAX_FILES];
 void init_file_table();
 int save_file_table();
 int load_file_table();
-int find_file_index(const char *name);
+void file_entry_dirty(int idx);
+int find_file_index(const char *path);
+int file_is_dir(int idx);
+int file_table_first();
+int file_table_next(int idx);
+uint32 file_table_count();
 int create_file(const char *name, const uint8 *data, uint32 size);
 int update_file(const char *name, const uint8 *data, uint32 size);
 int delete_file(const char *name);
 int copy_file(const char *src, const char *dst);
 int rename_file(const char *src, const char *dst);
 int append_file(const char *filename, const uint8 *data, uint32 data_size);
+int make_directory(const char *path);
+int remove_directory(const char *path);
+void file_table_stress_cmd(uint32 count);
+void scrub_cmd();
 
 #endif //TABLE_H
@@ -0,0 +1,1033 @@
+#include "tcp.h"
+#include "network.h"
+#include "keyboard.h"
+#include "kprint.h"
+#include "process.h"
+#include "slab.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "stream.h"
+#include "timer.h"
+#include "cpu.h"
+#include "type.h"
+
+/*=========================*/
+/* 8-3. TCP */
+/*=========================*/
+/*
+ * 연결은 (원격 주소, 원격 포트, 지역 포트) 해시로 찾고, 없으면 그 포트의 리스너를 찾는다.
+ * 송수신 버퍼는 시퀀스 번호 & (크기-1) 로 바로 색인하는 링이라 따로 머리/꼬리가 없다:
+ * 송신 버퍼에는 snd_una..snd_end (보냈지만 ACK 받지 못한 것 + 아직 안 보낸 것),
+ * 수신 버퍼에는 rcv_read..rcv_nxt (응용이 아직 읽지 않은 것) 가 들어 있다.
+ * 순서가 어긋난 세그먼트는 버리고 즉시 ACK 로 알린다 (상대의 빠른 재전송이 메운다).
+ * 재전송은 go-back-N, RTO 는 RFC 6298. 혼잡 제어는 없다 (상대가 광고한 창만큼 보낸다).
+ * 타이머는 PIT 틱 (timer_ticks) 기준의 마감 시각이고 network_stack_poll 이 틱마다 확인한다.
+ * 모든 상태는 tcp_lock 하나로 지킨다 (순서: tcp_lock -> arp_lock -> nic_lock / mbuf_lock).
+ */
+#define MS_TICKS(ms)    ((ms) * SCHED_HZ / 1000)
+#define SEQ_LT(a, b)    ((int)((a) - (b)) < 0)
+#define SEQ_LEQ(a, b)   ((int)((a) - (b)) <= 0)
+#define TCP_OPT_END     0
+#define TCP_OPT_NOP     1
+#define TCP_OPT_MSS     2
+#define TCP_DEFAULT_MSS 536        /* 상대가 MSS 옵션을 주지 않았을 때 (RFC 879) */
+#define SERVE_TIMEOUT_MS 5000
+
+typedef enum {
+    TCP_CLOSED = 0,
+    TCP_LISTEN,
+    TCP_SYN_SENT,
+    TCP_SYN_RCVD,
+    TCP_ESTABLISHED,
+    TCP_FIN_WAIT1,
+    TCP_FIN_WAIT2,
+    TCP_CLOSE_WAIT,
+    TCP_CLOSING,
+    TCP_LAST_ACK,
+    TCP_TIME_WAIT
+} tcp_state_t;
+
+typedef struct tcp_sock {
+    struct tcp_sock *hnext;         /* 4-tuple 해시 체인 */
+    struct tcp_sock *parent;        /* accept 되기 전의 자식: 리스너 */
+    struct tcp_sock *accept_next;   /* 리스너의 accept 큐 */
+    struct tcp_sock *accept_head, *accept_tail;
+    uint32 pending;                 /* 리스너: 아직 accept 되지 않은 자식 수 */
+    int sd;
+    tcp_state_t state;
+    uint32 rip;                     /* 호스트 바이트 순서 */
+    uint16 lport, rport;
+    uint32 hashed, app_closed, reset, nodelay, fin_queued, fin_rcvd, ack_now;
+    /* 송신: una <= nxt <= max <= end (+1 = FIN) */
+    uint32 iss, snd_una, snd_nxt, snd_max, snd_end, snd_wnd, snd_mss;
+    uint32 dupacks;
+    /* 수신 */
+    uint32 rcv_nxt, rcv_read, rcv_adv;  /* rcv_adv: 마지막으로 광고한 창의 오른쪽 끝 */
+    uint32 ack_pending;             /* 아직 ACK 하지 않은 세그먼트 수 */
+    /* 타이머: timer_ticks 마감 시각, 0 = 꺼짐 */
+    uint32 delack_at, rto_at, tw_at;
+    uint32 rto, srtt, rttvar, rtt_valid, retries;   /* srtt 는 8 배, rttvar 는 4 배 (틱) */
+    uint32 rtt_seq, rtt_start, rtt_timing;
+    uint32 retrans;
+    uint8 *sndbuf, *rcvbuf;
+} tcp_sock_t;
+
+/* 받은 세그먼트의 필드 (호스트 바이트 순서) */
+typedef struct {
+    uint32 seq, ack, win, mss;
+    uint8 flags;
+    uint8 *data;
+    uint32 dlen;
+    uint16 sport, dport;
+} tcp_seg_t;
+
+tcp_stats_t tcp_stats;
+static tcp_sock_t *socks[TCP_MAX_SOCKS];
+static tcp_sock_t *tcp_hash[TCP_HASH_BUCKETS];
+static kmem_cache_t *sock_cache = 0;
+static spinlock_t tcp_lock = SPINLOCK_INIT;
+static uint16 next_ephemeral = TCP_EPHEMERAL;
+static uint32 last_tick = 0;
+
+static const char *state_names[] = {
+    "CLOSED", "LISTEN", "SYN_SENT", "SYN_RCVD", "ESTABLISHED", "FIN_WAIT1",
+    "FIN_WAIT2", "CLOSE_WAIT", "CLOSING", "LAST_ACK", "TIME_WAIT"
+};
+
+static uint32 deadline(uint32 ticks) {
+    uint32 t = timer_ticks + ticks;
+    return t ? t : 1;
+}
+
+static int expired(uint32 at) {
+    return at && (int)(timer_ticks - at) >= 0;
+}
+
+/*=========================*/
+/* 소켓 표와 해시 */
+/*=========================*/
+static uint32 tcp_bucket(uint32 rip, uint16 rport, uint16 lport) {
+    uint32 h = rip ^ ((uint32)rport << 16 | lport);
+    h ^= h >> 16;
+    h *= 0x45D9F3B;
+    h ^= h >> 16;
+    return h & (TCP_HASH_BUCKETS - 1);
+}
+
+static void hash_insert(tcp_sock_t *s) {
+    uint32 b = tcp_bucket(s->rip, s->rport, s->lport);
+    s->hnext = tcp_hash[b];
+    tcp_hash[b] = s;
+    s->hashed = 1;
+}
+
+static void hash_remove(tcp_sock_t *s) {
+    tcp_sock_t **pp = &tcp_hash[tcp_bucket(s->rip, s->rport, s->lport)];
+    if (!s->hashed) return;
+    while (*pp && *pp != s) pp = &(*pp)->hnext;
+    if (*pp) *pp = s->hnext;
+    s->hashed = 0;
+}
+
+static tcp_sock_t *tcp_lookup(uint32 rip, uint16 rport, uint16 lport) {
+    tcp_sock_t *s;
+    uint32 i;
+    for (s = tcp_hash[tcp_bucket(rip, rport, lport)]; s; s = s->hnext)
+        if (s->rip == rip && s->rport == rport && s->lport == lport) return s;
+    for (i = 0; i < TCP_MAX_SOCKS; i++)
+        if (socks[i] && socks[i]->state == TCP_LISTEN && socks[i]->lport == lport) return socks[i];
+    return 0;
+}
+
+static void sock_free(tcp_sock_t *s) {
+    hash_remove(s);
+    socks[s->sd] = 0;
+    kfree(s->sndbuf);
+    kfree(s->rcvbuf);
+    kmem_cache_free(sock_cache, s);
+}
+
+/* 빈 번호가 없으면 가장 오래된 TIME_WAIT 연결을 거둔다 (tcp_lock) */
+static tcp_sock_t *sock_alloc(int buffers) {
+    tcp_sock_t *s, *victim = 0;
+    uint32 i, slot = TCP_MAX_SOCKS;
+    for (i = 0; i < TCP_MAX_SOCKS; i++) {
+        if (!socks[i]) {
+            slot = i;
+            break;
+        }
+        if (socks[i]->state == TCP_TIME_WAIT && socks[i]->app_closed &&
+            (!victim || SEQ_LT(socks[i]->tw_at, victim->tw_at))) victim = socks[i];
+    }
+    if (slot == TCP_MAX_SOCKS) {
+        if (!victim) return 0;
+        slot = (uint32)victim->sd;
+        sock_free(victim);
+    }
+    if ((s = (tcp_sock_t*)kmem_cache_alloc(sock_cache)) == 0) return 0;
+    memset(s, 0, sizeof(*s));
+    if (buffers) {
+        s->sndbuf = (uint8*)kmalloc(TCP_SNDBUF);
+        s->rcvbuf = (uint8*)kmalloc(TCP_RCVBUF);
+        if (!s->sndbuf || !s->rcvbuf) {
+            kfree(s->sndbuf);
+            kfree(s->rcvbuf);
+            kmem_cache_free(sock_cache, s);
+            return 0;
+        }
+    }
+    s->sd = (int)slot;
+    s->rto = MS_TICKS(TCP_RTO_INIT_MS);
+    s->snd_mss = TCP_DEFAULT_MSS;
+    socks[slot] = s;
+    return s;
+}
+
+static void set_iss(tcp_sock_t *s) {
+    s->iss = (uint32)rdtsc();
+    s->snd_una = s->iss;
+    s->snd_nxt = s->snd_max = s->snd_end = s->iss + 1;
+}
+
+/* accept 되기 전에 죽은 자식을 리스너에서 뗀다 (tcp_lock) */
+static void child_detach(tcp_sock_t *c) {
+    tcp_sock_t *l = c->parent, **pp;
+    if (!l) return;
+    for (pp = &l->accept_head; *pp; pp = &(*pp)->accept_next) {
+        if (*pp == c) {
+            *pp = c->accept_next;
+            break;
+        }
+    }
+    l->accept_tail = 0;
+    for (c = l->accept_head; c; c = c->accept_next) l->accept_tail = c;
+    l->pending--;
+}
+
+/* 닫힌 연결은 응용이 놓았거나 아직 accept 되지 않았으면 바로 풀어 준다 (tcp_lock) */
+static void maybe_free(tcp_sock_t *s) {
+    if (s->state != TCP_CLOSED) return;
+    if (s->parent) {
+        child_detach(s);
+        sock_free(s);
+    } else if (s->app_closed) {
+        sock_free(s);
+    }
+}
+
+/*=========================*/
+/* 세그먼트 송신 */
+/*=========================*/
+static uint32 rcv_used(tcp_sock_t *s) {
+    return s->rcv_nxt - s->fin_rcvd - s->rcv_read;
+}
+
+static void fill_checksum(mbuf_t *m, tcp_hdr_t *th, uint32 dst) {
+    th->csum = 0;
+    th->csum = inet_csum_fold(inet_csum_partial(th, m->len,
+                   inet_pseudo_sum(htonl(net_ip), htonl(dst), IP_PROTO_TCP, (uint16)m->len)));
+}
+
+/* seq 부터 len 바이트 (송신 링에서) 를 flags 와 함께 보낸다. ACK 를 실으면 지연 ACK 가 풀린다 (tcp_lock) */
+static int tcp_xmit(tcp_sock_t *s, uint32 seq, uint32 len, uint8 flags) {
+    mbuf_t *m = mbuf_alloc();
+    uint32 hlen = sizeof(tcp_hdr_t) + ((flags & TCP_SYN) ? 4 : 0), off, first, wnd;
+    tcp_hdr_t *th;
+    uint8 *p;
+
+    if (!m) return -1;
+    if (len) {
+        p = mbuf_append(m, len);
+        off = seq & (TCP_SNDBUF - 1);
+        first = TCP_SNDBUF - off;
+        if (first > len) first = len;
+        memcpy(p, s->sndbuf + off, first);
+        memcpy(p + first, s->sndbuf, len - first);
+    }
+    th = (tcp_hdr_t*)mbuf_prepend(m, hlen);
+    wnd = TCP_RCVBUF - rcv_used(s);
+    th->sport = htons(s->lport);
+    th->dport = htons(s->rport);
+    th->seq = htonl(seq);
+    th->ack = (flags & TCP_ACK) ? htonl(s->rcv_nxt) : 0;
+    th->off = (uint8)((hlen / 4) << 4);
+    th->flags = flags;
+    th->win = htons((uint16)wnd);
+    th->urg = 0;
+    if (flags & TCP_SYN) {
+        p = (uint8*)(th + 1);
+        p[0] = TCP_OPT_MSS;
+        p[1] = 4;
+        p[2] = TCP_MSS >> 8;
+        p[3] = TCP_MSS & 0xFF;
+    }
+    fill_checksum(m, th, s->rip);
+    if (flags & TCP_ACK) {
+        s->rcv_adv = s->rcv_nxt + wnd;
+        s->ack_pending = 0;
+        s->ack_now = 0;
+        s->delack_at = 0;
+    }
+    tcp_stats.segs_out++;
+    ip_output(m, s->rip, IP_PROTO_TCP);
+    return 0;
+}
+
+/* 소켓 없이 받은 세그먼트에 RST 로 답한다 (RFC 793 "Reset Generation") */
+static void tcp_reset_reply(uint32 rip, const tcp_seg_t *seg) {
+    mbuf_t *m;
+    tcp_hdr_t *th;
+    if (seg->flags & TCP_RST) return;
+    if ((m = mbuf_alloc()) == 0) return;
+    th = (tcp_hdr_t*)mbuf_append(m, sizeof(tcp_hdr_t));
+    th->sport = htons(seg->dport);
+    th->dport = htons(seg->sport);
+    if (seg->flags & TCP_ACK) {
+        th->seq = htonl(seg->ack);
+        th->ack = 0;
+        th->flags = TCP_RST;
+    } else {
+        th->seq = 0;
+        th->ack = htonl(seg->seq + seg->dlen + ((seg->flags & TCP_SYN) ? 1 : 0) + ((seg->flags & TCP_FIN) ? 1 : 0));
+        th->flags = TCP_RST | TCP_ACK;
+    }
+    th->off = (uint8)((sizeof(tcp_hdr_t) / 4) << 4);
+    th->win = 0;
+    th->urg = 0;
+    fill_checksum(m, th, rip);
+    tcp_stats.rsts_out++;
+    tcp_stats.segs_out++;
+    ip_output(m, rip, IP_PROTO_TCP);
+}
+
+static int can_send_data(tcp_sock_t *s) {
+    return s->state == TCP_ESTABLISHED || s->state == TCP_CLOSE_WAIT || s->state == TCP_FIN_WAIT1 ||
+           s->state == TCP_CLOSING || s->state == TCP_LAST_ACK;
+}
+
+/*
+ * 상대의 창이 허락하는 만큼 새 데이터를 보내고, 다 보냈고 닫는 중이면 FIN.
+ * Nagle: 보낸 것이 ACK 되지 않았으면 MSS 보다 작은 세그먼트는 미룬다 (nodelay 가 아니면) (tcp_lock)
+ */
+static void tcp_output(tcp_sock_t *s) {
+    uint32 in_flight, unsent, wnd, len;
+    if (!can_send_data(s)) return;
+    while (SEQ_LT(s->snd_nxt, s->snd_end)) {
+        in_flight = s->snd_nxt - s->snd_una;
+        unsent = s->snd_end - s->snd_nxt;
+        wnd = s->snd_wnd > in_flight ? s->snd_wnd - in_flight : 0;
+        len = unsent;
+        if (len > wnd) len = wnd;
+        if (len > s->snd_mss) len = s->snd_mss;
+        if (len == 0) break;
+        if (!s->nodelay && len < s->snd_mss && in_flight && !s->fin_queued) break;
+        if (tcp_xmit(s, s->snd_nxt, len, TCP_ACK | (len == unsent ? TCP_PSH : 0)) != 0) break;
+        if (!SEQ_LT(s->snd_nxt, s->snd_max)) {
+            tcp_stats.bytes_out += len;
+            if (!s->rtt_timing) {
+                s->rtt_timing = 1;
+                s->rtt_seq = s->snd_nxt;
+                s->rtt_start = timer_ticks;
+            }
+        }
+        s->snd_nxt += len;
+        if (SEQ_LT(s->snd_max, s->snd_nxt)) s->snd_max = s->snd_nxt;
+        if (!s->rto_at) s->rto_at = deadline(s->rto);
+    }
+    if (s->fin_queued && s->snd_nxt == s->snd_end && tcp_xmit(s, s->snd_end, 0, TCP_FIN | TCP_ACK) == 0) {
+        s->snd_nxt = s->snd_end + 1;
+        if (SEQ_LT(s->snd_max, s->snd_nxt)) s->snd_max = s->snd_nxt;
+        if (!s->rto_at) s->rto_at = deadline(s->rto);
+    }
+    /* 상대의 창이 닫혔는데 보낼 것이 남았으면 RTO 로 창을 두드린다 */
+    if (SEQ_LT(s->snd_nxt, s->snd_end) && s->snd_wnd == 0 && !s->rto_at) s->rto_at = deadline(s->rto);
+}
+
+static void enter_time_wait(tcp_sock_t *s) {
+    s->state = TCP_TIME_WAIT;
+    s->rto_at = 0;
+    s->delack_at = 0;
+    s->tw_at = deadline(MS_TICKS(TCP_TIME_WAIT_MS));
+}
+
+/* RST 를 보내고 닫는다 (tcp_lock) */
+static void tcp_abort(tcp_sock_t *s) {
+    if (s->state != TCP_CLOSED && s->state != TCP_LISTEN && s->state != TCP_TIME_WAIT) {
+        tcp_xmit(s, s->snd_nxt, 0, TCP_RST | TCP_ACK);
+        tcp_stats.rsts_out++;
+    }
+    s->state = TCP_CLOSED;
+    s->reset = 1;
+    s->rto_at = s->delack_at = s->tw_at = 0;
+    maybe_free(s);
+}
+
+/* RFC 6298: srtt += (r - srtt) / 8, rttvar += (|r - srtt| - rttvar) / 4, rto = srtt + 4 * rttvar */
+static void rtt_update(tcp_sock_t *s, uint32 r) {
+    int delta;
+    if (!s->rtt_valid) {
+        s->srtt = r << 3;
+        s->rttvar = r << 1;
+        s->rtt_valid = 1;
+    } else {
+        delta = (int)r - (int)(s->srtt >> 3);
+        s->srtt += delta;
+        if (delta < 0) delta = -delta;
+        s->rttvar += delta - (int)(s->rttvar >> 2);
+    }
+    s->rto = (s->srtt >> 3) + (s->rttvar ? s->rttvar : 1);
+    if (s->rto < MS_TICKS(TCP_RTO_MIN_MS)) s->rto = MS_TICKS(TCP_RTO_MIN_MS);
+    if (s->rto > MS_TICKS(TCP_RTO_MAX_MS)) s->rto = MS_TICKS(TCP_RTO_MAX_MS);
+}
+
+/* 재전송 타이머 만료 (tcp_lock) */
+static void tcp_rto(tcp_sock_t *s) {
+    s->rto_at = 0;
+    if (++s->retries > TCP_MAX_RETRIES) {
+        tcp_stats.timeouts++;
+        tcp_abort(s);
+        return;
+    }
+    s->rto = s->rto * 2 > MS_TICKS(TCP_RTO_MAX_MS) ? MS_TICKS(TCP_RTO_MAX_MS) : s->rto * 2;
+    s->rtt_timing = 0;   /* Karn: 재전송한 세그먼트로는 RTT 를 재지 않는다 */
+    if (s->state == TCP_SYN_SENT) {
+        tcp_xmit(s, s->iss, 0, TCP_SYN);
+    } else if (s->state == TCP_SYN_RCVD) {
+        tcp_xmit(s, s->iss, 0, TCP_SYN | TCP_ACK);
+    } else if (s->snd_una == s->snd_max && s->snd_wnd == 0 && SEQ_LT(s->snd_una, s->snd_end)) {
+        /* 창 탐색: 창을 무시하고 1 바이트 */
+        tcp_xmit(s, s->snd_una, 1, TCP_ACK);
+        s->snd_nxt = s->snd_max = s->snd_una + 1;
+    } else if (s->snd_una != s->snd_max) {
+        s->snd_nxt = s->snd_una;
+        s->retrans++;
+        tcp_stats.retransmits++;
+        tcp_output(s);
+    } else {
+        return;
+    }
+    s->rto_at = deadline(s->rto);
+}
+
+/*=========================*/
+/* 세그먼트 수신 */
+/*=========================*/
+static void parse_options(const tcp_hdr_t *th, uint32 thl, tcp_seg_t *seg) {
+    const uint8 *p = (const uint8*)(th + 1), *end = (const uint8*)th + thl;
+    while (p < end && *p != TCP_OPT_END) {
+        if (*p == TCP_OPT_NOP) {
+            p++;
+            continue;
+        }
+        if (p + 1 >= end || p[1] < 2 || p + p[1] > end) break;
+        if (p[0] == TCP_OPT_MSS && p[1] == 4) seg->mss = (uint32)(p[2] << 8 | p[3]);
+        p += p[1];
+    }
+}
+
+static void listen_input(tcp_sock_t *l, uint32 rip, const tcp_seg_t *seg) {
+    tcp_sock_t *c;
+    if (seg->flags & TCP_RST) return;
+    if (seg->flags & TCP_ACK) {
+        tcp_reset_reply(rip, seg);
+        return;
+    }
+    if (!(seg->flags & TCP_SYN)) return;
+    if (l->pending >= TCP_BACKLOG || (c = sock_alloc(1)) == 0) {
+        tcp_stats.accept_drops++;
+        return;
+    }
+    c->parent = l;
+    l->pending++;
+    c->state = TCP_SYN_RCVD;
+    c->rip = rip;
+    c->rport = seg->sport;
+    c->lport = l->lport;
+    c->nodelay = l->nodelay;
+    c->rcv_nxt = c->rcv_read = seg->seq + 1;
+    c->snd_wnd = seg->win;
+    if (seg->mss) c->snd_mss = seg->mss < TCP_MSS ? seg->mss : TCP_MSS;
+    set_iss(c);
+    hash_insert(c);
+    tcp_xmit(c, c->iss, 0, TCP_SYN | TCP_ACK);
+    c->rto_at = deadline(c->rto);
+    tcp_stats.passive_opens++;
+}
+
+static void syn_sent_input(tcp_sock_t *s, uint32 rip, const tcp_seg_t *seg) {
+    if ((seg->flags & TCP_ACK) && (SEQ_LEQ(seg->ack, s->iss) || SEQ_LT(s->snd_max, seg->ack))) {
+        tcp_reset_reply(rip, seg);
+        return;
+    }
+    if (seg->flags & TCP_RST) {
+        if (seg->flags & TCP_ACK) {
+            s->state = TCP_CLOSED;
+            s->reset = 1;
+            s->rto_at = 0;
+            maybe_free(s);
+        }
+        return;
+    }
+    if (!(seg->flags & TCP_SYN) || !(seg->flags & TCP_ACK)) return;   /* 동시 열기는 다루지 않는다 */
+    s->rcv_nxt = s->rcv_read = seg->seq + 1;
+    s->snd_una = seg->ack;
+    s->snd_wnd = seg->win;
+    if (seg->mss) s->snd_mss = seg->mss < TCP_MSS ? seg->mss : TCP_MSS;
+    s->state = TCP_ESTABLISHED;
+    s->rto_at = 0;
+    s->retries = 0;
+    tcp_xmit(s, s->snd_nxt, 0, TCP_ACK);
+}
+
+/* 연결된 (SYN_RCVD 이후) 상태의 세그먼트 (tcp_lock). s 가 풀리면 1 */
+static int conn_input(tcp_sock_t *s, uint32 rip, tcp_seg_t *seg) {
+    uint32 space, n, off, first, in_order;
+    tcp_sock_t *l;
+
+    /* 이미 받은 앞부분은 잘라 낸다 */
+    if (seg->dlen && SEQ_LT(seg->seq, s->rcv_nxt) && SEQ_LT(s->rcv_nxt, seg->seq + seg->dlen)) {
+        n = s->rcv_nxt - seg->seq;
+        seg->data += n;
+        seg->dlen -= n;
+        seg->seq = s->rcv_nxt;
+    }
+    in_order = seg->seq == s->rcv_nxt;
+
+    if (seg->flags & TCP_RST) {
+        if (!in_order) return 0;   /* 창 밖의 RST 는 무시 */
+        tcp_stats.rsts_in++;
+        s->state = TCP_CLOSED;
+        s->reset = 1;
+        s->rto_at = s->delack_at = s->tw_at = 0;
+        if (s->parent || s->app_closed) {
+            maybe_free(s);
+            return 1;
+        }
+        return 0;
+    }
+    if (seg->flags & TCP_SYN) {
+        if (s->state == TCP_SYN_RCVD && seg->seq + 1 == s->rcv_nxt) tcp_xmit(s, s->iss, 0, TCP_SYN | TCP_ACK);
+        return 0;
+    }
+    if (!(seg->flags & TCP_ACK)) return 0;
+
+    /* ACK */
+    if (s->state == TCP_SYN_RCVD) {
+        if (!SEQ_LT(s->snd_una, seg->ack) || SEQ_LT(s->snd_max, seg->ack)) {
+            tcp_reset_reply(rip, seg);
+            return 0;
+        }
+        s->state = TCP_ESTABLISHED;
+        s->snd_una = seg->ack;
+        s->snd_wnd = seg->win;
+        s->retries = 0;
+        s->rto_at = 0;
+        l = s->parent;
+        if (l->accept_tail) l->accept_tail->accept_next = s;
+        else l->accept_head = s;
+        l->accept_tail = s;
+    } else if (SEQ_LT(s->snd_una, seg->ack) && SEQ_LEQ(seg->ack, s->snd_max)) {
+        if (s->rtt_timing && SEQ_LT(s->rtt_seq, seg->ack)) {
+            rtt_update(s, timer_ticks - s->rtt_start);
+            s->rtt_timing = 0;
+        }
+        s->snd_una = seg->ack;
+        if (SEQ_LT(s->snd_nxt, s->snd_una)) s->snd_nxt = s->snd_una;
+        s->snd_wnd = seg->win;
+        s->retries = 0;
+        s->dupacks = 0;
+        s->rto_at = s->snd_una == s->snd_max ? 0 : deadline(s->rto);
+        if (s->fin_queued && s->snd_una == s->snd_end + 1) {
+            /* 우리 FIN 이 ACK 됐다 */
+            if (s->state == TCP_FIN_WAIT1) s->state = TCP_FIN_WAIT2;
+            else if (s->state == TCP_CLOSING) enter_time_wait(s);
+            else if (s->state == TCP_LAST_ACK) {
+                s->state = TCP_CLOSED;
+                maybe_free(s);
+                return 1;
+            }
+        }
+    } else if (seg->ack == s->snd_una) {
+        if (seg->dlen == 0 && !(seg->flags & TCP_FIN) && seg->win == s->snd_wnd && s->snd_una != s->snd_max) {
+            tcp_stats.dup_acks++;
+            if (++s->dupacks == 3) {
+                /* 빠른 재전송: 빠진 세그먼트 하나만 */
+                n = s->snd_max - s->snd_una;
+                if (SEQ_LT(s->snd_end, s->snd_max)) n--;   /* FIN 은 tcp_output 이 다시 보낸다 */
+                if (n > s->snd_mss) n = s->snd_mss;
+                if (n) tcp_xmit(s, s->snd_una, n, TCP_ACK);
+                s->rtt_timing = 0;
+                s->retrans++;
+                tcp_stats.fast_retransmits++;
+            }
+        } else {
+            s->snd_wnd = seg->win;   /* 창 갱신 */
+        }
+    } else if (SEQ_LT(s->snd_max, seg->ack)) {
+        s->ack_now = 1;   /* 보내지 않은 것에 대한 ACK */
+    }
+
+    /* 데이터: 순서대로 온 것만 */
+    if (seg->dlen) {
+        if (in_order && (s->state == TCP_ESTABLISHED || s->state == TCP_FIN_WAIT1 || s->state == TCP_FIN_WAIT2)) {
+            space = TCP_RCVBUF - rcv_used(s);
+            n = seg->dlen < space ? seg->dlen : space;
+            off = s->rcv_nxt & (TCP_RCVBUF - 1);
+            first = TCP_RCVBUF - off;
+            if (first > n) first = n;
+            memcpy(s->rcvbuf + off, seg->data, first);
+            memcpy(s->rcvbuf, seg->data + first, n - first);
+            s->rcv_nxt += n;
+            tcp_stats.bytes_in += n;
+            /* 지연 ACK: 두 세그먼트마다, 아니면 TCP_DELACK_MS 뒤 */
+            if (n < seg->dlen || ++s->ack_pending >= 2) s->ack_now = 1;
+            else if (!s->delack_at) s->delack_at = deadline(MS_TICKS(TCP_DELACK_MS));
+        } else {
+            tcp_stats.ooo_drops++;
+            s->ack_now = 1;
+        }
+    }
+
+    /* FIN: 앞의 데이터를 모두 받았을 때만 */
+    if ((seg->flags & TCP_FIN) && !s->fin_rcvd) {
+        if (in_order && seg->seq + seg->dlen == s->rcv_nxt) {
+            s->rcv_nxt++;
+            s->fin_rcvd = 1;
+            if (s->state == TCP_ESTABLISHED) s->state = TCP_CLOSE_WAIT;
+            else if (s->state == TCP_FIN_WAIT1) s->state = TCP_CLOSING;
+            else if (s->state == TCP_FIN_WAIT2) enter_time_wait(s);
+        }
+        s->ack_now = 1;
+    } else if ((seg->flags & TCP_FIN) && s->state == TCP_TIME_WAIT) {
+        enter_time_wait(s);   /* 우리 ACK 가 사라졌다: 다시 ACK 하고 기다림을 늘린다 */
+        s->ack_now = 1;
+    }
+
+    tcp_output(s);
+    if (s->ack_now) tcp_xmit(s, s->snd_nxt, 0, TCP_ACK);
+    return 0;
+}
+
+void tcp_input(mbuf_t *m, ipv4_hdr_t *ip, uint32 hl) {
+    tcp_hdr_t *th = (tcp_hdr_t*)((uint8*)ip + hl);
+    uint32 len = m->len - hl, thl, flags, rip;
+    tcp_seg_t seg;
+    tcp_sock_t *s;
+
+    if (len < sizeof(tcp_hdr_t) || (thl = (uint32)(th->off >> 4) * 4) < sizeof(tcp_hdr_t) || thl > len ||
+        ip->dst != htonl(net_ip) ||
+        inet_csum_fold(inet_csum_partial(th, len, inet_pseudo_sum(ip->src, ip->dst, IP_PROTO_TCP, (uint16)len))) != 0) {
+        tcp_stats.bad++;
+        mbuf_free(m);
+        return;
+    }
+    tcp_stats.segs_in++;
+    seg.seq = ntohl(th->seq);
+    seg.ack = ntohl(th->ack);
+    seg.win = ntohs(th->win);
+    seg.flags = th->flags;
+    seg.sport = ntohs(th->sport);
+    seg.dport = ntohs(th->dport);
+    seg.data = (uint8*)th + thl;
+    seg.dlen = len - thl;
+    seg.mss = 0;
+    if (seg.flags & TCP_SYN) parse_options(th, thl, &seg);
+    rip = ntohl(ip->src);
+
+    flags = spin_lock_irqsave(&tcp_lock);
+    s = tcp_lookup(rip, seg.sport, seg.dport);
+    if (!s) tcp_reset_reply(rip, &seg);
+    else if (s->state == TCP_LISTEN) listen_input(s, rip, &seg);
+    else if (s->state == TCP_SYN_SENT) syn_sent_input(s, rip, &seg);
+    else if (s->state != TCP_CLOSED) conn_input(s, rip, &seg);
+    spin_unlock_irqrestore(&tcp_lock, flags);
+    mbuf_free(m);
+}
+
+void tcp_timer() {
+    uint32 flags, i;
+    tcp_sock_t *s;
+    if (timer_ticks == last_tick) return;
+    flags = spin_lock_irqsave(&tcp_lock);
+    last_tick = timer_ticks;
+    for (i = 0; i < TCP_MAX_SOCKS; i++) {
+        if ((s = socks[i]) == 0) continue;
+        if (expired(s->delack_at)) {
+            tcp_stats.delayed_acks++;
+            tcp_xmit(s, s->snd_nxt, 0, TCP_ACK);
+        }
+        if (expired(s->rto_at)) {
+            tcp_rto(s);
+        } else if (expired(s->tw_at)) {
+            s->tw_at = 0;
+            s->state = TCP_CLOSED;
+            maybe_free(s);
+        }
+    }
+    spin_unlock_irqrestore(&tcp_lock, flags);
+}
+
+void tcp_init() {
+    uint32 flags = spin_lock_irqsave(&tcp_lock);
+    if (!sock_cache) sock_cache = kmem_cache_create("tcp_sock", sizeof(tcp_sock_t));
+    memset(socks, 0, sizeof(socks));
+    memset(tcp_hash, 0, sizeof(tcp_hash));
+    memset(&tcp_stats, 0, sizeof(tcp_stats));
+    spin_unlock_irqrestore(&tcp_lock, flags);
+}
+
+/*=========================*/
+/* 소켓 API */
+/*=========================*/
+/* 소켓 번호가 가리키는 연결 (응용이 닫은 뒤면 없음) (tcp_lock) */
+static tcp_sock_t *sock_get(int sd) {
+    tcp_sock_t *s;
+    if (sd < 0 || sd >= TCP_MAX_SOCKS || (s = socks[sd]) == 0 || s->app_closed || s->parent) return 0;
+    return s;
+}
+
+static int timed_out(uint32 start, uint32 timeout_ms) {
+    return timeout_ms != TCP_WAIT_FOREVER && timer_ticks - start >= MS_TICKS(timeout_ms);
+}
+
+void sock_wait() {
+    network_stack_poll();
+    if (this_cpu()->nr_queued) sched_yield();
+    else network_idle();
+}
+
+int sock_listen(uint16 port) {
+    uint32 flags = spin_lock_irqsave(&tcp_lock), i;
+    tcp_sock_t *l = 0;
+    for (i = 0; i < TCP_MAX_SOCKS; i++)
+        if (socks[i] && socks[i]->state == TCP_LISTEN && socks[i]->lport == port) break;
+    if (i == TCP_MAX_SOCKS && sock_cache && (l = sock_alloc(0)) != 0) {
+        l->state = TCP_LISTEN;
+        l->lport = port;
+    }
+    spin_unlock_irqrestore(&tcp_lock, flags);
+    return l ? l->sd : -1;
+}
+
+int sock_accept(int sd, uint32 timeout_ms) {
+    uint32 flags, start = timer_ticks;
+    tcp_sock_t *l, *c;
+    while (1) {
+        flags = spin_lock_irqsave(&tcp_lock);
+        if ((l = sock_get(sd)) == 0 || l->state != TCP_LISTEN) {
+            spin_unlock_irqrestore(&tcp_lock, flags);
+            return -1;
+        }
+        if ((c = l->accept_head) != 0) {
+            l->accept_head = c->accept_next;
+            if (!l->accept_head) l->accept_tail = 0;
+            l->pending--;
+            c->parent = 0;
+            c->accept_next = 0;
+            spin_unlock_irqrestore(&tcp_lock, flags);
+            return c->sd;
+        }
+        spin_unlock_irqrestore(&tcp_lock, flags);
+        if (timed_out(start, timeout_ms)) return -1;
+        sock_wait();
+    }
+}
+
+int sock_connect(uint32 ip, uint16 port, uint32 timeout_ms) {
+    uint32 flags = spin_lock_irqsave(&tcp_lock), start = timer_ticks;
+    tcp_sock_t *s = sock_cache ? sock_alloc(1) : 0;
+    int sd, state;
+    if (!s) {
+        spin_unlock_irqrestore(&tcp_lock, flags);
+        return -1;
+    }
+    s->rip = ip;
+    s->rport = port;
+    do {
+        s->lport = next_ephemeral++;
+        if (next_ephemeral == 0) next_ephemeral = TCP_EPHEMERAL;
+    } while (tcp_lookup(ip, port, s->lport));
+    s->rcv_nxt = s->rcv_read = 0;
+    set_iss(s);
+    s->state = TCP_SYN_SENT;
+    hash_insert(s);
+    tcp_xmit(s, s->iss, 0, TCP_SYN);
+    s->rto_at = deadline(s->rto);
+    tcp_stats.active_opens++;
+    sd = s->sd;
+    spin_unlock_irqrestore(&tcp_lock, flags);
+
+    while (1) {
+        flags = spin_lock_irqsave(&tcp_lock);
+        state = socks[sd] ? (int)socks[sd]->state : TCP_CLOSED;
+        spin_unlock_irqrestore(&tcp_lock, flags);
+        if (state != TCP_SYN_SENT) break;
+        if (timed_out(start, timeout_ms)) break;
+        sock_wait();
+    }
+    if (state == TCP_ESTABLISHED) return sd;
+    sock_close(sd);
+    return -1;
+}
+
+int sock_send(int sd, const void *buf, uint32 len) {
+    const uint8 *src = (const uint8*)buf;
+    uint32 flags, sent = 0, n, off, first;
+    tcp_sock_t *s;
+    while (sent < len) {
+        flags = spin_lock_irqsave(&tcp_lock);
+        s = sock_get(sd);
+        if (!s || s->reset || s->fin_queued || (s->state != TCP_ESTABLISHED && s->state != TCP_CLOSE_WAIT)) {
+            spin_unlock_irqrestore(&tcp_lock, flags);
+            return -1;
+        }
+        n = TCP_SNDBUF - (s->snd_end - s->snd_una);
+        if (n > len - sent) n = len - sent;
+        if (n) {
+            off = s->snd_end & (TCP_SNDBUF - 1);
+            first = TCP_SNDBUF - off;
+            if (first > n) first = n;
+            memcpy(s->sndbuf + off, src + sent, first);
+            memcpy(s->sndbuf, src + sent + first, n - first);
+            s->snd_end += n;
+            sent += n;
+            tcp_output(s);
+        }
+        spin_unlock_irqrestore(&tcp_lock, flags);
+        if (sent < len) sock_wait();
+    }
+    return (int)sent;
+}
+
+int sock_recv(int sd, void *buf, uint32 len, uint32 timeout_ms) {
+    uint8 *dst = (uint8*)buf;
+    uint32 flags, start = timer_ticks, n, off, first;
+    tcp_sock_t *s;
+    while (1) {
+        flags = spin_lock_irqsave(&tcp_lock);
+        if ((s = sock_get(sd)) == 0) {
+            spin_unlock_irqrestore(&tcp_lock, flags);
+            return -1;
+        }
+        if ((n = rcv_used(s)) != 0) {
+            if (n > len) n = len;
+            off = s->rcv_read & (TCP_RCVBUF - 1);
+            first = TCP_RCVBUF - off;
+            if (first > n) first = n;
+            memcpy(dst, s->rcvbuf + off, first);
+            memcpy(dst + first, s->rcvbuf, n - first);
+            s->rcv_read += n;
+            /* 창이 버퍼 절반 이상 넓어졌으면 바로 알린다 (상대가 닫힌 창 앞에서 기다리지 않게) */
+            if (!s->fin_rcvd && (s->rcv_read + TCP_RCVBUF) - s->rcv_adv >= TCP_RCVBUF / 2)
+                tcp_xmit(s, s->snd_nxt, 0, TCP_ACK);
+            spin_unlock_irqrestore(&tcp_lock, flags);
+            return (int)n;
+        }
+        if (s->fin_rcvd || s->reset || s->state == TCP_CLOSED) {
+            n = s->fin_rcvd && !s->reset;
+            spin_unlock_irqrestore(&tcp_lock, flags);
+            return n ? 0 : -1;
+        }
+        spin_unlock_irqrestore(&tcp_lock, flags);
+        if (timed_out(start, timeout_ms)) return -1;
+        sock_wait();
+    }
+}
+
+int sock_flush(int sd, uint32 timeout_ms) {
+    uint32 flags, start = timer_ticks, done;
+    tcp_sock_t *s;
+    while (1) {
+        flags = spin_lock_irqsave(&tcp_lock);
+        s = sock_get(sd);
+        done = !s || s->reset ? 2 : s->snd_una == s->snd_end;
+        spin_unlock_irqrestore(&tcp_lock, flags);
+        if (done) return done == 1 ? 0 : -1;
+        if (timed_out(start, timeout_ms)) return -1;
+        sock_wait();
+    }
+}
+
+int sock_peer(int sd, uint32 *ip, uint16 *port) {
+    uint32 flags = spin_lock_irqsave(&tcp_lock);
+    tcp_sock_t *s = sock_get(sd);
+    if (s) {
+        *ip = s->rip;
+        *port = s->rport;
+    }
+    spin_unlock_irqrestore(&tcp_lock, flags);
+    return s ? 0 : -1;
+}
+
+void sock_set_nodelay(int sd, int on) {
+    uint32 flags = spin_lock_irqsave(&tcp_lock);
+    tcp_sock_t *s = sock_get(sd);
+    if (s) {
+        s->nodelay = on != 0;
+        if (s->nodelay) tcp_output(s);
+    }
+    spin_unlock_irqrestore(&tcp_lock, flags);
+}
+
+void sock_close(int sd) {
+    uint32 flags = spin_lock_irqsave(&tcp_lock), i;
+    tcp_sock_t *s = sock_get(sd), *c;
+    if (!s) {
+        spin_unlock_irqrestore(&tcp_lock, flags);
+        return;
+    }
+    s->app_closed = 1;
+    switch (s->state) {
+        case TCP_LISTEN:
+            /* accept 되지 않은 연결은 끊는다 */
+            for (i = 0; i < TCP_MAX_SOCKS && s->pending; i++)
+                if ((c = socks[i]) != 0 && c->parent == s) tcp_abort(c);
+            sock_free(s);
+            break;
+        case TCP_SYN_RCVD:
+        case TCP_ESTABLISHED:
+            s->fin_queued = 1;
+            s->state = TCP_FIN_WAIT1;
+            tcp_output(s);
+            break;
+        case TCP_CLOSE_WAIT:
+            s->fin_queued = 1;
+            s->state = TCP_LAST_ACK;
+            tcp_output(s);
+            break;
+        case TCP_SYN_SENT:
+            s->state = TCP_CLOSED;
+            maybe_free(s);
+            break;
+        default:
+            maybe_free(s);   /* 이미 닫히는 중이면 타이머가 마저 푼다 */
+            break;
+    }
+    spin_unlock_irqrestore(&tcp_lock, flags);
+}
+
+/*=========================*/
+/* 명령어: tcpstat, fileserve */
+/*=========================*/
+void tcp_stat_cmd() {
+    static tcp_sock_t snap[TCP_MAX_SOCKS];   /* 셸에서만 부른다 */
+    uint32 flags, i, n = 0;
+
+    flags = spin_lock_irqsave(&tcp_lock);
+    for (i = 0; i < TCP_MAX_SOCKS; i++)
+        if (socks[i]) snap[n++] = *socks[i];
+    spin_unlock_irqrestore(&tcp_lock, flags);
+
+    kprint("SD  Local  Remote                 State        Send-Q Recv-Q  RTO   SRTT  Retrans\n");
+    for (i = 0; i < n; i++) {
+        kprintf("%u  %u  ", (uint32)snap[i].sd, (uint32)snap[i].lport);
+        if (snap[i].state == TCP_LISTEN) {
+            kprint("*");
+        } else {
+            inet_print_addr(snap[i].rip);
+            kprintf(":%u", (uint32)snap[i].rport);
+        }
+        kprintf("  %s  %u  %u  %u  %u  %u\n", state_names[snap[i].state],
+                snap[i].state == TCP_LISTEN ? snap[i].pending : snap[i].snd_end - snap[i].snd_una,
+                snap[i].state == TCP_LISTEN ? 0 : rcv_used(&snap[i]),
+                snap[i].rto * 1000 / SCHED_HZ, (snap[i].srtt >> 3) * 1000 / SCHED_HZ, snap[i].retrans);
+    }
+    kprintf("Opens: %u active, %u passive, %u SYNs dropped (backlog)\n",
+            tcp_stats.active_opens, tcp_stats.passive_opens, tcp_stats.accept_drops);
+    kprintf("Segments: %u in, %u out, %u bad; data %u bytes in, %u bytes out\n",
+            tcp_stats.segs_in, tcp_stats.segs_out, tcp_stats.bad, tcp_stats.bytes_in, tcp_stats.bytes_out);
+    kprintf("Retransmits: %u timeout, %u fast (%u dup ACKs); %u delayed ACKs, %u out-of-order drops\n",
+            tcp_stats.retransmits, tcp_stats.fast_retransmits, tcp_stats.dup_acks,
+            tcp_stats.delayed_acks, tcp_stats.ooo_drops);
+    kprintf("Resets: %u in, %u out; %u connections timed out\n",
+            tcp_stats.rsts_in, tcp_stats.rsts_out, tcp_stats.timeouts);
+}
+
+static uint8 serve_buf[TCP_SNDBUF / 2];
+
+static int send_str(int c, const char *s) {
+    return sock_send(c, s, strlen(s));
+}
+
+/*
+ * 요청 한 줄을 읽고 파일을 보낸 뒤 닫는다. 요청은 "이름" 또는 "GET /이름 HTTP/1.x" 이고,
+ * 뒤의 경우 HTTP/1.0 응답 머리를 붙여 호스트의 curl/wget 으로 받을 수 있게 한다.
+ */
+static void serve_one(int c, int nodelay) {
+    char *req = (char*)serve_buf, *name, *p, num[16];
+    uint32 n = 0, size, sent = 0, us, peer_ip = 0, retrans = tcp_stats.retransmits + tcp_stats.fast_retransmits;
+    uint16 peer_port = 0;
+    int r, http = 0, fh;
+    uint64 t0;
+
+    sock_set_nodelay(c, nodelay);
+    sock_peer(c, &peer_ip, &peer_port);
+    while (n < MAX_CMD_LEN) {
+        if ((r = sock_recv(c, req + n, MAX_CMD_LEN - n, SERVE_TIMEOUT_MS)) <= 0) break;
+        n += (uint32)r;
+        req[n] = '\0';
+        for (p = req; *p && *p != '\n'; p++) ;
+        if (*p) break;
+    }
+    req[n] = '\0';
+    name = req;
+    if (strncmp(req, "GET ", 4) == 0) {
+        http = 1;
+        name = req + 4;
+        if (*name == '/') name++;
+    }
+    for (p = name; *p && *p != ' ' && *p != '\r' && *p != '\n'; p++) ;
+    *p = '\0';
+
+    inet_print_addr(peer_ip);
+    kprintf(":%u %s: ", (uint32)peer_port, name);
+    if (!*name || (fh = file_open(name, FILE_OPEN_READ)) < 0) {
+        send_str(c, http ? "HTTP/1.0 404 Not Found\r\n\r\n" : "not found\n");
+        sock_close(c);
+        kprint("not found\n");
+        return;
+    }
+    size = file_size(fh);
+    t0 = rdtsc();
+    if (http) {
+        simple_itoa(size, num);
+        send_str(c, "HTTP/1.0 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: ");
+        send_str(c, num);
+        send_str(c, "\r\n\r\n");
+    }
+    /* 블록 캐시 포인터는 양보하는 동안 바뀔 수 있으므로 file_read 로 복사해 보낸다 */
+    while (sent < size && (r = file_read(fh, serve_buf, sizeof(serve_buf))) > 0) {
+        if (sock_send(c, serve_buf, (uint32)r) != r) break;
+        sent += (uint32)r;
+    }
+    file_close(fh);
+    sock_flush(c, SERVE_TIMEOUT_MS);
+    us = cycles_to_us(rdtsc() - t0);
+    sock_close(c);
+    if (us == 0) us = 1;
+    kprintf("%u of %u bytes in %u ms, %u KB/s, %u retransmits\n", sent, size, us / 1000,
+            (uint32)udiv64((uint64)sent * 1000000 / 1024, us),
+            tcp_stats.retransmits + tcp_stats.fast_retransmits - retrans);
+}
+
+void file_serve_cmd(uint16 port, int nodelay) {
+    int sd, c;
+    if (!ne2k_present()) {
+        kprint("fileserve: no NIC\n");
+        return;
+    }
+    if (port == 0) port = TCP_FILE_PORT;
+    if ((sd = sock_listen(port)) < 0) {
+        kprint("fileserve: cannot listen on that port\n");
+        return;
+    }
+    kprint("Serving KnixFS files on ");
+    inet_print_addr(net_ip);
+    kprintf(":%u (Nagle %s), press any key to stop\n", (uint32)port, nodelay ? "off" : "on");
+    while (!kbd_pending()) {
+        if ((c = sock_accept(sd, 0)) >= 0) serve_one(c, nodelay);
+        else sock_wait();
+    }
+    kbd_getchar();
+    sock_close(sd);
+}
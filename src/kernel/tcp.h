@@ -0,0 +1,77 @@
+#ifndef TCP_H
+#define TCP_H
+
+#include "dc.h"
+#include "inet.h"
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_RST 0x04
+#define TCP_PSH 0x08
+#define TCP_ACK 0x10
+
+typedef struct {
+    uint16 sport;
+    uint16 dport;
+    uint32 seq;
+    uint32 ack;
+    uint8 off;                /* 상위 4비트: 헤더 길이 / 4 */
+    uint8 flags;
+    uint16 win;
+    uint16 csum;
+    uint16 urg;
+} __attribute__((packed)) tcp_hdr_t;
+
+typedef struct {
+    uint32 active_opens;
+    uint32 passive_opens;
+    uint32 accept_drops;      /* backlog 가 가득 차 버린 SYN */
+    uint32 segs_in;
+    uint32 segs_out;
+    uint32 bytes_in;
+    uint32 bytes_out;         /* 처음 보낸 데이터 (재전송 제외) */
+    uint32 retransmits;       /* RTO 만료 */
+    uint32 fast_retransmits;  /* 중복 ACK 3 개 */
+    uint32 dup_acks;
+    uint32 delayed_acks;      /* 지연 타이머로 보낸 ACK */
+    uint32 ooo_drops;         /* 순서가 어긋나 버린 세그먼트 (재조립하지 않는다) */
+    uint32 rsts_in;
+    uint32 rsts_out;
+    uint32 bad;               /* 길이/체크섬 오류 */
+    uint32 timeouts;          /* 재전송 한도를 넘어 끊은 연결 */
+} tcp_stats_t;
+
+extern tcp_stats_t tcp_stats;
+
+void tcp_init();
+/* ip_input 이 넘긴다 (m->data 는 IP 헤더). m 을 가진다 */
+void tcp_input(mbuf_t *m, ipv4_hdr_t *ip, uint32 hl);
+/* 지연 ACK, 재전송, TIME_WAIT 타이머 (network_stack_poll 이 부른다) */
+void tcp_timer();
+
+/*
+ * 소켓 API. 소켓은 file_open 의 핸들처럼 작은 정수이고 실패하면 -1.
+ * 기다리는 호출은 네트워크를 직접 폴링하며 (같은 CPU 에 다른 작업이 있으면 양보),
+ * timeout_ms 에 0 을 주면 기다리지 않고 TCP_WAIT_FOREVER 면 끝까지 기다린다.
+ * execbin 프로그램은 진입점이 받는 knix_api 표 (kapi.h) 로 같은 함수를 부른다.
+ */
+int sock_listen(uint16 port);
+int sock_accept(int sd, uint32 timeout_ms);
+int sock_connect(uint32 ip, uint16 port, uint32 timeout_ms);
+/* len 바이트를 모두 송신 버퍼에 넣을 때까지 기다린다. 넣은 바이트, 연결이 끊기면 -1 */
+int sock_send(int sd, const void *buf, uint32 len);
+/* 받은 바이트, 상대가 닫았으면 0, 오류나 시간 초과면 -1 */
+int sock_recv(int sd, void *buf, uint32 len, uint32 timeout_ms);
+/* 보낸 데이터가 모두 ACK 될 때까지 기다린다 (끊기거나 시간 초과면 -1) */
+int sock_flush(int sd, uint32 timeout_ms);
+int sock_peer(int sd, uint32 *ip, uint16 *port);
+/* 남은 데이터를 보내고 FIN. 소켓 번호는 바로 재사용할 수 없게 되고, 연결은 뒤에서 마저 닫힌다 */
+void sock_close(int sd);
+void sock_set_nodelay(int sd, int on);
+/* 네트워크를 한 번 폴링 (기다리는 루프용) */
+void sock_wait();
+
+void tcp_stat_cmd();
+void file_serve_cmd(uint16 port, int nodelay);
+
+#endif //TCP_H
@@ -0,0 +1,66 @@
+#include "timer.h"
+#include "io.h"
+#include "cpu.h"
+#include "type.h"
+#include "idt.h"
+#include "process.h"
+
+/*=========================*/
+/* 11. PIT / TSC 시간 측정 */
+/*=========================*/
+#define PIT_FREQUENCY     1193182
+#define PIT_CH0_DATA      0x40
+#define PIT_CH2_DATA      0x42
+#define PIT_COMMAND       0x43
+#define PIT_CH2_GATE      0x61
+
+uint32 tsc_khz = 0;
+volatile uint32 timer_ticks = 0;
+
+/*
+ * PIT 채널 2를 one-shot 으로 TIMER_CALIBRATE_MS 동안 돌리며 TSC 증가량을 잰다.
+ * 벤치마크 결과를 사이클이 아닌 실제 시간(us, MB/s)으로 보여주기 위해 사용.
+ */
+void timer_calibrate_tsc() {
+    uint32 count = PIT_FREQUENCY * TIMER_CALIBRATE_MS / 1000;
+    uint8 gate = inb(PIT_CH2_GATE);
+
+    outb(PIT_CH2_GATE, (gate & 0xFD) | 0x01);   /* 스피커 off, 게이트 on */
+    outb(PIT_COMMAND, 0xB0);                    /* 채널 2, lo/hi, 모드 0 */
+    outb(PIT_CH2_DATA, count & 0xFF);
+    outb(PIT_CH2_DATA, (count >> 8) & 0xFF);
+
+    uint64 start = rdtsc();
+    while (!(inb(PIT_CH2_GATE) & 0x20)) { }     /* OUT2 가 high 가 될 때까지 */
+    uint64 elapsed = rdtsc() - start;
+
+    outb(PIT_CH2_GATE, gate);
+    tsc_khz = (uint32)udiv64(elapsed, TIMER_CALIBRATE_MS);
+    if (tsc_khz == 0) tsc_khz = 1;
+}
+
+uint32 cycles_to_us(uint64 cycles) {
+    if (tsc_khz == 0) return 0;
+    return (uint32)udiv64(cycles * 1000, tsc_khz);
+}
+
+/* TSC 로 us 만큼 바쁜 대기 (IPI 간격처럼 틱보다 짧은 지연) */
+void timer_delay_us(uint32 us) {
+    uint64 end = rdtsc() + udiv64((uint64)tsc_khz * us, 1000);
+    while (rdtsc() < end) cpu_relax();
+}
+
+static void timer_irq(interrupt_frame_t *frame) {
+    (void)frame;
+    timer_ticks++;
+    sched_tick();
+}
+
+/* PIT 채널 0 을 hz 주기 (모드 2, rate generator) 로 돌려 스케줄러 틱을 만든다 */
+void timer_init(uint32 hz) {
+    uint32 divisor = PIT_FREQUENCY / hz;
+    outb(PIT_COMMAND, 0x34);                    /* 채널 0, lo/hi, 모드 2 */
+    outb(PIT_CH0_DATA, divisor & 0xFF);
+    outb(PIT_CH0_DATA, (divisor >> 8) & 0xFF);
+    irq_register(0, timer_irq);
+}
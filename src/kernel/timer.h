@@ -0,0 +1,14 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "dc.h"
+
+extern uint32 tsc_khz;
+extern volatile uint32 timer_ticks;
+
+void timer_calibrate_tsc();
+void timer_init(uint32 hz);
+uint32 cycles_to_us(uint64 cycles);
+void timer_delay_us(uint32 us);
+
+#endif //TIMER_H
@@ -48,4 +48,12 @@ void simple_itoa(uint32 value, char *buf) {
     int i;
     for (i = 0; i < pos; i++) { buf[i] = temp[pos - i - 1]; }
     buf[pos] = '\0';
-}
\ No newline at end of file
+}
+
+/* libgcc(__udivdi3) 없이 64비트 / 32비트 나눗셈 (divl 두 번) */
+uint64 udiv64(uint64 n, uint32 d) {
+    uint32 hi = (uint32)(n >> 32), lo = (uint32)n;
+    uint32 q_hi = hi / d, rem = hi % d, q_lo;
+    __asm__ ("divl %4" : "=a"(q_lo), "=d"(rem) : "a"(lo), "d"(rem), "rm"(d));
+    return ((uint64)q_hi << 32) | q_lo;
+}
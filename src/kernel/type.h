@@ -10,5 +10,6 @@ int strcmp(const char *s1, const char *s2);
 int strncmp(const char *s1, const char *s2, size_t n);
 uint32 simple_atoi(const char *s);
 void simple_itoa(uint32 value, char *buf);
+uint64 udiv64(uint64 n, uint32 d);
 
 #endif //TYPE_H